@@ -115,6 +115,7 @@ int main()
     int axis3_dim;
     double time_step;
     int steps;
+    int sparse;
     // stringstreams for generating input prompt messages
     std::stringstream ss_radius;
     std::stringstream ss_min_mass;
@@ -147,11 +148,14 @@ int main()
     // get simulation steps and time_step per step
     time_step = get_numeric_value("Input the desired simulation time_step (>= 0.1): ", 0.1, -1.0);
     steps = get_numeric_value("Input the number of steps the simulation should take (>= 1): ", 1, -1);
+
+    // sparse grids only store the occupied cells of large, mostly empty grids
+    sparse = get_numeric_value("Store only the occupied cells (sparse grid)? (0: no, 1: yes): ", 0, 2);
     std::cout << "\n";
 
     // create galaxy using user given parameters
     Galaxy galaxy = Galaxy(time_step, min_mass, max_mass, density,
-                           boundary_radius, axis1_dim, axis2_dim, axis3_dim);
+                           boundary_radius, axis1_dim, axis2_dim, axis3_dim, sparse == 1);
     galaxy.init_galaxy();
     // start simulation
     int error = galaxy.simulation(steps);
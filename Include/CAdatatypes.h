@@ -16,8 +16,20 @@
 #include <unordered_map>
 #include <iostream>
 #include <algorithm> // max_element
-#include <utility>   // pair
+#include <utility>   // pair, declval
 #include <cmath>     // pow
+#include <vector>
+#include <new> // bad_alloc
+#include <cstdint> // uint64_t
+#include <atomic>  // tile queues
+#include <chrono>  // tile costs
+#include <climits> // INT_MAX
+#ifdef ENABLE_OMP
+#include <omp.h>
+#endif
+#ifdef ENABLE_MPI
+#include <mpi.h>
+#endif
 
 // File path of the output data log
 const std::string FILE_PATH = "Data/data.csv";
@@ -69,6 +81,17 @@ namespace CAEnums
         Custom
     };
 
+    /**
+     * @brief enum containing the policies used to schedule the tiles of a step across threads
+     *
+     */
+    enum Schedule
+    {
+        Static,  //!< every thread updates the same share of tiles; no stealing
+        Dynamic, //!< same shares, idle threads steal tiles from the others
+        Balanced //!< shares of equal cost during the previous step, idle threads steal tiles
+    };
+
     /**
      * @brief enum containing the various error codes
      * the CellularAutomata class can return
@@ -85,815 +108,6251 @@ namespace CAEnums
         InvalidNumStates = -7,
         NeighborhoodCellsMalloc = -8,
         CustomRuleIsNull = -9,
-        RadiusLargerThanDimensions = -10
+        RadiusLargerThanDimensions = -10,
+        RuleTableTooLarge = -11,
+        InvalidTileSize = -12,
+        InvalidNumThreads = -13,
+        InvalidNumSteps = -14,
+        InPlaceCellMoved = -15,
+        InvalidDecomposition = -16,
+        InvalidDimensions = -17
     };
 }
 
 /**
- * @brief A base CellularAutomata class that contains non-templated member variables and method definitions
- * from which templated and specialized template classes can inherit.
- * Default values:<br>
- * &emsp;&emsp; boundary_type = CAEnums::Periodic <br>
- * &emsp;&emsp; neighborhood_type = CAEnums::Moore <br>
- * &emsp;&emsp; rule_type = CAEnums::Majority <br>
+ * @brief Non-owning, mdspan-style view of a contiguous cell grid.
+ * The view stores the grid's rank, extents and strides so cells can be addressed
+ * with stride-based indexing and rows/slabs can be walked linearly.
+ *
+ * Row-major layout: the last axis is contiguous (stride 1).
+ *
+ * @tparam T cell type
  */
-class BaseCellularAutomata
+template <typename T>
+class GridView
 {
+private:
+    T *cells;        //!< first cell of the grid
+    int grid_rank;   //!< number of axes (1, 2 or 3)
+    int extents[3];  //!< number of cells along each axis
+    long strides[3]; //!< distance (in cells) between consecutive indices of each axis
+    long total_size; //!< number of cells addressed by the view
+
 public:
-    CAEnums::Boundary boundary_type;         //!< enum code to hold boundary
-    int boundary_radius;                     //!< declare a radius for the boundary
-    CAEnums::Neighborhood neighborhood_type; //!< enum code to hold neighborhood type
-    int num_states;                          //!< integer code for number of states
-    CAEnums::Rule rule_type;                 //!< enum code for rule type
-    int axis1_dim;                           //!< count of cells in first dimension
-    int axis2_dim;                           //!< count of cells in second dimension
-    int axis3_dim;                           //!< count of cells in third dimension
+    /**
+     * @brief Construct an empty view (rank 0, no cells).
+     *
+     */
+    GridView() : cells(nullptr), grid_rank(0), extents{0, 0, 0}, strides{0, 0, 0}, total_size(0) {}
 
     /**
-     * @brief Construct a new Cellular Automata:: Cellular Automata object.
-     * Sets the default value to all class attributes.
+     * @brief Construct a view over a contiguous grid.
      *
+     * @param cells first cell of the grid
+     * @param rank number of axes (1, 2 or 3)
+     * @param extents number of cells along each axis (rank elements are read)
+     * @param strides distance between consecutive indices of each axis (rank elements are read)
      */
-    BaseCellularAutomata();
+    GridView(T *cells, int rank, const int *extents, const long *strides)
+        : cells(cells), grid_rank(rank), extents{0, 0, 0}, strides{0, 0, 0}, total_size(1)
+    {
+        for (int axis = 0; axis < rank; axis++)
+        {
+            this->extents[axis] = extents[axis];
+            this->strides[axis] = strides[axis];
+            total_size *= extents[axis];
+        }
+    }
 
     /**
-     * @brief Destroy the Cellular Automata:: Cellular Automata object.
-     * Deallocates memory reserved for vector/matrix/tensor.
+     * @brief Pointer to the first cell of the grid
      *
+     * @return T*
      */
-    virtual ~BaseCellularAutomata(){};
+    T *data() const { return cells; }
 
     /**
-     * @brief Setup neighborhood with values from enum neighborhood.
+     * @brief Number of axes of the grid
      *
-     * @param neighborhood_type enum value for neighborhood type (VonNeumann or Moore)
-     * @return int error code
+     * @return int
      */
-    int setup_neighborhood(CAEnums::Neighborhood neighborhood_type);
+    int rank() const { return grid_rank; }
 
     /**
-     * @brief Defines the range of cell states to be used in the CA object.
+     * @brief Number of cells along the given axis
      *
-     * @param num_states describes the range of numbers to use for cell states
-     * @return int - error code\n
-     * InvalidNumStates: num_states can't be less than to 2\n
-     * 0: no error
+     * @param axis axis number (0 based)
+     * @return int
      */
-    int setup_cell_states(int num_states);
+    int extent(int axis) const { return extents[axis]; }
 
     /**
-     * @brief Setup the rule choice to specify the rule type to be used in CA object.
+     * @brief Distance (in cells) between consecutive indices of the given axis
      *
-     * @param rule_type enum rule representing the rule type
-     * @return int error code
+     * @param axis axis number (0 based)
+     * @return long
      */
-    int setup_rule(CAEnums::Rule rule_type);
+    long stride(int axis) const { return strides[axis]; }
 
     /**
-     * @brief Prints an error message for the given error code
+     * @brief Number of cells addressed by the view
      *
-     * @param error ErrorCode enum type
+     * @return long
      */
-    void print_error_status(CAEnums::ErrorCode error);
+    long size() const { return total_size; }
+
+    /**
+     * @brief Access a vector (1d) cell
+     *
+     * @param i cell's i-th index
+     * @return T&
+     */
+    T &operator()(int i) const { return cells[i * strides[0]]; }
+
+    /**
+     * @brief Access a matrix (2d) cell
+     *
+     * @param i cell's i-th index
+     * @param j cell's j-th index
+     * @return T&
+     */
+    T &operator()(int i, int j) const { return cells[i * strides[0] + j * strides[1]]; }
+
+    /**
+     * @brief Access a tensor (3d) cell
+     *
+     * @param i cell's i-th index
+     * @param j cell's j-th index
+     * @param k cell's k-th index
+     * @return T&
+     */
+    T &operator()(int i, int j, int k) const
+    {
+        return cells[i * strides[0] + j * strides[1] + k * strides[2]];
+    }
+
+    /**
+     * @brief Contiguous row of a matrix (extent(1) cells)
+     *
+     * @param i row index
+     * @return T*
+     */
+    T *row(int i) const { return cells + i * strides[0]; }
+
+    /**
+     * @brief Contiguous row of a tensor (extent(2) cells)
+     *
+     * @param i slab index
+     * @param j row index within the slab
+     * @return T*
+     */
+    T *row(int i, int j) const { return cells + i * strides[0] + j * strides[1]; }
+
+    /**
+     * @brief Contiguous slab of a tensor (extent(1) * extent(2) cells)
+     *
+     * @param i slab index
+     * @return T*
+     */
+    T *slab(int i) const { return cells + i * strides[0]; }
 };
 
 /**
- * @brief A CellularAutomata class for simulating cellular automata models.
- * This templated class supports structs/class objects or integer states.
- *
- * The object must contain a .state property that the CellularAutomata class updates.<br>
- * The object must have a default constructor or default initialzed values.<br>
- * The object must meet the requirements of CopyConstructible and CopyAssignable (until C++11)MoveConstructible and MoveAssignable (since C++11)<br>
- * The object must have a defined != operator for the comparison of cell states.<br>
+ * @brief Non-owning view of a cell's neighborhood that references the cells
+ * in the current state grid instead of copying them.
+ * Neighbors are listed in the same order as the neighborhood array passed to
+ * custom rules (increasing di, then dj, then dk).
  *
- * If these requirements are not satisfied then the class will produce undefined behavior.
+ * The view is only valid for the duration of the custom rule call.
  *
- * @tparam T : struct/class with a .state property, move operator and assignment operator.<br>
- * @tparam int : when cell states are represented by an integer
+ * @tparam T cell type
  */
 template <typename T>
-class CellularAutomata : public BaseCellularAutomata
+class NeighborhoodView
 {
 private:
-    T *vector;        //!< vector for one dimensional grid of cells
-    T *next_vector;   //!< vector for one dimensional grid of cells holding the next state
-    T **matrix;       //!< pointer to 2d array for grid cells holding a state
-    T **next_matrix;  //!< pointer to 2d array for grid cells holding the next state
-    T ***tensor;      //!< tensor for three dimensional grid of cells
-    T ***next_tensor; //!< tensor for three dimensional grid of cells holding the next state
-    int steps_taken;  //!< the number of steps the CA has taken
+    const T *center;       //!< the cell of interest
+    const long *offsets;   //!< each neighbor's position relative to center
+    const int *coords;     //!< each neighbor's relative index (index_size ints per neighbor)
+    int neighborhood_size; //!< number of neighbors
+    int index_size;        //!< number of indices required to address a cell
 
+public:
     /**
-     * @brief Sets the new_cell_state variable based on the specified rule.
+     * @brief A neighboring cell along with its relative index [di, dj, dk]
      *
-     * @param cell_index cell of interest's index; can be modified for dynamic models
-     * @param index_size size of cell_index array
-     * @param neighborhood_cells flatten array of all neighboring cells
-     * @param neighborhood_size size of neighborhood_cells array
-     * @param new_cell_state reference variable for setting the new state
-     * @param custom_rule function that is called when a Custom rule type is specified
-     *@return int - error code\n
-     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
-     * CustomRuleIsNull: given custom rule function is null\n
-     * 0: no error
      */
-    int set_new_cell_state(int *cell_index, int index_size,
-                           T *neighborhood_cells, int neighborhood_size,
-                           T &new_cell_state, void(custom_rule)(int *, int, T *, int, T &))
+    struct Neighbor
     {
-        int sum = 0;                         // sum of cells within boundary_radius for Parity rule
-        MajorityCounter state_votes_counter; // counter to keep track of votes for Majority rule
-        initialize_majority_rule_counter(state_votes_counter, num_states);
-
-        switch (rule_type)
-        {
-        case CAEnums::Custom:
-            if (vector == nullptr && matrix == nullptr && tensor == nullptr)
-            {
-                new_cell_state.state = -1;
-                return CAEnums::CellsAreNull;
-            }
-            if (custom_rule == nullptr)
-            {
-                new_cell_state.state = -1;
-                return CAEnums::CustomRuleIsNull;
-            }
-            else
-            {
-                // custom_rule should set the new_cell_state
-                custom_rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state);
-            }
-            break;
-        case CAEnums::Parity:
-            for (int i = 0; i < neighborhood_size; i++)
-            {
-                // update sum with current cell value
-                sum += neighborhood_cells[i].state;
-            }
-            new_cell_state.state = sum % num_states; // store the parity state as the new state
-            break;
-        case CAEnums::Majority:
-            for (int i = 0; i < neighborhood_size; i++)
-            {
-                // increment the cell state's number of votes
-                auto it = state_votes_counter.find(neighborhood_cells[i].state);
-                if (it != state_votes_counter.end())
-                {
-                    it->second++;
-                }
-            }
-            // find the max_element in the counter based on the pairs' second variable (number of "votes")
-            auto max_elem = max_element(state_votes_counter.begin(), state_votes_counter.end(),
-                                        less_than_votes);
-            new_cell_state.state = max_elem->first; // set the majority state as the new state
-            break;
-        }
-        return 0;
-    }
+        const T &cell;     //!< the neighboring cell
+        const int *offset; //!< relative index of the neighboring cell (index_size ints)
+    };
 
     /**
-     * @brief Generates an array of neighboring cells and then calls set_new_cell_state to set the state.
-     * This method supports a vector of cell states.
+     * @brief Forward iterator over the neighbors of the view
      *
-     * @param cell_index cell of interest's index; can be modified for dynamic models
-     * @param index_size size of cell_index array
-     * @param new_cell_state reference variable for setting the new state
-     * @param custom_rule function that is called when a Custom rule type is specified
-     *@return int - error code\n
-     * Error codes returned by set_new_cell_state\n
-     * 0: no error
      */
-    int get_state_from_neighborhood_1d(int *cell_index, int index_size, T &new_cell_state,
-                                       void(custom_rule)(int *, int, T *, int, T &))
+    class Iterator
     {
-        int error_code = 0;         // store error code return by other methods
-        int i = cell_index[0];      // get i-th index from array
-        int neighborhood_index = 0; // keep track of neighborhood array as we iterate through CA cells
+    private:
+        const NeighborhoodView *view; //!< view being iterated
+        int n;                        //!< current neighbor number
 
-        // allocate memory and check if operation was successful
-        T *neighborhood_cells = malloc_neighborhood_array(index_size);
-        if (neighborhood_cells == nullptr)
+    public:
+        Iterator(const NeighborhoodView *view, int n) : view(view), n(n) {}
+        Neighbor operator*() const { return Neighbor{(*view)[n], view->offset(n)}; }
+        Iterator &operator++()
         {
-            return CAEnums::NeighborhoodCellsMalloc;
+            n++;
+            return *this;
         }
+        bool operator!=(const Iterator &other) const { return n != other.n; }
+        bool operator==(const Iterator &other) const { return n == other.n; }
+    };
 
-        // VonNeumann and Moore do not differ for 1d (vector) case
-        switch (boundary_type)
-        {
-        case CAEnums::Periodic:
-            generate_periodic_neighborhood_1d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        case CAEnums::Walled: // with walled boundaries the edge cells never change
-            // check if i is a boundary cell
-            if (i == 0 || i == axis1_dim - 1)
-            {
-                new_cell_state = vector[i]; // keep boundary cell state
-                break;
-            }
-            // fall-through to CutOff case when cell isn't a boundary cell
-        case CAEnums::CutOff:
-            generate_cutoff_neighborhood_1d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        }
-        delete[] neighborhood_cells;
-        return error_code;
+    /**
+     * @brief Construct a neighborhood view.
+     *
+     * @param center the cell of interest
+     * @param offsets each neighbor's position relative to center
+     * @param coords each neighbor's relative index (index_size ints per neighbor)
+     * @param neighborhood_size number of neighbors
+     * @param index_size number of indices required to address a cell
+     */
+    NeighborhoodView(const T *center, const long *offsets, const int *coords, int neighborhood_size,
+                     int index_size)
+        : center(center), offsets(offsets), coords(coords), neighborhood_size(neighborhood_size),
+          index_size(index_size)
+    {
     }
 
     /**
-     * @brief Generates an array of neighboring cells and then calls set_new_cell_state to set the state.
-     * This method supports a matrix of cell states.
+     * @brief Number of neighbors (the cell of interest included)
      *
-     * @param cell_index cell of interest's index; can be modified for dynamic models
-     * @param index_size size of cell_index array
-     * @param new_cell_state reference variable for setting the new state
-     * @param custom_rule function that is called when a Custom rule type is specified
-     *@return int - error code\n
-     * Error codes returned by set_new_cell_state\n
-     * 0: no error
+     * @return int
      */
-    int get_state_from_neighborhood_2d(int *cell_index, int index_size, T &new_cell_state,
-                                       void(custom_rule)(int *, int, T *, int, T &))
-    {
-        int error_code = 0;         // store error code return by other methods
-        int i = cell_index[0];      // get i-th index from array
-        int j = cell_index[1];      // get j-th index from array
-        int neighborhood_index = 0; // keep track of neighborhood array as we iterate through CA cells
+    int size() const { return neighborhood_size; }
 
-        // allocate memory and check if operation was successful
-        T *neighborhood_cells = malloc_neighborhood_array(index_size);
-        if (neighborhood_cells == nullptr)
-        {
-            return CAEnums::NeighborhoodCellsMalloc;
-        }
+    /**
+     * @brief Number of indices required to address a cell
+     *
+     * @return int
+     */
+    int rank() const { return index_size; }
 
-        switch (boundary_type)
-        {
-        case CAEnums::Periodic:
-            generate_periodic_neighborhood_2d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        case CAEnums::Walled: // with walled boundaries the edge cells never change
-            // check if i,j is a boundary cell
-            if ((i == 0 || i == axis1_dim - 1) || (j == 0 || j == axis2_dim - 1))
-            {
-                new_cell_state = matrix[i][j]; // keep boundary cell state
-                break;
-            }
-            // fall-through to CutOff case when cell isn't a boundary cell
-        case CAEnums::CutOff:
-            generate_cutoff_neighborhood_2d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        }
-        delete[] neighborhood_cells;
-        return error_code;
-    }
+    /**
+     * @brief Access the n-th neighbor
+     *
+     * @param n neighbor number
+     * @return const T&
+     */
+    const T &operator[](int n) const { return center[offsets[n]]; }
 
     /**
-     * @brief Generates an array of neighboring cells and then calls set_new_cell_state to set the state.
-     * This method supports a tensor of cell states.
+     * @brief Relative index [di, dj, dk] of the n-th neighbor (rank() ints)
      *
-     * @param cell_index cell of interest's index; can be modified for dynamic models
-     * @param index_size size of cell_index array
-     * @param new_cell_state reference variable for setting the new state
-     * @param custom_rule function that is called when a Custom rule type is specified
-     *@return int - error code\n
-     * Error codes returned by set_new_cell_state\n
-     * 0: no error
+     * @param n neighbor number
+     * @return const int*
      */
-    int get_state_from_neighborhood_3d(int *cell_index, int index_size, T &new_cell_state,
-                                       void(custom_rule)(int *, int, T *, int, T &))
-    {
-        int error_code = 0;         // store error code return by other methods
-        int i = cell_index[0];      // get i-th index from array
-        int j = cell_index[1];      // get j-th index from array
-        int k = cell_index[2];      // get k-th index from array
-        int neighborhood_index = 0; // keep track of neighborhood array as we iterate through CA cells
+    const int *offset(int n) const { return coords + n * index_size; }
 
-        // allocate memory and check if operation was successful
-        T *neighborhood_cells = malloc_neighborhood_array(index_size); // index_size == rank
-        if (neighborhood_cells == nullptr)
-        {
-            return CAEnums::NeighborhoodCellsMalloc;
-        }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, neighborhood_size); }
+};
 
-        switch (boundary_type)
-        {
-        case CAEnums::Periodic:
-            generate_periodic_neighborhood_3d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        case CAEnums::Walled:
-            // check if i,j,k is a boundary cell
-            if ((i == 0 || i == axis1_dim - 1) || (j == 0 || j == axis2_dim - 1) || (k == 0 || j == axis3_dim - 1))
-            {
-                // with walled boundaries the edge cells never change
-                new_cell_state = tensor[i][j][k]; // keep boundary cell state
-                break;
-            }
-            // fall-through to CutOff case when cell isn't a boundary cell
-        case CAEnums::CutOff:
-            generate_cutoff_neighborhood_3d(cell_index, neighborhood_cells, neighborhood_index);
-            error_code = set_new_cell_state(cell_index, index_size, neighborhood_cells, neighborhood_index, new_cell_state, custom_rule);
-            break;
-        }
-        delete[] neighborhood_cells;
-        return error_code;
-    }
+/**
+ * @brief Precomputed geometry of a VonNeumann or Moore neighborhood.
+ * Built once per grid/radius/neighborhood configuration and shared by every cell.
+ * Neighbors are listed in the same order as the neighborhood array passed to
+ * custom rules (increasing di, then dj, then dk); the cell of interest is included.
+ */
+class NeighborhoodStencil
+{
+public:
+    int rank;                                //!< number of axes of the grid (0 while not built)
+    int radius;                              //!< neighborhood radius
+    CAEnums::Neighborhood neighborhood_type; //!< neighborhood type
+    long strides[3];                         //!< grid strides used for the linear offsets
+    std::vector<long> offsets;               //!< each neighbor's linear offset from the cell of interest
+    std::vector<int> coords;                 //!< each neighbor's relative index (rank ints per neighbor)
 
     /**
-     * @brief Adds periodic neighboring cell state to neighborhood_cells array.
-     * Handles vector (1d) case.
+     * @brief Construct an empty stencil (rank 0, no neighbors).
      *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
      */
-    void generate_periodic_neighborhood_1d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
-    {
-        int i = cell_index[0]; // get i-th index from array
-        int periodic_i;        // axis1_dim index used by Periodic boundary type
+    NeighborhoodStencil();
 
-        for (int di = -boundary_radius; di <= boundary_radius; di++)
-        {
-            periodic_i = get_periodic_index(i, di, axis1_dim);
-            // add state to flattened array
-            neighborhood_cells[neighborhood_index] = vector[periodic_i];
-            neighborhood_index++;
-        }
-    }
+    /**
+     * @brief Computes the offsets and relative indices of every neighbor.
+     *
+     * @param rank number of axes of the grid
+     * @param radius neighborhood radius
+     * @param neighborhood_type VonNeumann or Moore
+     * @param strides grid strides (rank elements are read)
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the stencil\n
+     * 0: no error
+     */
+    int build(int rank, int radius, CAEnums::Neighborhood neighborhood_type, const long *strides);
 
     /**
-     * @brief Adds cutoff neighboring cell state to neighborhood_cells array.
-     * Handles vector (1d) case.
+     * @brief Determines if the stencil was built for the given configuration.
      *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
+     * @param rank number of axes of the grid
+     * @param radius neighborhood radius
+     * @param neighborhood_type VonNeumann or Moore
+     * @param strides grid strides (rank elements are read)
+     * @return true: stencil is up to date
+     * @return false: stencil needs to be rebuilt
      */
-    void generate_cutoff_neighborhood_1d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
-    {
-        int i = cell_index[0]; // get i-th index from array
-        int neighbor_i;        // neighboring cell's i-th index
+    bool matches(int rank, int radius, CAEnums::Neighborhood neighborhood_type, const long *strides) const;
 
-        for (int di = -boundary_radius; di <= boundary_radius; di++)
-        {
-            neighbor_i = di + i;
-            // exclude cells that are out of bounds
-            if (neighbor_i <= 0 || neighbor_i >= axis1_dim)
-            {
-                // outside bounds; don't include cell state in the sum/counter
-                continue;
-            }
-            // add state to flattened array
-            neighborhood_cells[neighborhood_index] = vector[di];
-            neighborhood_index++;
-        }
-    }
+    /**
+     * @brief Number of neighbors (the cell of interest included)
+     *
+     * @return int
+     */
+    int size() const { return offsets.size(); }
 
     /**
-     * @brief Adds periodic neighboring cell state to neighborhood_cells array.
-     * Handles matrix (2d) case.
+     * @brief Relative index [di, dj, dk] of the n-th neighbor (rank ints)
      *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
+     * @param n neighbor number
+     * @return const int*
      */
-    void generate_periodic_neighborhood_2d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
-    {
-        int i = cell_index[0]; // get i-th index from array
-        int j = cell_index[1]; // get j-th index from array
-        int periodic_i;        // axis1_dim index used by Periodic boundary type
-        int periodic_j;        // axis2_dim index used by Periodic boundary type
+    const int *coord(int n) const { return coords.data() + n * rank; }
+};
 
-        if (neighborhood_type == CAEnums::VonNeumann)
-        {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                periodic_i = get_periodic_index(i, di, axis1_dim);
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    // exclude diagonal cells from neighborhood when VonNeumann is selected
-                    if (is_diagonal_neighboring_cell_2d(di, dj))
-                    {
-                        // current di,dj cell is a diagonal neighbor so exclude it
-                        continue;
-                    }
-                    periodic_j = get_periodic_index(j, dj, axis2_dim);
-                    // add state to flattened array
-                    neighborhood_cells[neighborhood_index] = matrix[periodic_i][periodic_j];
-                    neighborhood_index++;
-                }
-            }
-        }
-        else // Moore neighborhood
-        {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                periodic_i = get_periodic_index(i, di, axis1_dim);
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    periodic_j = get_periodic_index(j, dj, axis2_dim);
-                    // add state to flattened array
-                    neighborhood_cells[neighborhood_index] = matrix[periodic_i][periodic_j];
-                    neighborhood_index++;
-                }
-            }
-        }
-    }
+/**
+ * @brief Compile-time geometry of a neighborhood: size and relative index of every neighbor,
+ * in the order of NeighborhoodStencil (increasing di, then dj, then dk).
+ *
+ * @tparam Rank number of axes of the grid
+ * @tparam Radius neighborhood radius
+ * @tparam Type VonNeumann or Moore
+ */
+template <int Rank, int Radius, CAEnums::Neighborhood Type>
+struct StencilGeometry
+{
+    static constexpr int width = 2 * Radius + 1; //!< cells along each axis of a Moore box
 
     /**
-     * @brief Adds cutoff neighboring cell state to neighborhood_cells array.
-     * Handles matrix (2d) case.
-     *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
+     * @brief Number of neighbors (cell of interest included) of a neighborhood with rank axes.
      */
-    void generate_cutoff_neighborhood_2d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
+    static constexpr int size_of(int rank)
     {
-        int i = cell_index[0]; // get i-th index from array
-        int j = cell_index[1]; // get j-th index from array
-        int neighbor_i;        // neighboring cell's i-th index
-        int neighbor_j;        // neighboring cell's j-th index
+        return Type == CAEnums::Moore ? (rank == 0 ? 1 : width * size_of(rank - 1))
+                                      : 2 * rank * Radius + 1;
+    }
+
+    static constexpr int size = size_of(Rank); //!< number of neighbors
+
+    /**
+     * @brief Relative index along axis of the n-th neighbor of a neighborhood with rank axes
+     * (axis 0 being the first of those axes).
+     */
+    static constexpr int coord(int rank, int n, int axis)
+    {
+        return Type == CAEnums::Moore ? moore_coord(rank, n, axis) : cross_coord(rank, n, axis);
+    }
+
+    /**
+     * @brief Moore boxes: the digits of n in base width.
+     */
+    static constexpr int moore_coord(int rank, int n, int axis)
+    {
+        return axis == 0 ? n / size_of(rank - 1) - Radius
+                         : moore_coord(rank - 1, n % size_of(rank - 1), axis - 1);
+    }
+
+    /**
+     * @brief VonNeumann crosses: the first Radius neighbors lie before the cell along the first axis,
+     * then comes the cross of the remaining axes, then the Radius neighbors after the cell.
+     */
+    static constexpr int cross_coord(int rank, int n, int axis)
+    {
+        return n < Radius ? (axis == 0 ? n - Radius : 0)
+               : n >= Radius + size_of(rank - 1) ? (axis == 0 ? n - Radius - size_of(rank - 1) + 1 : 0)
+               : axis == 0 ? 0
+                           : cross_coord(rank - 1, n - Radius, axis - 1);
+    }
+
+    /**
+     * @brief Relative index along axis of the n-th neighbor; 0 along unused axes.
+     */
+    static constexpr int neighbor_coord(int n, int axis)
+    {
+        return axis < Rank ? coord(Rank, n, axis) : 0;
+    }
+};
+
+/**
+ * @brief Interior neighborhood gather with the rank, radius and neighborhood type fixed at compile time.
+ * The gather is unrolled by template recursion, one statement per neighbor, and every
+ * relative index is a constant; only the grid's strides are read at run time.
+ *
+ * @tparam Rank number of axes of the grid
+ * @tparam Radius neighborhood radius
+ * @tparam Type VonNeumann or Moore
+ * @tparam N first neighbor copied by this step of the recursion
+ */
+template <int Rank, int Radius, CAEnums::Neighborhood Type,
+          int N = 0, bool Done = (N == StencilGeometry<Rank, Radius, Type>::size)>
+struct StencilKernel
+{
+    /**
+     * @brief Copies the neighbors of an interior cell into neighborhood_cells.
+     *
+     * @param center cell of interest
+     * @param stencil stencil built for the grid (only its strides are read)
+     * @param neighborhood_cells array receiving the neighbors
+     * @return int - number of neighbors
+     */
+    template <typename T>
+    static int gather(const T *center, const NeighborhoodStencil &stencil, T *neighborhood_cells)
+    {
+        typedef StencilGeometry<Rank, Radius, Type> Geometry;
+        neighborhood_cells[N] = center[Geometry::neighbor_coord(N, 0) * stencil.strides[0] +
+                                       Geometry::neighbor_coord(N, 1) * stencil.strides[1] +
+                                       Geometry::neighbor_coord(N, 2) * stencil.strides[2]];
+        return StencilKernel<Rank, Radius, Type, N + 1>::gather(center, stencil, neighborhood_cells);
+    }
+};
+
+/**
+ * @brief End of the StencilKernel recursion.
+ */
+template <int Rank, int Radius, CAEnums::Neighborhood Type, int N>
+struct StencilKernel<Rank, Radius, Type, N, true>
+{
+    template <typename T>
+    static int gather(const T *, const NeighborhoodStencil &, T *)
+    {
+        return N;
+    }
+};
+
+/**
+ * @brief Interior neighborhood gather for any rank, radius and neighborhood type;
+ * reads the stencil's offset table (fallback of the StencilKernel family).
+ */
+struct RuntimeStencilKernel
+{
+    /**
+     * @brief Copies the neighbors of an interior cell into neighborhood_cells.
+     *
+     * @param center cell of interest
+     * @param stencil stencil built for the grid
+     * @param neighborhood_cells array receiving the neighbors
+     * @return int - number of neighbors
+     */
+    template <typename T>
+    static int gather(const T *center, const NeighborhoodStencil &stencil, T *neighborhood_cells)
+    {
+        const long *offsets = stencil.offsets.data();
+        int stencil_size = stencil.size();
+        for (int n = 0; n < stencil_size; n++)
+        {
+            neighborhood_cells[n] = center[offsets[n]];
+        }
+        return stencil_size;
+    }
+};
+
+/**
+ * @brief Custom rule materialized into a lookup table: the next state of the cell of interest
+ * for every configuration of a full neighborhood over num_states states.
+ * A configuration's key is its neighbors' states read as a base num_states number
+ * (first neighbor most significant), in the order of NeighborhoodStencil.
+ *
+ * @tparam T cell type
+ */
+template <typename T>
+class RuleTable
+{
+public:
+    void (*rule)(int *, int, T *, int, T &); //!< materialized custom rule (nullptr while not set up)
+    int num_states;                          //!< number of cell states the table covers
+    int rank;                                //!< number of axes the table was built for (0 while not built)
+    int radius;                              //!< neighborhood radius the table was built for
+    CAEnums::Neighborhood neighborhood_type; //!< neighborhood type the table was built for
+    int neighborhood_size;                   //!< number of neighbors (digits) of every key
+    std::vector<T> next_states;              //!< next state of the cell of interest of every key
+
+    /**
+     * @brief Construct an empty table (no rule).
+     *
+     */
+    RuleTable() : rule(nullptr), num_states(0), rank(0), radius(0),
+                  neighborhood_type(CAEnums::Moore), neighborhood_size(0) {}
+
+    /**
+     * @brief Evaluates the rule once for every configuration of a full neighborhood.
+     * The rule gets a zero cell_index, and new_cell_state initially holds the cell of interest.
+     *
+     * @param rank number of axes of the grid
+     * @param radius neighborhood radius
+     * @param neighborhood_type VonNeumann or Moore
+     * @param neighborhood_size number of neighbors of a full neighborhood
+     * @return int - error code\n
+     * RuleTableTooLarge: num_states ^ neighborhood_size is larger than RULE_TABLE_MAX_SIZE\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the table\n
+     * 0: no error
+     */
+    int build(int rank, int radius, CAEnums::Neighborhood neighborhood_type, int neighborhood_size)
+    {
+        long table_size = 1;
+        for (int n = 0; n < neighborhood_size; n++)
+        {
+            table_size *= num_states;
+            if (table_size > RULE_TABLE_MAX_SIZE)
+            {
+                return CAEnums::RuleTableTooLarge;
+            }
+        }
+        std::vector<T> neighborhood_cells(neighborhood_size, T());
+        try
+        {
+            next_states.assign(table_size, T());
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+
+        int cell_index[3] = {0, 0, 0};
+        for (long key = 0; key < table_size; key++)
+        {
+            T new_cell_state = neighborhood_cells[neighborhood_size / 2];
+            rule(cell_index, rank, neighborhood_cells.data(), neighborhood_size, new_cell_state);
+            next_states[key] = new_cell_state;
+
+            // next configuration: increment the last neighbor and carry
+            for (int n = neighborhood_size - 1; n >= 0; n--)
+            {
+                int state = get_cell_state(neighborhood_cells[n]) + 1;
+                set_cell_state(neighborhood_cells[n], state == num_states ? 0 : state);
+                if (state != num_states)
+                {
+                    break;
+                }
+            }
+        }
+        this->rank = rank;
+        this->radius = radius;
+        this->neighborhood_type = neighborhood_type;
+        this->neighborhood_size = neighborhood_size;
+        return 0;
+    }
+
+    /**
+     * @brief Determines if the table was built for the given configuration.
+     *
+     * @param rank number of axes of the grid
+     * @param radius neighborhood radius
+     * @param neighborhood_type VonNeumann or Moore
+     * @return true: table is up to date
+     * @return false: table needs to be rebuilt
+     */
+    bool matches(int rank, int radius, CAEnums::Neighborhood neighborhood_type) const
+    {
+        return this->rank == rank && this->radius == radius && this->neighborhood_type == neighborhood_type;
+    }
+};
+
+/**
+ * @brief Work-stealing scheduler of the tiles a step is split into.
+ * Before every step, the tiles are split into one contiguous range per thread, so that every range
+ * has about the same cost, using the time each tile took during the previous step.
+ * Threads update the tiles of their own range from the front and, once it is empty,
+ * steal tiles from the back of the other threads' ranges, one at a time.
+ */
+class TileScheduler
+{
+public:
+    /**
+     * @brief Range [head, tail) of the tiles left to a thread, packed into one word
+     * (head in the high 32 bits) so that its owner and thieves update it with one compare-and-swap.
+     */
+    struct TileQueue
+    {
+        std::atomic<uint64_t> range; //!< packed [head, tail) range of tiles
+        char padding[56];            //!< keeps the queues of different threads on different cache lines
+
+        TileQueue() : range(0) {}
+        TileQueue(const TileQueue &other) : range(other.range.load()) {}
+        TileQueue &operator=(const TileQueue &other)
+        {
+            range.store(other.range.load());
+            return *this;
+        }
+    };
+
+    std::vector<double> tile_costs; //!< seconds each tile took during the previous step
+
+    /**
+     * @brief Construct a scheduler without tiles.
+     *
+     */
+    TileScheduler();
+
+    /**
+     * @brief Splits the tiles [0, num_tiles) into one contiguous range per thread: ranges of about
+     * the same cost (Balanced) or the same number of tiles (Static, Dynamic).
+     * Resets the costs to a uniform estimate when the number of tiles changed since the previous step.
+     *
+     * @param num_tiles number of tiles of the step
+     * @param num_threads number of threads updating the tiles
+     * @param schedule scheduling policy
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the queues\n
+     * 0: no error
+     */
+    int plan(long num_tiles, int num_threads, CAEnums::Schedule schedule = CAEnums::Balanced);
+
+    /**
+     * @brief Takes the next tile of a thread: the front of its own range or, once the range is empty,
+     * the back of another thread's range (except with the Static schedule).
+     *
+     * @param thread thread number (0 based)
+     * @param tile the tile taken
+     * @return true: a tile was taken
+     * @return false: every tile was taken
+     */
+    bool next_tile(int thread, long &tile);
+
+    /**
+     * @brief Runs update_tile(tile) once for every tile planned by plan, from num_threads threads
+     * when OpenMP is enabled, and records how long each tile took (Balanced schedule).
+     * Each thread keeps the error code of its own tiles and the codes are reduced once the tiles
+     * are done; once a tile returns an error, threads stop taking tiles.
+     *
+     * @param update_tile callable returning an error code
+     * @return int - error code\n
+     * Lowest error code returned by update_tile\n
+     * 0: no error
+     */
+    template <typename TileUpdate>
+    int run(TileUpdate &update_tile)
+    {
+        int error_code = 0;
+        std::atomic<bool> failed(false); // a tile returned an error; only written on errors
+        // updates a tile and records its cost
+        auto run_tile = [this, &update_tile](long tile) -> int
+        {
+            std::chrono::steady_clock::time_point start;
+            if (timing)
+            {
+                start = std::chrono::steady_clock::now();
+            }
+            int tile_error = update_tile(tile);
+            if (timing)
+            {
+                tile_costs[tile] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            return tile_error;
+        };
+#ifdef ENABLE_OMP
+#pragma omp parallel num_threads(num_threads) reduction(min : error_code)
+#endif
+        {
+#ifdef ENABLE_OMP
+            int thread = omp_get_thread_num();
+            int team_size = omp_get_num_threads();
+#else
+            int thread = 0;
+            int team_size = 1;
+#endif
+            long tile;
+            int thread_error = 0; // error code of this thread's tiles
+            // own range, plus the ranges of the threads missing from a smaller team than planned
+            for (int queue = thread; queue < num_threads && thread_error == 0; queue += team_size)
+            {
+                while (!failed.load(std::memory_order_relaxed) && pop_tile(queues[queue], true, tile))
+                {
+                    thread_error = run_tile(tile);
+                    if (thread_error < 0)
+                    {
+                        failed.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            }
+            while (stealing && thread_error == 0 && !failed.load(std::memory_order_relaxed) && steal_tile(thread, tile))
+            {
+                thread_error = run_tile(tile);
+                if (thread_error < 0)
+                {
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+            error_code = std::min(error_code, thread_error);
+        }
+        return error_code;
+    }
+
+private:
+    std::vector<TileQueue> queues; //!< tiles left to each thread
+    int num_threads;               //!< number of threads of the current plan
+    bool stealing;                 //!< idle threads take tiles from the other queues
+    bool timing;                   //!< record the cost of every tile
+
+    /**
+     * @brief Takes the tile at the front (own range) or the back (stolen) of a queue.
+     *
+     * @param queue queue to take the tile from
+     * @param front take the front tile instead of the back one
+     * @param tile the tile taken
+     * @return true: a tile was taken
+     * @return false: the queue is empty
+     */
+    static bool pop_tile(TileQueue &queue, bool front, long &tile);
+
+    /**
+     * @brief Takes the tile at the back of the first non-empty range of the other threads.
+     *
+     * @param thread thread number (0 based)
+     * @param tile the tile taken
+     * @return true: a tile was taken
+     * @return false: every other range is empty
+     */
+    bool steal_tile(int thread, long &tile);
+};
+
+/**
+ * @brief A base CellularAutomata class that contains non-templated member variables and method definitions
+ * from which templated and specialized template classes can inherit.
+ * Default values:<br>
+ * &emsp;&emsp; boundary_type = CAEnums::Periodic <br>
+ * &emsp;&emsp; neighborhood_type = CAEnums::Moore <br>
+ * &emsp;&emsp; rule_type = CAEnums::Majority <br>
+ * &emsp;&emsp; num_threads = CA_NUM_THREADS environment variable, or 0 (OpenMP default) <br>
+ * &emsp;&emsp; schedule = CA_SCHEDULE environment variable (static, dynamic or balanced), or CAEnums::Balanced <br>
+ * &emsp;&emsp; pin_threads = true if the CA_PIN_THREADS environment variable is 1, or false <br>
+ */
+class BaseCellularAutomata
+{
+public:
+    CAEnums::Boundary boundary_type;         //!< enum code to hold boundary
+    int boundary_radius;                     //!< declare a radius for the boundary
+    CAEnums::Neighborhood neighborhood_type; //!< enum code to hold neighborhood type
+    int num_states;                          //!< integer code for number of states
+    CAEnums::Rule rule_type;                 //!< enum code for rule type
+    int axis1_dim;                           //!< count of cells in first dimension
+    int axis2_dim;                           //!< count of cells in second dimension
+    int axis3_dim;                           //!< count of cells in third dimension
+    int num_threads;                         //!< threads running a step (0: OpenMP default); see setup_threads
+    CAEnums::Schedule schedule;              //!< policy scheduling the tiles of a step across threads
+    bool pin_threads;                        //!< pin the step threads to the CPUs of one socket each
+
+    /**
+     * @brief Construct a new Cellular Automata:: Cellular Automata object.
+     * Sets the default value to all class attributes.
+     *
+     */
+    BaseCellularAutomata();
+
+    /**
+     * @brief Destroy the Cellular Automata:: Cellular Automata object.
+     * Deallocates memory reserved for vector/matrix/tensor.
+     *
+     */
+    virtual ~BaseCellularAutomata(){};
+
+    /**
+     * @brief Setup neighborhood with values from enum neighborhood.
+     *
+     * @param neighborhood_type enum value for neighborhood type (VonNeumann or Moore)
+     * @return int error code
+     */
+    int setup_neighborhood(CAEnums::Neighborhood neighborhood_type);
+
+    /**
+     * @brief Defines the range of cell states to be used in the CA object.
+     *
+     * @param num_states describes the range of numbers to use for cell states
+     * @return int - error code\n
+     * InvalidNumStates: num_states can't be less than to 2\n
+     * 0: no error
+     * @note uint8_t and uint16_t cells hold fewer states in less memory. Parity and Majority steps sum
+     * them in uint16_t lanes when the sums fit; other rules still compute in int.
+     */
+    int setup_cell_states(int num_states);
+
+    /**
+     * @brief Setup the rule choice to specify the rule type to be used in CA object.
+     *
+     * @param rule_type enum rule representing the rule type
+     * @return int error code
+     * @note With two cell states, Parity steps run on bit-packed cells for every boundary but Majority steps
+     * only with Periodic boundaries (CutOff/Walled neighborhoods shrink near the edges, which changes the
+     * majority threshold); other Majority grids step through the neighborhood sums. While packed, integer
+     * grids release their cell buffers until the cells are read again.
+     */
+    int setup_rule(CAEnums::Rule rule_type);
+
+    /**
+     * @brief Sets the number of threads running the steps of this CA object (OpenMP builds;
+     * sequential builds always use one thread). Idle threads wait between steps according to
+     * the OpenMP runtime (OMP_WAIT_POLICY); their placement follows OMP_PROC_BIND/OMP_PLACES.
+     *
+     * @param num_threads number of threads; 0 uses the OpenMP default (OMP_NUM_THREADS or the number of cores)
+     * @return int - error code\n
+     * InvalidNumThreads: num_threads can't be negative\n
+     * 0: no error
+     */
+    int setup_threads(int num_threads);
+
+    /**
+     * @brief Sets the policy scheduling the tiles of a step across threads.
+     *
+     * @param schedule Static, Dynamic or Balanced
+     * @return int error code
+     */
+    int setup_schedule(CAEnums::Schedule schedule);
+
+    /**
+     * @brief Pins the threads running the steps to CPU sockets (OpenMP builds on Linux): consecutive
+     * threads share a socket and each thread may run on any CPU of its socket. Threads keep the slabs
+     * of the grid they first touched on their socket's memory (see allocate_cells); set this before
+     * setup_dimensions_* and use the Static schedule to keep every thread on its own slab.
+     * The OpenMP worker threads are shared by the whole program, so the pinning also applies to
+     * other parallel regions and to the thread calling step.
+     *
+     * @param pin_threads pin the threads (true) or leave them to the OpenMP runtime (false)
+     * @return int error code
+     */
+    int setup_thread_pinning(bool pin_threads);
+
+    /**
+     * @brief Number of threads running the parallel loops of a step (see setup_threads).
+     *
+     * @return int
+     */
+    int get_step_threads() const
+    {
+#ifdef ENABLE_OMP
+        return num_threads > 0 ? num_threads : omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    /**
+     * @brief Prints an error message for the given error code
+     *
+     * @param error ErrorCode enum type
+     */
+    void print_error_status(CAEnums::ErrorCode error);
+};
+
+/**
+ * @brief A CellularAutomata class for simulating cellular automata models.
+ * This templated class supports structs/class objects or integer states.
+ *
+ * The object must contain a .state property that the CellularAutomata class updates.<br>
+ * The object must have a default constructor or default initialzed values.<br>
+ * The object must meet the requirements of CopyConstructible and CopyAssignable (until C++11)MoveConstructible and MoveAssignable (since C++11)<br>
+ * The object must have a defined != operator for the comparison of cell states.<br>
+ *
+ * If these requirements are not satisfied then the class will produce undefined behavior.
+ *
+ * @tparam T : struct/class with a .state property, move operator and assignment operator.<br>
+ * @tparam int : when cell states are represented by an integer
+ * @tparam uint8_t, uint16_t : when cell states are represented by a narrow integer (fewer bytes per cell).
+ * Parity and Majority steps accumulate the neighborhood sums and votes of each block in uint16_t lanes,
+ * twice as many per register as int, whenever they fit (see has_narrow_cells); other rules widen to int.
+ */
+template <typename T>
+class SparseGrid; // storage of sparse grids (see CellularAutomata::setup_sparse), defined in CAsparse.h
+
+template <typename T>
+class CellularAutomata : public BaseCellularAutomata
+{
+private:
+    T *cell_buffer;           //!< aligned buffer holding every cell of the current state (ghost layers included)
+    T *next_cell_buffer;      //!< aligned buffer holding every cell of the next state (ghost layers included)
+    long buffer_size;         //!< number of cells in each of the cell_buffer/next_cell_buffer buffers
+    int ghost_width;          //!< number of ghost layers padding each side of every axis
+    bool use_ghost_cells;     //!< pad the grid with boundary_radius ghost layers (see setup_ghost_cells)
+    bool ghost_neighborhoods; //!< neighborhoods of the current step can be read through the ghost layers
+    T *cells;                 //!< cell [0, 0, 0] of the current state inside cell_buffer
+    T *next_cells;            //!< cell [0, 0, 0] of the next state inside next_cell_buffer
+    long num_cells;           //!< number of cells of the grid (ghost layers excluded)
+    int rank;                 //!< number of axes of the grid (0 while the grid is not set up)
+    long strides[3];          //!< distance (in cells) between consecutive indices of each axis
+    T *vector;                //!< vector for one dimensional grid of cells (aliases cells)
+    T *next_vector;           //!< vector for one dimensional grid of cells holding the next state (aliases next_cells)
+    T **matrix;               //!< row pointers into cells for the 2d grid of cells holding a state
+    T **next_matrix;          //!< row pointers into next_cells for the 2d grid of cells holding the next state
+    T ***tensor;              //!< row pointers into cells for the three dimensional grid of cells
+    T ***next_tensor;         //!< row pointers into next_cells for the three dimensional grid of cells holding the next state
+    int steps_taken;          //!< the number of steps the CA has taken
+    bool in_place;            //!< update the cells in place without a next state buffer (see setup_in_place)
+    int global_axis1_dim;     //!< size of the first axis of the whole grid (axis1_dim: this process' slabs and halos)
+    int first_owned_slab;     //!< index along the first axis of the whole grid of this process' first slab
+    int lower_halo;           //!< number of halo slabs before this process' slabs (see exchange_halos)
+    int upper_halo;           //!< number of halo slabs after this process' slabs
+    int first_updated_slab;   //!< first slab along the first axis updated by the current step phase
+    int last_updated_slab;    //!< one past the last slab along the first axis updated by the current step phase
+    bool halos_exchanged;     //!< the halo slabs hold the current state (see exchange_halos)
+#ifdef ENABLE_MPI
+    enum MessageTag
+    {
+        HaloTagUp = 1, //!< edge slabs sent to the next process
+        HaloTagDown,   //!< edge slabs sent to the previous process
+        MovedTagUp,    //!< moved cells sent to the next process
+        MovedTagDown   //!< moved cells sent to the previous process
+    };
+    MPI_Comm comm;                //!< processes the grid is split across (MPI_COMM_NULL: not split); see setup_mpi
+    int comm_rank;                //!< this process' rank in comm
+    int comm_size;                //!< number of processes in comm
+    MPI_Datatype cell_type;       //!< one cell (sizeof(T) bytes) so message counts are in cells
+    MPI_Request halo_requests[4]; //!< pending sends and receives of the halo exchange
+    int num_halo_requests;        //!< number of pending halo_requests
+    std::vector<T> moved_cells;   //!< cells moved into the halo slabs of the neighboring processes
+#endif
+
+    std::vector<T> neighborhood_scratch; //!< one reusable neighborhood array per thread
+    std::vector<long> offset_scratch;    //!< one reusable array of neighbor positions per thread
+    std::vector<int> coord_scratch;      //!< one reusable array of neighbor relative indices per thread
+    std::vector<int> vote_scratch;       //!< one reusable MajorityHistogram array per thread (many states only)
+    int neighborhood_slot_size;          //!< number of cells reserved for each thread's neighborhood array
+    int vote_slot_size;                  //!< number of votes reserved for each thread's MajorityHistogram
+    int neighborhood_num_slots;          //!< number of threads with a neighborhood array
+    NeighborhoodStencil stencil;         //!< neighborhood geometry shared by every cell
+    std::vector<uint64_t> packed_rows;   //!< bit-packed binary cells; one bit per cell, 64 cells per word
+    std::vector<uint64_t> next_packed_rows; //!< next generation of packed_rows
+    std::vector<uint64_t> packed_scratch;   //!< next row and bit-sliced counter of every thread of a packed step
+    int packed_row_words;                //!< number of words of each packed row
+    bool packed_cells_current;           //!< packed_rows hold the current generation; the cell buffers are out of date
+                                         //!< (or released, see release_cell_buffers)
+    RuleTable<T> rule_table;             //!< custom rule materialized by setup_rule_table
+    int tile_rows;                       //!< number of rows of the tiles scheduled by run_step
+    int tile_width;                      //!< number of cells along the last axis of the tiles scheduled by run_step
+    TileScheduler tile_scheduler;        //!< balances the tiles across threads using their costs of the previous step
+    int pinned_threads;                  //!< number of threads pinned by pin_step_threads (0: none)
+    bool track_activity;                 //!< only recompute the tiles next to changed cells (see setup_activity_tracking)
+    bool activity_valid;                 //!< changed_segments describes the previous step
+    long activity_setup[8];              //!< boundary, neighborhood, rule, states and tiles changed_segments were tracked with
+    std::vector<uint8_t> changed_segments; //!< per updated row and column tile: a cell changed during the previous step
+    std::vector<uint8_t> active_segments;  //!< changed_segments spread over boundary_radius cells
+    std::vector<uint8_t> spread_segments;  //!< intermediate spread of mark_active_segments
+    std::vector<long> active_tiles;        //!< tiles recomputed by the current step
+    std::vector<uint8_t> moved_tiles;      //!< per active tile: a rule moved a cell
+    long num_active_tiles;                 //!< number of tiles recomputed by the last step (see get_num_active_tiles)
+    NeighborhoodStencil block_stencil;   //!< neighborhood geometry inside the step_n block buffers
+    TileScheduler block_scheduler;       //!< balances the step_n blocks across threads
+    std::vector<std::vector<T>> block_buffers; //!< two block buffers (current and next generation) per thread
+    std::vector<int> staged_states;      //!< intermediate generations of step_n waiting to be logged
+    std::vector<T> in_place_slabs;       //!< saved slabs and per-thread windows of run_in_place_step
+    SparseGrid<T> *sparse_grid;          //!< occupied bricks of a sparse grid (see setup_sparse); nullptr: dense grid
+    void (*collision_rule)(T &, const T &); //!< merges cells moved onto occupied cells of a sparse grid (see setup_collision_rule)
+    bool logging;                        //!< setup_dimensions and steps write the log file (see setup_logging)
+
+    /**
+     * @brief Allocates one contiguous, aligned buffer per state for the grid
+     * and the row pointer tables used by get_matrix/get_tensor.
+     * Every axis is padded with ghost_width ghost layers on each side.
+     * Grids updated in place (see setup_in_place) only get the current state's buffer.
+     * Grids split across processes only hold this process' slabs (see split_first_axis).
+     * Expects axis1_dim, axis2_dim and axis3_dim to be set for the given rank.
+     *
+     * @param grid_rank number of axes of the grid (1, 2 or 3)
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the grid\n
+     * InvalidDecomposition: there are more processes than slabs, or the halo slabs exceed INT_MAX cells\n
+     * 0: no error
+     */
+    int allocate_cells(int grid_rank)
+    {
+        if (global_axis1_dim == 0)
+        {
+            // first allocation: axis1_dim spans the whole grid
+            int error_code = split_first_axis();
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        long origin = 0; // position of cell [0, 0, 0] in the buffers
+
+        num_cells = 1;
+        buffer_size = 1;
+        for (int axis = grid_rank - 1; axis >= 0; axis--)
+        {
+            strides[axis] = buffer_size; // row-major; last axis is contiguous
+            buffer_size *= extents[axis] + 2 * ghost_width;
+            num_cells *= extents[axis];
+            origin += ghost_width * strides[axis];
+        }
+        if ((lower_halo > 0 || upper_halo > 0) && boundary_radius * strides[0] > INT_MAX)
+        {
+            return CAEnums::InvalidDecomposition; // halo messages count their cells with an int
+        }
+
+        // cells are constructed below by the threads that update them
+        cell_buffer = aligned_alloc_array<T>(buffer_size);
+        next_cell_buffer = in_place ? nullptr : aligned_alloc_array<T>(buffer_size);
+        if (cell_buffer == nullptr || (next_cell_buffer == nullptr && !in_place))
+        {
+            free(cell_buffer);
+            free(next_cell_buffer);
+            cell_buffer = nullptr;
+            next_cell_buffer = nullptr;
+            free_cells();
+            return CAEnums::CellsMalloc;
+        }
+        cells = cell_buffer + origin;
+        next_cells = in_place ? nullptr : next_cell_buffer + origin;
+        rank = grid_rank;
+        first_touch_cells();
+
+        switch (rank)
+        {
+        case 1:
+            break;
+        case 2:
+            matrix = new (std::nothrow) T *[axis1_dim];
+            next_matrix = in_place ? nullptr : new (std::nothrow) T *[axis1_dim];
+            if (matrix == nullptr || (next_matrix == nullptr && !in_place))
+            {
+                free_cells();
+                return CAEnums::CellsMalloc;
+            }
+            break;
+        case 3:
+            tensor = new (std::nothrow) T **[axis1_dim];
+            next_tensor = in_place ? nullptr : new (std::nothrow) T **[axis1_dim];
+            if (tensor == nullptr || (next_tensor == nullptr && !in_place))
+            {
+                free_cells();
+                return CAEnums::CellsMalloc;
+            }
+            // one block of row pointers per state instead of one allocation per slab
+            tensor[0] = new (std::nothrow) T *[axis1_dim * axis2_dim];
+            if (next_tensor != nullptr)
+            {
+                next_tensor[0] = new (std::nothrow) T *[axis1_dim * axis2_dim];
+            }
+            if (tensor[0] == nullptr || (next_tensor != nullptr && next_tensor[0] == nullptr))
+            {
+                free_cells();
+                return CAEnums::CellsMalloc;
+            }
+            break;
+        }
+        link_row_tables();
+        return 0;
+    }
+
+    /**
+     * @brief Points vector/matrix/tensor (and their next state tables) at the rows of cells and next_cells.
+     * Called whenever the cell buffers are (re)allocated; the row pointer tables must already be allocated.
+     *
+     */
+    void link_row_tables()
+    {
+        switch (rank)
+        {
+        case 1:
+            vector = cells;
+            next_vector = next_cells;
+            break;
+        case 2:
+            for (int i = 0; i < axis1_dim; i++)
+            {
+                matrix[i] = cells + i * strides[0];
+                if (next_matrix != nullptr)
+                {
+                    next_matrix[i] = next_cells + i * strides[0];
+                }
+            }
+            break;
+        case 3:
+            for (int i = 0; i < axis1_dim; i++)
+            {
+                tensor[i] = tensor[0] + i * axis2_dim;
+                for (int j = 0; j < axis2_dim; j++)
+                {
+                    tensor[i][j] = cells + i * strides[0] + j * strides[1];
+                }
+                if (next_tensor == nullptr)
+                {
+                    continue;
+                }
+                next_tensor[i] = next_tensor[0] + i * axis2_dim;
+                for (int j = 0; j < axis2_dim; j++)
+                {
+                    next_tensor[i][j] = next_cells + i * strides[0] + j * strides[1];
+                }
+            }
+            break;
+        }
+    }
+
+    /**
+     * @brief Frees both cell buffers while packed_rows hold the current generation of an integer grid,
+     * whose cells carry nothing but their state. cells, next_cells and the row pointer tables keep their
+     * values (and thus the grid keeps counting as set up) but must not be read until restore_cell_buffers.
+     * Struct cells keep their other members in the cell buffers, and grids split across processes exchange
+     * their halos through them, so both keep their buffers.
+     *
+     */
+    void release_cell_buffers()
+    {
+        if (!std::is_integral<T>::value || is_distributed() || cell_buffer == nullptr)
+        {
+            return;
+        }
+        aligned_delete_array(cell_buffer, buffer_size);
+        aligned_delete_array(next_cell_buffer, buffer_size);
+        cell_buffer = nullptr;
+        next_cell_buffer = nullptr;
+    }
+
+    /**
+     * @brief Reallocates the cell buffers freed by release_cell_buffers, with the same layout, and points
+     * cells, next_cells and the row pointer tables at them. Does nothing when the buffers are allocated.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the grid (the buffers stay released)\n
+     * 0: no error
+     */
+    int restore_cell_buffers()
+    {
+        if (cell_buffer != nullptr)
+        {
+            return 0;
+        }
+        long origin = 0; // position of cell [0, 0, 0] in the buffers
+        for (int axis = 0; axis < rank; axis++)
+        {
+            origin += ghost_width * strides[axis];
+        }
+        cell_buffer = aligned_alloc_array<T>(buffer_size);
+        next_cell_buffer = aligned_alloc_array<T>(buffer_size);
+        if (cell_buffer == nullptr || next_cell_buffer == nullptr)
+        {
+            free(cell_buffer);
+            free(next_cell_buffer);
+            cell_buffer = nullptr;
+            next_cell_buffer = nullptr;
+            return CAEnums::CellsMalloc;
+        }
+        cells = cell_buffer + origin;
+        next_cells = next_cell_buffer + origin;
+        first_touch_cells();
+        link_row_tables();
+        return 0;
+    }
+
+    /**
+     * @brief Number of tiles a step is split into (see run_step).
+     *
+     * @param num_column_tiles set to the number of tiles along the last axis
+     * @return long
+     */
+    long get_num_tiles(long &num_column_tiles)
+    {
+        int begin, end, interior_begin, interior_end;
+        get_update_range(rank - 1, begin, end, interior_begin, interior_end);
+        long num_row_tiles = (get_num_updated_rows() + tile_rows - 1) / tile_rows;
+        num_column_tiles = (end - begin + tile_width - 1) / tile_width;
+        return num_row_tiles * num_column_tiles;
+    }
+
+    /**
+     * @brief Position in the cell buffers of the first cell of a tile.
+     * Increases with the tile number, since tiles are numbered in row-major order.
+     *
+     * @param tile tile number
+     * @param num_column_tiles number of tiles along the last axis
+     * @return long
+     */
+    long get_tile_buffer_offset(long tile, long num_column_tiles)
+    {
+        int begin[3], end[3], interior_begin[3], interior_end[3];
+        for (int axis = 0; axis < rank; axis++)
+        {
+            get_update_range(axis, begin[axis], end[axis], interior_begin[axis], interior_end[axis]);
+        }
+        long row = tile / num_column_tiles * tile_rows;
+        long rows_per_i = rank == 3 ? end[1] - begin[1] : 1;
+        int cell_index[3] = {0, 0, 0};
+        if (rank >= 2)
+        {
+            cell_index[0] = begin[0] + row / rows_per_i;
+        }
+        if (rank == 3)
+        {
+            cell_index[1] = begin[1] + row % rows_per_i;
+        }
+        cell_index[rank - 1] = begin[rank - 1] + tile % num_column_tiles * tile_width;
+        return (cells - cell_buffer) + get_flat_index(cell_index, rank);
+    }
+
+    /**
+     * @brief Calls slice(begin, end) from every step thread with the part of the cell buffers holding
+     * the tiles the thread gets with the Static schedule (thread 0 also gets the cells before the
+     * first tile, the last thread the cells after its last tile). Pages are thus first touched and
+     * later updated by the same thread.
+     *
+     * @param slice callable receiving a range of positions in the cell buffers
+     */
+    template <typename SliceFunction>
+    void for_each_thread_slice(SliceFunction slice)
+    {
+        long num_column_tiles = 0;
+        long num_tiles = get_num_tiles(num_column_tiles);
+        int num_slices = get_step_threads();
+        if (num_tiles == 0)
+        {
+            num_slices = 1;
+        }
+        pin_step_threads();
+#ifdef ENABLE_OMP
+#pragma omp parallel num_threads(num_slices)
+#endif
+        {
+#ifdef ENABLE_OMP
+            int thread = omp_get_thread_num();
+            int team_size = omp_get_num_threads();
+#else
+            int thread = 0;
+            int team_size = 1;
+#endif
+            for (int n = thread; n < num_slices; n += team_size)
+            {
+                long first_tile = num_tiles * n / num_slices;
+                long last_tile = num_tiles * (n + 1) / num_slices;
+                long begin = n == 0 ? 0 : get_tile_buffer_offset(first_tile, num_column_tiles);
+                long end = n == num_slices - 1 ? buffer_size : get_tile_buffer_offset(last_tile, num_column_tiles);
+                slice(begin, end);
+            }
+        }
+    }
+
+    /**
+     * @brief Constructs the cells of both buffers from the threads that update them (see for_each_thread_slice),
+     * so that each thread's pages are placed on its NUMA node.
+     *
+     */
+    void first_touch_cells()
+    {
+        T *buffer = cell_buffer;
+        T *next_buffer = next_cell_buffer;
+        for_each_thread_slice([buffer, next_buffer](long begin, long end)
+                              {
+                                  construct_array(buffer, begin, end);
+                                  if (next_buffer != nullptr)
+                                  {
+                                      construct_array(next_buffer, begin, end);
+                                  }
+                              });
+    }
+
+    /**
+     * @brief Pins the step threads to CPU sockets when pin_threads is set (see setup_thread_pinning).
+     * Thread t of n runs on socket t * num_sockets / n. Only pins again when the number of threads changed.
+     *
+     */
+    void pin_step_threads()
+    {
+#ifdef ENABLE_OMP
+        int threads = get_step_threads();
+        if (!pin_threads || pinned_threads == threads)
+        {
+            return;
+        }
+        std::vector<std::vector<int>> sockets;
+        int num_sockets = get_cpu_sockets(sockets);
+        if (num_sockets == 0)
+        {
+            return;
+        }
+#pragma omp parallel num_threads(threads)
+        {
+            int thread = omp_get_thread_num();
+            pin_thread_to_cpus(sockets[(long)thread * num_sockets / omp_get_num_threads()]);
+        }
+        pinned_threads = threads;
+#endif
+    }
+
+    /**
+     * @brief Deallocates the cell buffers and row pointer tables and resets them to nullptr.
+     * The next allocate_cells call allocates a grid without ghost layers.
+     *
+     */
+    void free_cells()
+    {
+        if (matrix != nullptr)
+        {
+            delete[] matrix;
+        }
+        if (next_matrix != nullptr)
+        {
+            delete[] next_matrix;
+        }
+        if (tensor != nullptr)
+        {
+            delete[] tensor[0];
+            delete[] tensor;
+        }
+        if (next_tensor != nullptr)
+        {
+            delete[] next_tensor[0];
+            delete[] next_tensor;
+        }
+        aligned_delete_array(cell_buffer, buffer_size);
+        aligned_delete_array(next_cell_buffer, buffer_size);
+
+        cell_buffer = nullptr;
+        next_cell_buffer = nullptr;
+        buffer_size = 0;
+        ghost_width = 0;
+        packed_cells_current = false;
+        cells = nullptr;
+        next_cells = nullptr;
+        num_cells = 0;
+        rank = 0;
+        vector = nullptr;
+        next_vector = nullptr;
+        matrix = nullptr;
+        next_matrix = nullptr;
+        tensor = nullptr;
+        next_tensor = nullptr;
+    }
+
+    /**
+     * @brief Sets up an empty sparse grid (see setup_sparse) in place of allocate_cells.
+     * Expects axis1_dim, axis2_dim and axis3_dim to be set for the given rank.
+     *
+     * @param grid_rank number of axes of the grid (1, 2 or 3)
+     * @param fill_value the value to set every cell state to (sparse grids start empty)
+     * @return int - error code\n
+     * InvalidCellState: fill_value isn't 0\n
+     * InvalidDecomposition: sparse grids can't be split across processes\n
+     * InvalidDimensions: see SparseGrid::setup_dimensions\n
+     * 0: no error
+     */
+    int setup_sparse_dimensions(int grid_rank, int fill_value)
+    {
+        if (fill_value != 0)
+        {
+            return CAEnums::InvalidCellState;
+        }
+        if (is_distributed())
+        {
+            return CAEnums::InvalidDecomposition;
+        }
+        int dims[3] = {axis1_dim, axis2_dim, axis3_dim};
+        int error_code = sparse_grid->setup_dimensions(grid_rank, dims);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        rank = grid_rank;
+        global_axis1_dim = axis1_dim;
+        num_cells = 1;
+        for (int axis = 0; axis < rank; axis++)
+        {
+            num_cells *= dims[axis];
+        }
+        create_log();
+        return 0;
+    }
+
+    /**
+     * @brief init_condition of a sparse grid: every cell turns to x_state with probability prob.
+     * The gaps between the chosen cells are geometric, so they are drawn slab by slab along the first axis.
+     *
+     * @param x_state cell state to initialize the grid with
+     * @param prob the probability of a cell to turn to x_state
+     * @return int - error code (see init_condition)
+     */
+    int init_sparse_condition(int x_state, double prob)
+    {
+        if (prob <= 0.0)
+        {
+            return 0;
+        }
+        srand(time(NULL));
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        long slab_size = num_cells / axis1_dim; // cells of a slab along the first axis
+        double log_miss = std::log1p(-std::min(prob, 1.0 - 1e-12));
+        for (int i = 0; i < axis1_dim; i++)
+        {
+            long n = -1;
+            while (true)
+            {
+                double random = (rand() + 1.0) / (RAND_MAX + 2.0);
+                n += 1 + (prob >= 1.0 ? 0 : (long)(std::log(random) / log_miss));
+                if (n >= slab_size)
+                {
+                    break;
+                }
+                int cell_index[3] = {i, 0, 0};
+                long remainder = n;
+                for (int axis = rank - 1; axis >= 1; axis--)
+                {
+                    cell_index[axis] = remainder % extents[axis];
+                    remainder /= extents[axis];
+                }
+                T cell = sparse_grid->get_cell(cell_index);
+                set_cell_state(cell, x_state);
+                int error_code = sparse_grid->set_cell(cell_index, cell);
+                if (error_code < 0)
+                {
+                    return error_code;
+                }
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Computes the position of the cell at cell_index in the cells/next_cells buffers.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @return long
+     */
+    long get_flat_index(const int *cell_index, int index_size)
+    {
+        long flat_index = 0;
+        for (int axis = 0; axis < index_size; axis++)
+        {
+            flat_index += cell_index[axis] * strides[axis];
+        }
+        return flat_index;
+    }
+
+    /**
+     * @brief Number of cells along the last (contiguous) axis of the grid.
+     *
+     * @return int
+     */
+    int get_row_size()
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        return rank > 0 ? extents[rank - 1] : 0;
+    }
+
+    /**
+     * @brief Determines if the grid is set up: its cells are allocated or its sparse grid has dimensions.
+     *
+     * @return true: the grid holds cells
+     * @return false: setup_dimensions wasn't called
+     */
+    bool has_cells() const
+    {
+        return cells != nullptr || (sparse_grid != nullptr && rank > 0);
+    }
+
+    /**
+     * @brief Determines if a cell index lies inside the grid (this process' slabs for split grids).
+     *
+     * @param cell_index index of the cell (rank ints)
+     * @return true: the cell is inside the grid
+     * @return false: the cell is outside the grid
+     */
+    bool is_inside_grid(const int *cell_index) const
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        for (int axis = 0; axis < rank; axis++)
+        {
+            if (cell_index[axis] < 0 || cell_index[axis] >= extents[axis])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Determines if steps read the neighborhoods from windows of the grid (see run_window_step):
+     * grids updated in place and sparse grids.
+     *
+     * @return true: window steps
+     * @return false: steps read the current state buffer
+     */
+    bool steps_in_windows() const
+    {
+        return in_place || sparse_grid != nullptr;
+    }
+
+    /**
+     * @brief Get the first cell of a row (cells along the last axis) of the grid.
+     * Rows are numbered in row-major order; there are num_cells / get_row_size() rows.
+     * Ghost layers are skipped so this works with and without ghost cells.
+     *
+     * @param buffer_origin cell [0, 0, 0] of the cells or next_cells buffer
+     * @param row row number
+     * @return T*
+     */
+    T *get_row(T *buffer_origin, long row)
+    {
+        switch (rank)
+        {
+        case 1:
+            return buffer_origin;
+        case 2:
+            return buffer_origin + row * strides[0];
+        default:
+            return buffer_origin + (row / axis2_dim) * strides[0] + (row % axis2_dim) * strides[1];
+        }
+    }
+
+    /**
+     * @brief Copies the cells into the next state buffer, which then holds the same generation.
+     * Grids updated in place have no next state buffer and are left as they are.
+     *
+     */
+    void copy_cells_to_next_generation()
+    {
+        if (next_cells == nullptr)
+        {
+            return;
+        }
+        int row_size = get_row_size();
+        for (long row = 0; row < num_cells / row_size; row++)
+        {
+            std::copy(get_row(cells, row), get_row(cells, row) + row_size, get_row(next_cells, row));
+        }
+    }
+
+    /**
+     * @brief Number of cells of each row of this process' slabs (see get_owned_row).
+     *
+     * @return int
+     */
+    int get_owned_row_size()
+    {
+        return rank == 1 ? axis1_dim - lower_halo - upper_halo : get_row_size();
+    }
+
+    /**
+     * @brief Number of rows of this process' slabs, skipping the halo slabs.
+     *
+     * @return long
+     */
+    long get_num_owned_rows()
+    {
+        long rows_per_slab = rank == 3 ? axis2_dim : 1;
+        return rank == 1 ? 1 : (axis1_dim - lower_halo - upper_halo) * rows_per_slab;
+    }
+
+    /**
+     * @brief Get the first cell of a row of this process' slabs.
+     * Without halo slabs these are the rows of get_row.
+     *
+     * @param buffer_origin cell [0, 0, 0] of the cells or next_cells buffer
+     * @param row row number
+     * @return T*
+     */
+    T *get_owned_row(T *buffer_origin, long row)
+    {
+        long rows_per_slab = rank == 3 ? axis2_dim : 1;
+        return rank == 1 ? buffer_origin + lower_halo : get_row(buffer_origin, row + lower_halo * rows_per_slab);
+    }
+
+    /**
+     * @brief Reallocates the grid with the given number of ghost layers and copies the cells over.
+     * The next state buffer is (re)allocated or dropped when in_place changed (see setup_in_place)
+     * and the halo slabs are resized when boundary_radius or boundary_type changed (see get_halo_slabs).
+     * Pointers returned by get_vector/get_matrix/get_tensor/get_view become invalid.
+     *
+     * @param width number of ghost layers padding each side of every axis
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the padded grid (the grid is kept without ghost layers)\n
+     * InvalidDecomposition: a process holds fewer than boundary_radius slabs, or halos exceed INT_MAX cells\n
+     * 0: no error
+     */
+    int relayout_cells(int width)
+    {
+        if (cells == nullptr)
+        {
+            return 0;
+        }
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        int lower = 0;
+        int upper = 0;
+        error_code = get_halo_slabs(lower, upper);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        if (width == ghost_width && (next_cells == nullptr) == in_place && lower == lower_halo && upper == upper_halo)
+        {
+            return 0;
+        }
+
+        int grid_rank = rank;
+        int row_size = get_owned_row_size();
+        long num_rows = get_num_owned_rows();
+        std::vector<T> saved_cells;
+        try
+        {
+            saved_cells.reserve(num_rows * row_size);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::CellsMalloc;
+        }
+        for (long row = 0; row < num_rows; row++)
+        {
+            T *cell = get_owned_row(cells, row);
+            saved_cells.insert(saved_cells.end(), cell, cell + row_size);
+        }
+
+        free_cells();
+        ghost_width = width;
+        axis1_dim += lower - lower_halo + upper - upper_halo;
+        lower_halo = lower;
+        upper_halo = upper;
+        halos_exchanged = false;
+        activity_valid = false;
+        error_code = allocate_cells(grid_rank);
+        if (error_code < 0)
+        {
+            // fall back to the layout without ghost layers
+            ghost_width = 0;
+            int fallback_error = allocate_cells(grid_rank);
+            if (fallback_error < 0)
+            {
+                return fallback_error;
+            }
+        }
+        for (long row = 0; row < num_rows; row++)
+        {
+            std::copy(saved_cells.begin() + row * row_size, saved_cells.begin() + (row + 1) * row_size,
+                      get_owned_row(cells, row));
+        }
+        copy_cells_to_next_generation();
+        return error_code;
+    }
+
+    /**
+     * @brief Determines if the grid is split across processes (see setup_mpi).
+     *
+     * @return bool
+     */
+    bool is_distributed() const
+    {
+#ifdef ENABLE_MPI
+        return comm != MPI_COMM_NULL;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Determines if this process writes the log and prints the grid:
+     * the first process of a split grid, and every process otherwise.
+     *
+     * @return bool
+     */
+    bool is_root_process() const
+    {
+#ifdef ENABLE_MPI
+        return comm_rank == 0;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Splits the first axis of the grid (axis1_dim slabs) into one block of consecutive
+     * slabs per process and keeps this process' block. Called by the first allocate_cells;
+     * grids that aren't split keep every slab.
+     *
+     * @return int - error code\n
+     * InvalidDecomposition: there are more processes than slabs\n
+     * 0: no error
+     */
+    int split_first_axis()
+    {
+        global_axis1_dim = axis1_dim;
+        first_owned_slab = 0;
+        lower_halo = 0;
+        upper_halo = 0;
+#ifdef ENABLE_MPI
+        if (is_distributed())
+        {
+            if (global_axis1_dim < comm_size)
+            {
+                global_axis1_dim = 0;
+                return CAEnums::InvalidDecomposition;
+            }
+            // block sizes differ by at most one slab
+            first_owned_slab = (long)global_axis1_dim * comm_rank / comm_size;
+            axis1_dim = (long)global_axis1_dim * (comm_rank + 1) / comm_size - first_owned_slab;
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Number of halo slabs needed before and after this process' slabs: boundary_radius slabs
+     * wherever a neighboring process holds the adjacent slabs (on both sides with Periodic boundaries).
+     * A single process wraps its own slabs and needs none.
+     *
+     * @param lower set to the number of halo slabs before this process' slabs
+     * @param upper set to the number of halo slabs after this process' slabs
+     * @return int - error code\n
+     * InvalidDecomposition: some process holds fewer than boundary_radius slabs\n
+     * 0: no error
+     */
+    int get_halo_slabs(int &lower, int &upper)
+    {
+        lower = 0;
+        upper = 0;
+#ifdef ENABLE_MPI
+        if (!is_distributed() || comm_size == 1)
+        {
+            return 0;
+        }
+        if (global_axis1_dim / comm_size < boundary_radius) // the smallest block
+        {
+            return CAEnums::InvalidDecomposition;
+        }
+        bool periodic = boundary_type == CAEnums::Periodic;
+        lower = periodic || comm_rank > 0 ? boundary_radius : 0;
+        upper = periodic || comm_rank < comm_size - 1 ? boundary_radius : 0;
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Starts sending this process' edge slabs to the neighboring processes
+     * and receiving their edge slabs into the halo slabs (see finish_halo_exchange).
+     * The halo slabs mustn't be read until the exchange finished; the other slabs can be updated meanwhile.
+     *
+     */
+    void start_halo_exchange()
+    {
+#ifdef ENABLE_MPI
+        num_halo_requests = 0;
+        int below = (comm_rank + comm_size - 1) % comm_size;
+        int above = (comm_rank + 1) % comm_size;
+        int halo_cells = boundary_radius * strides[0]; // checked against INT_MAX by allocate_cells
+        T *first_slab = cell_buffer + ghost_width * strides[0];
+        int owned_end = axis1_dim - upper_halo;
+        if (lower_halo > 0)
+        {
+            MPI_Irecv(first_slab, halo_cells, cell_type, below, HaloTagUp, comm,
+                      &halo_requests[num_halo_requests++]);
+            MPI_Isend(first_slab + lower_halo * strides[0], halo_cells, cell_type, below, HaloTagDown, comm,
+                      &halo_requests[num_halo_requests++]);
+        }
+        if (upper_halo > 0)
+        {
+            MPI_Irecv(first_slab + owned_end * strides[0], halo_cells, cell_type, above, HaloTagDown, comm,
+                      &halo_requests[num_halo_requests++]);
+            MPI_Isend(first_slab + (owned_end - boundary_radius) * strides[0], halo_cells, cell_type, above,
+                      HaloTagUp, comm, &halo_requests[num_halo_requests++]);
+        }
+#endif
+    }
+
+    /**
+     * @brief Waits for the halo exchange started by start_halo_exchange.
+     *
+     */
+    void finish_halo_exchange()
+    {
+#ifdef ENABLE_MPI
+        MPI_Waitall(num_halo_requests, halo_requests, MPI_STATUSES_IGNORE);
+        num_halo_requests = 0;
+        halos_exchanged = true;
+#endif
+    }
+
+    /**
+     * @brief Fills the halo slabs with the current state of the neighboring processes' edge slabs,
+     * unless they already hold it. Every process of a split grid has to call this.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the halo slabs\n
+     * InvalidDecomposition: a process holds fewer than boundary_radius slabs, or halos exceed INT_MAX cells\n
+     * 0: no error
+     */
+    int exchange_halos()
+    {
+        if (!is_distributed() || halos_exchanged)
+        {
+            return 0;
+        }
+        int error_code = update_ghost_layout();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        start_halo_exchange();
+        finish_halo_exchange();
+        return 0;
+    }
+
+    /**
+     * @brief Sends the cells a Custom rule moved into the halo slabs of the next generation
+     * to the processes holding those slabs, which keep them unless they're empty (T()).
+     *
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the moved cells\n
+     * 0: no error
+     */
+    int return_moved_cells()
+    {
+#ifdef ENABLE_MPI
+        if (lower_halo == 0 && upper_halo == 0)
+        {
+            return 0;
+        }
+        long halo_cells = boundary_radius * strides[0];
+        try
+        {
+            moved_cells.resize(2 * halo_cells);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+        int below = (comm_rank + comm_size - 1) % comm_size;
+        int above = (comm_rank + 1) % comm_size;
+        T *first_slab = next_cell_buffer + ghost_width * strides[0];
+        int owned_end = axis1_dim - upper_halo;
+        MPI_Request requests[4];
+        int num_requests = 0;
+        if (lower_halo > 0)
+        {
+            MPI_Irecv(moved_cells.data(), halo_cells, cell_type, below, MovedTagUp, comm, &requests[num_requests++]);
+            MPI_Isend(first_slab, halo_cells, cell_type, below, MovedTagDown, comm, &requests[num_requests++]);
+        }
+        if (upper_halo > 0)
+        {
+            MPI_Irecv(moved_cells.data() + halo_cells, halo_cells, cell_type, above, MovedTagDown, comm,
+                      &requests[num_requests++]);
+            MPI_Isend(first_slab + owned_end * strides[0], halo_cells, cell_type, above, MovedTagUp, comm,
+                      &requests[num_requests++]);
+        }
+        MPI_Waitall(num_requests, requests, MPI_STATUSES_IGNORE);
+
+        const T empty = T();
+        T *lower_edge = first_slab + lower_halo * strides[0];
+        T *upper_edge = first_slab + (owned_end - boundary_radius) * strides[0];
+        for (long n = 0; n < halo_cells; n++)
+        {
+            if (lower_halo > 0 && moved_cells[n] != empty)
+            {
+                lower_edge[n] = moved_cells[n];
+            }
+            if (upper_halo > 0 && moved_cells[halo_cells + n] != empty)
+            {
+                upper_edge[n] = moved_cells[halo_cells + n];
+            }
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Converts the first index of a cell from this process' slabs to the whole grid
+     * so rules see the same indices however the grid is split.
+     *
+     * @param cell_index cell of interest's index
+     */
+    void to_global_index(int *cell_index) const
+    {
+        cell_index[0] += first_owned_slab - lower_halo;
+    }
+
+    /**
+     * @brief Converts the first index of a cell from the whole grid back to this process' slabs.
+     * Periodic split grids wrap the index so cells moved across the grid's edge land in the halo slabs.
+     *
+     * @param cell_index cell of interest's index
+     */
+    void to_local_index(int *cell_index) const
+    {
+        cell_index[0] -= first_owned_slab - lower_halo;
+        if (is_distributed() && boundary_type == CAEnums::Periodic)
+        {
+            if (cell_index[0] < 0)
+            {
+                cell_index[0] += global_axis1_dim;
+            }
+            else if (cell_index[0] >= axis1_dim)
+            {
+                cell_index[0] -= global_axis1_dim;
+            }
+        }
+    }
+
+    /**
+     * @brief Gathers the states of every cell of the split grid on the first process in row-major order.
+     * Every process has to call this.
+     *
+     * @param states set to the gathered states on the first process
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the states\n
+     * InvalidDecomposition: the grid holds more than INT_MAX cells\n
+     * 0: no error
+     */
+    int gather_states(std::vector<int> &states)
+    {
+#ifdef ENABLE_MPI
+        int row_size = get_owned_row_size();
+        long num_rows = get_num_owned_rows();
+        long num_owned_cells = num_rows * row_size;
+        long total_cells = 0;
+        MPI_Allreduce(&num_owned_cells, &total_cells, 1, MPI_LONG, MPI_SUM, comm);
+        if (total_cells > INT_MAX) // MPI_Gatherv counts and displacements are int
+        {
+            return CAEnums::InvalidDecomposition;
+        }
+        std::vector<int> owned_states;
+        std::vector<int> counts;
+        std::vector<int> displacements;
+        try
+        {
+            owned_states.reserve(num_owned_cells);
+            counts.resize(comm_size);
+            displacements.resize(comm_size);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::CellsMalloc;
+        }
+        for (long row = 0; row < num_rows; row++)
+        {
+            const T *cell = get_owned_row(cells, row);
+            for (int k = 0; k < row_size; k++)
+            {
+                owned_states.push_back(get_cell_state(cell[k]));
+            }
+        }
+        int count = owned_states.size();
+        MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+        if (is_root_process())
+        {
+            int total = 0;
+            for (int p = 0; p < comm_size; p++)
+            {
+                displacements[p] = total;
+                total += counts[p];
+            }
+            states.resize(total);
+        }
+        MPI_Gatherv(owned_states.data(), count, MPI_INT, states.data(), counts.data(), displacements.data(), MPI_INT,
+                    0, comm);
+#else
+        static_cast<void>(states); // grids are never split without MPI
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Makes sure the grid carries boundary_radius ghost layers when ghost cells are
+     * enabled (and none otherwise) and decides if this step's neighborhoods are read through them.
+     *
+     * Periodic boundaries wrap every neighborhood through the ghost layers.
+     * CutOff/Walled ghost layers hold empty cells (T()), which only leaves the Parity sum unchanged;
+     * other rules keep the bounds checked gather near the edges.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the padded grid\n
+     * 0: no error
+     */
+    int update_ghost_layout()
+    {
+        int error_code = relayout_cells(use_ghost_cells ? boundary_radius : 0);
+        ghost_neighborhoods = ghost_width > 0 && ghost_width >= boundary_radius &&
+                              (boundary_type == CAEnums::Periodic || rule_type == CAEnums::Parity);
+        return error_code;
+    }
+
+    /**
+     * @brief Refreshes the ghost layers of the current state from the grid's cells:
+     * a periodic wrap for Periodic boundaries and empty cells (T()) otherwise.
+     * Axes are filled in order; each axis covers the ghost layers of the axes before it
+     * so the corners are filled as well.
+     *
+     */
+    void refresh_ghost_cells()
+    {
+        int extents[3] = {1, 1, 1};   // unused axes hold a single layer
+        long axis_strides[3] = {0, 0, 0};
+        int dims[3] = {axis1_dim, axis2_dim, axis3_dim};
+        T empty_cell_state = T();
+        bool periodic = boundary_type == CAEnums::Periodic;
+
+        if (ghost_width == 0)
+        {
+            return;
+        }
+        for (int axis = 0; axis < rank; axis++)
+        {
+            extents[axis] = dims[axis];
+            axis_strides[axis] = strides[axis];
+        }
+
+        for (int axis = 0; axis < rank; axis++)
+        {
+            int lower[3], upper[3]; // range of the other axes
+            for (int other = 0; other < 3; other++)
+            {
+                bool filled = other < axis && other < rank; // ghost layers of earlier axes are filled
+                lower[other] = filled ? -ghost_width : 0;
+                upper[other] = filled ? extents[other] + ghost_width : extents[other];
+            }
+            int b = (axis + 1) % 3; // the two other axes
+            int c = (axis + 2) % 3;
+            if (b > c)
+            {
+                std::swap(b, c); // keep the contiguous axis innermost
+            }
+
+            for (int layer = 0; layer < 2 * ghost_width; layer++)
+            {
+                int ghost = layer < ghost_width ? layer - ghost_width : extents[axis] + layer - ghost_width;
+                int source = ghost;
+                while (source < 0)
+                {
+                    source += extents[axis];
+                }
+                while (source >= extents[axis])
+                {
+                    source -= extents[axis];
+                }
+                for (int u = lower[b]; u < upper[b]; u++)
+                {
+                    for (int v = lower[c]; v < upper[c]; v++)
+                    {
+                        long other_position = u * axis_strides[b] + v * axis_strides[c];
+                        T &ghost_cell = cells[ghost * axis_strides[axis] + other_position];
+                        ghost_cell = periodic ? cells[source * axis_strides[axis] + other_position] : empty_cell_state;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Makes the next state the current state in O(1) by swapping the
+     * generation buffers (and their row pointer tables) instead of copying cells.
+     * After the swap next_cells holds the previous state.
+     * Every step/step_n swaps the buffers, and packed steps leave the cells stale or release the buffers
+     * (see release_cell_buffers), so the pointers of the grid getters must be fetched again after stepping.
+     *
+     */
+    void swap_generations()
+    {
+        halos_exchanged = false;
+        activity_valid = false;
+        std::swap(cell_buffer, next_cell_buffer);
+        std::swap(cells, next_cells);
+        std::swap(vector, next_vector);
+        std::swap(matrix, next_matrix);
+        std::swap(tensor, next_tensor);
+    }
+
+    /**
+     * @brief Prepares the next state buffer before a step.
+     * Majority and Parity write every cell so the buffer is left untouched.
+     * Custom rules may move cells and only write non-empty states, so the buffer
+     * has to start out empty (T()).
+     *
+     */
+    void prepare_next_generation()
+    {
+        if (rule_type == CAEnums::Custom)
+        {
+            // each thread clears the slab it updates
+            T *next_buffer = next_cell_buffer;
+            for_each_thread_slice([next_buffer](long begin, long end)
+                                  { clear_states(next_buffer + begin, end - begin); });
+        }
+    }
+
+    /**
+     * @brief Copies the neighboring cells of the cell at cell_index into neighborhood_cells
+     * in the order of the stencil, leaving out the cells outside CutOff/Walled grids.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param interior every neighbor can be reached with the stencil offsets (see run_step)
+     * @param neighborhood_cells array receiving the neighboring cells
+     * @param neighborhood_size set to the number of neighboring cells copied
+     */
+    void generate_neighborhood(const int *cell_index, int index_size, bool interior,
+                               T *neighborhood_cells, int &neighborhood_size)
+    {
+        neighborhood_size = 0;
+        if (interior)
+        {
+            generate_interior_neighborhood(cell_index, index_size, neighborhood_cells, neighborhood_size);
+        }
+        else if (boundary_type == CAEnums::Periodic)
+        {
+            generate_periodic_neighborhood(cell_index, index_size, neighborhood_cells, neighborhood_size);
+        }
+        else // Walled cells that aren't edge cells use the CutOff neighborhood
+        {
+            generate_cutoff_neighborhood(cell_index, index_size, neighborhood_cells, neighborhood_size);
+        }
+    }
+
+    /**
+     * @brief Runs one step of a rule that receives a copy of the neighborhood
+     * (rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state)).
+     * Picks the StencilKernel compiled for the grid's rank and neighborhood once per step
+     * (radius 1 and 2; other radii use RuntimeStencilKernel), so interior cells are gathered by
+     * fully unrolled loops and neither the kernel nor the rule is switched on per cell.
+     *
+     * @param rule callable rule; called concurrently from every thread when OpenMP is enabled
+     * @param num_steps number of steps to run (see run_array_rule_steps)
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * 0: no error
+     */
+    template <typename ArrayRule>
+    int run_array_rule_step(ArrayRule &rule, int num_steps = 1)
+    {
+        bool moore = neighborhood_type == CAEnums::Moore;
+        if (boundary_radius == 1)
+        {
+            switch (rank)
+            {
+            case 1: // both neighborhood types are segments
+                return run_array_rule_step_with<StencilKernel<1, 1, CAEnums::Moore>>(rule, num_steps);
+            case 2:
+                return moore ? run_array_rule_step_with<StencilKernel<2, 1, CAEnums::Moore>>(rule, num_steps)
+                             : run_array_rule_step_with<StencilKernel<2, 1, CAEnums::VonNeumann>>(rule, num_steps);
+            case 3:
+                return moore ? run_array_rule_step_with<StencilKernel<3, 1, CAEnums::Moore>>(rule, num_steps)
+                             : run_array_rule_step_with<StencilKernel<3, 1, CAEnums::VonNeumann>>(rule, num_steps);
+            }
+        }
+        else if (boundary_radius == 2)
+        {
+            switch (rank)
+            {
+            case 1:
+                return run_array_rule_step_with<StencilKernel<1, 2, CAEnums::Moore>>(rule, num_steps);
+            case 2:
+                return moore ? run_array_rule_step_with<StencilKernel<2, 2, CAEnums::Moore>>(rule, num_steps)
+                             : run_array_rule_step_with<StencilKernel<2, 2, CAEnums::VonNeumann>>(rule, num_steps);
+            case 3:
+                return moore ? run_array_rule_step_with<StencilKernel<3, 2, CAEnums::Moore>>(rule, num_steps)
+                             : run_array_rule_step_with<StencilKernel<3, 2, CAEnums::VonNeumann>>(rule, num_steps);
+            }
+        }
+        return run_array_rule_step_with<RuntimeStencilKernel>(rule, num_steps);
+    }
+
+    /**
+     * @brief run_array_rule_step with the interior gather kernel given as a template parameter.
+     * Cells near the boundary keep the generic Periodic/CutOff gathers.
+     *
+     * @tparam Kernel StencilKernel matching the grid or RuntimeStencilKernel
+     * @param rule callable rule
+     * @param num_steps number of steps to run (see run_array_rule_steps)
+     * @return int - error code (see run_array_rule_step)
+     */
+    template <typename Kernel, typename ArrayRule>
+    int run_array_rule_step_with(ArrayRule &rule, int num_steps = 1)
+    {
+        if (steps_in_windows())
+        {
+            return run_in_place_array_rule_steps<Kernel>(rule, num_steps);
+        }
+        if (num_steps != 1)
+        {
+            return run_array_rule_steps<Kernel>(rule, num_steps);
+        }
+        auto update = [this, &rule](int *cell_index, int index_size, bool interior, T &new_cell_state)
+        {
+            // reuse this thread's neighborhood array (reserved by run_step)
+            T *neighborhood_cells = get_neighborhood_scratch();
+            int neighborhood_size = 0;
+            if (interior)
+            {
+                neighborhood_size = Kernel::gather(cells + get_flat_index(cell_index, index_size),
+                                                   stencil, neighborhood_cells);
+            }
+            else
+            {
+                generate_neighborhood(cell_index, index_size, false, neighborhood_cells, neighborhood_size);
+            }
+            to_global_index(cell_index);
+            rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state);
+            to_local_index(cell_index);
+        };
+        return run_step(update);
+    }
+
+    /**
+     * @brief Runs num_steps steps of an array rule on a grid updated in place or a sparse grid
+     * (see run_window_step). Interior neighborhoods are gathered from the window by the Kernel.
+     *
+     * @tparam Kernel StencilKernel matching the grid or RuntimeStencilKernel
+     * @param rule callable rule
+     * @param num_steps number of steps to run
+     * @return int - error code (see run_window_step)
+     */
+    template <typename Kernel, typename ArrayRule>
+    int run_in_place_array_rule_steps(ArrayRule &rule, int num_steps)
+    {
+        auto update = [this, &rule](int *cell_index, int index_size, bool interior, const T *center,
+                                    const long *offsets, const int *, int neighborhood_size, T &new_cell_state)
+        {
+            T *neighborhood_cells = get_neighborhood_scratch();
+            if (interior)
+            {
+                Kernel::gather(center, stencil, neighborhood_cells);
+            }
+            else
+            {
+                for (int n = 0; n < neighborhood_size; n++)
+                {
+                    neighborhood_cells[n] = center[offsets[n]];
+                }
+            }
+            to_global_index(cell_index);
+            rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state);
+            to_local_index(cell_index);
+        };
+        for (; num_steps > 0; num_steps--)
+        {
+            int error_code = run_window_step(update);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Runs num_steps steps of an array rule, advancing several generations per block
+     * (see run_blocked_steps) while the rule doesn't move cells and the blocks aren't mostly halo.
+     * The remaining generations run one step at a time.
+     *
+     * @tparam Kernel StencilKernel matching the grid or RuntimeStencilKernel
+     * @param rule callable rule
+     * @param num_steps number of steps to run
+     * @return int - error code (see run_array_rule_step)
+     */
+    template <typename Kernel, typename ArrayRule>
+    int run_array_rule_steps(ArrayRule &rule, int num_steps)
+    {
+        int error_code = 0;
+        while (num_steps > 1)
+        {
+            int block_steps = get_block_steps(num_steps);
+            bool blocked = false;
+            if (block_steps > 1)
+            {
+                error_code = run_blocked_steps<Kernel>(rule, block_steps, blocked);
+                if (error_code < 0)
+                {
+                    return error_code;
+                }
+            }
+            if (!blocked)
+            {
+                break;
+            }
+            num_steps -= block_steps;
+        }
+        for (; num_steps > 0; num_steps--)
+        {
+            error_code = run_array_rule_step_with<Kernel>(rule);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Largest number of generations (at most num_steps) a block can be advanced by while it copies
+     * at most TEMPORAL_BLOCK_MAX_OVERHEAD cells per advanced cell.
+     *
+     * @param num_steps number of steps left
+     * @param window_blocks size the blocks like for_each_window_block instead of TEMPORAL_BLOCK_EXTENTS
+     * @return int - 1 when blocks wouldn't pay off, the grid is split across processes or activity is tracked
+     */
+    int get_block_steps(int num_steps, bool window_blocks = false)
+    {
+        if (is_distributed() || track_activity)
+        {
+            return 1; // the halo slabs only hold one generation; blocks don't record which cells changed
+        }
+        int dims[3] = {axis1_dim, axis2_dim, axis3_dim};
+        for (int block_steps = num_steps; block_steps > 1; block_steps--)
+        {
+            long core_cells = 1;
+            long buffer_cells = 1;
+            for (int axis = 0; axis < rank; axis++)
+            {
+                int extent = window_blocks ? std::max(WINDOW_BLOCK_EXTENTS[rank - 1][axis], 4 * boundary_radius)
+                                           : TEMPORAL_BLOCK_EXTENTS[rank - 1][axis];
+                extent = std::min(extent, dims[axis]);
+                core_cells *= extent;
+                buffer_cells *= extent + 2L * block_steps * boundary_radius;
+            }
+            if (buffer_cells <= TEMPORAL_BLOCK_MAX_OVERHEAD * core_cells)
+            {
+                return block_steps;
+            }
+        }
+        return 1;
+    }
+
+    /**
+     * @brief Advances the grid num_steps generations with an array rule by temporal blocking:
+     * the grid is split into blocks of TEMPORAL_BLOCK_EXTENTS cells that are copied, with a halo of
+     * num_steps * boundary_radius cells, into a cache resident buffer and advanced num_steps generations
+     * there before only the block itself is written back. Every generation shrinks the updated part of
+     * the buffer by the radius, so the halos of neighboring blocks are computed redundantly but no block
+     * waits for another. Gives the cells of num_steps run_step calls, steps_taken and the log included
+     * (intermediate generations are staged only when the log file can be written).
+     *
+     * Rules moving cells can't be blocked: when a rule changes its cell_index the grid is left as it was
+     * and blocked is false.
+     *
+     * @tparam Kernel StencilKernel matching the grid or RuntimeStencilKernel
+     * @param rule callable rule
+     * @param num_steps number of generations (at least 2)
+     * @param blocked set to true if the generations were advanced
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the block buffers or the neighborhood arrays\n
+     * 0: no error
+     */
+    template <typename Kernel, typename ArrayRule>
+    int run_blocked_steps(ArrayRule &rule, int num_steps, bool &blocked)
+    {
+        blocked = false;
+        if (cells == nullptr)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        int error_code = update_stencil();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = reserve_neighborhood_scratch();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        // block shape and count along the axes aligned to the right (axis 2 is the last axis)
+        int shift = 3 - rank;
+        int dims[3] = {axis1_dim, axis2_dim, axis3_dim};
+        int halo = num_steps * boundary_radius;
+        int block_extents[3] = {1, 1, 1};
+        long num_blocks[3] = {1, 1, 1};
+        long local_strides[3] = {0, 0, 0}; // strides of the block buffers along the grid's axes
+        long buffer_cells = 1;
+        for (int axis = rank - 1; axis >= 0; axis--)
+        {
+            int extent = std::min(TEMPORAL_BLOCK_EXTENTS[rank - 1][axis], dims[axis]);
+            block_extents[axis + shift] = extent;
+            num_blocks[axis + shift] = (dims[axis] + extent - 1) / extent;
+            local_strides[axis] = buffer_cells;
+            buffer_cells *= extent + 2 * halo;
+        }
+        if (!block_stencil.matches(rank, boundary_radius, neighborhood_type, local_strides))
+        {
+            error_code = block_stencil.build(rank, boundary_radius, neighborhood_type, local_strides);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        bool stage = can_append_log();
+        int threads = get_step_threads();
+        try
+        {
+            block_buffers.resize(2 * threads);
+            for (auto &buffer : block_buffers)
+            {
+                if ((long)buffer.size() < buffer_cells)
+                {
+                    buffer.assign(buffer_cells, T());
+                }
+            }
+            staged_states.resize(stage ? (num_steps - 1) * num_cells : 0);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+
+        std::atomic<bool> moved(false); // a cell moved; only written when it happens
+        auto block_update = [this, &rule, &moved, num_steps, &block_extents, &num_blocks, stage](long block) -> int
+        {
+            int thread = 0;
+#ifdef ENABLE_OMP
+            thread = omp_get_thread_num();
+#endif
+            if (!moved.load(std::memory_order_relaxed) &&
+                !advance_block<Kernel>(rule, block, num_steps, block_extents, num_blocks,
+                                       block_buffers[2 * thread].data(), block_buffers[2 * thread + 1].data(), stage))
+            {
+                moved.store(true, std::memory_order_relaxed);
+            }
+            return 0;
+        };
+        error_code = block_scheduler.plan(num_blocks[0] * num_blocks[1] * num_blocks[2], threads, schedule);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        block_scheduler.run(block_update);
+        if (moved.load())
+        {
+            return 0; // cells is untouched; next_cells is rebuilt by the next step
+        }
+
+        blocked = true;
+        swap_generations();
+        for (int generation = 1; generation < num_steps; generation++)
+        {
+            steps_taken++;
+            if (stage)
+            {
+                append_log_states(staged_states.data() + (generation - 1) * num_cells, num_cells);
+            }
+        }
+        steps_taken++;
+        return append_log();
+    }
+
+    /**
+     * @brief Advances one block of run_blocked_steps num_steps generations and writes it to next_cells.
+     * The arrays below are indexed by the grid's axes aligned to the right (axis 2 is the last axis);
+     * unused axes hold a single cell.
+     *
+     * @tparam Kernel StencilKernel matching the grid or RuntimeStencilKernel
+     * @param rule callable rule
+     * @param block block number (row-major)
+     * @param num_steps number of generations
+     * @param block_extents cells along each axis of a block
+     * @param num_blocks number of blocks along each axis
+     * @param buffer block buffer (see run_blocked_steps)
+     * @param next_buffer second block buffer
+     * @param stage copy the block's intermediate generations to staged_states
+     * @return true: the block was advanced
+     * @return false: the rule moved a cell
+     */
+    template <typename Kernel, typename ArrayRule>
+    bool advance_block(ArrayRule &rule, long block, int num_steps, const int *block_extents,
+                       const long *num_blocks, T *buffer, T *next_buffer, bool stage)
+    {
+        int shift = 3 - rank;
+        int r = boundary_radius;
+        bool periodic = boundary_type == CAEnums::Periodic;
+        bool walled = boundary_type == CAEnums::Walled;
+        int grid_dims[3] = {axis1_dim, axis2_dim, axis3_dim};
+        int dims[3] = {1, 1, 1};
+        long grid_strides[3] = {0, 0, 0};  // strides of cells
+        long local_strides[3] = {0, 0, 0}; // strides of the block buffers
+        long state_strides[3] = {0, 0, 0}; // strides of staged_states (row-major, no ghost layers)
+        bool used[3] = {false, false, false};
+        for (int axis = shift; axis < 3; axis++)
+        {
+            dims[axis] = grid_dims[axis - shift];
+            grid_strides[axis] = strides[axis - shift];
+            local_strides[axis] = block_stencil.strides[axis - shift];
+            used[axis] = true;
+        }
+        state_strides[2] = 1;
+        state_strides[1] = dims[2];
+        state_strides[0] = (long)dims[1] * dims[2];
+
+        long block_index[3] = {block / (num_blocks[1] * num_blocks[2]), block / num_blocks[2] % num_blocks[1],
+                               block % num_blocks[2]};
+        int core_begin[3], core_end[3]; // cells advanced by the block
+        int first[3], extent[3];        // cells copied into the buffers (outside of the grid when periodic)
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int halo = used[axis] ? num_steps * r : 0;
+            core_begin[axis] = block_index[axis] * block_extents[axis];
+            core_end[axis] = std::min(core_begin[axis] + block_extents[axis], dims[axis]);
+            first[axis] = core_begin[axis] - halo;
+            int last = core_end[axis] + halo;
+            if (!periodic)
+            {
+                first[axis] = std::max(first[axis], 0);
+                last = std::min(last, dims[axis]);
+            }
+            extent[axis] = last - first[axis];
+        }
+
+        for (int x0 = 0; x0 < extent[0]; x0++)
+        {
+            for (int x1 = 0; x1 < extent[1]; x1++)
+            {
+                const T *row = cells + wrap_index(first[0] + x0, dims[0]) * grid_strides[0] +
+                               wrap_index(first[1] + x1, dims[1]) * grid_strides[1];
+                T *local = buffer + x0 * local_strides[0] + x1 * local_strides[1];
+                int k = wrap_index(first[2], dims[2]);
+                for (int x2 = 0; x2 < extent[2]; x2++)
+                {
+                    local[x2] = row[k];
+                    k = k + 1 == dims[2] ? 0 : k + 1;
+                }
+            }
+        }
+
+        T *neighborhood_cells = get_neighborhood_scratch();
+        const long *offsets = block_stencil.offsets.data();
+        int stencil_size = block_stencil.size();
+        T *current = buffer;
+        T *next = next_buffer;
+        for (int generation = 1; generation <= num_steps; generation++)
+        {
+            // later generations still need reach cells around the block
+            int reach = (num_steps - generation) * r;
+            int begin[3], end[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int b = core_begin[axis] - (used[axis] ? reach : 0);
+                int e = core_end[axis] + (used[axis] ? reach : 0);
+                if (!periodic)
+                {
+                    b = std::max(b, 0);
+                    e = std::min(e, dims[axis]);
+                }
+                begin[axis] = b - first[axis];
+                end[axis] = e - first[axis];
+            }
+
+            for (int x0 = begin[0]; x0 < end[0]; x0++)
+            {
+                for (int x1 = begin[1]; x1 < end[1]; x1++)
+                {
+                    int g[3] = {wrap_index(first[0] + x0, dims[0]), wrap_index(first[1] + x1, dims[1]),
+                                wrap_index(first[2] + begin[2], dims[2])};
+                    // the row's neighborhoods are full along the first two axes; Walled edge rows never change
+                    bool row_full = true;
+                    bool row_edge = false;
+                    for (int axis = shift; axis < 2; axis++)
+                    {
+                        row_full = row_full && (periodic || (g[axis] >= r && g[axis] < dims[axis] - r));
+                        row_edge = row_edge || (walled && (g[axis] == 0 || g[axis] == dims[axis] - 1));
+                    }
+                    long row_offset = x0 * local_strides[0] + x1 * local_strides[1];
+                    for (int x2 = begin[2]; x2 < end[2]; x2++)
+                    {
+                        long x = row_offset + x2;
+                        if (row_edge || (walled && (g[2] == 0 || g[2] == dims[2] - 1)))
+                        {
+                            next[x] = current[x];
+                        }
+                        else
+                        {
+                            int neighborhood_size = 0;
+                            if (row_full && (periodic || (g[2] >= r && g[2] < dims[2] - r)))
+                            {
+                                neighborhood_size = Kernel::gather(current + x, block_stencil, neighborhood_cells);
+                            }
+                            else
+                            {
+                                // CutOff neighborhood: the neighbors inside the grid, in stencil order
+                                for (int n = 0; n < stencil_size; n++)
+                                {
+                                    const int *d = block_stencil.coord(n);
+                                    bool inside = true;
+                                    for (int axis = shift; axis < 3; axis++)
+                                    {
+                                        int y = g[axis] + d[axis - shift];
+                                        inside = inside && y >= 0 && y < dims[axis];
+                                    }
+                                    if (inside)
+                                    {
+                                        neighborhood_cells[neighborhood_size++] = current[x + offsets[n]];
+                                    }
+                                }
+                            }
+                            int cell_index[3] = {0, 0, 0};
+                            for (int axis = shift; axis < 3; axis++)
+                            {
+                                cell_index[axis - shift] = g[axis];
+                            }
+                            T new_cell_state = current[x];
+                            rule(cell_index, rank, neighborhood_cells, neighborhood_size, new_cell_state);
+                            for (int axis = shift; axis < 3; axis++)
+                            {
+                                if (cell_index[axis - shift] != g[axis])
+                                {
+                                    return false;
+                                }
+                            }
+                            next[x] = new_cell_state;
+                        }
+                        g[2] = g[2] + 1 == dims[2] ? 0 : g[2] + 1;
+                    }
+                }
+            }
+
+            if (stage && generation < num_steps)
+            {
+                int *states = staged_states.data() + (generation - 1) * num_cells;
+                for (int i = core_begin[0]; i < core_end[0]; i++)
+                {
+                    for (int j = core_begin[1]; j < core_end[1]; j++)
+                    {
+                        const T *local = next + (i - first[0]) * local_strides[0] + (j - first[1]) * local_strides[1] - first[2];
+                        int *state = states + i * state_strides[0] + j * state_strides[1];
+                        for (int k = core_begin[2]; k < core_end[2]; k++)
+                        {
+                            state[k] = get_cell_state(local[k]);
+                        }
+                    }
+                }
+            }
+            std::swap(current, next);
+        }
+
+        for (int i = core_begin[0]; i < core_end[0]; i++)
+        {
+            for (int j = core_begin[1]; j < core_end[1]; j++)
+            {
+                const T *local = current + (i - first[0]) * local_strides[0] + (j - first[1]) * local_strides[1] - first[2];
+                T *row = next_cells + i * grid_strides[0] + j * grid_strides[1];
+                for (int k = core_begin[2]; k < core_end[2]; k++)
+                {
+                    row[k] = local[k];
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Runs one step of the custom rule materialized by setup_rule_table.
+     * Full neighborhoods are looked up in the table by their key; the smaller CutOff/Walled
+     * neighborhoods near the edges call the rule. The table is rebuilt if the rank, radius or
+     * neighborhood type changed since it was built.
+     * Several steps are blocked (see run_array_rule_steps) only on Periodic grids whose table maps
+     * to states inside the table, since the states are only checked before the first step.
+     *
+     * @param num_steps number of steps to run
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * InvalidCellState: a cell state is outside [0, rule_states)\n
+     * RuleTableTooLarge: the new neighborhood has too many configurations\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the table or the neighborhood arrays\n
+     * 0: no error
+     */
+    int run_rule_table_step(int num_steps = 1)
+    {
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (!rule_table.matches(rank, boundary_radius, neighborhood_type))
+        {
+            int error_code = rule_table.build(rank, boundary_radius, neighborhood_type,
+                                              get_neighborhood_size(rank, boundary_radius, neighborhood_type));
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+
+        // every state must be a digit of the keys; checked once so the lookups don't branch on errors
+        int states = rule_table.num_states;
+        int row_size = get_row_size();
+        bool valid = true;
+        if (sparse_grid != nullptr)
+        {
+            // empty cells hold state 0
+            sparse_grid->for_each_cell([&valid, states](const int *, int, T &cell)
+                                       {
+                                           int state = get_cell_state(cell);
+                                           valid = valid && state >= 0 && state < states; });
+        }
+        else
+        {
+#ifdef ENABLE_OMP
+#pragma omp parallel for reduction(&& : valid) num_threads(get_step_threads())
+#endif
+            for (long row = 0; row < num_cells / row_size; row++)
+            {
+                const T *cell = get_row(cells, row);
+                for (int n = 0; n < row_size; n++)
+                {
+                    int state = get_cell_state(cell[n]);
+                    valid = valid && state >= 0 && state < states;
+                }
+            }
+        }
+#ifdef ENABLE_MPI
+        if (is_distributed())
+        {
+            // every process skips the step or none, otherwise the halo exchanges would wait forever
+            MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_CXX_BOOL, MPI_LAND, comm);
+        }
+#endif
+        if (!valid)
+        {
+            return CAEnums::InvalidCellState;
+        }
+
+        if (num_steps > 1)
+        {
+            bool closed = boundary_type == CAEnums::Periodic;
+            for (long key = 0; closed && key < (long)rule_table.next_states.size(); key++)
+            {
+                int state = get_cell_state(rule_table.next_states[key]);
+                closed = state >= 0 && state < states;
+            }
+            if (!closed)
+            {
+                for (; num_steps > 0; num_steps--)
+                {
+                    int error_code = run_rule_table_step();
+                    if (error_code < 0)
+                    {
+                        return error_code;
+                    }
+                }
+                return 0;
+            }
+        }
+
+        const T *next_states = rule_table.next_states.data();
+        int table_neighborhood_size = rule_table.neighborhood_size;
+        void (*rule)(int *, int, T *, int, T &) = rule_table.rule;
+        auto lookup_rule = [next_states, states, table_neighborhood_size, rule](int *cell_index, int index_size,
+                                                                               T *neighborhood_cells, int neighborhood_size,
+                                                                               T &new_cell_state)
+        {
+            if (neighborhood_size != table_neighborhood_size)
+            {
+                rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state);
+                return;
+            }
+            long key = 0;
+            for (int n = 0; n < neighborhood_size; n++)
+            {
+                key = key * states + get_cell_state(neighborhood_cells[n]);
+            }
+            new_cell_state = next_states[key];
+        };
+        return run_array_rule_step(lookup_rule, num_steps);
+    }
+
+    /**
+     * @brief Runs one step of a custom rule that reads its neighborhood through a NeighborhoodView
+     * (rule(cell_index, index_size, neighborhood, new_cell_state)).
+     *
+     * @param rule callable rule; called concurrently from every thread when OpenMP is enabled
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * 0: no error
+     */
+    template <typename ViewRule>
+    int run_view_rule_step(ViewRule &rule)
+    {
+        if (steps_in_windows())
+        {
+            auto in_place_update = [this, &rule](int *cell_index, int index_size, bool, const T *center,
+                                                 const long *offsets, const int *coords, int neighborhood_size,
+                                                 T &new_cell_state)
+            {
+                NeighborhoodView<T> neighborhood(center, offsets, coords, neighborhood_size, index_size);
+                to_global_index(cell_index);
+                rule(cell_index, index_size, neighborhood, new_cell_state);
+                to_local_index(cell_index);
+            };
+            return run_window_step(in_place_update);
+        }
+        // references the neighbors in the current state grid and applies the rule
+        auto update = [this, &rule](int *cell_index, int index_size, bool interior, T &new_cell_state)
+        {
+            long *offsets = get_offset_scratch();
+            int *coords = get_coord_scratch();
+            int neighborhood_size = 0;
+            // offsets/coords may be redirected to the stencil's tables
+            generate_neighborhood_offsets(cell_index, index_size, interior, offsets, coords, neighborhood_size);
+
+            NeighborhoodView<T> neighborhood(cells + get_flat_index(cell_index, index_size),
+                                             offsets, coords, neighborhood_size, index_size);
+            to_global_index(cell_index);
+            rule(cell_index, index_size, neighborhood, new_cell_state);
+            to_local_index(cell_index);
+        };
+        return run_step(update);
+    }
+
+    /**
+     * @brief Computes the position of the neighbor n of the cell at cell_index in the cells buffer
+     * with periodic wrapping. Uses the stencil's relative index instead of division and modulo.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param n neighbor number
+     * @return long
+     */
+    long get_periodic_neighbor_position(const int *cell_index, int index_size, int n)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        const int *d = stencil.coord(n);
+        long position = 0;
+        for (int axis = 0; axis < index_size; axis++)
+        {
+            int neighbor = cell_index[axis] + d[axis];
+            // radius never exceeds the axis size thus one wrap suffices in practice
+            while (neighbor < 0)
+            {
+                neighbor += extents[axis];
+            }
+            while (neighbor >= extents[axis])
+            {
+                neighbor -= extents[axis];
+            }
+            position += neighbor * strides[axis];
+        }
+        return position;
+    }
+
+    /**
+     * @brief Adds the neighboring cell states of an interior cell to neighborhood_cells array
+     * by adding the stencil's offsets to the cell's position; no wrapping nor bounds checks.
+     * Neighbors are listed in the order of the stencil.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param neighborhood_cells array containing neighboring cell states
+     * @param neighborhood_index keep track of number of cell states added
+     */
+    void generate_interior_neighborhood(const int *cell_index, int index_size, T *neighborhood_cells,
+                                        int &neighborhood_index)
+    {
+        const T *center = cells + get_flat_index(cell_index, index_size);
+        const long *offsets = stencil.offsets.data();
+        int stencil_size = stencil.size();
+
+        for (int n = 0; n < stencil_size; n++)
+        {
+            neighborhood_cells[n] = center[offsets[n]];
+        }
+        neighborhood_index = stencil_size;
+    }
+
+    /**
+     * @brief Adds periodic neighboring cell states to neighborhood_cells array.
+     * Neighbors are listed in the order of the stencil.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param neighborhood_cells array containing neighboring cell states
+     * @param neighborhood_index keep track of number of cell states added
+     */
+    void generate_periodic_neighborhood(const int *cell_index, int index_size, T *neighborhood_cells,
+                                        int &neighborhood_index)
+    {
+        int stencil_size = stencil.size();
+
+        for (int n = 0; n < stencil_size; n++)
+        {
+            neighborhood_cells[n] = cells[get_periodic_neighbor_position(cell_index, index_size, n)];
+        }
+        neighborhood_index = stencil_size;
+    }
+
+    /**
+     * @brief Adds cutoff neighboring cell states to neighborhood_cells array.
+     * Neighbors are listed in the order of the stencil; neighbors outside the grid are skipped.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param neighborhood_cells array containing neighboring cell states
+     * @param neighborhood_index keep track of number of cell states added
+     */
+    void generate_cutoff_neighborhood(const int *cell_index, int index_size, T *neighborhood_cells,
+                                      int &neighborhood_index)
+    {
+        long center = get_flat_index(cell_index, index_size);
+        const long *offsets = stencil.offsets.data();
+        int stencil_size = stencil.size();
+
+        for (int n = 0; n < stencil_size; n++)
+        {
+            if (!is_neighbor_inside_grid(cell_index, index_size, n))
+            {
+                // outside bounds; don't include cell state in the sum/counter
+                continue;
+            }
+            neighborhood_cells[neighborhood_index] = cells[center + offsets[n]];
+            neighborhood_index++;
+        }
+    }
+
+    /**
+     * @brief Determines if the neighbor n of the cell at cell_index lies inside the grid.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param n neighbor number
+     * @return true: neighbor is inside the grid
+     * @return false: neighbor is outside the grid
+     */
+    bool is_neighbor_inside_grid(const int *cell_index, int index_size, int n)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        const int *d = stencil.coord(n);
+        for (int axis = 0; axis < index_size; axis++)
+        {
+            int neighbor = cell_index[axis] + d[axis];
+            if (neighbor < 0 || neighbor >= extents[axis])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Rebuilds the neighborhood stencil if the grid, boundary radius or
+     * neighborhood type changed since it was last built.
+     * Sparse grids read the neighborhoods from the windows of SparseGrid::update_brick.
+     *
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the stencil\n
+     * 0: no error
+     */
+    int update_stencil()
+    {
+        long window_strides[3];
+        const long *step_strides = strides;
+        if (sparse_grid != nullptr)
+        {
+            sparse_grid->get_window_strides(boundary_radius, window_strides);
+            step_strides = window_strides;
+        }
+        if (stencil.matches(rank, boundary_radius, neighborhood_type, step_strides))
+        {
+            return 0;
+        }
+        return stencil.build(rank, boundary_radius, neighborhood_type, step_strides);
+    }
+
+    /**
+     * @brief Computes the range of cells along an axis that are updated by a step and the
+     * interior part of that range, whose neighbors are all reached with the stencil offsets.
+     * Walled edge cells never change thus they are excluded from the range.
+     * The first axis is also limited to the slabs of the current step phase (see run_distributed_tiles).
+     *
+     * @param axis axis number (0 based)
+     * @param begin first updated cell
+     * @param end one past the last updated cell
+     * @param interior_begin first interior cell (begin <= interior_begin <= interior_end)
+     * @param interior_end one past the last interior cell (interior_end <= end)
+     */
+    void get_update_range(int axis, int &begin, int &end, int &interior_begin, int &interior_end)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        bool walled = boundary_type == CAEnums::Walled;
+
+        begin = walled ? 1 : 0;
+        end = walled ? extents[axis] - 1 : extents[axis];
+        if (axis == 0)
+        {
+            // slabs of the current step phase (see run_distributed_tiles)
+            begin = std::max(begin, first_updated_slab);
+            end = std::min(end, last_updated_slab);
+        }
+        if (end < begin)
+        {
+            end = begin; // grid too small to have non-edge cells
+        }
+        if (ghost_neighborhoods)
+        {
+            // the ghost layers make every cell interior
+            interior_begin = begin;
+            interior_end = end;
+            return;
+        }
+        interior_begin = std::min(std::max(boundary_radius, begin), end);
+        interior_end = std::min(std::max(extents[axis] - boundary_radius, interior_begin), end);
+    }
+
+    /**
+     * @brief Updates the cells [begin, end) along the last axis of a row and stores them in next_cells.
+     *
+     * @param update callable that sets the new cell state (see run_step)
+     * @param row_index index of the row's cells along the other axes
+     * @param index_size number of indices required to address a cell
+     * @param begin first cell of the range
+     * @param end one past the last cell of the range
+     * @param interior every cell of the range is an interior cell
+     */
+    template <typename CellUpdate>
+    void update_cell_range(CellUpdate &update, const int *row_index, int index_size, int begin, int end,
+                           bool interior)
+    {
+        T new_cell_state;         // stores the cell's new state
+        T empty_cell_state = T(); // cell state of an empty cell
+        // Majority and Parity write every cell; custom rules only write non-empty cells
+        bool write_all_cells = rule_type != CAEnums::Custom;
+
+        for (int k = begin; k < end; k++)
+        {
+            int cell_index[3] = {row_index[0], row_index[1], row_index[2]};
+            cell_index[index_size - 1] = k;
+            new_cell_state = cells[get_flat_index(cell_index, index_size)];
+            update(cell_index, index_size, interior, new_cell_state);
+            /*
+             * The update cell if new_cell_state is no empty_state.
+             * Avoids overwriting the motion of cells.
+             */
+            if (write_all_cells || new_cell_state != empty_cell_state)
+            {
+                next_cells[get_flat_index(cell_index, index_size)] = new_cell_state;
+            }
+        }
+    }
+
+    /**
+     * @brief Updates the cells [span_begin, span_end) of a row (cells along the last axis) of the grid.
+     * Interior rows are split into the edge shells and the interior span so that
+     * the interior span runs without any wrapping nor bounds checks.
+     *
+     * @param update callable that sets the new cell state (see run_step)
+     * @param row_index index of the row's cells along the other axes
+     * @param index_size number of indices required to address a cell
+     * @param row_interior the row's index along the other axes is interior
+     * @param span_begin first cell of the span (inside the update range of the last axis)
+     * @param span_end one past the last cell of the span
+     */
+    template <typename CellUpdate>
+    void update_row(CellUpdate &update, const int *row_index, int index_size, bool row_interior,
+                    int span_begin, int span_end)
+    {
+        int begin, end, interior_begin, interior_end;
+        get_update_range(index_size - 1, begin, end, interior_begin, interior_end);
+
+        if (!row_interior)
+        {
+            update_cell_range(update, row_index, index_size, span_begin, span_end, false);
+            return;
+        }
+        // part of the interior span inside [span_begin, span_end)
+        interior_begin = std::min(std::max(interior_begin, span_begin), span_end);
+        interior_end = std::min(std::max(interior_end, interior_begin), span_end);
+        update_cell_range(update, row_index, index_size, span_begin, interior_begin, false);
+        update_cell_range(update, row_index, index_size, interior_begin, interior_end, true);
+        update_cell_range(update, row_index, index_size, interior_end, span_end, false);
+    }
+
+    /**
+     * @brief Number of rows updated by a step: rows whose index along the other axes is in
+     * their update range (see get_update_range); 1 for one dimensional grids.
+     *
+     * @return long
+     */
+    long get_num_updated_rows()
+    {
+        long num_rows = 1;
+        for (int axis = 0; axis < rank - 1; axis++)
+        {
+            int begin, end, interior_begin, interior_end;
+            get_update_range(axis, begin, end, interior_begin, interior_end);
+            num_rows *= end - begin;
+        }
+        return num_rows;
+    }
+
+    /**
+     * @brief Updates a tile of the grid: tile_rows consecutive updated rows (in row-major order)
+     * by tile_width cells along the last axis.
+     *
+     * @param update callable that sets the new cell state (see run_step)
+     * @param row_tile tile number along the updated rows
+     * @param column_tile tile number along the last axis
+     */
+    template <typename CellUpdate>
+    void update_tile(CellUpdate &update, long row_tile, long column_tile)
+    {
+        int begin[3], end[3], interior_begin[3], interior_end[3];
+        for (int axis = 0; axis < rank; axis++)
+        {
+            get_update_range(axis, begin[axis], end[axis], interior_begin[axis], interior_end[axis]);
+        }
+        int last_axis = rank - 1;
+        int span_begin = begin[last_axis] + column_tile * tile_width;
+        int span_end = std::min(span_begin + tile_width, end[last_axis]);
+        long first_row = row_tile * tile_rows;
+        long last_row = std::min(first_row + tile_rows, get_num_updated_rows());
+        long rows_per_i = rank == 3 ? end[1] - begin[1] : 1; // updated rows sharing an index along the first axis
+
+        for (long row = first_row; row < last_row; row++)
+        {
+            int row_index[3] = {0, 0, 0};
+            bool row_interior = true;
+            if (rank >= 2)
+            {
+                row_index[0] = begin[0] + row / rows_per_i;
+                row_interior = row_index[0] >= interior_begin[0] && row_index[0] < interior_end[0];
+            }
+            if (rank == 3)
+            {
+                row_index[1] = begin[1] + row % rows_per_i;
+                row_interior = row_interior && row_index[1] >= interior_begin[1] && row_index[1] < interior_end[1];
+            }
+            update_row(update, row_index, rank, row_interior, span_begin, span_end);
+        }
+    }
+
+    /**
+     * @brief Copies the edge cells of the grid into next_cells.
+     * With Walled boundaries these cells never change and are skipped by run_step.
+     *
+     */
+    void copy_walled_edge_cells()
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        int row_size = get_row_size();
+        long num_rows = num_cells / row_size;
+
+        for (long row = 0; row < num_rows; row++)
+        {
+            T *cell = get_row(cells, row);
+            T *next_cell = get_row(next_cells, row);
+            // index of the row along the other axes
+            int i = rank == 3 ? row / axis2_dim : row;
+            int j = rank == 3 ? row % axis2_dim : 0;
+            bool edge_row = (rank >= 2 && (i == 0 || i == extents[0] - 1)) ||
+                            (rank == 3 && (j == 0 || j == extents[1] - 1));
+            if (edge_row)
+            {
+                std::copy(cell, cell + row_size, next_cell);
+            }
+            else
+            {
+                next_cell[0] = cell[0];
+                next_cell[row_size - 1] = cell[row_size - 1];
+            }
+        }
+    }
+
+    /**
+     * @brief Wraps an index that is at most one axis size outside of [0, axis_dim).
+     *
+     * @param x index
+     * @param axis_dim number of cells along the axis
+     * @return int
+     */
+    static int wrap_index(int x, int axis_dim)
+    {
+        while (x < 0)
+        {
+            x += axis_dim;
+        }
+        while (x >= axis_dim)
+        {
+            x -= axis_dim;
+        }
+        return x;
+    }
+
+    /**
+     * @brief Per-thread buffers of for_each_window_block: the cell states of a block of the grid
+     * with a halo of boundary_radius cells (num_steps * boundary_radius when blocked in time) on each side
+     * of every axis, and the sums of the block.
+     *
+     * @tparam Lane int, or uint16_t when the sums fit 16 bits (see has_narrow_cells)
+     */
+    template <typename Lane>
+    struct WindowBlockScratch
+    {
+        std::vector<Lane> states;  //!< cell states of the block and its halo (row-major)
+        std::vector<Lane> passes;  //!< window sums along one axis after the other (two halo sized buffers)
+        std::vector<Lane> sums;    //!< neighborhood sums of the block's cells (row-major)
+        std::vector<Lane> matches; //!< 1 where a cell of the block or its halo is in the voted state (Majority)
+        std::vector<Lane> votes;   //!< highest number of votes of the block's cells so far (Majority)
+        std::vector<Lane> winners; //!< state with that many votes (Majority)
+    };
+
+    /**
+     * @brief Determines if the cells are narrow integers (uint8_t, uint16_t). Their states fit 16 bits,
+     * so Parity and Majority window sums run on uint16_t lanes (twice as many cells per register as int)
+     * whenever the sums fit too.
+     *
+     * @return true: uint8_t or uint16_t cells
+     * @return false: other cells
+     */
+    static bool has_narrow_cells()
+    {
+        return std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value;
+    }
+
+    /**
+     * @brief Get the extents of the grid on three axes with the grid's axes last (e.g. {1, 1, axis1_dim}
+     * for a 1d grid), so the last axis is always the contiguous one. Used by the window blocks.
+     *
+     * @param extents set to the number of cells along each axis
+     */
+    void get_block_grid_extents(int *extents)
+    {
+        int grid_extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            extents[axis] = axis < 3 - rank ? 1 : grid_extents[axis - (3 - rank)];
+        }
+    }
+
+    /**
+     * @brief Get the extents of a window block along with its halo (num_steps * boundary_radius cells on each
+     * side of the grid's axes), on the three axes of get_block_grid_extents.
+     *
+     * @param size cells of the block along each axis
+     * @param dims set to the cells of the block and its halo along each axis
+     * @param num_steps generations the block is advanced by (see advance_window_block)
+     */
+    void get_block_halo_dims(const int *size, long *dims, int num_steps = 1)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            dims[axis] = size[axis] + (axis < 3 - rank ? 0 : 2 * num_steps * boundary_radius);
+        }
+    }
+
+    /**
+     * @brief Splits the grid into blocks of WINDOW_BLOCK_EXTENTS cells (at least 4 * boundary_radius along
+     * each axis) and calls block(lo, size, scratch) for every block from the step threads. lo and size are the
+     * block's first cell and extents on the axes of get_block_grid_extents; scratch holds the calling thread's
+     * buffers, which only cover a block and its halo and are released once the blocks are done.
+     * Blocks are handed out in order with a static schedule, so each thread reads the slabs it first touched.
+     * Split grids exchange their halo slabs first and only go through this process' slabs.
+     *
+     * @tparam Lane integer type of the scratch buffers (see WindowBlockScratch)
+     * @param block callable summing and updating one block
+     * @param votes also allocate the Majority vote buffers of the scratch
+     * @param num_steps generations each block is advanced by; sizes the halo and lets the sum and vote
+     * buffers hold a whole generation (see advance_window_block)
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the block buffers\n
+     * CellsMalloc, InvalidDecomposition: see exchange_halos\n
+     * 0: no error
+     */
+    template <typename Lane, typename BlockFunction>
+    int for_each_window_block(BlockFunction block, bool votes = false, int num_steps = 1)
+    {
+        int error_code = exchange_halos();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        int extents[3];
+        get_block_grid_extents(extents);
+        int first_axis = 3 - rank;
+        int begin[3] = {0, 0, 0};
+        begin[first_axis] = lower_halo; // halo slabs of a split grid are replaced by the next exchange
+        extents[first_axis] -= upper_halo;
+
+        int block_extents[3];
+        long num_blocks[3];
+        long total_blocks = 1;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int extent = axis < first_axis ? 1 : WINDOW_BLOCK_EXTENTS[rank - 1][axis - first_axis];
+            block_extents[axis] = std::max(1, std::min(std::max(extent, 4 * boundary_radius), extents[axis] - begin[axis]));
+            num_blocks[axis] = (extents[axis] - begin[axis] + block_extents[axis] - 1) / block_extents[axis];
+            total_blocks *= num_blocks[axis];
+        }
+        long halo_dims[3];
+        get_block_halo_dims(block_extents, halo_dims, num_steps);
+        long halo_cells = halo_dims[0] * halo_dims[1] * halo_dims[2];
+        long block_cells = num_steps > 1 ? halo_cells : (long)block_extents[0] * block_extents[1] * block_extents[2];
+
+        pin_step_threads();
+#ifdef ENABLE_OMP
+#pragma omp parallel num_threads(get_step_threads()) reduction(min : error_code)
+#endif
+        {
+            WindowBlockScratch<Lane> scratch;
+            bool allocated = true;
+            try
+            {
+                scratch.states.resize(halo_cells);
+                scratch.passes.resize(2 * halo_cells);
+                scratch.sums.resize(block_cells);
+                if (votes)
+                {
+                    scratch.matches.resize(halo_cells);
+                    scratch.votes.resize(block_cells);
+                    scratch.winners.resize(block_cells);
+                }
+            }
+            catch (const std::bad_alloc &)
+            {
+                allocated = false;
+                error_code = CAEnums::NeighborhoodCellsMalloc;
+            }
+#ifdef ENABLE_OMP
+#pragma omp for schedule(static)
+#endif
+            for (long n = 0; n < total_blocks; n++)
+            {
+                if (!allocated)
+                {
+                    continue;
+                }
+                int lo[3];
+                int size[3];
+                long remainder = n;
+                for (int axis = 2; axis >= 0; axis--)
+                {
+                    lo[axis] = begin[axis] + remainder % num_blocks[axis] * block_extents[axis];
+                    size[axis] = std::min(block_extents[axis], extents[axis] - lo[axis]);
+                    remainder /= num_blocks[axis];
+                }
+                block(lo, size, scratch);
+            }
+        }
+        return error_code;
+    }
+
+    /**
+     * @brief Copies the states of a block's cells and its halo into states (row-major, see get_block_halo_dims).
+     * Periodic boundaries wrap the halo; halo cells outside the grid get the outside value.
+     *
+     * @param lo first cell of the block (axes of get_block_grid_extents)
+     * @param size cells of the block along each axis
+     * @param states block and halo states
+     * @param outside value of the cells outside the grid (e.g. 0 so they don't add to the sums)
+     * @param num_steps generations the block is advanced by (see get_block_halo_dims)
+     */
+    template <typename Lane>
+    void load_block_states(const int *lo, const int *size, Lane *states, int outside, int num_steps = 1)
+    {
+        int extents[3];
+        get_block_grid_extents(extents);
+        long dims[3];
+        get_block_halo_dims(size, dims, num_steps);
+        int r = num_steps * boundary_radius; // halo
+        bool periodic = boundary_type == CAEnums::Periodic;
+        // index along an axis of the grid of a halo coordinate; -1 outside the grid
+        auto grid_index = [&extents, periodic](int axis, int x) -> int
+        {
+            if (periodic)
+            {
+                return wrap_index(x, extents[axis]);
+            }
+            return x < 0 || x >= extents[axis] ? -1 : x;
+        };
+        int halo[3] = {0, 0, 0};
+        for (int axis = 3 - rank; axis < 3; axis++)
+        {
+            halo[axis] = r;
+        }
+
+        Lane *row_states = states;
+        for (long a = 0; a < dims[0]; a++)
+        {
+            for (long b = 0; b < dims[1]; b++, row_states += dims[2])
+            {
+                int i = grid_index(0, lo[0] - halo[0] + a);
+                int j = grid_index(1, lo[1] - halo[1] + b);
+                if (i < 0 || j < 0)
+                {
+                    std::fill(row_states, row_states + dims[2], (Lane)outside);
+                    continue;
+                }
+                const T *cell = get_row(cells, (long)i * extents[1] + j);
+                for (int k = 0; k < dims[2]; k++)
+                {
+                    int x = k >= r && k < r + size[2] ? lo[2] + k - r : grid_index(2, lo[2] + k - r);
+                    row_states[k] = (Lane)(x < 0 ? outside : get_cell_state(cell[x]));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Sums in over a window of boundary_radius cells on each side along one axis of a row-major
+     * block of dims cells; out gets 2 * boundary_radius fewer cells along that axis. Each sum is obtained
+     * from the previous one by adding the cell entering the window and subtracting the cell leaving it,
+     * so the cost per cell doesn't depend on the radius; along the other axes whole rows slide at once
+     * with the simd_* kernels.
+     *
+     * @param in values to sum
+     * @param out window sums
+     * @param dims cells of in along each axis
+     * @param axis axis number (0 based, axes of get_block_grid_extents)
+     * @param r window radius
+     */
+    template <typename Lane>
+    static void window_sums_along(const Lane *in, Lane *out, const long *dims, int axis, int r)
+    {
+        long num_outer = 1; // blocks of cells sharing the index of every axis before axis
+        long row_size = 1;  // cells between consecutive indices of the axis
+        for (int other = 0; other < axis; other++)
+        {
+            num_outer *= dims[other];
+        }
+        for (int other = axis + 1; other < 3; other++)
+        {
+            row_size *= dims[other];
+        }
+        long in_dim = dims[axis];
+        long out_dim = in_dim - 2 * r;
+        for (long outer = 0; outer < num_outer; outer++)
+        {
+            const Lane *block_in = in + outer * in_dim * row_size;
+            Lane *block_out = out + outer * out_dim * row_size;
+            if (row_size == 1)
+            {
+                Lane sum = 0;
+                for (int d = 0; d <= 2 * r; d++)
+                {
+                    sum += block_in[d];
+                }
+                block_out[0] = sum;
+                for (long x = 1; x < out_dim; x++)
+                {
+                    sum += block_in[x + 2 * r] - block_in[x - 1];
+                    block_out[x] = sum;
+                }
+                continue;
+            }
+            // window of the first cell, then slide the window along the axis
+            std::copy(block_in, block_in + row_size, block_out);
+            for (int d = 1; d <= 2 * r; d++)
+            {
+                simd_add_arrays(block_out, block_out, block_in + d * row_size, row_size);
+            }
+            for (long x = 1; x < out_dim; x++)
+            {
+                simd_add_sub_arrays(block_out + x * row_size, block_out + (x - 1) * row_size,
+                                    block_in + (x + 2 * r) * row_size, block_in + (x - 1) * row_size, row_size);
+            }
+        }
+    }
+
+    /**
+     * @brief Sums the values of every cell's neighborhood (cell of interest included) over a block
+     * and stores them in sums (row-major over the block). values holds the block and its halo.
+     * Moore neighborhoods are boxes thus their sums are window sums along every axis in turn.
+     * VonNeumann neighborhoods are crosses thus their sums add up the window sums of each axis.
+     *
+     * @param values one value per cell of the block and its halo (see load_block_states)
+     * @param size cells of the block along each axis
+     * @param scratch thread's buffers; the sums are written to scratch.sums
+     */
+    template <typename Lane>
+    void sum_block_neighborhoods(const Lane *values, const int *size, WindowBlockScratch<Lane> &scratch)
+    {
+        long dims[3];
+        get_block_halo_dims(size, dims);
+        int r = boundary_radius;
+        int first_axis = 3 - rank;
+        long halo_cells = dims[0] * dims[1] * dims[2];
+        Lane *sums = scratch.sums.data();
+        if (neighborhood_type == CAEnums::Moore || rank == 1)
+        {
+            const Lane *in = values;
+            for (int axis = 2; axis >= first_axis; axis--)
+            {
+                // alternate buffers so that the first axis writes the sums
+                Lane *out = axis == first_axis ? sums : scratch.passes.data() + (axis % 2) * halo_cells;
+                window_sums_along(in, out, dims, axis, r);
+                dims[axis] -= 2 * r;
+                in = out;
+            }
+            return;
+        }
+
+        // the cell of interest is part of every axis' window; count it once
+        int repeats = rank - 1;
+        Lane *axis_sums = scratch.passes.data();
+        for (int pass = -1; pass < rank; pass++)
+        {
+            // pass -1 starts the sums with the repeated cells of interest, pass n adds the window sums of axis n
+            int axis = first_axis + pass;
+            long in_dims[3] = {dims[0], dims[1], dims[2]};
+            const Lane *in = values;
+            if (pass >= 0)
+            {
+                window_sums_along(values, axis_sums, in_dims, axis, r);
+                in_dims[axis] -= 2 * r;
+                in = axis_sums;
+            }
+            // the block's cells sit past the halo, except along the summed axis
+            long offset[3];
+            for (int other = 0; other < 3; other++)
+            {
+                offset[other] = other < first_axis || other == axis ? 0 : r;
+            }
+            Lane *row_sums = sums;
+            for (long a = 0; a < size[0]; a++)
+            {
+                for (long b = 0; b < size[1]; b++, row_sums += size[2])
+                {
+                    const Lane *row_in = in + ((a + offset[0]) * in_dims[1] + b + offset[1]) * in_dims[2] + offset[2];
+                    if (pass < 0)
+                    {
+                        for (int k = 0; k < size[2]; k++)
+                        {
+                            row_sums[k] = (Lane)(-repeats * row_in[k]); // uint16_t lanes wrap back once the axes are added
+                        }
+                    }
+                    else
+                    {
+                        simd_add_arrays(row_sums, row_sums, row_in, size[2]);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the next state of every cell of a block into next_cells.
+     *
+     * @param lo first cell of the block (axes of get_block_grid_extents)
+     * @param size cells of the block along each axis
+     * @param states next state of the block's cells (row-major over the block)
+     */
+    template <typename Lane>
+    void write_block_states(const int *lo, const int *size, const Lane *states)
+    {
+        int extents[3];
+        get_block_grid_extents(extents);
+        for (long a = 0; a < size[0]; a++)
+        {
+            for (long b = 0; b < size[1]; b++, states += size[2])
+            {
+                long row = (lo[0] + a) * extents[1] + lo[1] + b;
+                const T *cell = get_row(cells, row) + lo[2];
+                T *next_cell = get_row(next_cells, row) + lo[2];
+                for (int k = 0; k < size[2]; k++)
+                {
+                    next_cell[k] = cell[k];
+                    set_cell_state(next_cell[k], states[k]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Finishes a step whose blocks wrote next_cells: Walled edge cells keep their state,
+     * the generations are swapped and the step is logged.
+     *
+     * @param num_steps generations the blocks were advanced by
+     * @param stage the intermediate generations were staged in staged_states and are logged first
+     * @return int - error code (see append_log)
+     */
+    int finish_block_step(int num_steps = 1, bool stage = false)
+    {
+        if (boundary_type == CAEnums::Walled)
+        {
+            copy_walled_edge_cells(); // with walled boundaries the edge cells never change
+        }
+
+        // the next cell state becomes the current cell state for the next time step
+        swap_generations();
+        for (int generation = 1; generation < num_steps; generation++)
+        {
+            steps_taken++;
+            if (stage)
+            {
+                append_log_states(staged_states.data() + (generation - 1) * num_cells, num_cells);
+            }
+        }
+        steps_taken++;
+        // Appending the step to the file log
+        return append_log();
+    }
+
+    /**
+     * @brief Resets the cells of a generation computed in a window block buffer that a step doesn't update:
+     * cells outside the grid get the outside value back and Walled edge cells keep their state.
+     * Periodic grids have neither.
+     *
+     * @param lo first cell of the part (axes of get_block_grid_extents; may be outside the grid)
+     * @param size cells of the part along each axis
+     * @param previous previous generation of the part and its halo of boundary_radius cells (row-major)
+     * @param states new generation of the part (row-major)
+     * @param outside value of the cells outside the grid (see load_block_states)
+     */
+    template <typename Lane>
+    void restore_block_boundary(const int *lo, const int *size, const Lane *previous, Lane *states, int outside)
+    {
+        if (boundary_type == CAEnums::Periodic)
+        {
+            return;
+        }
+        bool walled = boundary_type == CAEnums::Walled;
+        int extents[3];
+        get_block_grid_extents(extents);
+        long dims[3];
+        get_block_halo_dims(size, dims);
+        int first_axis = 3 - rank;
+        int r[3] = {0, 0, 0};
+        for (int axis = first_axis; axis < 3; axis++)
+        {
+            r[axis] = boundary_radius;
+        }
+        // cells of the rows inside the grid along the last axis
+        int first = std::max(0, -lo[2]);
+        int last = std::max(first, std::min(size[2], extents[2] - lo[2]));
+        Lane *row_states = states;
+        for (long a = 0; a < size[0]; a++)
+        {
+            for (long b = 0; b < size[1]; b++, row_states += size[2])
+            {
+                int i = lo[0] + a;
+                int j = lo[1] + b;
+                if (i < 0 || i >= extents[0] || j < 0 || j >= extents[1] || first == last)
+                {
+                    std::fill(row_states, row_states + size[2], (Lane)outside);
+                    continue;
+                }
+                std::fill(row_states, row_states + first, (Lane)outside);
+                std::fill(row_states + last, row_states + size[2], (Lane)outside);
+                if (!walled)
+                {
+                    continue;
+                }
+                const Lane *row_previous = previous + ((a + r[0]) * dims[1] + b + r[1]) * dims[2] + r[2];
+                bool edge_row = (first_axis <= 0 && (i == 0 || i == extents[0] - 1)) ||
+                                (first_axis <= 1 && (j == 0 || j == extents[1] - 1));
+                if (edge_row)
+                {
+                    std::copy(row_previous + first, row_previous + last, row_states + first);
+                    continue;
+                }
+                if (lo[2] + first == 0)
+                {
+                    row_states[first] = row_previous[first];
+                }
+                if (lo[2] + last == extents[2])
+                {
+                    row_states[last - 1] = row_previous[last - 1];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Advances a window block num_steps Parity or Majority generations in the scratch buffers and
+     * writes the last one to next_cells. The block is loaded once with a halo of num_steps * boundary_radius
+     * cells; each generation updates the block and the reach of the generations left around it, so the part
+     * shrinks by the radius every generation and neighboring blocks recompute their overlapping halos.
+     * Parity sums the part's neighborhoods and reduces them modulo num_states; Majority votes one state
+     * at a time (see run_majority_vote_step).
+     *
+     * @param lo first cell of the block (axes of get_block_grid_extents)
+     * @param size cells of the block along each axis
+     * @param num_steps number of generations
+     * @param stage copy the block's intermediate generations to staged_states
+     * @param scratch thread's buffers (see for_each_window_block)
+     */
+    template <typename Lane>
+    void advance_window_block(const int *lo, const int *size, int num_steps, bool stage,
+                              WindowBlockScratch<Lane> &scratch)
+    {
+        bool parity = rule_type == CAEnums::Parity;
+        int outside = parity ? 0 : -1; // cells outside the grid don't add to the sums nor vote
+        load_block_states(lo, size, scratch.states.data(), outside, num_steps);
+        int first_axis = 3 - rank;
+        for (int generation = 1; generation <= num_steps; generation++)
+        {
+            int reach = (num_steps - generation) * boundary_radius;
+            int part_lo[3];
+            int part_size[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int halo = axis < first_axis ? 0 : reach;
+                part_lo[axis] = lo[axis] - halo;
+                part_size[axis] = size[axis] + 2 * halo;
+            }
+            long part_cells = (long)part_size[0] * part_size[1] * part_size[2];
+            const Lane *states = scratch.states.data();
+            Lane *next_states = nullptr;
+            if (parity)
+            {
+                sum_block_neighborhoods(states, part_size, scratch);
+                next_states = scratch.sums.data();
+                simd_remainder_array(next_states, next_states, num_states, part_cells);
+            }
+            else
+            {
+                long dims[3];
+                get_block_halo_dims(part_size, dims);
+                long halo_cells = dims[0] * dims[1] * dims[2];
+                Lane *best_votes = scratch.votes.data();
+                next_states = scratch.winners.data();
+                std::fill(best_votes, best_votes + part_cells, (Lane)0); // state 0 takes the lead with any number of votes
+                for (int state = 0; state < num_states; state++)
+                {
+                    simd_match_state_array(scratch.matches.data(), states, state, halo_cells);
+                    sum_block_neighborhoods(scratch.matches.data(), part_size, scratch);
+                    simd_vote_state_array(best_votes, next_states, scratch.sums.data(), state, part_cells);
+                }
+            }
+            restore_block_boundary(part_lo, part_size, states, next_states, outside);
+            if (generation == num_steps)
+            {
+                write_block_states(lo, size, next_states);
+                return;
+            }
+
+            if (stage)
+            {
+                // the block sits lo - part_lo cells into the part
+                int extents[3];
+                get_block_grid_extents(extents);
+                int *staged = staged_states.data() + (generation - 1) * num_cells;
+                for (long a = 0; a < size[0]; a++)
+                {
+                    for (long b = 0; b < size[1]; b++)
+                    {
+                        const Lane *row = next_states + ((a + lo[0] - part_lo[0]) * part_size[1] + b + lo[1] - part_lo[1]) *
+                                                            part_size[2] +
+                                          lo[2] - part_lo[2];
+                        int *state = staged + ((lo[0] + a) * extents[1] + lo[1] + b) * extents[2] + lo[2];
+                        for (int k = 0; k < size[2]; k++)
+                        {
+                            state[k] = row[k];
+                        }
+                    }
+                }
+            }
+            // the generation becomes the input of the next one
+            std::swap(scratch.states, parity ? scratch.sums : scratch.winners);
+        }
+    }
+
+    /**
+     * @brief Runs num_steps Parity or Majority steps with the array rule kernels (see run_array_rule_step),
+     * which compute one neighborhood at a time: Parity sums it, Majority counts its votes in a
+     * MajorityHistogram. Used where the window sum kernels can't run (in-place grids, activity tracking,
+     * Majority with many states); several steps are blocked in time like Custom rules.
+     *
+     * @param num_steps number of steps to run (see run_array_rule_steps)
+     * @return int - error code (see run_array_rule_step)
+     */
+    int run_builtin_array_rule_steps(int num_steps)
+    {
+        int states = num_states;
+        if (rule_type == CAEnums::Parity)
+        {
+            auto parity_rule = [states](int *, int, T *neighborhood_cells, int neighborhood_size,
+                                        T &new_cell_state)
+            {
+                int sum = 0;
+                for (int i = 0; i < neighborhood_size; i++)
+                {
+                    sum += get_cell_state(neighborhood_cells[i]);
+                }
+                set_cell_state(new_cell_state, sum % states);
+            };
+            return run_array_rule_step(parity_rule, num_steps);
+        }
+        auto majority_rule = [this, states](int *, int, T *neighborhood_cells, int neighborhood_size,
+                                            T &new_cell_state)
+        {
+            MajorityHistogram state_votes(states, get_vote_scratch()); // votes of each cell state
+            for (int i = 0; i < neighborhood_size; i++)
+            {
+                state_votes.vote(get_cell_state(neighborhood_cells[i]));
+            }
+            set_cell_state(new_cell_state, state_votes.majority_state());
+        };
+        return run_array_rule_step(majority_rule, num_steps);
+    }
+
+    /**
+     * @brief Determines if step_n can block a built-in rule in time: Parity and Majority steps of a two-buffer
+     * grid that doesn't track activity, isn't split across processes and doesn't run on bit-packed cells.
+     *
+     * @return true: use run_blocked_builtin_steps
+     * @return false: run one step() at a time
+     */
+    bool can_block_builtin_steps()
+    {
+        return (rule_type == CAEnums::Parity || rule_type == CAEnums::Majority) && !in_place && !track_activity &&
+               !is_distributed() && !can_step_packed_binary();
+    }
+
+    /**
+     * @brief Runs num_steps Parity or Majority steps of step_n blocked in time: the window sum and vote
+     * kernels advance each window block several generations at once (see run_window_rule_steps);
+     * Majority with many states counts every neighborhood's votes and is blocked like Custom rules.
+     *
+     * @param num_steps number of steps
+     * @return int - error code (see run_parity_step and run_array_rule_step)
+     */
+    int run_blocked_builtin_steps(int num_steps)
+    {
+        if (rule_type == CAEnums::Parity)
+        {
+            return run_parity_step(num_steps);
+        }
+        if (prefers_majority_votes())
+        {
+            return run_majority_vote_step(num_steps);
+        }
+        return run_builtin_array_rule_steps(num_steps);
+    }
+
+    /**
+     * @brief Runs num_steps Parity steps: the neighborhood sums are computed block by block with window sums
+     * (see for_each_window_block) and reduced modulo num_states with the simd_* kernels. Several steps
+     * advance each block several generations at a time (see run_window_rule_steps).
+     * Narrow cells sum in uint16_t lanes when no sum can exceed 65535, or when num_states divides 65536
+     * so that sums wrapping modulo 65536 keep their remainder.
+     *
+     * @param num_steps number of steps
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the block buffers\n
+     * 0: no error
+     */
+    int run_parity_step(int num_steps = 1)
+    {
+        if (cells == nullptr)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        long max_state = sizeof(T) == 1 ? 255 : 65535; // only used by narrow cells
+        long max_sum = max_state * get_neighborhood_size(rank, boundary_radius, neighborhood_type);
+        if (has_narrow_cells() && (max_sum <= 65535 || 65536 % num_states == 0))
+        {
+            return run_window_rule_steps<uint16_t>(num_steps);
+        }
+        return run_window_rule_steps<int>(num_steps);
+    }
+
+    /**
+     * @brief Runs num_steps Parity or Majority (vote) steps on Lane sums. Consecutive steps are blocked in
+     * time: each window block advances get_block_steps generations at once in its thread's buffers
+     * (see advance_window_block), so the grid is read and written once per block of generations.
+     *
+     * @tparam Lane integer type of the window sums (see WindowBlockScratch)
+     * @param num_steps number of steps
+     * @return int - error code (see run_parity_step)
+     */
+    template <typename Lane>
+    int run_window_rule_steps(int num_steps)
+    {
+        bool votes = rule_type == CAEnums::Majority;
+        while (num_steps > 0)
+        {
+            int block_steps = get_block_steps(num_steps, true);
+            bool stage = block_steps > 1 && can_append_log();
+            try
+            {
+                staged_states.resize(stage ? (block_steps - 1) * num_cells : 0);
+            }
+            catch (const std::bad_alloc &)
+            {
+                return CAEnums::NeighborhoodCellsMalloc;
+            }
+            int error_code = for_each_window_block<Lane>(
+                [this, block_steps, stage](const int *lo, const int *size, WindowBlockScratch<Lane> &scratch)
+                { advance_window_block(lo, size, block_steps, stage, scratch); },
+                votes, block_steps);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+            error_code = finish_block_step(block_steps, stage);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+            num_steps -= block_steps;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Determines if voting one state at a time (run_majority_vote_step) is cheaper than
+     * counting every neighborhood in a MajorityHistogram. Each vote sweeps the grid about rank + 2
+     * times while the histogram reads every neighbor of every cell; measured on a 1024x1024 grid
+     * the two break even at about twice the neighborhood size.
+     *
+     * @return true: use run_majority_vote_step
+     * @return false: use the per-cell histogram
+     */
+    bool prefers_majority_votes()
+    {
+        return num_states * (rank + 2) <= 2 * get_neighborhood_size(rank, boundary_radius, neighborhood_type);
+    }
+
+    /**
+     * @brief Runs num_steps Majority steps by voting one state at a time: the neighbors in each state
+     * are counted with window sums over a 0/1 match array and the state with the most votes wins
+     * (ties go to the highest state, like MajorityHistogram). Every pass runs on the simd_* kernels,
+     * so this beats the per-cell histogram when there are few states (see prefers_majority_votes).
+     * The votes are counted block by block in the step threads' buffers (see run_window_rule_steps).
+     * Narrow cells count them in uint16_t lanes, where 65535 marks the cells outside the grid.
+     *
+     * @param num_steps number of steps
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the block buffers\n
+     * 0: no error
+     */
+    int run_majority_vote_step(int num_steps = 1)
+    {
+        if (cells == nullptr)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (has_narrow_cells() && num_states <= 65535 &&
+            get_neighborhood_size(rank, boundary_radius, neighborhood_type) <= 65535)
+        {
+            return run_window_rule_steps<uint16_t>(num_steps);
+        }
+        return run_window_rule_steps<int>(num_steps);
+    }
+
+    /**
+     * @brief Number of cells in the neighborhood of the cell at cell_index (cell of interest included).
+     * Periodic neighborhoods always have get_neighborhood_size cells;
+     * CutOff/Walled neighborhoods leave out the cells outside the grid.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @return int
+     */
+    int get_cell_neighborhood_size(const int *cell_index, int index_size)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        if (boundary_type == CAEnums::Periodic)
+        {
+            return get_neighborhood_size(index_size, boundary_radius, neighborhood_type);
+        }
+
+        int box_size = 1;  // Moore: product of the window lengths
+        int cross_size = 1; // VonNeumann: sum of the window lengths without the repeated cell of interest
+        for (int axis = 0; axis < index_size; axis++)
+        {
+            int first = std::max(cell_index[axis] - boundary_radius, 0);
+            int last = std::min(cell_index[axis] + boundary_radius, extents[axis] - 1);
+            box_size *= last - first + 1;
+            cross_size += last - first;
+        }
+        return neighborhood_type == CAEnums::Moore ? box_size : cross_size;
+    }
+
+    /**
+     * @brief Runs one step of a totalistic rule, whose new state only depends on the cell
+     * and the sum of its neighborhood's states. The sums are computed block by block with window sums
+     * (see for_each_window_block) so the cost per cell doesn't depend on the boundary radius.
+     *
+     * @param rule callable rule(sum, neighborhood_size, new_cell_state); new_cell_state
+     * is initially the cell's current state
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the block buffers\n
+     * 0: no error
+     */
+    template <typename TotalisticRule>
+    int run_totalistic_step(TotalisticRule &rule)
+    {
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (steps_in_windows())
+        {
+            // in-place grids are overwritten while they're swept and sparse grids have no
+            // current state buffer, so the sums are taken from the window
+            auto in_place_update = [&rule](int *, int, bool, const T *center, const long *offsets, const int *,
+                                           int neighborhood_size, T &new_cell_state)
+            {
+                int sum = 0;
+                for (int n = 0; n < neighborhood_size; n++)
+                {
+                    sum += get_cell_state(center[offsets[n]]);
+                }
+                rule(sum, neighborhood_size, new_cell_state);
+            };
+            return run_window_step(in_place_update);
+        }
+        if (track_activity)
+        {
+            // only the recomputed tiles sum their neighborhoods
+            auto sum_rule = [&rule](int *, int, T *neighborhood_cells, int neighborhood_size, T &new_cell_state)
+            {
+                int sum = 0;
+                for (int n = 0; n < neighborhood_size; n++)
+                {
+                    sum += get_cell_state(neighborhood_cells[n]);
+                }
+                rule(sum, neighborhood_size, new_cell_state);
+            };
+            return run_array_rule_step(sum_rule);
+        }
+        // the sums of each block are taken from the thread's block buffers
+        int first_axis = 3 - rank;
+        bool walled = boundary_type == CAEnums::Walled;
+        int error_code = for_each_window_block<int>(
+            [this, &rule, first_axis, walled](const int *lo, const int *size, WindowBlockScratch<int> &scratch)
+            {
+                load_block_states(lo, size, scratch.states.data(), 0);
+                sum_block_neighborhoods(scratch.states.data(), size, scratch);
+                int extents[3];
+                get_block_grid_extents(extents);
+                const int *sums = scratch.sums.data();
+                for (long a = 0; a < size[0]; a++)
+                {
+                    for (long b = 0; b < size[1]; b++, sums += size[2])
+                    {
+                        long row = (lo[0] + a) * extents[1] + lo[1] + b;
+                        const T *cell = get_row(cells, row) + lo[2];
+                        T *next_cell = get_row(next_cells, row) + lo[2];
+                        for (int k = 0; k < size[2]; k++)
+                        {
+                            int index[3] = {(int)(lo[0] + a), (int)(lo[1] + b), lo[2] + k};
+                            bool edge = false; // Walled edge cells never change
+                            for (int axis = first_axis; axis < 3 && walled; axis++)
+                            {
+                                edge = edge || index[axis] == 0 || index[axis] == extents[axis] - 1;
+                            }
+                            T new_cell_state = cell[k];
+                            if (!edge)
+                            {
+                                rule(sums[k], get_cell_neighborhood_size(index + first_axis, rank), new_cell_state);
+                            }
+                            next_cell[k] = new_cell_state;
+                        }
+                    }
+                }
+            });
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        return finish_block_step();
+    }
+
+    /**
+     * @brief Determines if this step can run on bit-packed cells: two cell states with the
+     * Parity rule (every boundary) or the Majority rule (Periodic boundaries only since
+     * CutOff/Walled neighborhoods shrink near the edges, which changes the majority threshold).
+     *
+     * @return true: step can use the bit-packed kernels
+     * @return false: step needs the generic kernels
+     */
+    bool can_step_packed_binary()
+    {
+        return num_states == 2 &&
+               (rule_type == CAEnums::Parity ||
+                (rule_type == CAEnums::Majority && boundary_type == CAEnums::Periodic));
+    }
+
+    /**
+     * @brief Packs the current cells into packed_rows, one bit per cell and 64 cells per word.
+     * Every row is padded with boundary_radius bits on each side holding the wrapped cells
+     * (Periodic) or 0 (CutOff/Walled) so that shifted rows never need bounds checks.
+     * An extra all-zero row stands for the rows outside CutOff/Walled grids.
+     * packed_rows and next_packed_rows keep their memory from one step to the next, while the cell
+     * buffers of integer grids are released until the cells are unpacked (see release_cell_buffers).
+     *
+     * @return true: cells were packed
+     * @return false: a cell state isn't 0 or 1 (or memory ran out) thus cells can't be packed
+     */
+    bool pack_binary_cells()
+    {
+        int row_size = get_row_size();
+        long num_rows = num_cells / row_size;
+        int r = boundary_radius;
+        bool periodic = boundary_type == CAEnums::Periodic;
+        bool valid = true;
+
+        // +1 word so that reads of shifted rows stay in bounds
+        packed_row_words = (row_size + 2 * r + 63) / 64 + 1;
+        long packed_size = (num_rows + 1) * packed_row_words;
+        try
+        {
+            packed_rows.resize(packed_size);
+            next_packed_rows.resize(packed_size);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return false;
+        }
+        // the all-zero row of both generations
+        std::fill(packed_rows.end() - packed_row_words, packed_rows.end(), 0);
+        std::fill(next_packed_rows.end() - packed_row_words, next_packed_rows.end(), 0);
+
+#ifdef ENABLE_OMP
+#pragma omp parallel for reduction(&& : valid) num_threads(get_step_threads())
+#endif
+        for (long row = 0; row < num_rows; row++)
+        {
+            uint64_t *words = packed_rows.data() + row * packed_row_words;
+            T *cell = get_row(cells, row);
+            std::fill(words, words + packed_row_words, 0);
+            for (int k = -r; k < row_size + r; k++)
+            {
+                int source = k;
+                if (k < 0 || k >= row_size)
+                {
+                    if (!periodic)
+                    {
+                        continue; // padding bits stay 0
+                    }
+                    source = wrap_index(k, row_size);
+                }
+                int state = get_cell_state(cell[source]);
+                valid = valid && (state == 0 || state == 1);
+                long bit = k + r;
+                words[bit >> 6] |= static_cast<uint64_t>(state & 1) << (bit & 63);
+            }
+        }
+        return valid;
+    }
+
+    /**
+     * @brief Writes the packed cells back into the cell buffers when packed_rows hold the current
+     * generation (see step_packed_binary), reallocating the buffers when they were released.
+     * The other members of the cells are copied from the generation in the cell buffers,
+     * which becomes the next state buffer.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't reallocate the cell buffers (the cells stay packed)\n
+     * 0: no error
+     */
+    int unpack_binary_cells()
+    {
+        if (!packed_cells_current)
+        {
+            return 0;
+        }
+        int error_code = restore_cell_buffers();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        packed_cells_current = false;
+        int row_size = get_row_size();
+        long num_rows = num_cells / row_size;
+        int r = boundary_radius;
+
+#ifdef ENABLE_OMP
+#pragma omp parallel for num_threads(get_step_threads())
+#endif
+        for (long row = 0; row < num_rows; row++)
+        {
+            const uint64_t *words = packed_rows.data() + row * packed_row_words;
+            T *cell = get_row(cells, row);
+            T *next_cell = get_row(next_cells, row);
+            for (int k = 0; k < row_size; k++)
+            {
+                next_cell[k] = cell[k];
+                set_cell_state(next_cell[k], get_packed_bit(words, k + r));
+            }
+        }
+        swap_generations();
+        return 0;
+    }
+
+    /**
+     * @brief Appends the current generation to the log file from packed_rows, like append_log.
+     *
+     * @return int error code
+     */
+    int append_packed_log()
+    {
+        std::ofstream file;
+        file.open(FILE_PATH, std::ios::app);
+        int row_size = get_row_size();
+        int r = boundary_radius;
+        for (long row = 0; row < num_cells / row_size; row++)
+        {
+            const uint64_t *words = packed_rows.data() + row * packed_row_words;
+            for (int k = 0; k < row_size; k++)
+            {
+                file << get_packed_bit(words, k + r) << ",";
+            }
+        }
+        file << "\n";
+        file.close();
+        return 0;
+    }
+
+    /**
+     * @brief Reads one bit of a packed row.
+     *
+     * @param words packed row
+     * @param bit position of the bit
+     * @return int 0 or 1
+     */
+    static int get_packed_bit(const uint64_t *words, long bit)
+    {
+        return (words[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    /**
+     * @brief Sets one bit of a packed row.
+     *
+     * @param words packed row
+     * @param bit position of the bit
+     * @param value 0 or 1
+     */
+    static void set_packed_bit(uint64_t *words, long bit, int value)
+    {
+        uint64_t mask = 1ULL << (bit & 63);
+        words[bit >> 6] = value ? words[bit >> 6] | mask : words[bit >> 6] & ~mask;
+    }
+
+    /**
+     * @brief Stores the next states of a row (see step_packed_binary_row) into a packed row of
+     * next_packed_rows, with the same padding as pack_binary_cells. With Walled boundaries the
+     * edge cells keep their current state.
+     *
+     * @param row row number (see get_row)
+     * @param next_words one word per 64 cells of the row
+     */
+    void store_packed_row(long row, const uint64_t *next_words)
+    {
+        int row_size = get_row_size();
+        int num_words = (row_size + 63) / 64;
+        int r = boundary_radius;
+        const uint64_t *words = packed_rows.data() + row * packed_row_words;
+        uint64_t *next_row_words = next_packed_rows.data() + row * packed_row_words;
+
+        std::fill(next_row_words, next_row_words + packed_row_words, 0);
+        for (int w = 0; w < num_words; w++)
+        {
+            uint64_t bits = next_words[w];
+            if (w == num_words - 1 && row_size % 64 != 0)
+            {
+                bits &= (1ULL << (row_size % 64)) - 1; // bits past the end of the row
+            }
+            long bit = 64L * w + r;
+            int shift = bit & 63;
+            next_row_words[bit >> 6] |= bits << shift;
+            if (shift != 0)
+            {
+                next_row_words[(bit >> 6) + 1] |= bits >> (64 - shift);
+            }
+        }
+
+        if (boundary_type == CAEnums::Periodic)
+        {
+            for (int k = 0; k < r; k++)
+            {
+                set_packed_bit(next_row_words, k, get_packed_bit(next_row_words, row_size + k));
+                set_packed_bit(next_row_words, row_size + r + k, get_packed_bit(next_row_words, r + k));
+            }
+        }
+        else if (boundary_type == CAEnums::Walled)
+        {
+            // the edge cells never change (see copy_walled_edge_cells)
+            int i = rank == 3 ? row / axis2_dim : row;
+            int j = rank == 3 ? row % axis2_dim : 0;
+            bool edge_row = (rank >= 2 && (i == 0 || i == axis1_dim - 1)) ||
+                            (rank == 3 && (j == 0 || j == axis2_dim - 1));
+            if (edge_row)
+            {
+                std::copy(words, words + packed_row_words, next_row_words);
+            }
+            else
+            {
+                set_packed_bit(next_row_words, r, get_packed_bit(words, r));
+                set_packed_bit(next_row_words, r + row_size - 1, get_packed_bit(words, r + row_size - 1));
+            }
+        }
+    }
+
+    /**
+     * @brief Reads 64 consecutive bits of a packed row starting at the given bit.
+     *
+     * @param words packed row
+     * @param bit position of the first bit
+     * @return uint64_t
+     */
+    static uint64_t extract_packed_word(const uint64_t *words, long bit)
+    {
+        long word = bit >> 6;
+        int shift = bit & 63;
+        if (shift == 0)
+        {
+            return words[word];
+        }
+        return (words[word] >> shift) | (words[word + 1] << (64 - shift));
+    }
+
+    /**
+     * @brief Get the packed row holding the neighbors of a row along the other axes.
+     *
+     * @param row row number (see get_row)
+     * @param d neighbor's relative index along the axes before the last
+     * @return const uint64_t* packed row (the all-zero row when outside CutOff/Walled grids)
+     */
+    const uint64_t *get_packed_neighbor_row(long row, const int *d)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        int row_index[2] = {0, 0}; // row's index along the axes before the last
+        long num_rows = num_cells / get_row_size();
+        long neighbor_row = 0;
+
+        if (rank == 2)
+        {
+            row_index[0] = row;
+        }
+        else if (rank == 3)
+        {
+            row_index[0] = row / axis2_dim;
+            row_index[1] = row % axis2_dim;
+        }
+        for (int axis = 0; axis < rank - 1; axis++)
+        {
+            int neighbor = row_index[axis] + d[axis];
+            if (boundary_type == CAEnums::Periodic)
+            {
+                neighbor = wrap_index(neighbor, extents[axis]);
+            }
+            else if (neighbor < 0 || neighbor >= extents[axis])
+            {
+                return packed_rows.data() + num_rows * packed_row_words; // all-zero row
+            }
+            neighbor_row = neighbor_row * extents[axis] + neighbor;
+        }
+        return packed_rows.data() + neighbor_row * packed_row_words;
+    }
+
+    /**
+     * @brief Computes the next state of a row with bitwise kernels, 64 cells at a time.
+     * Parity XORs the shifted neighbor rows. Majority adds them with a bit-sliced counter
+     * (one word per bit of the count) and compares the count with half the neighborhood size.
+     *
+     * @param row row number (see get_row)
+     * @param next_words one word per 64 cells of the row; receives the next states
+     * @param counter bit-sliced counter scratch; num_planes words per 64 cells
+     * @param num_planes number of bits of the counter
+     */
+    void step_packed_binary_row(long row, uint64_t *next_words, uint64_t *counter, int num_planes)
+    {
+        int row_size = get_row_size();
+        int num_words = (row_size + 63) / 64;
+        int stencil_size = stencil.size();
+        int r = boundary_radius;
+        bool parity = rule_type == CAEnums::Parity;
+
+        std::fill(next_words, next_words + num_words, 0);
+        if (!parity)
+        {
+            std::fill(counter, counter + num_words * num_planes, 0);
+        }
+
+        for (int n = 0; n < stencil_size; n++)
+        {
+            const int *d = stencil.coord(n);
+            const uint64_t *neighbor_words = get_packed_neighbor_row(row, d);
+            long first_bit = d[rank - 1] + r; // shift along the last axis
+            for (int w = 0; w < num_words; w++)
+            {
+                uint64_t neighbors = extract_packed_word(neighbor_words, 64L * w + first_bit);
+                if (parity)
+                {
+                    next_words[w] ^= neighbors;
+                    continue;
+                }
+                // add one to the bit-sliced counter of every cell whose neighbor is 1
+                uint64_t carry = neighbors;
+                uint64_t *planes = counter + w * num_planes;
+                for (int b = 0; b < num_planes && carry != 0; b++)
+                {
+                    uint64_t next_carry = planes[b] & carry;
+                    planes[b] ^= carry;
+                    carry = next_carry;
+                }
+            }
+        }
+
+        if (parity)
+        {
+            return;
+        }
+        // majority: 1 when the number of 1s is at least the number of 0s
+        int threshold = (stencil_size + 1) / 2;
+        for (int w = 0; w < num_words; w++)
+        {
+            uint64_t *planes = counter + w * num_planes;
+            uint64_t greater = 0;
+            uint64_t equal = ~0ULL;
+            for (int b = num_planes - 1; b >= 0; b--)
+            {
+                if ((threshold >> b) & 1)
+                {
+                    equal &= planes[b];
+                }
+                else
+                {
+                    greater |= equal & planes[b];
+                    equal &= ~planes[b];
+                }
+            }
+            next_words[w] = greater | equal;
+        }
+    }
+
+    /**
+     * @brief Runs one binary Parity/Majority step on bit-packed cells (see can_step_packed_binary).
+     * The cells are updated 64 at a time from packed_rows into next_packed_rows, and the packed
+     * generations are swapped. packed_rows stay the grid of record over consecutive packed steps:
+     * the cells are only packed when the cell buffers hold the current generation, and only unpacked
+     * when they are read (see unpack_binary_cells). Grids split across processes are unpacked after
+     * every step since their halos are exchanged through the cell buffers.
+     *
+     * @param packed set to false when the cells can't be packed; nothing is changed then
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the stencil\n
+     * CellsMalloc, InvalidDecomposition: see exchange_halos\n
+     * 0: no error
+     */
+    int step_packed_binary(bool &packed)
+    {
+        packed = false;
+        int error_code = 0;
+        if (!packed_cells_current)
+        {
+            error_code = exchange_halos();
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        error_code = update_stencil();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        int row_size = get_row_size();
+        long num_rows = num_cells / row_size;
+        int num_words = (row_size + 63) / 64;
+        int num_planes = 1; // bits needed to count every neighbor
+        while ((1L << num_planes) <= stencil.size())
+        {
+            num_planes++;
+        }
+        // each thread's next row followed by its bit-sliced counter
+        long slot_words = (long)num_words * (1 + num_planes);
+        long scratch_words = slot_words * get_step_threads();
+        try
+        {
+            if ((long)packed_scratch.size() < scratch_words)
+            {
+                packed_scratch.resize(scratch_words);
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            return 0;
+        }
+        if (!packed_cells_current)
+        {
+            if (!pack_binary_cells())
+            {
+                return 0;
+            }
+            release_cell_buffers();
+        }
+        packed = true;
+
+#ifdef ENABLE_OMP
+#pragma omp parallel num_threads(get_step_threads())
+#endif
+        {
+            int thread = 0;
+#ifdef ENABLE_OMP
+            thread = omp_get_thread_num();
+#endif
+            uint64_t *next_words = packed_scratch.data() + thread * slot_words;
+            uint64_t *counter = next_words + num_words;
+#ifdef ENABLE_OMP
+#pragma omp for
+#endif
+            for (long row = 0; row < num_rows; row++)
+            {
+                step_packed_binary_row(row, next_words, counter, num_planes);
+                store_packed_row(row, next_words);
+            }
+        }
+
+        // the next cell state becomes the current cell state for the next time step
+        packed_rows.swap(next_packed_rows);
+        packed_cells_current = true;
+        steps_taken++;
+        if (is_distributed())
+        {
+            error_code = unpack_binary_cells();
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        // Appending the step to the file log
+        return append_log();
+    }
+
+    /**
+     * @brief Runs one step: computes the next state of every cell with update,
+     * stores it in next_cells, swaps the generations and appends the log.
+     *
+     * update(cell_index, index_size, interior, new_cell_state) is called for every cell with
+     * new_cell_state set to the cell's current state. interior is true when every neighbor
+     * of the cell is reached with the stencil offsets (no wrapping nor bounds checks).
+     * update may modify cell_index to move the cell. Every error is checked before the cells are
+     * updated, so update doesn't return an error code and the cell loops have no error branches.
+     *
+     * The updated cells are split into tiles of tile_rows rows by tile_width cells (see setup_tiles)
+     * that are scheduled across threads by tile_scheduler, so the parallelism follows the number of
+     * cells rather than axis1_dim, and tiles are balanced by their cost during the previous step.
+     * Within a tile, cells are updated row by row; each row runs its shells and interior span in
+     * separate loops. Walled edge cells never change thus they are copied instead of updated.
+     * With activity tracking only the tiles next to changed cells are updated (see run_active_tiles).
+     *
+     * @param update callable that sets the new cell state
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * 0: no error
+     */
+    template <typename CellUpdate>
+    int run_step(CellUpdate &update)
+    {
+        int error_code = 0; // store error code return by other methods
+
+        if (cells == nullptr)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        error_code = update_ghost_layout();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        refresh_ghost_cells();
+        error_code = update_stencil();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = reserve_neighborhood_scratch();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        bool tracked = track_activity && !is_distributed();
+        if (!tracked)
+        {
+            prepare_next_generation(); // run_active_tiles only prepares the recomputed tiles
+        }
+        if (boundary_type == CAEnums::Walled)
+        {
+            copy_walled_edge_cells();
+        }
+
+        pin_step_threads();
+        bool moved = false;
+        if (tracked)
+        {
+            error_code = run_active_tiles(update, moved);
+        }
+        else
+        {
+            error_code = is_distributed() ? run_distributed_tiles(update) : run_tiles(update);
+        }
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        // the next cell state becomes the current cell state for the next time step
+        swap_generations();
+        activity_valid = tracked && !moved;
+        steps_taken++;
+        // Appending the step to the file log
+        error_code = append_log();
+        return error_code;
+    }
+
+    /**
+     * @brief Updates the cells in tiles of tile_rows rows by tile_width cells, scheduled over the
+     * updated range of the grid (see run_step).
+     *
+     * @param update callable that sets the new cell state
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the tile queues\n
+     * 0: no error
+     */
+    template <typename CellUpdate>
+    int run_tiles(CellUpdate &update)
+    {
+        long num_column_tiles = 0;
+        long num_tiles = get_num_tiles(num_column_tiles);
+        int error_code = tile_scheduler.plan(num_tiles, get_step_threads(), schedule);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        auto tile_update = [this, &update, num_column_tiles](long tile) -> int
+        {
+            update_tile(update, tile / num_column_tiles, tile % num_column_tiles);
+            return 0;
+        };
+        return tile_scheduler.run(tile_update);
+    }
+
+    /**
+     * @brief Calls row_span(position, length) for every row of a tile with the position of the tile's
+     * first cell of the row in the cell buffers (relative to cells) and the number of the row's cells in the tile.
+     *
+     * @param tile tile number
+     * @param num_column_tiles number of tiles along the last axis
+     * @param row_span callable
+     */
+    template <typename RowSpan>
+    void for_each_tile_row(long tile, long num_column_tiles, RowSpan row_span)
+    {
+        int begin[3], end[3], interior_begin[3], interior_end[3];
+        for (int axis = 0; axis < rank; axis++)
+        {
+            get_update_range(axis, begin[axis], end[axis], interior_begin[axis], interior_end[axis]);
+        }
+        int last_axis = rank - 1;
+        int span_begin = begin[last_axis] + tile % num_column_tiles * tile_width;
+        int span_end = std::min(span_begin + tile_width, end[last_axis]);
+        long first_row = tile / num_column_tiles * tile_rows;
+        long last_row = std::min(first_row + tile_rows, get_num_updated_rows());
+        long rows_per_i = rank == 3 ? end[1] - begin[1] : 1;
+        for (long row = first_row; row < last_row; row++)
+        {
+            int row_index[3] = {0, 0, 0};
+            if (rank >= 2)
+            {
+                row_index[0] = begin[0] + row / rows_per_i;
+            }
+            if (rank == 3)
+            {
+                row_index[1] = begin[1] + row % rows_per_i;
+            }
+            row_index[last_axis] = span_begin;
+            row_span(get_flat_index(row_index, rank), span_end - span_begin);
+        }
+    }
+
+    /**
+     * @brief Spreads flags along one axis of the segments (see mark_active_segments):
+     * out is set wherever in is set within reach positions along the axis.
+     *
+     * @param in flags to spread
+     * @param out spread flags
+     * @param num_segments number of flags
+     * @param stride distance between neighbors along the axis
+     * @param extent number of positions along the axis
+     * @param reach positions spread on each side
+     * @param wrap wrap around the axis (Periodic)
+     */
+    static void spread_segments_along(const uint8_t *in, uint8_t *out, long num_segments, long stride, long extent,
+                                      long reach, bool wrap)
+    {
+        reach = std::min(reach, extent);
+        for (long n = 0; n < num_segments; n++)
+        {
+            long position = n / stride % extent;
+            uint8_t flag = 0;
+            for (long d = -reach; d <= reach && !flag; d++)
+            {
+                long neighbor = position + d;
+                if (wrap)
+                {
+                    neighbor = (neighbor % extent + extent) % extent;
+                }
+                else if (neighbor < 0 || neighbor >= extent)
+                {
+                    continue;
+                }
+                flag = in[n + (neighbor - position) * stride];
+            }
+            out[n] = flag;
+        }
+    }
+
+    /**
+     * @brief Marks the segments (updated rows by column tiles) holding a cell whose neighborhood reaches a
+     * segment changed during the previous step: changed_segments is spread over boundary_radius rows along
+     * the other axes and over the column tiles within boundary_radius cells, wrapped with Periodic boundaries.
+     * Cells outside the update range never change and aren't tracked.
+     *
+     * @param num_column_tiles number of tiles along the last axis
+     */
+    void mark_active_segments(long num_column_tiles)
+    {
+        int begin[3], end[3], interior_begin[3], interior_end[3];
+        for (int axis = 0; axis < rank; axis++)
+        {
+            get_update_range(axis, begin[axis], end[axis], interior_begin[axis], interior_end[axis]);
+        }
+        bool periodic = boundary_type == CAEnums::Periodic;
+        long num_segments = changed_segments.size();
+        long rows_per_i = rank == 3 ? end[1] - begin[1] : 1;
+        // the last tile may be shorter than boundary_radius cells, so wrapped spreads reach one tile further
+        long column_reach = (boundary_radius + tile_width - 1) / tile_width + (periodic ? 1 : 0);
+
+        // spreads (stride, extent, reach) along the last axis, the second axis and the first axis
+        long spreads[3][3] = {{1, num_column_tiles, column_reach}, {0, 0, 0}, {0, 0, 0}};
+        int num_spreads = 1;
+        if (rank == 3)
+        {
+            spreads[num_spreads][0] = num_column_tiles;
+            spreads[num_spreads][1] = rows_per_i;
+            spreads[num_spreads++][2] = boundary_radius;
+        }
+        if (rank >= 2)
+        {
+            spreads[num_spreads][0] = num_column_tiles * rows_per_i;
+            spreads[num_spreads][1] = end[0] - begin[0];
+            spreads[num_spreads++][2] = boundary_radius;
+        }
+        // alternate between the buffers so the last spread lands in active_segments
+        const uint8_t *in = changed_segments.data();
+        for (int n = 0; n < num_spreads; n++)
+        {
+            uint8_t *out = (num_spreads - n) % 2 == 1 ? active_segments.data() : spread_segments.data();
+            spread_segments_along(in, out, num_segments, spreads[n][0], spreads[n][1], spreads[n][2], periodic);
+            in = out;
+        }
+    }
+
+    /**
+     * @brief Updates the tiles next to cells that changed during the previous step (see setup_activity_tracking).
+     * The other tiles aren't touched: their cells didn't change, so the next state buffer, which holds the
+     * previous generation, already holds them. Records which segments of the recomputed tiles changed.
+     *
+     * @param update callable that sets the new cell state
+     * @param moved set to true when a rule moved a cell (the next step then recomputes every tile)
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the activity flags or the tile queues\n
+     * 0: no error
+     */
+    template <typename CellUpdate>
+    int run_active_tiles(CellUpdate &update, bool &moved)
+    {
+        long num_column_tiles = 0;
+        long num_tiles = get_num_tiles(num_column_tiles);
+        long num_rows = get_num_updated_rows();
+        long num_segments = num_rows * num_column_tiles;
+        long setup[8] = {boundary_type, boundary_radius, neighborhood_type, rule_type, num_states,
+                         tile_rows, tile_width, num_segments};
+        try
+        {
+            changed_segments.resize(num_segments);
+            active_segments.resize(num_segments);
+            spread_segments.resize(num_segments);
+            active_tiles.clear();
+            active_tiles.reserve(num_tiles);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+        if (!activity_valid || !std::equal(setup, setup + 8, activity_setup))
+        {
+            // the previous step is unknown: every tile is recomputed
+            std::fill(changed_segments.begin(), changed_segments.end(), 1);
+            std::copy(setup, setup + 8, activity_setup);
+        }
+        mark_active_segments(num_column_tiles);
+        for (long tile = 0; tile < num_tiles; tile++)
+        {
+            long first_row = tile / num_column_tiles * tile_rows;
+            long last_row = std::min(first_row + tile_rows, num_rows);
+            bool active = false;
+            for (long row = first_row; row < last_row && !active; row++)
+            {
+                active = active_segments[row * num_column_tiles + tile % num_column_tiles] != 0;
+            }
+            if (active)
+            {
+                active_tiles.push_back(tile);
+            }
+        }
+        num_active_tiles = active_tiles.size();
+        moved_tiles.assign(num_active_tiles, 0);
+
+        int error_code = tile_scheduler.plan(num_active_tiles, get_step_threads(), schedule);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        bool custom = rule_type == CAEnums::Custom;
+        if (custom)
+        {
+            // custom rules only write non-empty cells (see prepare_next_generation)
+            auto clear_tile = [this, num_column_tiles](long n) -> int
+            {
+                for_each_tile_row(active_tiles[n], num_column_tiles, [this](long position, int length)
+                                  { std::fill(next_cells + position, next_cells + position + length, T()); });
+                return 0;
+            };
+            error_code = tile_scheduler.run(clear_tile);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+            // run takes the tiles off the queues
+            error_code = tile_scheduler.plan(num_active_tiles, get_step_threads(), schedule);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
+        }
+        auto tile_update = [this, &update, num_column_tiles, custom](long n) -> int
+        {
+            long tile = active_tiles[n];
+            bool tile_moved = false;
+            if (custom)
+            {
+                auto tracked_update = [&update, &tile_moved](int *cell_index, int index_size, bool interior,
+                                                             T &new_cell_state)
+                {
+                    int cell[3] = {cell_index[0], cell_index[1], cell_index[2]};
+                    update(cell_index, index_size, interior, new_cell_state);
+                    tile_moved = tile_moved || !std::equal(cell_index, cell_index + index_size, cell);
+                };
+                update_tile(tracked_update, tile / num_column_tiles, tile % num_column_tiles);
+            }
+            else
+            {
+                update_tile(update, tile / num_column_tiles, tile % num_column_tiles);
+            }
+            moved_tiles[n] = tile_moved;
+            uint8_t *changed = changed_segments.data() + tile / num_column_tiles * tile_rows * num_column_tiles +
+                               tile % num_column_tiles;
+            for_each_tile_row(tile, num_column_tiles, [this, &changed, num_column_tiles](long position, int length)
+                              {
+                                  bool row_changed = false;
+                                  for (int k = 0; k < length && !row_changed; k++)
+                                  {
+                                      row_changed = next_cells[position + k] != cells[position + k];
+                                  }
+                                  *changed = row_changed;
+                                  changed += num_column_tiles;
+                              });
+            return 0;
+        };
+        error_code = tile_scheduler.run(tile_update);
+        moved = std::find(moved_tiles.begin(), moved_tiles.end(), 1) != moved_tiles.end();
+        return error_code;
+    }
+
+    /**
+     * @brief Updates the slabs [begin, end) of the first axis in tiles (see run_tiles).
+     *
+     * @param update callable that sets the new cell state
+     * @param begin first updated slab
+     * @param end one past the last updated slab
+     * @return int - error code (see run_tiles)
+     */
+    template <typename CellUpdate>
+    int run_slab_tiles(CellUpdate &update, int begin, int end)
+    {
+        if (begin >= end)
+        {
+            return 0;
+        }
+        first_updated_slab = begin;
+        last_updated_slab = end;
+        int error_code = run_tiles(update);
+        first_updated_slab = 0;
+        last_updated_slab = INT_MAX;
+        return error_code;
+    }
+
+    /**
+     * @brief Updates this process' slabs of a split grid (see setup_mpi). The halo exchange overlaps
+     * the update of the slabs that don't read the halos; the boundary_radius slabs at either end are
+     * updated once the halos arrived. The halo slabs themselves aren't updated: they're replaced by
+     * the next exchange. Cells a Custom rule moved into the halos are handed to their process.
+     *
+     * @param update callable that sets the new cell state
+     * @return int - error code (see run_tiles and return_moved_cells)
+     */
+    template <typename CellUpdate>
+    int run_distributed_tiles(CellUpdate &update)
+    {
+        int owned_begin = lower_halo;
+        int owned_end = axis1_dim - upper_halo;
+        int inner_begin = std::min(owned_begin + boundary_radius, owned_end);
+        int inner_end = std::max(owned_end - boundary_radius, inner_begin);
+        if (rule_type == CAEnums::Custom)
+        {
+            // the next generation's halo slabs only collect moved cells (Walled edges are copied there)
+            long slab_size = strides[0];
+            T *first_slab = next_cell_buffer + ghost_width * slab_size;
+            std::fill(first_slab, first_slab + lower_halo * slab_size, T());
+            std::fill(first_slab + owned_end * slab_size, first_slab + axis1_dim * slab_size, T());
+        }
+        bool exchange = !halos_exchanged;
+        if (exchange)
+        {
+            start_halo_exchange();
+        }
+        int error_code = run_slab_tiles(update, inner_begin, inner_end);
+        if (exchange)
+        {
+            finish_halo_exchange();
+        }
+        if (error_code >= 0)
+        {
+            error_code = run_slab_tiles(update, owned_begin, inner_begin);
+        }
+        if (error_code >= 0)
+        {
+            error_code = run_slab_tiles(update, inner_end, owned_end);
+        }
+        if (error_code >= 0 && rule_type == CAEnums::Custom)
+        {
+            error_code = return_moved_cells();
+        }
+        return error_code;
+    }
+
+    /**
+     * @brief Runs one step updating the cells in place (see setup_in_place), so the grid needs
+     * no next state buffer. The grid is swept along its first axis one slab (cells sharing index i)
+     * at a time; each thread keeps the previous generation of the 2 * boundary_radius + 1 slabs
+     * around the slab it updates in a window (kept contiguous in a buffer twice its size), reads every
+     * neighborhood from the window and writes the new states straight into the cells. The sweep is
+     * split into one chunk of slabs per thread; the boundary_radius first and last slabs of every chunk
+     * are saved before any cell is written, so neighboring chunks read them instead of cells that may
+     * already hold the next generation. The result is the synchronous update of run_step.
+     *
+     * update(cell_index, index_size, interior, center, offsets, coords, neighborhood_size, new_cell_state)
+     * reads neighbor n at center[offsets[n]], its relative index at coords + n * index_size.
+     * Rules can't move cells: a cell_index changed by a rule is ignored and reported once the step is done.
+     *
+     * @param update callable that sets the new cell state
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the saved slabs or the neighborhood arrays\n
+     * InPlaceCellMoved: a rule changed its cell_index (the step was still taken)\n
+     * 0: no error
+     */
+    template <typename CellUpdate>
+    int run_in_place_step(CellUpdate &update)
+    {
+        if (cells == nullptr)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        int error_code = update_ghost_layout();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        refresh_ghost_cells();
+        error_code = exchange_halos();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = update_stencil();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = reserve_neighborhood_scratch();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        int num_slabs = axis1_dim;
+        int radius = std::max(boundary_radius, 1);
+        int window_slabs = 2 * (2 * radius + 1); // window of 2r + 1 slabs, slid back when the buffer is full
+        long slab_size = strides[0];             // a slab along with its ghost layers
+        int num_chunks = std::max(1, std::min(get_step_threads(), num_slabs / radius)); // chunks hold >= r slabs
+        int step_threads = get_step_threads();
+        try
+        {
+            in_place_slabs.resize((2L * radius * num_chunks + (long)window_slabs * step_threads) * slab_size);
+        }
+        catch (const std::bad_alloc &)
+        {
+            in_place_slabs.clear();
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+        T *saved_slabs = in_place_slabs.data();
+        T *windows = saved_slabs + 2L * radius * num_chunks * slab_size;
+        T *first_slab = cell_buffer + ghost_width * slab_size;
+        bool periodic = boundary_type == CAEnums::Periodic;
+
+        // the first slab of every chunk and the number of its slabs that are saved at each end
+        auto chunk_begin = [num_slabs, num_chunks](int chunk) -> long
+        { return (long)num_slabs * chunk / num_chunks; };
+        auto saved_count = [&chunk_begin, radius](int chunk) -> long
+        { return std::min((long)radius, chunk_begin(chunk + 1) - chunk_begin(chunk)); };
+
+        // previous generation of the logical slab t (may lie past the grid) read by a chunk; nullptr: empty cells
+        auto source_slab = [&](int chunk, long t) -> const T *
+        {
+            if (t >= chunk_begin(chunk) && t < chunk_begin(chunk + 1))
+            {
+                return first_slab + t * slab_size; // not written yet: slabs are read ahead of the sweep
+            }
+            if (!periodic && (t < 0 || t >= num_slabs))
+            {
+                return nullptr;
+            }
+            long s = ((t % num_slabs) + num_slabs) % num_slabs;
+            int owner = 0;
+            while (s >= chunk_begin(owner + 1))
+            {
+                owner++;
+            }
+            long m = s - chunk_begin(owner);
+            long length = chunk_begin(owner + 1) - chunk_begin(owner);
+            long saved = saved_count(owner);
+            long slot = m < saved ? m : radius + m - (length - saved);
+            return saved_slabs + (2L * radius * owner + slot) * slab_size;
+        };
+
+        pin_step_threads();
+#ifdef ENABLE_OMP
+#pragma omp parallel for num_threads(num_chunks)
+#endif
+        for (int chunk = 0; chunk < num_chunks; chunk++)
+        {
+            long begin = chunk_begin(chunk);
+            long saved = saved_count(chunk);
+            T *head = saved_slabs + 2L * radius * chunk * slab_size;
+            std::copy(first_slab + begin * slab_size, first_slab + (begin + saved) * slab_size, head);
+            long tail_begin = chunk_begin(chunk + 1) - saved;
+            std::copy(first_slab + tail_begin * slab_size, first_slab + (tail_begin + saved) * slab_size,
+                      head + radius * slab_size);
+        }
+
+        int begin[3], end[3], interior_begin[3], interior_end[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            begin[axis] = interior_begin[axis] = 0;
+            end[axis] = interior_end[axis] = 1; // unused axes hold a single index
+        }
+        if (is_distributed())
+        {
+            // the halo slabs are read but not updated
+            first_updated_slab = lower_halo;
+            last_updated_slab = axis1_dim - upper_halo;
+        }
+        for (int axis = 0; axis < rank; axis++)
+        {
+            get_update_range(axis, begin[axis], end[axis], interior_begin[axis], interior_end[axis]);
+        }
+        first_updated_slab = 0;
+        last_updated_slab = INT_MAX;
+        long slab_lead = (cells - cell_buffer) - ghost_width * slab_size; // cell [0, 0, 0] inside its slab
+        // Majority and Parity write every cell; custom rules only keep non-empty cells
+        bool write_all_cells = rule_type != CAEnums::Custom;
+        bool moved = false;
+
+#ifdef ENABLE_OMP
+#pragma omp parallel for num_threads(num_chunks) reduction(|| : moved)
+#endif
+        for (int chunk = 0; chunk < num_chunks; chunk++)
+        {
+            int thread = 0;
+#ifdef ENABLE_OMP
+            thread = omp_get_thread_num();
+#endif
+            T *window = windows + (long)window_slabs * thread * slab_size;
+            T empty_cell_state = T();
+            long base = chunk_begin(chunk) - radius; // logical slab in the window's first slot
+            long loaded = base;                      // next logical slab to load into the window
+            for (long i = chunk_begin(chunk); i < chunk_begin(chunk + 1); i++)
+            {
+                if (i + radius - base >= window_slabs)
+                {
+                    // slide the slabs still needed back to the front of the buffer
+                    std::copy(window + (i - radius - base) * slab_size, window + (loaded - base) * slab_size, window);
+                    base = i - radius;
+                }
+                for (; loaded <= i + radius; loaded++)
+                {
+                    const T *source = source_slab(chunk, loaded);
+                    T *slot = window + (loaded - base) * slab_size;
+                    if (source == nullptr)
+                    {
+                        std::fill(slot, slot + slab_size, empty_cell_state);
+                    }
+                    else
+                    {
+                        std::copy(source, source + slab_size, slot);
+                    }
+                }
+                if (i < begin[0] || i >= end[0])
+                {
+                    continue; // Walled edge slab
+                }
+
+                const T *window_slab = window + (i - base) * slab_size + slab_lead;
+                bool slab_interior = i >= interior_begin[0] && i < interior_end[0];
+                for (int j = begin[1]; j < end[1]; j++)
+                {
+                    bool row_interior = slab_interior && j >= interior_begin[1] && j < interior_end[1];
+                    for (int k = begin[2]; k < end[2]; k++)
+                    {
+                        int cell_index[3] = {(int)i, j, k};
+                        long position = get_flat_index(cell_index, rank);
+                        const T *center = window_slab + (position - i * slab_size);
+                        bool interior = row_interior && k >= interior_begin[2] && k < interior_end[2];
+                        long *offsets = stencil.offsets.data();
+                        int *coords = stencil.coords.data();
+                        int neighborhood_size = stencil.size();
+                        if (!interior)
+                        {
+                            offsets = get_offset_scratch();
+                            coords = get_coord_scratch();
+                            generate_in_place_offsets(cell_index, rank, offsets, coords, neighborhood_size);
+                        }
+
+                        int rule_index[3] = {cell_index[0], cell_index[1], cell_index[2]};
+                        T new_cell_state = *center;
+                        update(rule_index, rank, interior, center, offsets, coords, neighborhood_size, new_cell_state);
+                        moved = moved || !std::equal(cell_index, cell_index + rank, rule_index);
+                        cells[position] = write_all_cells || new_cell_state != empty_cell_state ? new_cell_state
+                                                                                                : empty_cell_state;
+                    }
+                }
+            }
+        }
+
+        halos_exchanged = false;
+        steps_taken++;
+        // Appending the step to the file log
+        error_code = append_log();
+        return moved ? CAEnums::InPlaceCellMoved : error_code;
+    }
+
+    /**
+     * @brief Runs one step of an update reading its neighborhoods from windows of the grid, called like
+     * in run_in_place_step: sparse grids run run_sparse_step, grids updated in place run_in_place_step.
+     *
+     * @param update callable that sets the new cell state
+     * @return int - error code (see run_in_place_step and run_sparse_step)
+     */
+    template <typename CellUpdate>
+    int run_window_step(CellUpdate &update)
+    {
+        if (sparse_grid != nullptr)
+        {
+            return run_sparse_step(update);
+        }
+        return run_in_place_step(update);
+    }
+
+    /**
+     * @brief Runs one step of a sparse grid (see setup_sparse). The bricks next to occupied cells
+     * (see SparseGrid::collect_active_bricks) are scheduled across threads by tile_scheduler; each brick
+     * is copied with its halo into a window that the update reads every neighborhood from
+     * (see SparseGrid::update_brick), like run_in_place_step. Rules may move cells: the moved cells are
+     * written once every brick is updated, through collision_rule when they land on occupied cells.
+     *
+     * @param update callable that sets the new cell state (see run_in_place_step)
+     * @return int - error code\n
+     * CellsAreNull: the sparse grid has no dimensions\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays or the brick queues\n
+     * CellsMalloc: couldn't allocate memory for the next generation\n
+     * 0: no error
+     */
+    template <typename CellUpdate>
+    int run_sparse_step(CellUpdate &update)
+    {
+        if (rank == 0)
+        {
+            return CAEnums::CellsAreNull;
+        }
+        int error_code = update_stencil();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = reserve_neighborhood_scratch();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = sparse_grid->setup_step(boundary_type, boundary_radius, stencil, get_step_threads());
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = sparse_grid->collect_active_bricks();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = tile_scheduler.plan(sparse_grid->get_num_active_bricks(), get_step_threads(), schedule);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        SparseGrid<T> *grid = sparse_grid;
+        auto brick_update = [grid, &update](long n) -> int
+        {
+            int thread = 0;
+#ifdef ENABLE_OMP
+            thread = omp_get_thread_num();
+#endif
+            try
+            {
+                grid->update_brick(update, n, thread);
+            }
+            catch (const std::bad_alloc &)
+            {
+                return CAEnums::CellsMalloc;
+            }
+            return 0;
+        };
+        pin_step_threads();
+        error_code = tile_scheduler.run(brick_update);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        error_code = sparse_grid->assemble_next_generation(collision_rule);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        steps_taken++;
+        // Appending the step to the file log
+        return append_log();
+    }
+
+    /**
+     * @brief Sets up the neighbor positions (relative to the cell) and relative indices of a cell
+     * that isn't interior for run_in_place_step. Positions along the first axis aren't wrapped since
+     * the window holds the periodic slabs next to each other; the other axes are wrapped (Periodic)
+     * or the neighbors outside the grid are left out (CutOff/Walled), like generate_neighborhood_offsets.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param offsets this thread's array receiving the neighbor positions
+     * @param coords this thread's array receiving the relative indices
+     * @param neighborhood_size number of neighbors listed
+     */
+    void generate_in_place_offsets(const int *cell_index, int index_size, long *offsets, int *coords,
+                                   int &neighborhood_size)
+    {
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        bool periodic = boundary_type == CAEnums::Periodic;
+        int stencil_size = stencil.size();
+
+        neighborhood_size = 0;
+        for (int n = 0; n < stencil_size; n++)
+        {
+            const int *d = stencil.coord(n);
+            bool inside = periodic || (cell_index[0] + d[0] >= 0 && cell_index[0] + d[0] < extents[0]);
+            long offset = d[0] * strides[0];
+            for (int axis = 1; axis < index_size && inside; axis++)
+            {
+                int neighbor = cell_index[axis] + d[axis];
+                if (!periodic && (neighbor < 0 || neighbor >= extents[axis]))
+                {
+                    inside = false; // outside bounds; don't include cell
+                }
+                while (neighbor < 0)
+                {
+                    neighbor += extents[axis];
+                }
+                while (neighbor >= extents[axis])
+                {
+                    neighbor -= extents[axis];
+                }
+                offset += (long)(neighbor - cell_index[axis]) * strides[axis];
+            }
+            if (!inside)
+            {
+                continue;
+            }
+            offsets[neighborhood_size] = offset;
+            std::copy(d, d + index_size, coords + neighborhood_size * index_size);
+            neighborhood_size++;
+        }
+    }
+
+    /**
+     * @brief Sets up the neighbor positions (relative to the cell at cell_index, in the cells buffer)
+     * and relative indices [di, dj, dk] referenced by a NeighborhoodView.
+     * Interior cells reference the stencil's tables directly; other cells fill the given arrays.
+     * With CutOff/Walled boundaries, neighbors outside the grid are not listed.
+     *
+     * @param cell_index cell of interest's index
+     * @param index_size size of cell_index array
+     * @param interior every neighbor can be reached with the stencil offsets (see run_step)
+     * @param offsets this thread's array for neighbor positions; set to the array to reference
+     * @param coords this thread's array for relative indices; set to the array to reference
+     * @param neighborhood_size number of neighbors listed
+     */
+    void generate_neighborhood_offsets(const int *cell_index, int index_size, bool interior, long *&offsets,
+                                       int *&coords, int &neighborhood_size)
+    {
+        long center = get_flat_index(cell_index, index_size);
+        int stencil_size = stencil.size();
+
+        if (interior)
+        {
+            offsets = stencil.offsets.data();
+            coords = stencil.coords.data();
+            neighborhood_size = stencil_size;
+            return;
+        }
+
+        if (boundary_type == CAEnums::Periodic)
+        {
+            for (int n = 0; n < stencil_size; n++)
+            {
+                offsets[n] = get_periodic_neighbor_position(cell_index, index_size, n) - center;
+            }
+            coords = stencil.coords.data(); // every neighbor is listed
+            neighborhood_size = stencil_size;
+            return;
+        }
+
+        neighborhood_size = 0;
+        for (int n = 0; n < stencil_size; n++)
+        {
+            if (!is_neighbor_inside_grid(cell_index, index_size, n))
+            {
+                continue; // outside bounds; don't include cell
+            }
+            offsets[neighborhood_size] = stencil.offsets[n];
+            std::copy(stencil.coord(n), stencil.coord(n) + index_size, coords + neighborhood_size * index_size);
+            neighborhood_size++;
+        }
+    }
+
+    /**
+     * @brief Reserves one neighborhood array per thread of the step team (see get_step_threads)
+     * that is reused for every cell of every step, and one array of votes per thread when there are
+     * more than MAJORITY_STACK_STATES cell states. The arrays are only reallocated when the
+     * neighborhood or the number of states grows (e.g. larger radius) or the step team grows.
+     *
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * 0: no error
+     */
+    int reserve_neighborhood_scratch()
+    {
+        /*
+         * Generate a flatten array of the cell's neighborhood.
+         * The neighborhood array can then be utilized for Majority, Parity, or Custom rule
+         */
+        int max_neighborhood_size = get_neighborhood_size(rank, boundary_radius, neighborhood_type);
+        int num_slots = get_step_threads(); // one neighborhood array per thread
+        // round each thread's array up to whole cache lines so threads don't share a line
+        int cells_per_line = CELL_BUFFER_ALIGNMENT / sizeof(T) > 0 ? CELL_BUFFER_ALIGNMENT / sizeof(T) : 1;
+        int slot_size = (max_neighborhood_size + cells_per_line - 1) / cells_per_line * cells_per_line;
+        int votes_per_line = CELL_BUFFER_ALIGNMENT / sizeof(int);
+        int vote_size = num_states > MAJORITY_STACK_STATES
+                            ? (num_states + votes_per_line - 1) / votes_per_line * votes_per_line
+                            : vote_slot_size;
+
+        if (slot_size > neighborhood_slot_size || num_slots > neighborhood_num_slots || vote_size > vote_slot_size)
+        {
+            try
+            {
+                neighborhood_scratch.assign((long)slot_size * num_slots, T());
+                offset_scratch.assign((long)slot_size * num_slots, 0);
+                coord_scratch.assign(3L * slot_size * num_slots, 0);
+                vote_scratch.assign((long)vote_size * num_slots, 0);
+            }
+            catch (const std::bad_alloc &)
+            {
+                neighborhood_scratch.clear();
+                offset_scratch.clear();
+                coord_scratch.clear();
+                vote_scratch.clear();
+                neighborhood_slot_size = 0;
+                neighborhood_num_slots = 0;
+                vote_slot_size = 0;
+                return CAEnums::NeighborhoodCellsMalloc;
+            }
+            neighborhood_slot_size = slot_size;
+            neighborhood_num_slots = num_slots;
+            vote_slot_size = vote_size;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Get the calling thread's neighborhood array (see reserve_neighborhood_scratch).
+     *
+     * @return T* array with room for get_neighborhood_size cells
+     */
+    T *get_neighborhood_scratch()
+    {
+        int slot = 0;
+#ifdef ENABLE_OMP
+        slot = omp_get_thread_num();
+#endif
+        return neighborhood_scratch.data() + (long)slot * neighborhood_slot_size;
+    }
+
+    /**
+     * @brief Get the calling thread's array for neighbor positions (see generate_neighborhood_offsets).
+     *
+     * @return long* array with room for get_neighborhood_size positions
+     */
+    long *get_offset_scratch()
+    {
+        int slot = 0;
+#ifdef ENABLE_OMP
+        slot = omp_get_thread_num();
+#endif
+        return offset_scratch.data() + (long)slot * neighborhood_slot_size;
+    }
+
+    /**
+     * @brief Get the calling thread's array for neighbor relative indices (see generate_neighborhood_offsets).
+     *
+     * @return int* array with room for 3 * get_neighborhood_size indices
+     */
+    int *get_coord_scratch()
+    {
+        int slot = 0;
+#ifdef ENABLE_OMP
+        slot = omp_get_thread_num();
+#endif
+        return coord_scratch.data() + 3L * slot * neighborhood_slot_size;
+    }
+
+    /**
+     * @brief Get the calling thread's array of MajorityHistogram votes (see reserve_neighborhood_scratch).
+     *
+     * @return int* array with room for num_states votes when num_states > MAJORITY_STACK_STATES
+     */
+    int *get_vote_scratch()
+    {
+        int slot = 0;
+#ifdef ENABLE_OMP
+        slot = omp_get_thread_num();
+#endif
+        return vote_scratch.data() + (long)slot * vote_slot_size;
+    }
+
+    /**
+     * @brief The universal method that writing the output data in a log file
+     * (nothing is written when logging is disabled, see setup_logging).
+     * Sparse grids are logged like dense grids, one row at a time (see SparseGrid::copy_row).
+     *
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * 0: no error
+     */
+    int append_log()
+    {
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (!logging)
+        {
+            return 0;
+        }
+        if (is_distributed())
+        {
+            return append_gathered_log();
+        }
+        if (packed_cells_current)
+        {
+            return append_packed_log();
+        }
+
+        std::ofstream file;
+        file.open(FILE_PATH, std::ios::app);
+        if (!file.is_open())
+        {
+            return 0; // no log directory
+        }
+
+        // rows are stored in row-major order so walking them logs i, j, k in order
+        int row_size = get_row_size();
+        std::vector<T> sparse_row(sparse_grid != nullptr ? row_size : 0);
+        for (long row = 0; row < num_cells / row_size; row++)
+        {
+            const T *cell = sparse_row.data();
+            if (sparse_grid != nullptr)
+            {
+                sparse_grid->copy_row(row, sparse_row.data());
+            }
+            else
+            {
+                cell = get_row(cells, row);
+            }
+            for (int n = 0; n < row_size; n++)
+            {
+                file << get_cell_state(cell[n]) << ",";
+            }
+        }
+        file << "\n";
+        file.close();
+        return (0);
+    }
+
+    /**
+     * @brief Appends a generation given by the states of its cells to the log file, like append_log.
+     *
+     * @param states state of every cell (row-major, no ghost layers)
+     * @param count number of cells
+     * @return int error code
+     */
+    int append_log_states(const int *states, long count)
+    {
+        std::ofstream file;
+        file.open(FILE_PATH, std::ios::app);
+        for (long n = 0; n < count; n++)
+        {
+            file << states[n] << ",";
+        }
+        file << "\n";
+        file.close();
+        return 0;
+    }
+
+    /**
+     * @brief Appends the current generation of a split grid to the log file:
+     * the first process gathers and writes every process' slabs. Every process has to call this.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the gathered states\n
+     * InvalidDecomposition: the grid holds more than INT_MAX cells\n
+     * 0: no error
+     */
+    int append_gathered_log()
+    {
+        std::vector<int> states;
+        int error_code = gather_states(states);
+        if (error_code < 0 || !is_root_process())
+        {
+            return error_code;
+        }
+        return append_log_states(states.data(), states.size());
+    }
+
+    /**
+     * @brief Prints the current generation of a split grid like print_grid:
+     * the first process gathers and prints every process' slabs. Every process has to call this.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the gathered states\n
+     * InvalidDecomposition: the grid holds more than INT_MAX cells\n
+     * 0: no error
+     */
+    int print_gathered_grid()
+    {
+        std::vector<int> states;
+        int error_code = gather_states(states);
+        if (error_code < 0 || !is_root_process())
+        {
+            return error_code;
+        }
+        long n = 0;
+        switch (rank)
+        {
+        case 1:
+            for (int i = 0; i < global_axis1_dim; i++)
+            {
+                std::cout << states[n++] << " ";
+            }
+            std::cout << std::endl;
+            break;
+        case 2:
+            for (int j = 0; j < global_axis1_dim; j++)
+            {
+                for (int k = 0; k < axis2_dim; k++)
+                {
+                    std::cout << states[n++] << " ";
+                }
+                std::cout << std::endl;
+            }
+            break;
+        default:
+            for (int i = 0; i < global_axis1_dim; i++)
+            {
+                std::cout << "Printing " << i << "'th slice of Tensor" << std::endl;
+                for (int j = 0; j < axis2_dim; j++)
+                {
+                    for (int k = 0; k < axis3_dim; k++)
+                    {
+                        std::cout << states[n++] << " ";
+                    }
+                    std::cout << std::endl;
+                }
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Determines if append_log writes to the log file (logging is enabled and the log's directory exists).
+     *
+     * @return true: steps are logged
+     * @return false: logging is disabled or the log file can't be opened
+     */
+    bool can_append_log()
+    {
+        if (!logging)
+        {
+            return false;
+        }
+        std::ofstream file(FILE_PATH, std::ios::app);
+        return file.is_open();
+    }
+
+    /**
+     * @brief Create a log file (.csv) for data output
+     *
+     */
+    int create_log(void)
+    {
+        if (!logging || !is_root_process())
+        {
+            return 0; // split grids are logged by the first process
+        }
+        std::ofstream file;
+        file.open(FILE_PATH, std::ios::trunc | std::ios::out); // If it is pre-existing content, it should be erased
+
+        file << this->num_states << ",\n"; // First Line: Number of the states.
+        // Rule and function
+        file << this->global_axis1_dim << ","
+             << this->axis2_dim << ","
+             << this->axis3_dim << ",\n"; // Second Line: Dimensions of each axis.
+        file.close();
+        return 0;
+    }
+
+public:
+    /**
+     * @brief Get the vector cell grid
+     *
+     * @return T* (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned pointer (see swap_generations).
+     */
+    T *get_vector()
+    {
+        if (unpack_binary_cells() < 0)
+        {
+            return nullptr;
+        }
+        return vector;
+    }
+
+    /**
+     * @brief Get the next state vector cell grid
+     * (nullptr when the cells are updated in place, see setup_in_place)
+     *
+     * @return T* (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned pointer (see swap_generations).
+     */
+    T *get_next_vector()
+    {
+        if (unpack_binary_cells() < 0)
+        {
+            return nullptr;
+        }
+        return next_vector;
+    }
 
-        if (neighborhood_type == CAEnums::VonNeumann)
+    /**
+     * @brief Get the matrix cell grid
+     *
+     * @return T** (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned row table (see swap_generations).
+     */
+    T **get_matrix()
+    {
+        if (unpack_binary_cells() < 0)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                neighbor_i = di + i;
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    neighbor_j = dj + j;
-                    // exclude diagonal cells from neighborhood when VonNeumann is selected
-                    if (is_diagonal_neighboring_cell_2d(di, dj))
-                    {
-                        // current di,dj cell is a diagonal neighbor so exclude it
-                        continue;
-                    }
-                    // exclude cells that are out of bounds
-                    if ((neighbor_i <= 0 || neighbor_i >= axis1_dim) || (neighbor_j <= 0 || neighbor_j >= axis2_dim))
-                    {
-                        // outside bounds; don't include cell state in the sum/counter
-                        continue;
-                    }
-                    // add state to flattened array
-                    neighborhood_cells[neighborhood_index] = matrix[neighbor_i][neighbor_j];
-                    neighborhood_index++;
-                }
-            }
+            return nullptr;
         }
-        else // Moore neighborhood
+        return matrix;
+    }
+
+    /**
+     * @brief Get the next state matrix cell grid
+     * (nullptr when the cells are updated in place, see setup_in_place)
+     *
+     * @return T** (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned row table (see swap_generations).
+     */
+    T **get_next_matrix()
+    {
+        if (unpack_binary_cells() < 0)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                neighbor_i = di + i;
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    neighbor_j = dj + j;
-                    // exclude cells that are out of bounds
-                    if ((neighbor_i <= 0 || neighbor_i >= axis1_dim) || (neighbor_j <= 0 || neighbor_j >= axis2_dim))
-                    {
-                        // outside bounds; don't include cell state in the sum/counter
-                        continue;
-                    }
-                    // add state to flattened array
-                    neighborhood_cells[neighborhood_index] = matrix[neighbor_i][neighbor_j];
-                    neighborhood_index++;
-                }
-            }
+            return nullptr;
         }
+        return next_matrix;
     }
 
     /**
-     * @brief Adds periodic neighboring cell state to neighborhood_cells array.
-     * Handles tensor (3d) case.
+     * @brief Get the tensor cell grid
      *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
+     * @return T*** (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned row table (see swap_generations).
      */
-    void generate_periodic_neighborhood_3d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
+    T ***get_tensor()
     {
-        int i = cell_index[0]; // get i-th index from array
-        int j = cell_index[1]; // get j-th index from array
-        int k = cell_index[2]; // get k-th index from array
-        int periodic_i;        // axis1_dim index used by Periodic boundary type
-        int periodic_j;        // axis2_dim index used by Periodic boundary type
-        int periodic_k;        // axis3_dim index used by Periodic boundary type
+        if (unpack_binary_cells() < 0)
+        {
+            return nullptr;
+        }
+        return tensor;
+    }
 
-        if (neighborhood_type == CAEnums::VonNeumann)
+    /**
+     * @brief Get the next state tensor cell grid
+     * (nullptr when the cells are updated in place, see setup_in_place)
+     *
+     * @return T*** (nullptr if the cell buffers released by a packed step couldn't be reallocated)
+     * @note step/step_n invalidate the returned row table (see swap_generations).
+     */
+    T ***get_next_tensor()
+    {
+        if (unpack_binary_cells() < 0)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                periodic_i = get_periodic_index(i, di, axis1_dim);
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    periodic_j = get_periodic_index(j, dj, axis2_dim);
-                    for (int dk = -boundary_radius; dk <= boundary_radius; dk++)
-                    {
-                        // exclude diagonal cells from neighborhood when VonNeumann is selected
-                        if (is_diagonal_neighboring_cell_3d(di, dj, dk))
-                        {
-                            // current di,dj,dk cell is a diagonal neighbor so exclude it
-                            continue;
-                        }
-                        periodic_k = get_periodic_index(k, dk, axis3_dim);
-                        // add state to flattened array
-                        neighborhood_cells[neighborhood_index] = tensor[periodic_i][periodic_j][periodic_k];
-                        neighborhood_index++;
-                    }
-                }
-            }
+            return nullptr;
         }
-        else // Moore neighborhood
+        return next_tensor;
+    }
+
+    /**
+     * @brief Get a strided view of the current state cell grid.
+     * The view addresses the same contiguous buffer as get_vector/get_matrix/get_tensor
+     * and can be used to walk rows and slabs linearly.
+     *
+     * @return GridView<T> (rank 0 if the grid isn't set up, is sparse or its packed cells couldn't be unpacked)
+     * @note Like the pointers of get_vector/get_matrix/get_tensor, the view is invalidated by step/step_n.
+     */
+    GridView<T> get_view()
+    {
+        if (sparse_grid != nullptr || unpack_binary_cells() < 0)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                periodic_i = get_periodic_index(i, di, axis1_dim);
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    periodic_j = get_periodic_index(j, dj, axis2_dim);
-                    for (int dk = -boundary_radius; dk <= boundary_radius; dk++)
-                    {
-                        periodic_k = get_periodic_index(k, dk, axis3_dim);
-                        // add state to flattened array
-                        neighborhood_cells[neighborhood_index] = tensor[periodic_i][periodic_j][periodic_k];
-                        neighborhood_index++;
-                    }
-                }
-            }
+            return GridView<T>();
         }
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        return GridView<T>(cells, rank, extents, strides);
     }
 
     /**
-     * @brief Adds cutoff neighboring cell state to neighborhood_cells array.
-     * Handles tensor (3d) case.
+     * @brief Get a strided view of the next state cell grid.
      *
-     * @param cell_index cell of interest's index
-     * @param neighborhood_cells array containing neighboring cell states
-     * @param neighborhood_index keep track of number of cell states added
+     * @return GridView<T> (rank 0 if the grid isn't set up, is updated in place, is sparse or its packed cells
+     * couldn't be unpacked)
+     * @note Like the pointers of get_vector/get_matrix/get_tensor, the view is invalidated by step/step_n.
      */
-    void generate_cutoff_neighborhood_3d(int *cell_index, T *neighborhood_cells, int &neighborhood_index)
+    GridView<T> get_next_view()
     {
-        int i = cell_index[0]; // get i-th index from array
-        int j = cell_index[1]; // get j-th index from array
-        int k = cell_index[2]; // get k-th index from array
-        int neighbor_i;        // neighboring cell's i-th index
-        int neighbor_j;        // neighboring cell's j-th index
-        int neighbor_k;        // neighboring cell's k-th index
+        if (sparse_grid != nullptr || unpack_binary_cells() < 0)
+        {
+            return GridView<T>();
+        }
+        int extents[3] = {axis1_dim, axis2_dim, axis3_dim};
+        if (next_cells == nullptr)
+        {
+            return GridView<T>(); // single buffer grid (see setup_in_place)
+        }
+        return GridView<T>(next_cells, rank, extents, strides);
+    }
 
-        if (neighborhood_type == CAEnums::VonNeumann)
+    /**
+     * @brief Get a cell of the grid (dense or sparse, see setup_sparse).
+     *
+     * @param cell_index index of the cell (one int per axis; this process' slabs for split grids)
+     * @return T - the cell, or an empty cell (T()) when cell_index lies outside the grid or the grid isn't set up
+     */
+    T get_cell(const int *cell_index)
+    {
+        if (!has_cells() || !is_inside_grid(cell_index) || unpack_binary_cells() < 0)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
-            {
-                neighbor_i = di + i;
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
-                {
-                    neighbor_j = dj + j;
-                    for (int dk = -boundary_radius; dk <= boundary_radius; dk++)
-                    {
-                        neighbor_k = dk + k;
-                        // exclude diagonal cells from neighborhood when VonNeumann is selected
-                        if (is_diagonal_neighboring_cell_3d(di, dj, dk))
-                        {
-                            // current di,dj,dk cell is a diagonal neighbor so exclude it
-                            continue;
-                        }
-                        // exclude cells that are out of bounds
-                        if ((neighbor_i <= 0 || neighbor_i >= axis1_dim) ||
-                            (neighbor_j <= 0 || neighbor_j >= axis2_dim) ||
-                            (neighbor_k <= 0 || neighbor_k >= axis3_dim))
-                        {
-                            // outside bounds; don't include cell state in the sum/counter
-                            continue;
-                        }
-                        // add state to flattened array
-                        neighborhood_cells[neighborhood_index] = tensor[neighbor_i][neighbor_j][neighbor_k];
-                        neighborhood_index++;
-                    }
-                }
-            }
+            return T();
+        }
+        if (sparse_grid != nullptr)
+        {
+            return sparse_grid->get_cell(cell_index);
+        }
+        return cells[get_flat_index(cell_index, rank)];
+    }
+
+    /**
+     * @brief Set a cell of the grid (dense or sparse, see setup_sparse).
+     * Sparse grids store the cell's brick if needed; bricks left empty are dropped by the next step.
+     *
+     * @param cell_index index of the cell (one int per axis; this process' slabs for split grids)
+     * @param cell the new cell
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * InvalidDimensions: cell_index lies outside the grid\n
+     * CellsMalloc: couldn't allocate memory for the brick or the cell buffers released by packed steps\n
+     * 0: no error
+     */
+    int set_cell(const int *cell_index, const T &cell)
+    {
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (!is_inside_grid(cell_index))
+        {
+            return CAEnums::InvalidDimensions;
+        }
+        if (sparse_grid != nullptr)
+        {
+            return sparse_grid->set_cell(cell_index, cell);
+        }
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        cells[get_flat_index(cell_index, rank)] = cell;
+        activity_valid = false;
+        return 0;
+    }
+
+    /**
+     * @brief Calls visit(cell_index, index_size, cell) for every occupied (non-empty) cell of the grid:
+     * row by row for dense grids, brick by brick for sparse grids (see setup_sparse). visit may change the
+     * cell; sparse grids drop the bricks it empties with the next step.
+     *
+     * @param visit lambda, functor or function taking (const int *cell_index, int index_size, T &cell)
+     * @return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * CellsMalloc: couldn't reallocate the cell buffers released by packed steps (see unpack_binary_cells)\n
+     * 0: no error
+     */
+    template <typename Visit>
+    int for_each_cell(Visit visit)
+    {
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (sparse_grid != nullptr)
+        {
+            sparse_grid->for_each_cell(visit);
+            return 0;
+        }
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
         }
-        else // Moore neighborhood
+        T empty_cell_state = T();
+        int row_size = get_row_size();
+        for (long row = 0; row < num_cells / row_size; row++)
         {
-            for (int di = -boundary_radius; di <= boundary_radius; di++)
+            T *cell = get_row(cells, row);
+            int cell_index[3] = {0, 0, 0};
+            if (rank == 2)
             {
-                neighbor_i = di + i;
-                for (int dj = -boundary_radius; dj <= boundary_radius; dj++)
+                cell_index[0] = row;
+            }
+            else if (rank == 3)
+            {
+                cell_index[0] = row / axis2_dim;
+                cell_index[1] = row % axis2_dim;
+            }
+            for (int n = 0; n < row_size; n++)
+            {
+                if (cell[n] != empty_cell_state)
                 {
-                    neighbor_j = dj + j;
-                    for (int dk = -boundary_radius; dk <= boundary_radius; dk++)
-                    {
-                        neighbor_k = dk + k;
-                        // exclude cells that are out of bounds
-                        if ((neighbor_i <= 0 || neighbor_i >= axis1_dim) ||
-                            (neighbor_j <= 0 || neighbor_j >= axis2_dim) ||
-                            (neighbor_k <= 0 || neighbor_k >= axis3_dim))
-                        {
-                            // outside bounds; don't include cell state in the sum/counter
-                            continue;
-                        }
-                        // add state to flattened array
-                        neighborhood_cells[neighborhood_index] = tensor[neighbor_i][neighbor_j][neighbor_k];
-                        neighborhood_index++;
-                    }
+                    cell_index[rank - 1] = n;
+                    visit(cell_index, rank, cell[n]);
                 }
             }
         }
+        activity_valid = false;
+        return 0;
     }
 
     /**
-     * @brief Dynamically allocates an array that will contain the neighborhood cell states.
+     * @brief Number of bricks stored by a sparse grid (see setup_sparse): its occupied bricks,
+     * plus the bricks emptied since the last step.
      *
-     * @param rank rank of the cells data
-     * @return T* pointer to the dynamic array
+     * @return long - 0 for dense grids
      */
-    T *malloc_neighborhood_array(int rank)
+    long get_num_bricks()
     {
-        /*
-         * Generate a flatten array of the cell's neighborhood.
-         * The neighborhood array can then be utilized for Majority, Parity, or Custom rule
-         */
-        int max_neighborhood_size = get_neighborhood_size(rank, boundary_radius, neighborhood_type);
-        // allocate memory and check if operation was successful
-        T *neighborhood_cells = new (std::nothrow) T[max_neighborhood_size];
-        return neighborhood_cells;
+        return sparse_grid != nullptr ? sparse_grid->get_num_bricks() : 0;
     }
 
     /**
-     * @brief The universal method that writing the output data in a log file
+     * @brief Get the neighborhood stencil for the current grid, boundary radius and neighborhood type.
+     * Entry n describes the n-th cell of the neighborhood array passed to custom rules
+     * with Periodic boundaries, so rules can read relative indices from stencil.coord(n)
+     * instead of decoding them with get_periodic_*_neighbor_index.
+     *
+     * @return const NeighborhoodStencil& (empty if the grid isn't set up)
+     */
+    const NeighborhoodStencil &get_stencil()
+    {
+        update_stencil();
+        return stencil;
+    }
+
+    /**
+     * @brief Setup boundary with enum values from boundary and set the boundary radius.
      *
+     * @param bound_type enum value for boundary (None, Periodic, Walled, CutOff)
+     * @param radius radius for the boundary
      * @return int - error code\n
-     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * InvalidRadius: radius can't be less than equal to 0\n
+     * RadiusLargerThanDimensions: radius must be smaller than half of the dimensions' size.
+     * CellsMalloc: couldn't reallocate the cell buffers released by packed steps (see unpack_binary_cells)\n
      * 0: no error
+     * @note Binary Majority steps only run on bit-packed cells with Periodic boundaries (see setup_rule).
      */
-    int append_log()
+    int setup_boundary(CAEnums::Boundary bound_type, int radius)
     {
-        std::ofstream file;
-        file.open(FILE_PATH, std::ios::app);
-
+        if (radius <= 0)
+        {
+            return CAEnums::InvalidRadius;
+        }
         if (vector != nullptr)
         {
-            for (int i = 0; i < axis1_dim; i++)
+            if (radius > global_axis1_dim / 2)
             {
-                file << vector[i].state << ",";
+                return CAEnums::RadiusLargerThanDimensions;
             }
         }
         else if (matrix != nullptr)
         {
-            for (int j = 0; j < axis1_dim; j++)
+            if (radius > global_axis1_dim / 2 || radius > axis2_dim / 2)
             {
-                for (int k = 0; k < axis2_dim; k++)
-                {
-                    file << matrix[j][k].state << ",";
-                }
+                return CAEnums::RadiusLargerThanDimensions;
             }
         }
-        else if (tensor != nullptr)
+        else if (tensor != nullptr || (sparse_grid != nullptr && rank == 3))
         {
-            for (int i = 0; i < axis1_dim; i++)
+            if (radius > axis2_dim / 2 || radius > axis3_dim / 2)
             {
-                for (int j = 0; j < axis2_dim; j++)
-                {
-                    for (int k = 0; k < axis3_dim; k++)
-                    {
-                        file << tensor[i][j][k].state << ",";
-                    }
-                }
+                return CAEnums::RadiusLargerThanDimensions;
             }
         }
-        else
+        else if (sparse_grid != nullptr && rank > 0)
         {
-            return CAEnums::CellsAreNull;
+            if (radius > axis1_dim / 2 || (rank == 2 && radius > axis2_dim / 2))
+            {
+                return CAEnums::RadiusLargerThanDimensions;
+            }
         }
-        file << "\n";
-        file.close();
-        return (0);
+
+        int error_code = unpack_binary_cells(); // the packed rows are padded for the boundary
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        this->boundary_type = bound_type;
+        this->boundary_radius = radius;
+        return 0;
     }
 
     /**
-     * @brief Create a log file (.csv) for data output
+     * @brief Enables or disables ghost cells: boundary_radius layers of padding around every axis
+     * of the grid that are refreshed once per step (periodic wrap or empty cells for CutOff/Walled).
+     * Neighborhoods are then read through the ghost layers without any modulo or bounds check.
+     * Ghost layers are used by every rule with Periodic boundaries and by the Parity rule
+     * with CutOff/Walled boundaries.
      *
+     * The grid is reallocated when ghost cells are toggled or the radius changes, which invalidates
+     * pointers returned by get_vector/get_matrix/get_tensor/get_view. With ghost cells the grid's
+     * rows are contiguous but the grid is not (see GridView::stride).
+     *
+     * @param enable pad the grid with ghost layers
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the padded grid\n
+     * 0: no error
      */
-    int create_log(void)
+    int setup_ghost_cells(bool enable)
     {
-        std::ofstream file;
-        file.open(FILE_PATH, std::ios::trunc | std::ios::out); // If it is pre-existing content, it should be erased
+        use_ghost_cells = enable;
+        return update_ghost_layout();
+    }
 
-        file << this->num_states << ",\n"; // First Line: Number of the states.
-        // Rule and function
-        file << this->axis1_dim << ","
-             << this->axis2_dim << ","
-             << this->axis3_dim << ",\n"; // Second Line: Dimensions of each axis.
-        file.close();
+    /**
+     * @brief Enables or disables the single buffer mode: steps update the cells in place instead of
+     * writing the next state into a second buffer, which halves the memory held by the grid. While a
+     * step sweeps the grid along its first axis, each thread only keeps a window of the previous
+     * generation of the 2 * boundary_radius + 1 slabs (rows for 2d grids) around the slab it updates,
+     * so every rule still sees the previous generation (synchronous update) and gives the same cells.
+     *
+     * Rules must not move cells (change cell_index): such steps return InPlaceCellMoved and keep every
+     * cell in place. There is no next state grid: get_next_vector/matrix/tensor return nullptr and
+     * get_next_view has rank 0. The grid is reallocated when the mode changes, which invalidates pointers
+     * returned by get_vector/get_matrix/get_tensor/get_view.
+     *
+     * @param enable update the cells in place
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the grid\n
+     * 0: no error
+     */
+    int setup_in_place(bool enable)
+    {
+        in_place = enable;
+        return relayout_cells(ghost_width);
+    }
+
+    /**
+     * @brief Enables or disables sparse storage, for grids that are mostly empty such as 4096^3 grids that
+     * can't be allocated densely. Only the bricks of SPARSE_BRICK_WIDTH cells along each axis (8 x 8 x 8 cells
+     * for 3d grids) holding a non-empty cell are stored (see SparseGrid); every other cell is empty (T()), so the
+     * memory held by the grid is proportional to its occupied bricks. A step only updates the occupied bricks and
+     * the bricks within boundary_radius cells of them, reading the neighborhoods from a window around each brick.
+     *
+     * Sparse grids take the same setup, step, step_n, log and print calls as dense grids and give the same cells,
+     * with two requirements on custom rules: an empty cell whose whole neighborhood is empty must stay empty (rules
+     * aren't called for such cells), and there is no next state grid to handle clashes in, so a cell moved onto an
+     * occupied cell of the next generation replaces it unless setup_collision_rule merges them. Cells moved outside
+     * the grid are dropped. The cells are read and written with get_cell, set_cell and for_each_cell:
+     * get_vector/get_matrix/get_tensor return nullptr and get_view has rank 0. Sparse grids start empty
+     * (fill_value 0), can't be split across processes (see setup_mpi) and are always stepped out of place.
+     * The log holds every cell of the grid, so disable it (see setup_logging) for grids too large to write.
+     *
+     * @param enable store only the occupied bricks
+     * @return int - error code\n
+     * CellsAlreadyInitialized: must be called before setup_dimensions\n
+     * CellsMalloc: couldn't allocate memory for the sparse grid\n
+     * 0: no error
+     */
+    int setup_sparse(bool enable)
+    {
+        if (has_cells())
+        {
+            return CAEnums::CellsAlreadyInitialized;
+        }
+        delete sparse_grid;
+        sparse_grid = nullptr;
+        if (enable)
+        {
+            sparse_grid = new (std::nothrow) SparseGrid<T>();
+            if (sparse_grid == nullptr)
+            {
+                return CAEnums::CellsMalloc;
+            }
+        }
         return 0;
     }
 
-public:
     /**
-     * @brief Get the vector cell grid
+     * @brief Sets the rule merging a cell moved by a step of a sparse grid (see setup_sparse) with the occupied
+     * cell of the next generation it lands on: collision_rule(moved_cell, next_cell) turns moved_cell into the
+     * cell kept. Without a collision rule the moved cell replaces the next cell. Dense grids don't call it:
+     * their rules read the next state grid (get_next_vector/matrix/tensor) to handle clashes.
      *
-     * @return T*
+     * @param collision_rule function merging the two cells (nullptr: the moved cell is kept)
+     * @return int - error code\n
+     * 0: no error
      */
-    T *get_vector()
+    int setup_collision_rule(void (*collision_rule)(T &moved_cell, const T &next_cell))
     {
-        return vector;
+        this->collision_rule = collision_rule;
+        return 0;
     }
 
     /**
-     * @brief Get the next state vector cell grid
+     * @brief Enables or disables the log file (Data/data.csv) written by setup_dimensions and every step.
+     * Logging is enabled by default; disable it for grids too large to write, such as large sparse grids.
      *
-     * @return T*
+     * @param enable write the log file
+     * @return int - error code\n
+     * 0: no error
      */
-    T *get_next_vector()
+    int setup_logging(bool enable)
     {
-        return next_vector;
+        logging = enable;
+        return 0;
+    }
+
+#ifdef ENABLE_MPI
+    /**
+     * @brief Splits the grid across the processes of comm (e.g. MPI_COMM_WORLD of a program run with
+     * mpirun -np N). Each process holds one block of consecutive slabs along the first axis (cells sharing
+     * the index i) and boundary_radius halo slabs copied from the neighboring blocks before every step.
+     * A process only updates its own slabs, and the halo exchange overlaps the update of the slabs that
+     * don't read the halos. Periodic grids exchange halos between the first and last processes as well.
+     *
+     * Every process must call the setup and step methods with the same arguments. Rules see the cells'
+     * indices in the whole grid and may move cells up to boundary_radius slabs into another process' block.
+     * append_log and print_grid gather the grid on the first process, which writes the log.
+     * get_vector/get_matrix/get_tensor/get_view return this process' slabs and halos (see get_owned_slabs).
+     * Cells are sent as bytes, so T must be trivially copyable. Steps don't use temporal blocking.
+     *
+     * Only the first axis is split: it must hold at least one slab per process, otherwise setup_dimensions
+     * returns InvalidDecomposition, and steps need boundary_radius slabs per process. Grids whose first axis
+     * is short (e.g. the 1 x N grids of Galaxy) can't be split; put the longest axis first. A message holds
+     * boundary_radius slabs and a logged grid is gathered whole, so both must fit in INT_MAX cells.
+     *
+     * @param comm processes sharing the grid; used for the grid's messages as is
+     * @return int - error code\n
+     * CellsAlreadyInitialized: must be called before setup_dimensions\n
+     * 0: no error
+     */
+    int setup_mpi(MPI_Comm comm)
+    {
+        if (cells != nullptr)
+        {
+            return CAEnums::CellsAlreadyInitialized;
+        }
+        this->comm = comm;
+        MPI_Comm_rank(comm, &comm_rank);
+        MPI_Comm_size(comm, &comm_size);
+        if (cell_type == MPI_DATATYPE_NULL)
+        {
+            MPI_Type_contiguous(sizeof(T), MPI_BYTE, &cell_type);
+            MPI_Type_commit(&cell_type);
+        }
+        return 0;
     }
+#endif
 
     /**
-     * @brief Get the matrix cell grid
+     * @brief Get the slabs (indices along the first axis) of get_view/get_vector/get_matrix/get_tensor
+     * held by this process (see setup_mpi). Without MPI these are all the slabs of the grid.
      *
-     * @return T*
+     * @param local_begin set to the index of this process' first slab
+     * @param local_end set to one past the index of this process' last slab
+     * @param global_begin set to the index of this process' first slab in the whole grid
      */
-    T **get_matrix()
+    void get_owned_slabs(int &local_begin, int &local_end, int &global_begin)
     {
-        return matrix;
+        local_begin = lower_halo;
+        local_end = axis1_dim - upper_halo;
+        global_begin = first_owned_slab;
     }
 
     /**
-     * @brief Get the next state matrix cell grid
+     * @brief Enables or disables activity tracking: steps record which tiles (see setup_tiles) changed and
+     * only recompute the tiles whose cells' neighborhoods reach a cell that changed during the previous step.
+     * The other tiles are left as they are; the next state buffer already holds their cells, so once most of
+     * the grid is static a step costs about the number of active tiles instead of the number of cells.
      *
-     * @return T*
+     * Rules must only depend on the neighborhood (not on cell_index, steps_taken or random numbers) and steps
+     * must keep using the same rule. Majority, Parity and totalistic rules are then computed tile by tile
+     * instead of over the whole grid. After a step in which a rule moved a cell, the next step recomputes
+     * every tile. Cells changed outside of step (e.g. through get_view) require calling
+     * setup_activity_tracking(true) again. Grids updated in place or split across processes recompute every cell.
+     *
+     * @param enable track the activity
+     * @return int error code
      */
-    T **get_next_matrix()
+    int setup_activity_tracking(bool enable)
     {
-        return next_matrix;
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        track_activity = enable;
+        activity_valid = false; // the first step recomputes every tile
+        return 0;
     }
 
     /**
-     * @brief Get the tensor cell grid
+     * @brief Number of tiles recomputed by the last step with activity tracking (see setup_activity_tracking).
      *
-     * @return T*
+     * @return long
      */
-    T ***get_tensor()
+    long get_num_active_tiles()
     {
-        return tensor;
+        return num_active_tiles;
     }
 
     /**
-     * @brief Get the next state tensor cell grid
+     * @brief Sets the shape of the tiles a step is split into. Each tile updates tile_rows
+     * consecutive rows (cells along the last axis) by tile_width cells; with OpenMP the tiles
+     * are scheduled dynamically across threads. Smaller tiles balance the load on small grids,
+     * larger tiles reduce the scheduling overhead.
      *
-     * @return T*
+     * @param tile_rows number of rows of a tile (DEFAULT_TILE_ROWS by default)
+     * @param tile_width number of cells along the last axis of a tile (DEFAULT_TILE_WIDTH by default)
+     * @return int - error code\n
+     * InvalidTileSize: tile_rows and tile_width must be greater than 0\n
+     * 0: no error
      */
-    T ***get_next_tensor()
+    int setup_tiles(int tile_rows, int tile_width)
     {
-        return next_tensor;
+        if (tile_rows < 1 || tile_width < 1)
+        {
+            return CAEnums::InvalidTileSize;
+        }
+        this->tile_rows = tile_rows;
+        this->tile_width = tile_width;
+        return 0;
     }
 
     /**
-     * @brief Setup boundary with enum values from boundary and set the boundary radius.
+     * @brief Materializes a custom rule into a lookup table so that step() looks up the next state
+     * of every full neighborhood instead of calling the rule. The rule must be pure: its new state
+     * may only depend on the neighborhood's states (it gets a zero cell_index while the table is built).
+     * After this call, step() and step(custom_rule) use the table; other rules passed to step are called as usual.
+     * The table has rule_states ^ neighborhood size entries, built for the current rank, radius and
+     * neighborhood type (or on the first step when the grid isn't set up yet) and rebuilt when they change.
      *
-     * @param bound_type enum value for boundary (None, Periodic, Walled, CutOff)
-     * @param radius radius for the boundary
+     * @param custom_rule pure custom rule; nullptr removes the table
+     * @param rule_states number of cell states the rule is defined for; cell states must be in [0, rule_states)
      * @return int - error code\n
-     * InvalidRadius: radius can't be less than equal to 0\n
-     * RadiusLargerThanDimensions: radius must be smaller than half of the dimensions' size.
+     * InvalidNumStates: rule_states can't be less than 2\n
+     * RuleTableTooLarge: rule_states ^ neighborhood size is larger than RULE_TABLE_MAX_SIZE\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the table\n
      * 0: no error
      */
-    int setup_boundary(CAEnums::Boundary bound_type, int radius)
+    int setup_rule_table(void(custom_rule)(int *, int, T *, int, T &), int rule_states)
     {
-        if (radius <= 0)
+        rule_table = RuleTable<T>();
+        if (custom_rule == nullptr)
         {
-            return CAEnums::InvalidRadius;
+            return 0;
         }
-        if (vector != nullptr)
+        if (rule_states < 2)
         {
-            if (radius > axis1_dim / 2)
-            {
-                return CAEnums::RadiusLargerThanDimensions;
-            }
+            return CAEnums::InvalidNumStates;
         }
-        else if (matrix != nullptr)
+        rule_table.rule = custom_rule;
+        rule_table.num_states = rule_states;
+        if (rank == 0)
         {
-            if (radius > axis1_dim / 2 || radius > axis2_dim / 2)
-            {
-                return CAEnums::RadiusLargerThanDimensions;
-            }
+            return 0;
         }
-        else if (tensor != nullptr)
+        int error_code = rule_table.build(rank, boundary_radius, neighborhood_type,
+                                          get_neighborhood_size(rank, boundary_radius, neighborhood_type));
+        if (error_code < 0)
         {
-            if (radius > axis2_dim / 2 || radius > axis3_dim / 2)
-            {
-                return CAEnums::RadiusLargerThanDimensions;
-            }
+            rule_table = RuleTable<T>();
         }
-
-        this->boundary_type = bound_type;
-        this->boundary_radius = radius;
-        return 0;
+        return error_code;
     }
 
     /**
@@ -904,61 +6363,71 @@ public:
     CellularAutomata() : BaseCellularAutomata()
     {
         steps_taken = 0;
+        in_place = false;
+        global_axis1_dim = 0;
+        first_owned_slab = 0;
+        lower_halo = 0;
+        upper_halo = 0;
+        first_updated_slab = 0;
+        last_updated_slab = INT_MAX;
+        halos_exchanged = false;
+#ifdef ENABLE_MPI
+        comm = MPI_COMM_NULL;
+        comm_rank = 0;
+        comm_size = 1;
+        cell_type = MPI_DATATYPE_NULL;
+        num_halo_requests = 0;
+#endif
+        neighborhood_slot_size = 0;
+        neighborhood_num_slots = 0;
+        vote_slot_size = 0;
+        cell_buffer = nullptr;
+        next_cell_buffer = nullptr;
+        buffer_size = 0;
+        packed_row_words = 0;
+        packed_cells_current = false;
+        tile_rows = DEFAULT_TILE_ROWS;
+        tile_width = DEFAULT_TILE_WIDTH;
+        pinned_threads = 0;
+        track_activity = false;
+        activity_valid = false;
+        num_active_tiles = 0;
+        ghost_width = 0;
+        use_ghost_cells = false;
+        ghost_neighborhoods = false;
+        cells = nullptr;
+        next_cells = nullptr;
+        num_cells = 0;
+        rank = 0;
+        strides[0] = strides[1] = strides[2] = 0;
         vector = nullptr;
         next_vector = nullptr;
         matrix = nullptr;
         next_matrix = nullptr;
         tensor = nullptr;
         next_tensor = nullptr;
+        sparse_grid = nullptr;
+        collision_rule = nullptr;
+        logging = true;
     }
 
     /**
      * @brief Destroy the Cellular Automata object.
-     * Deallocates memory reserved for vector/matrix/tensor.
+     * Deallocates memory reserved for vector/matrix/tensor and the sparse grid.
      *
      */
     ~CellularAutomata()
     {
-        // Free each sub-array
-        if (vector != nullptr)
-        {
-            // Free the array of pointers
-            delete[] vector;
-            delete[] next_vector;
-        }
-
-        if (matrix != nullptr)
-        {
-            // Free each sub-array
-            for (int i = 0; i < axis1_dim; ++i)
-            {
-                delete[] matrix[i];
-                delete[] next_matrix[i];
-            }
-            // Free the array of pointers
-            delete[] matrix;
-            delete[] next_matrix;
-        }
-
-        if (tensor != nullptr)
+        free_cells();
+        delete sparse_grid;
+#ifdef ENABLE_MPI
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (cell_type != MPI_DATATYPE_NULL && !finalized)
         {
-            // Free each sub-array
-            for (int i = 0; i < axis1_dim; ++i)
-            {
-                for (int j = 0; j < axis2_dim; j++)
-                {
-                    delete[] tensor[i][j];
-                    delete[] next_tensor[i][j];
-                }
-
-                delete[] tensor[i];
-                delete[] next_tensor[i];
-            }
-
-            // Free the array of pointers
-            delete[] tensor;
-            delete[] next_tensor;
+            MPI_Type_free(&cell_type);
         }
+#endif
     }
 
     /**
@@ -969,30 +6438,39 @@ public:
      * @return int - error code\n
      * CellsAlreadyInitialized: vector was already allocated\n
      * CellsMalloc: couldn't allocate memory for the specified vector size\n
+     * InvalidCellState: fill_value doesn't fit the cell type (e.g. uint8_t cells) or isn't 0 on a sparse grid\n
+     * InvalidDecomposition: the grid is split across more processes than axis1_dim slabs (see setup_mpi)\n
+     * InvalidDimensions: an axis of a sparse grid is empty or too long (see SparseGrid::setup_dimensions)\n
      * 0: no error
      */
     int setup_dimensions_1d(int axis1_dim, int fill_value = 0)
     {
-        if (vector != nullptr)
+        if (has_cells())
         {
             return CAEnums::CellsAlreadyInitialized;
         }
+        if (!is_storable_state<T>(fill_value))
+        {
+            return CAEnums::InvalidCellState;
+        }
 
         this->axis1_dim = axis1_dim;
-        vector = new (std::nothrow) T[axis1_dim];
-        next_vector = new (std::nothrow) T[axis1_dim];
-
-        if (vector == nullptr || next_vector == nullptr)
+        if (sparse_grid != nullptr)
         {
-            return CAEnums::CellsMalloc;
+            return setup_sparse_dimensions(1, fill_value);
+        }
+        int error_code = allocate_cells(1);
+        if (error_code < 0)
+        {
+            return error_code;
         }
 
         // initialize vector filled with zeros
-        for (int j = 0; j < axis1_dim; j++)
+        for (long n = 0; n < num_cells; n++)
         {
-            vector[j].state = fill_value;
-            next_vector[j].state = fill_value;
+            set_cell_state(cells[n], fill_value);
         }
+        copy_cells_to_next_generation();
 
         create_log();
         return 0;
@@ -1007,336 +6485,496 @@ public:
      * @return int - error code\n
      * CellsAlreadyInitialized: matrix was already allocated\n
      * CellsMalloc: couldn't allocate memory for the specified matrix size\n
+     * InvalidCellState: fill_value doesn't fit the cell type (e.g. uint8_t cells) or isn't 0 on a sparse grid\n
+     * InvalidDecomposition: the grid is split across more processes than axis1_dim slabs (see setup_mpi)\n
+     * InvalidDimensions: an axis of a sparse grid is empty or too long (see SparseGrid::setup_dimensions)\n
+     * 0: no error
+     */
+    int setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value = 0)
+    {
+        if (has_cells())
+        {
+            return CAEnums::CellsAlreadyInitialized;
+        }
+        if (!is_storable_state<T>(fill_value))
+        {
+            return CAEnums::InvalidCellState;
+        }
+
+        this->axis1_dim = axis1_dim;
+        this->axis2_dim = axis2_dim;
+        if (sparse_grid != nullptr)
+        {
+            return setup_sparse_dimensions(2, fill_value);
+        }
+        int error_code = allocate_cells(2);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        // initialize matrix filled with zeros
+        for (long n = 0; n < num_cells; n++)
+        {
+            set_cell_state(cells[n], fill_value);
+        }
+        copy_cells_to_next_generation();
+
+        create_log();
+        return 0;
+    }
+
+    /**
+     * @brief Set up 3d tensor of cell states.
+     *
+     * @param axis1_dim The size of the first dimension
+     * @param axis2_dim The size of the second dimension
+     * @param axis3_dim The size of the third dimension
+     * @param fill_value the value to set every cell state to
+     * @return int - error code\n
+     * CellsAlreadyInitialized: tensor was already allocated\n
+     * CellsMalloc: couldn't allocate memory for the specified tensor size\n
+     * InvalidCellState: fill_value doesn't fit the cell type (e.g. uint8_t cells) or isn't 0 on a sparse grid\n
+     * InvalidDecomposition: the grid is split across more processes than axis1_dim slabs (see setup_mpi)\n
+     * InvalidDimensions: an axis of a sparse grid is empty or too long (see SparseGrid::setup_dimensions)\n
+     * 0: no error
+     */
+    int setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value = 0)
+    {
+        if (has_cells())
+        {
+            return CAEnums::CellsAlreadyInitialized;
+        }
+        if (!is_storable_state<T>(fill_value))
+        {
+            return CAEnums::InvalidCellState;
+        }
+
+        this->axis1_dim = axis1_dim;
+        this->axis2_dim = axis2_dim;
+        this->axis3_dim = axis3_dim;
+        if (sparse_grid != nullptr)
+        {
+            return setup_sparse_dimensions(3, fill_value);
+        }
+        int error_code = allocate_cells(3);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+
+        // initialize tensor filled with zeros
+        for (long n = 0; n < num_cells; n++)
+        {
+            set_cell_state(cells[n], fill_value);
+        }
+        copy_cells_to_next_generation();
+
+        create_log();
+        return 0;
+    }
+
+    /**
+     * @brief Initializes the first state of the grid using random numbers.
+     * Sparse grids draw the gaps between the chosen cells instead of a number per cell,
+     * so the cost is proportional to the number of occupied cells.
+     *
+     * @param x_state choose the cell state to initialize the grid with.
+     * @param prob the probability of a cell to turn to state given from x_state
+     *@return int - error code\n
+     * CellsAreNull: tensor not initialized\n
+     * InvalidCellStateCondition: x_state must be less than num_states and fit the cell type\n
+     * CellsMalloc: couldn't allocate memory for the occupied bricks of a sparse grid\n
+     * 0: no error
+     */
+    int init_condition(int x_state, double prob)
+    {
+        if (!(x_state < num_states) || !is_storable_state<T>(x_state))
+        {
+            return CAEnums::InvalidCellStateCondition;
+        }
+
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (sparse_grid != nullptr)
+        {
+            return init_sparse_condition(x_state, prob);
+        }
+
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        srand(time(NULL));
+        double random_cell_state;
+
+        // rows are stored in row-major order so walking them visits i, j, k in order
+        int row_size = get_row_size();
+        for (long row = 0; row < num_cells / row_size; row++)
+        {
+            T *cell = get_row(cells, row);
+            for (int n = 0; n < row_size; n++)
+            {
+                random_cell_state = (double)rand() / RAND_MAX;
+                if (random_cell_state < prob)
+                {
+                    set_cell_state(cell[n], x_state);
+                }
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Simulates a cellular automata step.
+     * A new state is generated and stored stored as the new state for subsequent calls to step method.
+     *
+     * This method supports the use of a custom rule type.
+     *
+     * If cell states move on the grid, the user is responsible for handling clashes.
+     * If two cells move to the same cell position, the grid will retain the most
+     * recent cell assignment (new will replace the old).
+     *
+     * A rule materialized by setup_rule_table is looked up instead of called when custom_rule
+     * is that rule or nullptr.
+     *
+     * @param custom_rule function that is called when a Custom rule type is specified
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * CustomRuleIsNull: given custom rule function is null and no rule table is set up (Custom rule type)\n
+     * InvalidCellState, RuleTableTooLarge: see run_rule_table_step (rule table)\n
+     * CellsMalloc: couldn't reallocate the cell buffers released by packed steps (see unpack_binary_cells)\n
+     * 0: no error
+     */
+    int step(void(custom_rule)(int *, int, T *, int, T &))
+    {
+        if (cells != nullptr && !in_place && !track_activity && can_step_packed_binary())
+        {
+            // binary Parity/Majority run 64 cells at a time on bit-packed cells
+            bool packed = false;
+            int error_code = step_packed_binary(packed);
+            if (error_code < 0 || packed)
+            {
+                return error_code;
+            }
+        }
+        // every other step reads the cell buffers
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        if ((steps_in_windows() || track_activity) && rule_type == CAEnums::Parity)
+        {
+            // the sums of run_parity_step are written to the next state buffer and cover the whole grid
+            return run_builtin_array_rule_steps(1);
+        }
+        if (rule_type == CAEnums::Parity)
+        {
+            // parity only depends on the neighborhood sum
+            return run_parity_step();
+        }
+        if (rule_type == CAEnums::Majority && !steps_in_windows() && !track_activity && prefers_majority_votes())
+        {
+            return run_majority_vote_step();
+        }
+
+        if (rule_type == CAEnums::Majority)
+        {
+            // many states: count the votes of every neighborhood
+            return run_builtin_array_rule_steps(1);
+        }
+
+        if (!has_cells())
+        {
+            return CAEnums::CellsAreNull;
+        }
+        if (rule_table.rule != nullptr && (custom_rule == nullptr || custom_rule == rule_table.rule))
+        {
+            // materialized rule: one table lookup per cell
+            return run_rule_table_step();
+        }
+        if (custom_rule == nullptr)
+        {
+            return CAEnums::CustomRuleIsNull;
+        }
+        // copies the neighborhood into a flat array and applies the rule
+        return run_array_rule_step(custom_rule);
+    }
+
+    /**
+     * @brief Simulates a cellular automata step using a custom rule that reads its
+     * neighborhood through a NeighborhoodView instead of a copied array.
+     * The view references the current state grid directly so no neighbor is copied.
+     *
+     * Majority and Parity rule types don't use the custom rule and behave like step().
+     *
+     * If cell states move on the grid, the user is responsible for handling clashes.
+     * If two cells move to the same cell position, the grid will retain the most
+     * recent cell assignment (new will replace the old).
+     *
+     * @param view_rule function that is called when a Custom rule type is specified
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * CustomRuleIsNull: given custom rule function is null\n
+     * 0: no error
+     */
+    int step(void(view_rule)(int *, int, const NeighborhoodView<T> &, T &))
+    {
+        if (rule_type != CAEnums::Custom)
+        {
+            return step();
+        }
+        if (view_rule == nullptr)
+        {
+            return CAEnums::CustomRuleIsNull;
+        }
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        return run_view_rule_step(view_rule);
+    }
+
+    /**
+     * @brief Simulates a cellular automata step using a totalistic custom rule: the new state
+     * only depends on the cell and the sum of its neighborhood's states (e.g. Larger than Life rules).
+     * The neighborhood sums are computed with running sums along each axis, so the cost per cell
+     * doesn't depend on the boundary radius. Supports every boundary and neighborhood type.
+     *
+     * Majority and Parity rule types don't use the custom rule and behave like step().
+     *
+     * @param totalistic_rule function called for every cell with the sum of its neighborhood's states
+     * (cell of interest included), the number of cells in the neighborhood and a reference to the
+     * new cell state, which initially holds the cell's current state
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood sums\n
+     * CustomRuleIsNull: given custom rule function is null\n
      * 0: no error
      */
-    int setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value = 0)
+    int step(void(totalistic_rule)(int, int, T &))
     {
-        if (matrix != nullptr)
+        if (rule_type != CAEnums::Custom)
         {
-            return CAEnums::CellsAlreadyInitialized;
+            return step();
         }
-
-        this->axis1_dim = axis1_dim;
-        this->axis2_dim = axis2_dim;
-        matrix = new (std::nothrow) T *[axis1_dim];
-        next_matrix = new (std::nothrow) T *[axis1_dim];
-
-        if (matrix == nullptr || next_matrix == nullptr)
+        if (totalistic_rule == nullptr)
         {
-            return CAEnums::CellsMalloc;
+            return CAEnums::CustomRuleIsNull;
         }
-
-        for (int i = 0; i < axis1_dim; i++)
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
         {
-            matrix[i] = new (std::nothrow) T[axis2_dim];
-            next_matrix[i] = new (std::nothrow) T[axis2_dim];
+            return error_code;
         }
+        return run_totalistic_step(totalistic_rule);
+    }
 
-        // initialize matrix filled with zeros
-        for (int j = 0; j < axis1_dim; j++)
+    /**
+     * @brief Simulates a cellular automata step using a custom rule given as a lambda or functor
+     * (captured parameters replace globals). The rule's type is a template parameter, so its
+     * code is inlined into the neighborhood loop and specialized for every call site.
+     * Function pointers keep using the overloads above.
+     *
+     * The rule is chosen by its call signature, like the function pointer overloads:<br>
+     * rule(int *cell_index, int index_size, T *neighborhood_cells, int neighborhood_size, T &new_cell_state)<br>
+     * rule(int *cell_index, int index_size, const NeighborhoodView<T> &neighborhood, T &new_cell_state)<br>
+     * rule(int sum, int neighborhood_size, T &new_cell_state) (totalistic rule)
+     *
+     * Majority and Parity rule types don't use the custom rule and behave like step().
+     * With OpenMP the rule is called concurrently from every thread.
+     *
+     * @param rule lambda or functor
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
+     * 0: no error
+     */
+    template <typename Rule>
+    auto step(Rule &&rule)
+        -> decltype(rule(std::declval<int *>(), 0, std::declval<T *>(), 0, std::declval<T &>()), int())
+    {
+        if (rule_type != CAEnums::Custom)
         {
-            for (int k = 0; k < axis2_dim; k++)
-            {
-                matrix[j][k].state = fill_value;
-                next_matrix[j][k].state = fill_value;
-            }
+            return step();
         }
-
-        create_log();
-        return 0;
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        return run_array_rule_step(rule);
     }
 
     /**
-     * @brief Set up 3d tensor of cell states.
+     * @brief step(Rule &&rule) overload for rules reading their neighborhood through a NeighborhoodView.
      *
-     * @param axis1_dim The size of the first dimension
-     * @param axis2_dim The size of the second dimension
-     * @param axis3_dim The size of the third dimension
-     * @param fill_value the value to set every cell state to
-     * @return int - error code\n
-     * CellsAlreadyInitialized: tensor was already allocated\n
-     * CellsMalloc: couldn't allocate memory for the specified tensor size\n
+     * @param rule lambda or functor
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood arrays\n
      * 0: no error
      */
-    int setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value = 0)
+    template <typename Rule>
+    auto step(Rule &&rule)
+        -> decltype(rule(std::declval<int *>(), 0, std::declval<const NeighborhoodView<T> &>(), std::declval<T &>()), int())
     {
-        if (tensor != nullptr)
+        if (rule_type != CAEnums::Custom)
         {
-            return CAEnums::CellsAlreadyInitialized;
+            return step();
         }
-
-        this->axis1_dim = axis1_dim;
-        this->axis2_dim = axis2_dim;
-        this->axis3_dim = axis3_dim;
-        tensor = new (std::nothrow) T **[axis1_dim];
-        next_tensor = new (std::nothrow) T **[axis1_dim];
-
-        if (tensor == nullptr || next_tensor == nullptr)
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
         {
-            return CAEnums::CellsMalloc;
+            return error_code;
         }
+        return run_view_rule_step(rule);
+    }
 
-        for (int i = 0; i < axis1_dim; i++)
+    /**
+     * @brief step(Rule &&rule) overload for totalistic rules (see step(void(totalistic_rule)(int, int, T &))).
+     *
+     * @param rule lambda or functor
+     *@return int - error code\n
+     * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the neighborhood sums\n
+     * 0: no error
+     */
+    template <typename Rule>
+    auto step(Rule &&rule) -> decltype(rule(0, 0, std::declval<T &>()), int())
+    {
+        if (rule_type != CAEnums::Custom)
         {
-            tensor[i] = new (std::nothrow) T *[axis2_dim];
-            next_tensor[i] = new (std::nothrow) T *[axis2_dim];
-
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                tensor[i][j] = new (std::nothrow) T[axis3_dim];
-                next_tensor[i][j] = new (std::nothrow) T[axis3_dim];
-            }
+            return step();
         }
-
-        // initialize matrix filled with zeros
-        for (int i = 0; i < axis1_dim; i++)
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
         {
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                for (int k = 0; k < axis3_dim; k++)
-                {
-                    tensor[i][j][k].state = fill_value;
-                    next_tensor[i][j][k].state = fill_value;
-                }
-            }
+            return error_code;
         }
-
-        create_log();
-        return 0;
+        return run_totalistic_step(rule);
     }
 
     /**
-     * @brief Initializes the first state of the grid using random numbers.
+     * @brief Simulates a cellular automata step.
+     * A new state is generated and stored as the new state for subsequent calls to step method.
      *
-     * @param x_state choose the cell state to initialize the grid with.
-     * @param prob the probability of a cell to turn to state given from x_state
      *@return int - error code\n
-     * CellsAreNull: tensor not initialized\n
-     * InvalidCellStateCondition: x_state must be less than num_states\n
+     * Error codes returned by step(custom_rule)\n
      * 0: no error
      */
-    int init_condition(int x_state, double prob)
+    int step()
+    {
+        // return step(func) error code
+        return step(static_cast<void (*)(int *, int, T *, int, T &)>(nullptr));
+    }
+
+    /**
+     * @brief Simulates num_steps cellular automata steps; the cells, steps_taken and log are those of
+     * num_steps calls to step(custom_rule).
+     *
+     * Custom rules (and rule tables on Periodic grids) advance cache sized blocks several generations
+     * at a time with halos of num_steps * boundary_radius cells (temporal blocking), so the grid is
+     * streamed through memory once every few generations instead of every generation. This requires
+     * rules to only depend on their arguments; rules moving cells run one step at a time.
+     *
+     * The built-in Parity and Majority rules are blocked too, in the window blocks of their sum and vote
+     * kernels (see run_blocked_builtin_steps), except on bit-packed binary grids, whose steps already
+     * read 64 cells per word.
+     *
+     * @param num_steps number of steps
+     * @param custom_rule function pointer to a custom rule (see step)
+     * @return int - error code\n
+     * InvalidNumSteps: num_steps is negative\n
+     * Error codes returned by step(custom_rule)\n
+     * 0: no error
+     */
+    int step_n(int num_steps, void(custom_rule)(int *, int, T *, int, T &) = nullptr)
     {
-        if (!(x_state < num_states))
+        if (num_steps < 0)
         {
-            return CAEnums::InvalidCellStateCondition;
+            return CAEnums::InvalidNumSteps;
         }
-
-        srand(time(NULL));
-        double random_cell_state;
-
-        if (vector != nullptr)
+        if (cells != nullptr && num_steps > 1 && can_block_builtin_steps())
         {
-            for (int i = 0; i < axis1_dim; i++)
+            int error_code = unpack_binary_cells();
+            if (error_code < 0)
             {
-                random_cell_state = (double)rand() / RAND_MAX;
-                if (random_cell_state < prob)
-                {
-                    vector[i].state = x_state;
-                }
+                return error_code;
             }
+            return run_blocked_builtin_steps(num_steps);
         }
-        else if (matrix != nullptr)
+        if (cells != nullptr && rule_type == CAEnums::Custom && num_steps > 1)
         {
-            for (int j = 0; j < axis1_dim; j++)
+            int error_code = unpack_binary_cells();
+            if (error_code < 0)
             {
-                for (int k = 0; k < axis2_dim; k++)
-                {
-                    random_cell_state = (double)rand() / RAND_MAX;
-                    if (random_cell_state < prob)
-                    {
-                        matrix[j][k].state = x_state;
-                    }
-                }
+                return error_code;
             }
-        }
-        else if (tensor != nullptr)
-        {
-            for (int i = 0; i < axis1_dim; i++)
+            if (rule_table.rule != nullptr && (custom_rule == nullptr || custom_rule == rule_table.rule))
             {
-                for (int j = 0; j < axis2_dim; j++)
-                {
-                    for (int k = 0; k < axis3_dim; k++)
-                    {
-                        random_cell_state = (double)rand() / RAND_MAX;
-                        if (random_cell_state < prob)
-                        {
-                            tensor[i][j][k].state = x_state;
-                        }
-                    }
-                }
+                return run_rule_table_step(num_steps);
+            }
+            if (custom_rule != nullptr)
+            {
+                return run_array_rule_step(custom_rule, num_steps);
             }
         }
-        else
+        for (; num_steps > 0; num_steps--)
         {
-            return CAEnums::CellsAreNull;
+            int error_code = step(custom_rule);
+            if (error_code < 0)
+            {
+                return error_code;
+            }
         }
         return 0;
     }
 
     /**
-     * @brief Simulates a cellular automata step.
-     * A new state is generated and stored stored as the new state for subsequent calls to step method.
-     *
-     * This method supports the use of a custom rule type.
-     *
-     * If cell states move on the grid, the user is responsible for handling clashes.
-     * If two cells move to the same cell position, the grid will retain the most
-     * recent cell assignment (new will replace the old).
+     * @brief step_n overload for rules given as a lambda or functor (see step(Rule &&rule)).
      *
-     * @param custom_rule function that is called when a Custom rule type is specified
-     *@return int - error code\n
-     * Error codes returned by get_state_from_neighborhood_Xd methods\n
+     * @param num_steps number of steps
+     * @param rule lambda or functor
+     * @return int - error code\n
+     * InvalidNumSteps: num_steps is negative\n
+     * Error codes returned by step(rule)\n
      * 0: no error
      */
-    int step(void(custom_rule)(int *, int, T *, int, T &))
+    template <typename Rule>
+    auto step_n(int num_steps, Rule &&rule)
+        -> decltype(rule(std::declval<int *>(), 0, std::declval<T *>(), 0, std::declval<T &>()), int())
     {
-        int error_code = 0; // store error code return by other methods
-        T new_cell_state;   // stores the cell's new state
-        T empty_cell_state; // cell state for zeroing out old states
-        int index_size;     // number of indices required to address the cell
-
-        if (vector != nullptr)
+        if (num_steps < 0)
         {
-            // store the main cell's index in cell_index for custom rule type
-            index_size = 1;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-            for (int i = 0; i < axis1_dim; i++)
-            {
-                int cell_index[index_size] = {i};
-                new_cell_state = vector[i];
-                error_code = get_state_from_neighborhood_1d(cell_index, index_size, new_cell_state, custom_rule);
-                if (error_code < 0)
-                {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                    /*
-                     * Return error code when omp is not enabled
-                     * otherwise the above pragma will exit out of the for loop(s)
-                     */
-                    return error_code;
-#endif
-                }
-                /*
-                 * The update cell if new_cell_state is no empty_state.
-                 * Avoids overwriting the motion of cells.
-                 */
-                if (new_cell_state != empty_cell_state)
-                {
-                    next_vector[cell_index[0]] = new_cell_state;
-                }
-            }
-            // store next cell state to the current cell state for the next time step
-            swap_states<T>(vector, next_vector, axis1_dim);
+            return CAEnums::InvalidNumSteps;
         }
-        else if (matrix != nullptr)
+        bool builtin = cells != nullptr && num_steps > 1 && can_block_builtin_steps();
+        if (builtin || (cells != nullptr && rule_type == CAEnums::Custom && num_steps > 1))
         {
-            // store the main cell's index in cell_index for custom rule type
-            index_size = 2;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-            for (int i = 0; i < axis1_dim; i++)
+            int error_code = unpack_binary_cells();
+            if (error_code < 0)
             {
-                for (int j = 0; j < axis2_dim; j++)
-                {
-                    int cell_index[index_size] = {i, j};
-                    new_cell_state = matrix[i][j];
-                    error_code = get_state_from_neighborhood_2d(cell_index, index_size, new_cell_state, custom_rule);
-                    if (error_code < 0)
-                    {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                        /*
-                         * Return error code when omp is not enabled
-                         * otherwise the above pragma will exit out of the for loop(s)
-                         */
-                        return error_code;
-#endif
-                    }
-                    /*
-                     * The update cell if new_cell_state is no empty_state.
-                     * Avoids overwriting the motion of cells.
-                     */
-                    if (new_cell_state != empty_cell_state)
-                    {
-                        next_matrix[cell_index[0]][cell_index[1]] = new_cell_state;
-                    }
-                }
+                return error_code;
             }
-            // store next cell state to the current cell state for the next time step
-            swap_states<T>(matrix, next_matrix, axis1_dim, axis2_dim);
+            return builtin ? run_blocked_builtin_steps(num_steps) : run_array_rule_step(rule, num_steps);
         }
-        else if (tensor != nullptr)
+        for (; num_steps > 0; num_steps--)
         {
-            index_size = 3;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-            for (int i = 0; i < axis1_dim; i++)
+            int error_code = step(rule);
+            if (error_code < 0)
             {
-                for (int j = 0; j < axis2_dim; j++)
-                {
-                    for (int k = 0; k < axis3_dim; k++)
-                    {
-                        int cell_index[index_size] = {i, j, k};
-                        new_cell_state = tensor[i][j][k];
-                        error_code = get_state_from_neighborhood_3d(cell_index, index_size, new_cell_state, custom_rule);
-                        if (error_code < 0)
-                        {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                            /*
-                             * Return error code when omp is not enabled
-                             * otherwise the above pragma will exit out of the for loop(s)
-                             */
-                            return error_code;
-#endif
-                        }
-                        /*
-                         * The update cell if new_cell_state is no empty_state.
-                         * Avoids overwriting the motion of cells.
-                         */
-                        if (new_cell_state != empty_cell_state)
-                        {
-                            next_tensor[cell_index[0]][cell_index[1]][cell_index[2]] = new_cell_state;
-                        }
-                    }
-                }
+                return error_code;
             }
-            // store next cell state to the current cell state for the next time step
-            swap_states<T>(tensor, next_tensor, axis1_dim, axis2_dim, axis3_dim);
-        }
-        else
-        {
-            return CAEnums::CellsAreNull;
         }
-
-        steps_taken++;
-        // Appending the step to the file log
-        error_code = append_log();
-        return error_code;
-    }
-
-    /**
-     * @brief Simulates a cellular automata step.
-     * A new state is generated and stored as the new state for subsequent calls to step method.
-     *
-     *@return int - error code\n
-     * Error codes returned by get_state_from_neighborhood_Xd methods\n
-     * 0: no error
-     */
-    int step()
-    {
-        return step(nullptr); // return step(func) error code
+        return 0;
     }
 
     /**
@@ -1348,11 +6986,39 @@ public:
      */
     int print_grid()
     {
-        if (vector != nullptr)
+        int error_code = unpack_binary_cells();
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        if (is_distributed() && cells != nullptr)
+        {
+            return print_gathered_grid();
+        }
+        if (sparse_grid != nullptr && rank > 0)
+        {
+            // rows are laid out like the dense grids below
+            int row_size = get_row_size();
+            std::vector<T> sparse_row(row_size);
+            for (long row = 0; row < num_cells / row_size; row++)
+            {
+                if (rank == 3 && row % axis2_dim == 0)
+                {
+                    std::cout << "Printing " << row / axis2_dim << "'th slice of Tensor" << std::endl;
+                }
+                sparse_grid->copy_row(row, sparse_row.data());
+                for (int n = 0; n < row_size; n++)
+                {
+                    std::cout << get_cell_state(sparse_row[n]) << " ";
+                }
+                std::cout << std::endl;
+            }
+        }
+        else if (vector != nullptr)
         {
             for (int i = 0; i < axis1_dim; i++)
             {
-                std::cout << vector[i].state << " ";
+                std::cout << get_cell_state(cells[i]) << " ";
             }
             std::cout << std::endl;
         }
@@ -1362,7 +7028,7 @@ public:
             {
                 for (int k = 0; k < axis2_dim; k++)
                 {
-                    std::cout << matrix[j][k].state << " ";
+                    std::cout << get_cell_state(cells[j * strides[0] + k]) << " ";
                 }
                 std::cout << std::endl;
             }
@@ -1376,7 +7042,7 @@ public:
                 {
                     for (int k = 0; k < axis3_dim; k++)
                     {
-                        std::cout << tensor[i][j][k].state << " ";
+                        std::cout << get_cell_state(cells[i * strides[0] + j * strides[1] + k]) << " ";
                     }
                     std::cout << std::endl;
                 }
@@ -1425,116 +7091,4 @@ public:
     }
 };
 
-// Declare specialized int methods. Methods are defined in cellularautomata.cpp
-
-/**
- * @brief Set up 1d array of cell states.
- *
- * @param axis1_dim the size of a one dimensional vector
- * @param fill_value the value to set every cell state to
- * @return int - error code\n
- * CellsAlreadyInitialized: vector was already allocated\n
- * CellsMalloc: couldn't allocate memory for the specified vector size\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::setup_dimensions_1d(int axis1_dim, int fill_value);
-
-/**
- * @brief Set up 2d matrix of cell states.
- *
- * @param axis1_dim  The size of the first dimension
- * @param axis2_dim  The size of the second dimension
- * @param fill_value the value to set every cell state to
- * @return int - error code\n
- * CellsAlreadyInitialized: matrix was already allocated\n
- * CellsMalloc: couldn't allocate memory for the specified matrix size\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value);
-
-/**
- * @brief Set up 3d tensor of cell states.
- *
- * @param axis1_dim The size of the first dimension
- * @param axis2_dim The size of the second dimension
- * @param axis3_dim The size of the third dimension
- * @param fill_value the value to set every cell state to
- * @return int - error code\n
- * CellsAlreadyInitialized: tensor was already allocated\n
- * CellsMalloc: couldn't allocate memory for the specified tensor size\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value);
-
-/**
- * @brief Initializes the first state of the grid using random numbers.
- *
- * @param x_state choose the cell state to initialize the grid with.
- * @param prob the probability of a cell to turn to state given from x_state
- *@return int - error code\n
- * CellsAreNull: tensor not initialized\n
- * InvalidCellStateCondition: x_state must be less than num_states\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::init_condition(int x_state, double prob);
-
-/**
- * @brief Sets the new_cell_state variable based on the specified rule.
- *
- * @param cell_index cell of interest's index; can be modified for dynamic models
- * @param index_size size of cell_index array
- * @param neighborhood_cells flatten array of all neighboring cells
- * @param neighborhood_size size of neighborhood_cells array
- * @param new_cell_state reference variable for setting the new state
- * @param custom_rule function that is called when a Custom rule type is specified
- *@return int - error code\n
- * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
- * CustomRuleIsNull: given custom rule function is null\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::set_new_cell_state(int *cell_index, int index_size,
-                                              int *neighborhood_cells, int neighborhood_size,
-                                              int &new_cell_state, void(custom_rule)(int *, int, int *, int, int &));
-
-/**
- * @brief Print the current state of the grid.
- *
- * @return int - error code\n
- * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::print_grid();
-
-/**
- * @brief The universal method that writing the output data in a log file
- *
- * @return int - error code\n
- * CellsAreNull: neither vector, matrix, nor tensor are initialized\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::append_log();
-
-/**
- * @brief Simulates a cellular automata step.
- * A new state is generated and stored stored as the new state for subsequent calls to step method.
- *
- * This method supports the use of a custom rule type.
- *
- * If cell states move on the grid, the user is responsible for handling clashes.
- * If two cells move to the same cell position, the grid will retain the most
- * recent cell assignment (new will replace the old).
- *
- * @param custom_rule function that is called when a Custom rule type is specified
- *@return int - error code\n
- * Error codes returned by get_state_from_neighborhood_Xd methods\n
- * 0: no error
- */
-template <>
-int CellularAutomata<int>::step(void(custom_rule)(int *, int, int *, int, int &));
+#include "CAsparse.h" // SparseGrid
@@ -0,0 +1,997 @@
+/**
+ * @file CAsparse.h
+ * @author agent (agent@local)
+ *
+ * <b>Contributor(s)</b> <br> &emsp;&emsp;
+ * @brief Header file with the storage of mostly empty grids (see CellularAutomata::setup_sparse):
+ * the SparseGrid class and the BrickTable indexing its bricks.
+ * @date 2026-10-16
+ */
+#pragma once
+#include "CAdatatypes.h"
+#include <cstdint> // uint64_t
+#include <vector>
+
+/**
+ * @brief Open-addressing hash table (linear probing) from the key of a brick of a SparseGrid
+ * (see SparseGrid::get_brick_key) to the brick's slot in the brick pool.
+ * Keys are never removed one at a time: the table is rebuilt for every generation.
+ * find can be called concurrently; insert, reserve and clear can't.
+ */
+class BrickTable
+{
+public:
+    static const uint64_t EMPTY_KEY = UINT64_MAX; //!< key of the unused buckets
+
+    /**
+     * @brief Construct an empty table.
+     *
+     */
+    BrickTable();
+
+    /**
+     * @brief Finds the slot of a brick.
+     *
+     * @param key brick key
+     * @return long - slot of the brick, or -1 if the brick isn't in the table
+     */
+    long find(uint64_t key) const;
+
+    /**
+     * @brief Inserts a brick unless it is already in the table. The table grows to keep at most
+     * half of its buckets used.
+     *
+     * @param key brick key
+     * @param slot slot of the brick
+     * @param inserted set to false when the brick was already in the table (its slot is kept)
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the buckets\n
+     * 0: no error
+     */
+    int insert(uint64_t key, long slot, bool &inserted);
+
+    /**
+     * @brief Makes room for num_keys bricks so that inserting them doesn't rehash the table.
+     *
+     * @param num_keys number of bricks
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the buckets\n
+     * 0: no error
+     */
+    int reserve(long num_keys);
+
+    /**
+     * @brief Removes every brick; the buckets are kept for the next generation.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Number of bricks in the table
+     *
+     * @return long
+     */
+    long size() const { return num_keys; }
+
+private:
+    /**
+     * @brief A brick key and its slot, stored together so that a lookup touches one cache line.
+     */
+    struct Bucket
+    {
+        uint64_t key; //!< brick key (EMPTY_KEY: unused)
+        long slot;    //!< slot of the brick
+    };
+
+    std::vector<Bucket> buckets; //!< buckets probed linearly
+    long num_keys;               //!< number of used buckets
+    int bits;                    //!< log2 of the number of buckets
+
+    /**
+     * @brief First bucket probed for a key. Groups of 4 bricks along the last axis are hashed together
+     * (Fibonacci hashing) into consecutive buckets, so the lookups of neighboring bricks share cache lines.
+     *
+     * @param key brick key
+     * @param bits log2 of the number of buckets (at least 2)
+     * @return long
+     */
+    static long get_bucket(uint64_t key, int bits)
+    {
+        return (long)((((key >> 2) * 0x9E3779B97F4A7C15ULL) >> (66 - bits)) << 2 | (key & 3));
+    }
+};
+
+/**
+ * @brief Storage of a grid that is mostly empty (see CellularAutomata::setup_sparse), such as 4096^3 grids that
+ * can't be allocated densely. Only the bricks of SPARSE_BRICK_WIDTH cells along each axis (8 x 8 x 8 cells for
+ * 3d grids) holding a non-empty cell are stored, in a pool indexed by an open-addressing hash table (BrickTable).
+ * Every other cell is implicitly empty (T()), so the memory held by the grid is proportional to its occupied bricks.
+ *
+ * A step only updates the occupied bricks and the bricks within boundary_radius cells of them
+ * (see collect_active_bricks). Each brick is copied with a halo of boundary_radius cells into a window, looking up
+ * the bricks of the halo in the table, and the rules read their neighborhoods from the window (see update_brick).
+ * Bricks left empty by a step are dropped.
+ *
+ * @tparam T : cell type (see CellularAutomata)
+ */
+template <typename T>
+class SparseGrid
+{
+private:
+    /**
+     * @brief A cell moved by a rule, written into the next generation once every brick is updated.
+     */
+    struct MovedCell
+    {
+        int index[3]; //!< the cell's new index
+        T cell;       //!< the cell's new state
+    };
+
+    /**
+     * @brief Arrays of one thread running a step.
+     */
+    struct BrickScratch
+    {
+        std::vector<T> window;              //!< cells of the updated brick and its halo
+        std::vector<T> next_brick;          //!< next generation of the updated brick
+        std::vector<long> offsets;          //!< window offsets of the neighbors inside the grid (CutOff/Walled)
+        std::vector<int> coords;            //!< relative indices of the neighbors inside the grid
+        std::vector<int> runs[3];           //!< runs of the window held by one brick along each axis
+        std::vector<uint64_t> next_keys;    //!< keys of the non-empty next bricks updated by the thread
+        std::vector<T> next_cells;          //!< cells of the non-empty next bricks updated by the thread
+        std::vector<MovedCell> moved_cells; //!< cells moved by the thread's rules
+    };
+
+    int rank;                            //!< number of axes of the grid (0 until setup_dimensions)
+    int extents[3];                      //!< cells along each axis
+    long brick_strides[3];               //!< strides of the cells of a brick
+    long brick_size;                     //!< cells of a brick
+    long window_strides[3];              //!< strides of the cells of a window
+    long window_size;                    //!< cells of a window
+    CAEnums::Boundary boundary_type;     //!< boundary of the current step (see setup_step)
+    int boundary_radius;                 //!< neighborhood radius of the current step
+    const NeighborhoodStencil *stencil;  //!< neighbor offsets inside a window for the current step
+    BrickTable table;                    //!< slot of every brick
+    BrickTable next_table;               //!< bricks updated by a step, then the slots of the next generation
+    std::vector<uint64_t> brick_keys;    //!< key of the brick in every slot
+    std::vector<T> brick_cells;          //!< cells of every slot (brick_size cells each)
+    std::vector<uint64_t> active_bricks; //!< keys of the bricks updated by the current step
+    std::vector<BrickScratch> scratch;   //!< arrays of every thread
+
+    /**
+     * @brief Determines if a cell is empty (equal to T()).
+     *
+     * @param cell cell state
+     * @return true: the cell is empty
+     * @return false: the cell is occupied
+     */
+    static bool is_empty(T cell)
+    {
+        T empty_cell_state = T();
+        return !(cell != empty_cell_state);
+    }
+
+    /**
+     * @brief Key of a brick: its index along each axis packed into SPARSE_BRICK_KEY_BITS bits per axis.
+     *
+     * @param brick index of the brick (rank ints)
+     * @return uint64_t
+     */
+    uint64_t get_brick_key(const int *brick) const
+    {
+        uint64_t key = 0;
+        for (int axis = 0; axis < rank; axis++)
+        {
+            key = (key << SPARSE_BRICK_KEY_BITS) | (uint64_t)brick[axis];
+        }
+        return key;
+    }
+
+    /**
+     * @brief Unpacks the index of a brick from its key (see get_brick_key).
+     *
+     * @param key brick key
+     * @param brick index of the brick (rank ints)
+     */
+    void get_brick_index(uint64_t key, int *brick) const
+    {
+        uint64_t mask = (1ULL << SPARSE_BRICK_KEY_BITS) - 1;
+        for (int axis = rank - 1; axis >= 0; axis--)
+        {
+            brick[axis] = (int)(key & mask);
+            key >>= SPARSE_BRICK_KEY_BITS;
+        }
+    }
+
+    /**
+     * @brief Index of the brick holding a cell and the cell's position inside the brick.
+     *
+     * @param cell_index index of the cell (rank ints)
+     * @param brick index of the brick (rank ints)
+     * @return long - position of the cell in the brick
+     */
+    long get_brick_position(const int *cell_index, int *brick) const
+    {
+        long position = 0;
+        for (int axis = 0; axis < rank; axis++)
+        {
+            brick[axis] = cell_index[axis] / SPARSE_BRICK_WIDTH;
+            position += (cell_index[axis] % SPARSE_BRICK_WIDTH) * brick_strides[axis];
+        }
+        return position;
+    }
+
+    /**
+     * @brief Determines if a cell index lies inside the grid.
+     *
+     * @param cell_index index of the cell (rank ints)
+     * @return true: the cell is inside the grid
+     * @return false: the cell is outside the grid
+     */
+    bool is_inside_grid(const int *cell_index) const
+    {
+        for (int axis = 0; axis < rank; axis++)
+        {
+            if (cell_index[axis] < 0 || cell_index[axis] >= extents[axis])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Finds the lowest and highest index of the non-empty cells of a brick along each axis.
+     *
+     * @param cells cells of the brick
+     * @param lo receives the lowest index inside the brick along each axis
+     * @param hi receives the highest index inside the brick along each axis
+     * @return true: the brick holds a non-empty cell
+     * @return false: every cell of the brick is empty
+     */
+    bool get_occupied_box(const T *cells, int *lo, int *hi) const
+    {
+        bool occupied = false;
+        for (int axis = 0; axis < rank; axis++)
+        {
+            lo[axis] = SPARSE_BRICK_WIDTH;
+            hi[axis] = -1;
+        }
+        for (long n = 0; n < brick_size; n++)
+        {
+            if (is_empty(cells[n]))
+            {
+                continue;
+            }
+            occupied = true;
+            for (int axis = 0; axis < rank; axis++)
+            {
+                int local = n / brick_strides[axis] % SPARSE_BRICK_WIDTH;
+                lo[axis] = std::min(lo[axis], local);
+                hi[axis] = std::max(hi[axis], local);
+            }
+        }
+        return occupied;
+    }
+
+    /**
+     * @brief Copies a box of a brick into a window and widens [lo, hi] to the box's non-empty cells.
+     *
+     * @param cells cells of the brick
+     * @param window cells of the window
+     * @param first window index of the box's first cell
+     * @param start index of the box's first cell in the grid
+     * @param length cells of the box along each axis
+     * @param lo lowest window index of the non-empty cells along each axis
+     * @param hi highest window index of the non-empty cells along each axis
+     * @return true: the box holds a non-empty cell
+     * @return false: every cell of the box is empty
+     */
+    bool copy_brick_box(const T *cells, T *window, const int *first, const int *start, const int *length,
+                        int *lo, int *hi) const
+    {
+        bool occupied = false;
+        int last_axis = rank - 1;
+        long num_rows = 1;
+        for (int axis = 0; axis < last_axis; axis++)
+        {
+            num_rows *= length[axis];
+        }
+        for (long row = 0; row < num_rows; row++)
+        {
+            int index[3]; // window index of the copied cell
+            long source = start[last_axis] % SPARSE_BRICK_WIDTH;
+            long target = first[last_axis];
+            long remainder = row;
+            for (int axis = last_axis - 1; axis >= 0; axis--)
+            {
+                int d = remainder % length[axis];
+                remainder /= length[axis];
+                index[axis] = first[axis] + d;
+                source += (start[axis] % SPARSE_BRICK_WIDTH + d) * brick_strides[axis];
+                target += index[axis] * window_strides[axis];
+            }
+            for (int k = 0; k < length[last_axis]; k++)
+            {
+                window[target + k] = cells[source + k];
+                if (is_empty(cells[source + k]))
+                {
+                    continue;
+                }
+                occupied = true;
+                index[last_axis] = first[last_axis] + k;
+                for (int axis = 0; axis < rank; axis++)
+                {
+                    lo[axis] = std::min(lo[axis], index[axis]);
+                    hi[axis] = std::max(hi[axis], index[axis]);
+                }
+            }
+        }
+        return occupied;
+    }
+
+    /**
+     * @brief Copies a brick and its halo of boundary_radius cells into the thread's window. The window is split
+     * along each axis into runs of cells held by one brick, so every stored brick overlapping the window is looked
+     * up once and copied box by box. The other cells (missing bricks, outside CutOff/Walled grids) are empty.
+     *
+     * @param brick index of the brick
+     * @param thread_scratch arrays of the calling thread
+     * @param lo receives the lowest window index of the non-empty cells along each axis
+     * @param hi receives the highest window index of the non-empty cells along each axis
+     * @return true: the window holds a non-empty cell
+     * @return false: every cell of the window is empty
+     */
+    bool fill_window(const int *brick, BrickScratch &thread_scratch, int *lo, int *hi)
+    {
+        bool periodic = boundary_type == CAEnums::Periodic;
+        int window_extent = SPARSE_BRICK_WIDTH + 2 * boundary_radius;
+        T *window = thread_scratch.window.data();
+        clear_states(window, window_size);
+
+        for (int axis = 0; axis < rank; axis++)
+        {
+            // runs of (first window index, first cell, number of cells) inside the grid
+            std::vector<int> &runs = thread_scratch.runs[axis];
+            runs.clear();
+            for (int w = 0; w < window_extent;)
+            {
+                int cell = brick[axis] * SPARSE_BRICK_WIDTH - boundary_radius + w;
+                if (periodic)
+                {
+                    cell = (cell % extents[axis] + extents[axis]) % extents[axis];
+                }
+                int length = window_extent - w;
+                if (cell < 0)
+                {
+                    length = std::min(length, -cell);
+                }
+                else if (cell < extents[axis])
+                {
+                    length = std::min(length, std::min(SPARSE_BRICK_WIDTH - cell % SPARSE_BRICK_WIDTH,
+                                                       extents[axis] - cell));
+                    runs.push_back(w);
+                    runs.push_back(cell);
+                    runs.push_back(length);
+                }
+                w += length;
+            }
+            lo[axis] = window_extent;
+            hi[axis] = -1;
+        }
+
+        bool occupied = false;
+        int n[3] = {0, 0, 0}; // run along each axis
+        for (bool more = true; more;)
+        {
+            int first[3], start[3], length[3], source[3];
+            for (int axis = 0; axis < rank; axis++)
+            {
+                const int *run = thread_scratch.runs[axis].data() + 3 * n[axis];
+                first[axis] = run[0];
+                start[axis] = run[1];
+                length[axis] = run[2];
+                source[axis] = run[1] / SPARSE_BRICK_WIDTH;
+            }
+            long slot = table.find(get_brick_key(source));
+            if (slot >= 0 && copy_brick_box(brick_cells.data() + slot * brick_size, window, first, start, length, lo, hi))
+            {
+                occupied = true;
+            }
+            // next combination, the last axis first
+            int axis = rank - 1;
+            while (axis >= 0 && 3 * (n[axis] + 1) == (int)thread_scratch.runs[axis].size())
+            {
+                n[axis] = 0;
+                axis--;
+            }
+            more = axis >= 0;
+            if (more)
+            {
+                n[axis]++;
+            }
+        }
+        return occupied;
+    }
+
+    /**
+     * @brief Lists the neighbors of a cell near the edge of a CutOff/Walled grid that lie inside the grid.
+     *
+     * @param cell_index index of the cell
+     * @param offsets receives the window offsets of the neighbors
+     * @param coords receives the relative indices of the neighbors
+     * @return int - number of neighbors listed
+     */
+    int get_cutoff_neighbors(const int *cell_index, long *offsets, int *coords) const
+    {
+        int neighborhood_size = 0;
+        for (int n = 0; n < stencil->size(); n++)
+        {
+            const int *d = stencil->coord(n);
+            bool inside = true;
+            for (int axis = 0; axis < rank; axis++)
+            {
+                int neighbor = cell_index[axis] + d[axis];
+                inside = inside && neighbor >= 0 && neighbor < extents[axis];
+            }
+            if (!inside)
+            {
+                continue;
+            }
+            offsets[neighborhood_size] = stencil->offsets[n];
+            std::copy(d, d + rank, coords + neighborhood_size * rank);
+            neighborhood_size++;
+        }
+        return neighborhood_size;
+    }
+
+
+public:
+    /**
+     * @brief Construct a grid without dimensions (see setup_dimensions).
+     *
+     */
+    SparseGrid()
+    {
+        rank = 0;
+        brick_size = 0;
+        window_size = 0;
+        boundary_type = CAEnums::Periodic;
+        boundary_radius = 0;
+        stencil = nullptr;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            extents[axis] = 0;
+            brick_strides[axis] = 0;
+            window_strides[axis] = 0;
+        }
+    }
+
+    /**
+     * @brief Sets up a grid of the given rank and dimensions without any occupied cell.
+     *
+     * @param grid_rank number of axes of the grid
+     * @param dims cells along each axis
+     * @return int - error code\n
+     * CellsAlreadyInitialized: the grid was already set up\n
+     * InvalidDimensions: every axis must hold between 1 and SPARSE_BRICK_WIDTH << SPARSE_BRICK_KEY_BITS cells\n
+     * 0: no error
+     */
+    int setup_dimensions(int grid_rank, const int *dims)
+    {
+        if (rank != 0)
+        {
+            return CAEnums::CellsAlreadyInitialized;
+        }
+        for (int axis = 0; axis < grid_rank; axis++)
+        {
+            if (dims[axis] < 1 || dims[axis] > ((long)SPARSE_BRICK_WIDTH << SPARSE_BRICK_KEY_BITS))
+            {
+                return CAEnums::InvalidDimensions;
+            }
+        }
+
+        rank = grid_rank;
+        brick_size = 1;
+        for (int axis = rank - 1; axis >= 0; axis--)
+        {
+            extents[axis] = dims[axis];
+            brick_strides[axis] = brick_size;
+            brick_size *= SPARSE_BRICK_WIDTH;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Strides of the cells of the windows update_brick reads the neighborhoods from: a brick
+     * and its halo of radius cells along each axis. Stencils built with them read the windows.
+     *
+     * @param radius neighborhood radius
+     * @param strides receives the strides (3 longs, 0 past the grid's axes)
+     */
+    void get_window_strides(int radius, long *strides) const
+    {
+        long size = 1;
+        for (int axis = 2; axis >= 0; axis--)
+        {
+            strides[axis] = axis < rank ? size : 0;
+            size *= axis < rank ? SPARSE_BRICK_WIDTH + 2 * radius : 1;
+        }
+    }
+
+    /**
+     * @brief Sets up the boundary and neighborhood of the next step and reserves the arrays of every thread.
+     *
+     * @param bound_type boundary of the step
+     * @param radius neighborhood radius
+     * @param step_stencil neighborhood built with the window strides (see get_window_strides); must outlive the step
+     * @param num_threads number of threads updating the bricks
+     * @return int - error code\n
+     * NeighborhoodCellsMalloc: couldn't allocate memory for the arrays\n
+     * 0: no error
+     */
+    int setup_step(CAEnums::Boundary bound_type, int radius, const NeighborhoodStencil &step_stencil, int num_threads)
+    {
+        boundary_type = bound_type;
+        boundary_radius = radius;
+        stencil = &step_stencil;
+        get_window_strides(radius, window_strides);
+        window_size = window_strides[0] * (SPARSE_BRICK_WIDTH + 2 * radius);
+        try
+        {
+            scratch.resize(num_threads);
+            for (BrickScratch &thread_scratch : scratch)
+            {
+                thread_scratch.window.resize(window_size);
+                thread_scratch.next_brick.resize(brick_size);
+                thread_scratch.offsets.resize(stencil->size());
+                thread_scratch.coords.resize(stencil->size() * rank);
+                thread_scratch.next_keys.clear();
+                thread_scratch.next_cells.clear();
+                thread_scratch.moved_cells.clear();
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Lists the bricks updated by a step in active_bricks, in key order: the bricks holding a cell within
+     * boundary_radius cells (wrapped with Periodic boundaries) of the box of non-empty cells of an occupied brick.
+     *
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the list\n
+     * 0: no error
+     */
+    int collect_active_bricks()
+    {
+        bool periodic = boundary_type == CAEnums::Periodic;
+        std::vector<int> reached[3]; // bricks reached along each axis
+
+        next_table.clear();
+        active_bricks.clear();
+        int error_code = next_table.reserve(brick_keys.size());
+        try
+        {
+            for (size_t slot = 0; slot < brick_keys.size() && error_code == 0; slot++)
+            {
+                int brick[3], lo[3], hi[3];
+                if (!get_occupied_box(brick_cells.data() + slot * brick_size, lo, hi))
+                {
+                    continue; // emptied by set_cell
+                }
+                get_brick_index(brick_keys[slot], brick);
+                for (int axis = 0; axis < rank; axis++)
+                {
+                    reached[axis].clear();
+                    int first = brick[axis] * SPARSE_BRICK_WIDTH + lo[axis] - boundary_radius;
+                    int last = brick[axis] * SPARSE_BRICK_WIDTH + hi[axis] + boundary_radius;
+                    for (int cell = first; cell <= last; cell++)
+                    {
+                        int wrapped = periodic ? (cell % extents[axis] + extents[axis]) % extents[axis] : cell;
+                        if (wrapped < 0 || wrapped >= extents[axis])
+                        {
+                            continue;
+                        }
+                        if (reached[axis].empty() || reached[axis].back() != wrapped / SPARSE_BRICK_WIDTH)
+                        {
+                            reached[axis].push_back(wrapped / SPARSE_BRICK_WIDTH);
+                        }
+                    }
+                }
+                int n[3] = {0, 0, 0}; // reached brick along each axis
+                for (bool more = true; more && error_code == 0;)
+                {
+                    int neighbor[3];
+                    for (int axis = 0; axis < rank; axis++)
+                    {
+                        neighbor[axis] = reached[axis][n[axis]];
+                    }
+                    uint64_t key = get_brick_key(neighbor);
+                    bool inserted = false;
+                    error_code = next_table.insert(key, 0, inserted);
+                    if (inserted)
+                    {
+                        active_bricks.push_back(key);
+                    }
+                    // next combination, the last axis first
+                    int axis = rank - 1;
+                    while (axis >= 0 && n[axis] == (int)reached[axis].size() - 1)
+                    {
+                        n[axis] = 0;
+                        axis--;
+                    }
+                    more = axis >= 0;
+                    if (more)
+                    {
+                        n[axis]++;
+                    }
+                }
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::CellsMalloc;
+        }
+        std::sort(active_bricks.begin(), active_bricks.end());
+        return error_code;
+    }
+
+    /**
+     * @brief Number of bricks listed by collect_active_bricks.
+     *
+     * @return long
+     */
+    long get_num_active_bricks() const
+    {
+        return active_bricks.size();
+    }
+
+    /**
+     * @brief Updates the cells of the n-th brick listed by collect_active_bricks into the thread's next bricks
+     * and moved cells. update(cell_index, index_size, interior, center, offsets, coords, neighborhood_size,
+     * new_cell_state) is called like in CellularAutomata::run_in_place_step for every cell with a non-empty
+     * neighborhood, where center[offsets[n]] is the n-th neighbor in the window; interior cells read every
+     * neighbor at the stencil offsets. Only the cells within boundary_radius of the window's non-empty cells
+     * are visited. Walled edge cells never change thus they are copied instead of updated.
+     *
+     * @param update callable that sets the new cell state
+     * @param n brick number
+     * @param thread number of the calling thread (arrays reserved by setup_step)
+     */
+    template <typename CellUpdate>
+    void update_brick(CellUpdate &update, long n, int thread)
+    {
+        BrickScratch &thread_scratch = scratch[thread];
+        uint64_t key = active_bricks[n];
+        int brick[3] = {0, 0, 0};
+        int lo[3], hi[3];
+        get_brick_index(key, brick);
+        if (!fill_window(brick, thread_scratch, lo, hi))
+        {
+            return; // every cell of the brick stays empty
+        }
+        const T *window = thread_scratch.window.data();
+        T *next_brick = thread_scratch.next_brick.data();
+        clear_states(next_brick, brick_size);
+
+        // cells of the brick within boundary_radius of the non-empty window cells
+        int begin[3], box[3];
+        long num_box_cells = 1;
+        for (int axis = 0; axis < rank; axis++)
+        {
+            begin[axis] = std::max(lo[axis] - 2 * boundary_radius, 0);
+            box[axis] = std::min(hi[axis] + 1, SPARSE_BRICK_WIDTH) - begin[axis];
+            num_box_cells *= box[axis];
+        }
+
+        bool periodic = boundary_type == CAEnums::Periodic;
+        bool walled = boundary_type == CAEnums::Walled;
+        bool occupied = false;
+        for (long m = 0; m < num_box_cells; m++)
+        {
+            int cell[3] = {0, 0, 0};
+            long position_in_brick = 0;
+            long position = 0; // position of the cell in the window
+            bool inside = true, edge = false, interior = true;
+            long remainder = m;
+            for (int axis = rank - 1; axis >= 0; axis--)
+            {
+                int local = begin[axis] + remainder % box[axis];
+                remainder /= box[axis];
+                cell[axis] = brick[axis] * SPARSE_BRICK_WIDTH + local;
+                inside = inside && cell[axis] < extents[axis];
+                edge = edge || cell[axis] == 0 || cell[axis] == extents[axis] - 1;
+                interior = interior && cell[axis] >= boundary_radius && cell[axis] < extents[axis] - boundary_radius;
+                position_in_brick += local * brick_strides[axis];
+                position += (local + boundary_radius) * window_strides[axis];
+            }
+            if (!inside)
+            {
+                continue; // the last brick along an axis may be narrower
+            }
+            const T *center = window + position;
+            if (walled && edge)
+            {
+                next_brick[position_in_brick] = *center;
+                occupied = occupied || !is_empty(*center);
+                continue;
+            }
+
+            interior = interior || periodic; // the window wraps around Periodic grids
+            const long *offsets = stencil->offsets.data();
+            const int *coords = stencil->coords.data();
+            int neighborhood_size = stencil->size();
+            if (!interior)
+            {
+                offsets = thread_scratch.offsets.data();
+                coords = thread_scratch.coords.data();
+                neighborhood_size = get_cutoff_neighbors(cell, thread_scratch.offsets.data(),
+                                                         thread_scratch.coords.data());
+            }
+            bool quiescent = true; // every neighbor is empty (the cell included)
+            for (int i = 0; i < neighborhood_size && quiescent; i++)
+            {
+                quiescent = is_empty(center[offsets[i]]);
+            }
+            if (quiescent)
+            {
+                continue;
+            }
+
+            T new_cell_state = *center;
+            int cell_index[3] = {cell[0], cell[1], cell[2]};
+            update(cell_index, rank, interior, center, offsets, coords, neighborhood_size, new_cell_state);
+            if (is_empty(new_cell_state))
+            {
+                continue;
+            }
+            if (std::equal(cell_index, cell_index + rank, cell))
+            {
+                next_brick[position_in_brick] = new_cell_state;
+                occupied = true;
+            }
+            else if (is_inside_grid(cell_index))
+            {
+                MovedCell moved_cell;
+                std::copy(cell_index, cell_index + 3, moved_cell.index);
+                moved_cell.cell = new_cell_state;
+                thread_scratch.moved_cells.push_back(moved_cell);
+            }
+        }
+        if (occupied)
+        {
+            thread_scratch.next_keys.push_back(key);
+            thread_scratch.next_cells.insert(thread_scratch.next_cells.end(), next_brick, next_brick + brick_size);
+        }
+    }
+
+    /**
+     * @brief Gathers the non-empty next bricks of every thread into the brick pool and the table,
+     * then writes the moved cells. A cell moved onto an occupied cell of the next generation replaces it,
+     * or is merged with it by collision_rule(moved_cell, next_cell), which turns moved_cell into the cell kept.
+     * The current generation is kept when memory runs out.
+     *
+     * @param collision_rule merges moved cells with the cells they land on (nullptr: the moved cell is kept)
+     * @return int - error code\n
+     * CellsMalloc: couldn't allocate memory for the next generation\n
+     * 0: no error
+     */
+    int assemble_next_generation(void (*collision_rule)(T &, const T &))
+    {
+        long num_next_bricks = 0;
+        for (const BrickScratch &thread_scratch : scratch)
+        {
+            num_next_bricks += thread_scratch.next_keys.size();
+        }
+        std::vector<uint64_t> next_keys;
+        std::vector<T> next_cells;
+        next_table.clear();
+        int error_code = next_table.reserve(num_next_bricks);
+        if (error_code < 0)
+        {
+            return error_code;
+        }
+        try
+        {
+            next_keys.reserve(num_next_bricks);
+            next_cells.reserve(num_next_bricks * brick_size);
+            for (BrickScratch &thread_scratch : scratch)
+            {
+                next_keys.insert(next_keys.end(), thread_scratch.next_keys.begin(), thread_scratch.next_keys.end());
+                next_cells.insert(next_cells.end(), thread_scratch.next_cells.begin(), thread_scratch.next_cells.end());
+                thread_scratch.next_keys.clear();
+                thread_scratch.next_cells.clear();
+            }
+            bool inserted = false;
+            for (long slot = 0; slot < num_next_bricks; slot++)
+            {
+                next_table.insert(next_keys[slot], slot, inserted); // room was reserved
+            }
+            for (BrickScratch &thread_scratch : scratch)
+            {
+                for (const MovedCell &moved_cell : thread_scratch.moved_cells)
+                {
+                    int brick[3];
+                    long position = get_brick_position(moved_cell.index, brick);
+                    uint64_t key = get_brick_key(brick);
+                    long slot = next_table.find(key);
+                    if (slot < 0)
+                    {
+                        slot = next_keys.size();
+                        error_code = next_table.insert(key, slot, inserted);
+                        if (error_code < 0)
+                        {
+                            return error_code;
+                        }
+                        next_keys.push_back(key);
+                        next_cells.resize(next_cells.size() + brick_size);
+                    }
+                    T &next_cell = next_cells[slot * brick_size + position];
+                    if (collision_rule != nullptr && !is_empty(next_cell))
+                    {
+                        T cell = moved_cell.cell;
+                        collision_rule(cell, next_cell);
+                        next_cell = cell;
+                    }
+                    else
+                    {
+                        next_cell = moved_cell.cell;
+                    }
+                }
+                thread_scratch.moved_cells.clear();
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::CellsMalloc;
+        }
+
+        std::swap(table, next_table);
+        brick_keys.swap(next_keys);
+        brick_cells.swap(next_cells);
+        return 0;
+    }
+
+    /**
+     * @brief Get a cell of the grid.
+     *
+     * @param cell_index index of the cell (one int per axis)
+     * @return T - the cell, or an empty cell when its brick isn't stored or it lies outside the grid
+     */
+    T get_cell(const int *cell_index) const
+    {
+        if (rank == 0 || !is_inside_grid(cell_index))
+        {
+            return T();
+        }
+        int brick[3];
+        long position = get_brick_position(cell_index, brick);
+        long slot = table.find(get_brick_key(brick));
+        return slot < 0 ? T() : brick_cells[slot * brick_size + position];
+    }
+
+    /**
+     * @brief Set a cell of the grid, storing its brick if needed. Bricks left empty are dropped by the next step.
+     *
+     * @param cell_index index of the cell (one int per axis)
+     * @param cell the new cell
+     * @return int - error code\n
+     * InvalidDimensions: cell_index lies outside the grid\n
+     * CellsMalloc: couldn't allocate memory for the brick\n
+     * 0: no error
+     */
+    int set_cell(const int *cell_index, const T &cell)
+    {
+        if (!is_inside_grid(cell_index))
+        {
+            return CAEnums::InvalidDimensions;
+        }
+        int brick[3];
+        long position = get_brick_position(cell_index, brick);
+        uint64_t key = get_brick_key(brick);
+        long slot = table.find(key);
+        if (slot < 0)
+        {
+            if (is_empty(cell))
+            {
+                return 0; // already implicitly empty
+            }
+            slot = brick_keys.size();
+            try
+            {
+                brick_keys.push_back(key);
+                brick_cells.resize(brick_cells.size() + brick_size);
+            }
+            catch (const std::bad_alloc &)
+            {
+                brick_keys.resize(slot);
+                return CAEnums::CellsMalloc;
+            }
+            bool inserted = false;
+            int error_code = table.insert(key, slot, inserted);
+            if (error_code < 0)
+            {
+                brick_keys.pop_back();
+                brick_cells.resize(slot * brick_size);
+                return error_code;
+            }
+        }
+        brick_cells[slot * brick_size + position] = cell;
+        return 0;
+    }
+
+    /**
+     * @brief Calls visit(cell_index, index_size, cell) for every occupied cell, brick by brick.
+     * The cells can be changed; bricks left empty are dropped by the next step.
+     *
+     * @param visit callable
+     */
+    template <typename Visit>
+    void for_each_cell(Visit visit)
+    {
+        for (size_t slot = 0; slot < brick_keys.size(); slot++)
+        {
+            int brick[3];
+            get_brick_index(brick_keys[slot], brick);
+            T *cells = brick_cells.data() + slot * brick_size;
+            for (long n = 0; n < brick_size; n++)
+            {
+                if (is_empty(cells[n]))
+                {
+                    continue;
+                }
+                int cell_index[3] = {0, 0, 0};
+                for (int axis = 0; axis < rank; axis++)
+                {
+                    cell_index[axis] = brick[axis] * SPARSE_BRICK_WIDTH + n / brick_strides[axis] % SPARSE_BRICK_WIDTH;
+                }
+                visit(cell_index, rank, cells[n]);
+            }
+        }
+    }
+
+    /**
+     * @brief Copies a row of the grid (cells along the last axis), looking up each brick along the row once.
+     * Rows are numbered in row-major order like CellularAutomata::get_row.
+     *
+     * @param row row number
+     * @param row_cells receives the extent of the last axis cells
+     */
+    void copy_row(long row, T *row_cells) const
+    {
+        int last_axis = rank - 1;
+        int cell_index[3] = {0, 0, 0};
+        for (int axis = last_axis - 1; axis >= 0; axis--)
+        {
+            cell_index[axis] = row % extents[axis];
+            row /= extents[axis];
+        }
+        clear_states(row_cells, extents[last_axis]);
+        for (int k = 0; k < extents[last_axis]; k += SPARSE_BRICK_WIDTH)
+        {
+            int brick[3];
+            cell_index[last_axis] = k;
+            long position = get_brick_position(cell_index, brick);
+            long slot = table.find(get_brick_key(brick));
+            if (slot >= 0)
+            {
+                const T *cells = brick_cells.data() + slot * brick_size + position;
+                std::copy(cells, cells + std::min(SPARSE_BRICK_WIDTH, extents[last_axis] - k), row_cells + k);
+            }
+        }
+    }
+
+    /**
+     * @brief Number of bricks stored (occupied bricks, plus bricks emptied since the last step).
+     *
+     * @return long
+     */
+    long get_num_bricks() const
+    {
+        return brick_keys.size();
+    }
+};
@@ -7,70 +7,367 @@
  * @date 2022-12-06
  */
 #pragma once
-#include <utility> // pair
+#include <utility>     // pair
 #include <fstream>
+#include <cstdlib>     // posix_memalign, free
+#include <cstring>     // memset
+#include <new>         // placement new
+#include <type_traits> // is_trivial
+#include <algorithm>   // fill
+#include <cstdint>     // uint8_t, uint16_t
+#include <limits>      // numeric_limits
+#include <vector>
 
 /**
- * @brief swaps the computed next_vector to the current vector
+ * @brief Alignment (in bytes) of the contiguous cell buffers. One cache line.
+ */
+const std::size_t CELL_BUFFER_ALIGNMENT = 64;
+
+/**
+ * @brief Allocates a contiguous cache line aligned array without constructing its elements,
+ * so the caller decides which thread first touches (and thus places) each page.
+ * Every element must be constructed before use and before aligned_delete_array is called.
  *
- * @param vector cellular automata current vector state
- * @param next_vector cellular automata next vector state
- * @param axis1_dim vector dimension
+ * @param size number of elements in the array
+ * @return T* pointer to the first element or nullptr if the allocation failed
  */
 template <typename T>
-void swap_states(T *vector, T *next_vector, int axis1_dim)
+T *aligned_alloc_array(long size)
 {
-    for (int i = 0; i < axis1_dim; i++)
+    void *memory = nullptr;
+    std::size_t bytes = (size > 0 ? size : 1) * sizeof(T);
+    if (posix_memalign(&memory, CELL_BUFFER_ALIGNMENT, bytes) != 0)
     {
-        std::swap(vector[i], next_vector[i]);
-        next_vector[i] = T();
+        return nullptr;
     }
+    return static_cast<T *>(memory);
 }
 
 /**
- * @brief swaps the computed next_matrix to the current matrix
+ * @brief Default constructs the elements [begin, end) of an array allocated by aligned_alloc_array.
  *
- * @param matrix cellular automata current matrix state
- * @param next_matrix cellular automata next matrix state
- * @param axis1_dim first matrix dimension
- * @param axis2_dim second matrix dimension
+ * @param array contiguous array
+ * @param begin first element
+ * @param end one past the last element
  */
 template <typename T>
-void swap_states(T **matrix, T **next_matrix, int axis1_dim, int axis2_dim)
+void construct_array(T *array, long begin, long end)
 {
-    for (int i = 0; i < axis1_dim; i++)
+    for (long i = begin; i < end; i++)
     {
-        for (int j = 0; j < axis2_dim; j++)
-        {
-            std::swap(matrix[i][j], next_matrix[i][j]);
-            next_matrix[i][j] = T();
-        }
+        new (array + i) T();
+    }
+}
+
+/**
+ * @brief Destroys every element of an array created by aligned_alloc_array and releases its memory.
+ *
+ * @param array pointer returned by aligned_alloc_array (nullptr is ignored)
+ * @param size number of elements in the array
+ */
+template <typename T>
+void aligned_delete_array(T *array, long size)
+{
+    if (array == nullptr)
+    {
+        return;
     }
+    for (long i = 0; i < size; i++)
+    {
+        array[i].~T();
+    }
+    free(array);
+}
+
+/**
+ * @brief resets every cell to its default state T() (trivial types).
+ * Trivial types are zero-initialized by T() so the whole buffer is cleared with memset.
+ *
+ * @param cells contiguous cell buffer
+ * @param size number of cells in the buffer
+ */
+template <typename T>
+void clear_states(T *cells, long size, std::true_type)
+{
+    memset(cells, 0, size * sizeof(T));
+}
+
+/**
+ * @brief resets every cell to its default state T() (non-trivial types).
+ * Runs on the calling thread: parallel callers clear their own slice of the buffer.
+ *
+ * @param cells contiguous cell buffer
+ * @param size number of cells in the buffer
+ */
+template <typename T>
+void clear_states(T *cells, long size, std::false_type)
+{
+    const T empty_cell_state = T();
+    for (long n = 0; n < size; n++)
+    {
+        cells[n] = empty_cell_state;
+    }
+}
+
+/**
+ * @brief resets every cell of a contiguous cell buffer to its default state T().
+ * Uses a single memset when T is trivial (e.g. int or plain structs).
+ *
+ * @param cells contiguous cell buffer
+ * @param size number of cells in the buffer
+ */
+template <typename T>
+void clear_states(T *cells, long size)
+{
+    clear_states(cells, size, std::integral_constant<bool, std::is_trivial<T>::value>());
+}
+
+/**
+ * @brief Get the state of a cell (cell types with a state member).
+ *
+ * @param cell the cell
+ * @return int
+ */
+template <typename T>
+int get_cell_state(const T &cell)
+{
+    return cell.state;
+}
+
+/**
+ * @brief Get the state of an int cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @return int
+ */
+inline int get_cell_state(const int &cell)
+{
+    return cell;
+}
+
+/**
+ * @brief Get the state of a uint8_t cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @return int
+ */
+inline int get_cell_state(const uint8_t &cell)
+{
+    return cell;
+}
+
+/**
+ * @brief Get the state of a uint16_t cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @return int
+ */
+inline int get_cell_state(const uint16_t &cell)
+{
+    return cell;
+}
+
+/**
+ * @brief Set the state of a cell (cell types with a state member).
+ *
+ * @param cell the cell
+ * @param state new cell state
+ */
+template <typename T>
+void set_cell_state(T &cell, int state)
+{
+    cell.state = state;
+}
+
+/**
+ * @brief Set the state of an int cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @param state new cell state
+ */
+inline void set_cell_state(int &cell, int state)
+{
+    cell = state;
+}
+
+/**
+ * @brief Set the state of a uint8_t cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @param state new cell state
+ */
+inline void set_cell_state(uint8_t &cell, int state)
+{
+    cell = state;
+}
+
+/**
+ * @brief Set the state of a uint16_t cell (the cell is its state).
+ *
+ * @param cell the cell
+ * @param state new cell state
+ */
+inline void set_cell_state(uint16_t &cell, int state)
+{
+    cell = state;
+}
+
+/**
+ * @brief Determines if a state fits a cell type with a state member (any int state).
+ *
+ * @return true
+ */
+template <typename T>
+bool is_storable_state(int, std::false_type)
+{
+    return true;
+}
+
+/**
+ * @brief Determines if a state fits an integral cell type (e.g. [0, 255] for uint8_t).
+ *
+ * @param state cell state
+ * @return true: the cell type can hold the state
+ * @return false: the state is out of the cell type's range
+ */
+template <typename T>
+bool is_storable_state(int state, std::true_type)
+{
+    return (long)state >= (long)std::numeric_limits<T>::min() && (long)state <= (long)std::numeric_limits<T>::max();
 }
 
 /**
- * @brief swaps the computed next_tensor to the current tensor
+ * @brief Determines if a state fits a cell of type T.
  *
- * @param tensor cellular automata current tensor state
- * @param next_tensor cellular automata next tensor state
- * @param axis1_dim first tensor dimension
- * @param axis2_dim second tensor dimension
- * @param axis3_dim third tensor dimension
+ * @param state cell state
+ * @return true: the cell type can hold the state
+ * @return false: the state is out of the cell type's range
  */
 template <typename T>
-void swap_states(T ***tensor, T ***next_tensor, int axis1_dim, int axis2_dim, int axis3_dim)
+bool is_storable_state(int state)
+{
+    return is_storable_state<T>(state, std::integral_constant<bool, std::is_integral<T>::value>());
+}
+
+/**
+ * @brief Number of cell states whose Majority votes are counted in a stack array.
+ * Rules with more states count their votes in the step thread's reused vote scratch
+ * (see MajorityHistogram), which is sized once per step rather than per cell.
+ */
+const int MAJORITY_STACK_STATES = 64;
+
+/**
+ * @brief Largest number of neighborhood configurations a custom rule can be materialized into
+ * (see CellularAutomata::setup_rule_table), e.g. 2 states and 22 neighbors or 4 states and 11 neighbors.
+ */
+const long RULE_TABLE_MAX_SIZE = 1L << 22;
+
+/**
+ * @brief Default shape of the tiles a step is split into (see CellularAutomata::setup_tiles):
+ * 8 rows by 512 cells, i.e. 16KB of int cells per generation.
+ */
+const int DEFAULT_TILE_ROWS = 8;
+const int DEFAULT_TILE_WIDTH = 512;
+
+/**
+ * @brief Cells along each axis of the blocks that CellularAutomata::step_n advances several generations
+ * at a time, for 1d, 2d and 3d grids. Each block is copied with a halo of num_steps * radius cells
+ * on each side; with 4 generations of a radius 1 rule a 2d block takes 2 x 280KB of int cells.
+ */
+const int TEMPORAL_BLOCK_EXTENTS[3][3] = {{65536, 1, 1}, {128, 512, 1}, {32, 32, 128}};
+
+/**
+ * @brief Cells along each axis of the blocks whose neighborhood sums a step computes at once (Parity,
+ * Majority votes and totalistic rules), for 1d, 2d and 3d grids. Each thread sums one block with a halo of
+ * radius cells on each side in its own buffers; a 2d block with a radius 1 halo takes about 530KB of ints.
+ */
+const int WINDOW_BLOCK_EXTENTS[3][3] = {{16384, 1, 1}, {64, 512, 1}, {16, 32, 128}};
+
+/**
+ * @brief Cells along each axis of the bricks a sparse grid (see CellularAutomata::setup_sparse) stores its occupied cells in
+ * (8 x 8 x 8 cells for 3d grids), and most bricks along each axis of a sparse grid (bits of a brick key).
+ */
+const int SPARSE_BRICK_WIDTH = 8;
+const int SPARSE_BRICK_KEY_BITS = 21;
+
+/**
+ * @brief Largest number of cells copied into a step_n block (halo included) per cell the block advances;
+ * step_n advances fewer generations per block when the halo would be larger.
+ */
+const int TEMPORAL_BLOCK_MAX_OVERHEAD = 4;
+
+/**
+ * @brief Fixed-size histogram of the votes of each cell state for the Majority rule.
+ * States outside [0, num_states) don't vote.
+ */
+class MajorityHistogram
 {
-    for (int i = 0; i < axis1_dim; i++)
+private:
+    int num_states;                         //!< number of cell states
+    int stack_votes[MAJORITY_STACK_STATES]; //!< votes when num_states <= MAJORITY_STACK_STATES
+    int *votes;                             //!< votes of each cell state
+
+public:
+    /**
+     * @brief Construct a histogram with zero votes for every cell state.
+     * The histogram never allocates: more than MAJORITY_STACK_STATES states are counted in heap_votes.
+     *
+     * @param num_states number of cell states
+     * @param heap_votes array with room for num_states votes (e.g. a step thread's vote scratch);
+     * only used and required when num_states > MAJORITY_STACK_STATES
+     */
+    MajorityHistogram(int num_states, int *heap_votes) : num_states(num_states)
     {
-        for (int j = 0; j < axis2_dim; j++)
+        votes = num_states <= MAJORITY_STACK_STATES ? stack_votes : heap_votes;
+        std::fill(votes, votes + num_states, 0);
+    }
+
+    MajorityHistogram(const MajorityHistogram &) = delete;
+    MajorityHistogram &operator=(const MajorityHistogram &) = delete;
+
+    /**
+     * @brief Adds a vote for the given cell state.
+     *
+     * @param state cell state
+     */
+    void vote(int state)
+    {
+        if (static_cast<unsigned>(state) < static_cast<unsigned>(num_states))
         {
-            for (int k = 0; k < axis3_dim; k++)
+            votes[state]++;
+        }
+    }
+
+    /**
+     * @brief Cell state with the most votes. Ties go to the highest state.
+     *
+     * @return int
+     */
+    int majority_state() const
+    {
+        int majority = num_states - 1;
+        for (int state = num_states - 2; state >= 0; state--)
+        {
+            if (votes[state] > votes[majority])
             {
-                std::swap(tensor[i][j][k], next_tensor[i][j][k]);
-                next_tensor[i][j][k] = T();
+                majority = state;
             }
         }
+        return majority;
     }
+};
+
+/**
+ * @brief Majority rule for two cell states: compares the number of 1 votes
+ * with the number of 0 votes. Ties go to 1 (the highest state).
+ *
+ * @param ones number of neighbors in state 1
+ * @param zeros number of neighbors in state 0
+ * @return int majority state
+ */
+inline int get_binary_majority_state(int ones, int zeros)
+{
+    return ones >= zeros ? 1 : 0;
 }
 
 /**
@@ -155,3 +452,168 @@ void get_periodic_von_neumann_neighbor_index(int rank, int radius, int neighborh
  * @param result Line1 n_states; Line2 dims; Line3 counts of states of each step.
  */
 void get_density(std::ifstream& data, std::ofstream& result);
+
+/**
+ * @brief Instruction sets of the vectorized int array kernels (simd_* functions).
+ * The best level supported by the CPU is selected at program startup (CPUID).
+ */
+enum SimdLevel
+{
+    SimdScalar = 0,
+    SimdSSE42 = 1,
+    SimdAVX2 = 2,
+    SimdAVX512 = 3
+};
+
+/**
+ * @brief Get the instruction set used by the simd_* kernels.
+ *
+ * @return int - SimdLevel
+ */
+int get_simd_level();
+
+/**
+ * @brief Selects the instruction set used by the simd_* kernels (e.g. SimdScalar to compare results).
+ * Levels the CPU doesn't support are lowered to the best supported level.
+ * The level is stored atomically, so a step running concurrently sees either the old or the new level.
+ *
+ * @param level requested SimdLevel
+ * @return int - SimdLevel in use
+ */
+int set_simd_level(int level);
+
+/**
+ * @brief out[n] = a[n] + b[n]. out may alias a or b.
+ *
+ * @param out result array
+ * @param a first array
+ * @param b second array
+ * @param size number of elements
+ */
+void simd_add_arrays(int *out, const int *a, const int *b, long size);
+
+/**
+ * @brief out[n] = a[n] - b[n]. out may alias a or b.
+ *
+ * @param out result array
+ * @param a first array
+ * @param b second array
+ * @param size number of elements
+ */
+void simd_sub_arrays(int *out, const int *a, const int *b, long size);
+
+/**
+ * @brief out[n] = a[n] + b[n] - c[n]; slides a window sum by one cell. out may alias a, b or c.
+ *
+ * @param out result array
+ * @param a previous sums
+ * @param b values entering the window
+ * @param c values leaving the window
+ * @param size number of elements
+ */
+void simd_add_sub_arrays(int *out, const int *a, const int *b, const int *c, long size);
+
+/**
+ * @brief out[n] = in[n] % divisor (C++ remainder). out may alias in.
+ *
+ * @param out result array
+ * @param in dividends
+ * @param divisor positive divisor
+ * @param size number of elements
+ */
+void simd_remainder_array(int *out, const int *in, int divisor, long size);
+
+/**
+ * @brief out[n] = 1 if in[n] == state else 0.
+ *
+ * @param out result array
+ * @param in cell states
+ * @param state cell state to match
+ * @param size number of elements
+ */
+void simd_match_state_array(int *out, const int *in, int state, long size);
+
+/**
+ * @brief Majority vote of one cell state: where votes[n] >= best_votes[n] the state
+ * becomes best_states[n]. Voting the states in increasing order breaks ties toward the highest state.
+ *
+ * @param best_votes highest number of votes so far
+ * @param best_states cell state with best_votes votes
+ * @param votes number of votes of state
+ * @param state cell state being voted
+ * @param size number of elements
+ */
+void simd_vote_state_array(int *best_votes, int *best_states, const int *votes, int state, long size);
+
+/**
+ * @brief uint16_t version of simd_add_arrays: twice as many lanes per register as int.
+ * Sums wrap modulo 65536.
+ *
+ * @param out result array
+ * @param a first array
+ * @param b second array
+ * @param size number of elements
+ */
+void simd_add_arrays(uint16_t *out, const uint16_t *a, const uint16_t *b, long size);
+
+/**
+ * @brief uint16_t version of simd_add_sub_arrays. Sums wrap modulo 65536, so a window
+ * slid this way is exact as long as every window sum fits in 16 bits.
+ *
+ * @param out result array
+ * @param a previous sums
+ * @param b values entering the window
+ * @param c values leaving the window
+ * @param size number of elements
+ */
+void simd_add_sub_arrays(uint16_t *out, const uint16_t *a, const uint16_t *b, const uint16_t *c, long size);
+
+/**
+ * @brief uint16_t version of simd_remainder_array.
+ *
+ * @param out result array
+ * @param in dividends
+ * @param divisor positive divisor
+ * @param size number of elements
+ */
+void simd_remainder_array(uint16_t *out, const uint16_t *in, int divisor, long size);
+
+/**
+ * @brief uint16_t version of simd_match_state_array.
+ *
+ * @param out result array
+ * @param in cell states
+ * @param state cell state to match, in [0, 65535]
+ * @param size number of elements
+ */
+void simd_match_state_array(uint16_t *out, const uint16_t *in, int state, long size);
+
+/**
+ * @brief uint16_t version of simd_vote_state_array (votes are unsigned, so the first state
+ * voted wins against best_votes starting at 0).
+ *
+ * @param best_votes highest number of votes so far
+ * @param best_states cell state with best_votes votes
+ * @param votes number of votes of state
+ * @param state cell state being voted, in [0, 65535]
+ * @param size number of elements
+ */
+void simd_vote_state_array(uint16_t *best_votes, uint16_t *best_states, const uint16_t *votes, int state, long size);
+
+/**
+ * @brief Groups the CPUs this process may run on by CPU socket (physical package), in increasing
+ * socket and CPU order. Only implemented on Linux; other systems report no sockets.
+ *
+ * @param sockets set to the CPUs of every socket
+ * @return int - number of sockets found
+ */
+int get_cpu_sockets(std::vector<std::vector<int>> &sockets);
+
+/**
+ * @brief Restricts the calling thread to the given CPUs (Linux only).
+ *
+ * @param cpus CPU numbers
+ * @return true: the thread was pinned
+ * @return false: pinning isn't supported or failed
+ */
+bool pin_thread_to_cpus(const std::vector<int> &cpus);
@@ -64,10 +64,9 @@ public:
 
 /**
  * @brief Class for create a galaxy cellular automata model.
- * Only one instance should be created since the CellularAutomata instance is static and will be shared
- * among all instances.
- * CellularAutomata accepts a free function and not a member function thus galaxy_formation_rule needs to be static.
- * In order for galaxy_formation_rule to access the CellularAutomata and other class variable, they need to be static.
+ * Every instance owns its CellularAutomata instance. simulation passes galaxy_formation_rule to
+ * the CellularAutomata step method through a lambda capturing the instance, so several galaxies
+ * can be simulated independently.
  *
  */
 class Galaxy
@@ -80,8 +79,9 @@ public:
     int axis1_dim;                          //!< cellular automata axis1 dimension
     int axis2_dim;                          //!< cellular automata axis2 dimension
     int axis3_dim;                          //!< cellular automata axis3 dimension
-    static double time_step;                //!< time_step for computing forces during each simulation step
-    static CellularAutomata<GalaxyCell> CA; //!< the CA the simulation utilizes to model the formation of a galaxy
+    double time_step;                       //!< time_step for computing forces during each simulation step
+    bool sparse;                            //!< store only the occupied cells (see CellularAutomata::setup_sparse)
+    CellularAutomata<GalaxyCell> CA;        //!< the CA the simulation utilizes to model the formation of a galaxy
 
     /**
      * @brief Construct a new Galaxy object using the following default parameters:<br>
@@ -92,7 +92,8 @@ public:
      * axis1_dim = 1;<br>
      * axis2_dim = 6;<br>
      * axis3_dim = 6;<br>
-     * boundary_radius = 1;
+     * boundary_radius = 1;<br>
+     * sparse = false;
      *
      */
     Galaxy();
@@ -109,8 +110,10 @@ public:
      * @param axis1_dim cellular automata axis1 dimension
      * @param axis2_dim cellular automata axis2 dimension
      * @param axis3_dim cellular automata axis3 dimension
+     * @param sparse store only the occupied cells (see CellularAutomata::setup_sparse)
      */
-    Galaxy(double time_step, int min_mass, int max_mass, double density, int boundary_radius, int axis1_dim, int axis2_dim, int axis3_dim);
+    Galaxy(double time_step, int min_mass, int max_mass, double density, int boundary_radius, int axis1_dim, int axis2_dim, int axis3_dim,
+           bool sparse = false);
 
     /**
      * @brief Destroy the Galaxy object
@@ -144,13 +147,12 @@ public:
      *
      * @param cell_index new_cell_state position
      * @param index_size size of cell_index
-     * @param neighborhood_cells array of neighboring cells for computing gravitational force
-     * @param neighborhood_size size of neighborhood_cells array
+     * @param neighborhood view of the neighboring cells for computing gravitational force
      * @param new_cell_state reference to cell state that will be inserted into next state
      */
-    static void galaxy_formation_rule(int *cell_index, const int index_size,
-                                      GalaxyCell *neighborhood_cells, const int neighborhood_size,
-                                      GalaxyCell &new_cell_state);
+    void galaxy_formation_rule(int *cell_index, const int index_size,
+                               const NeighborhoodView<GalaxyCell> &neighborhood,
+                               GalaxyCell &new_cell_state);
 
     /**
      * @brief Set the new_cell_state's new position.
@@ -164,14 +166,15 @@ public:
      * @param new_cell_state cell that contains mass and velocity
      * @param displacement_vector vector to the new desired position
      */
-    static void set_new_position(int *cell_index, GalaxyCell &new_cell_state,
-                                 const std::vector<double> &displacement_vector);
+    void set_new_position(int *cell_index, GalaxyCell &new_cell_state,
+                          const std::vector<double> &displacement_vector);
 
     /**
      * @brief Determines if the new_cell_state collides with a cell at the current position: cell_index + offset_index.
      * If there is a collision then we set the new_cell_state index to the current position. 
      * And also increases the cell state by one to represent the number of collision. The mass and velocity properties are also updated using the laws of physics.
      * Else return false.
+     * Sparse grids have no next state grid to look the cells up in: they merge the cells where they land (see merge_galaxies).
      *
      * @param cell_index new_cell_state position
      * @param offset_index keep track of path the cell takes
@@ -179,7 +182,7 @@ public:
      * @return true : collision occurred
      * @return false : collision didn't occur
      */
-    static bool did_galaxies_collide(int *cell_index, const std::vector<int> &offset_index, GalaxyCell &new_cell_state);
+    bool did_galaxies_collide(int *cell_index, const std::vector<int> &offset_index, GalaxyCell &new_cell_state);
 
     /**
      * @brief compute the velocity after an inelastic collision
@@ -190,6 +193,15 @@ public:
      */
     static void update_velocity_after_collision(GalaxyCell &new_cell, GalaxyCell collied_cell);
 
+    /**
+     * @brief Merges a cell with the cell it collided with (inelastic collision): the states, masses and momenta add up.
+     * Also the collision rule of sparse grids (see CellularAutomata::setup_collision_rule).
+     *
+     * @param new_cell moved cell; receives the merged cell
+     * @param collied_cell cell at the position new_cell moved to
+     */
+    static void merge_galaxies(GalaxyCell &new_cell, const GalaxyCell &collied_cell);
+
     /**
      * @brief Get the cell state object at position cell_index + offset_index
      * from the CellularAutomata instance.
@@ -198,7 +210,7 @@ public:
      * @param offset_index used to compute the neighboring cell position
      * @return const GalaxyCell&
      */
-    static GalaxyCell &get_cell_state(int *cell_index, const std::vector<int> &offset_index);
+    GalaxyCell &get_cell_state(int *cell_index, const std::vector<int> &offset_index);
 
     /**
      * @brief Get the periodic vector.
@@ -207,7 +219,7 @@ public:
      * @param offset_index used to compute the neighboring cell position
      * @return std::vector<int>
      */
-    static std::vector<int> get_periodic_vector(int *cell_index, const std::vector<int> &offset_index);
+    std::vector<int> get_periodic_vector(int *cell_index, const std::vector<int> &offset_index);
 
     /**
      * @brief Rounds a double to an int.
@@ -3,20 +3,23 @@
  * @author Trevor Oldham (trevoldham@berkeley.edu)
  *
  * <b>Contributor(s)</b> <br> &emsp;&emsp; Emmanuel Cortes, Chongye Feng
- * @brief This file contains the class CellularAutomata functions declared in CAdatatypes.h
+ * @brief This file contains the class CellularAutomata functions declared in CAdatatypes.h and CAsparse.h
  * @date 2022-12-03
  */
 #include "CAdatatypes.h"
+#include "CAsparse.h" // BrickTable
 #include "CAutils.h"
 #include <iostream>
 #include <fstream>
 #include <string> // for log file output
 #include <array>
 #include <random>        // srand, rand
+#include <cstdlib>       // getenv, atoi
 #include <ctime>         // time
 #include <unordered_map> // unordered_map
 #include <utility>       // make_pair
 #include <algorithm>     // max_element
+#include <cstdint>       // uint8_t, uint16_t
 #ifdef ENABLE_OMP
 #include <omp.h>
 #endif
@@ -31,6 +34,119 @@ BaseCellularAutomata::BaseCellularAutomata()
     boundary_radius = 1;
     neighborhood_type = CAEnums::Moore;
     rule_type = CAEnums::Majority;
+    num_threads = 0;
+    schedule = CAEnums::Balanced;
+    pin_threads = false;
+
+    // runtime concurrency settings, so one build can be tuned per host
+    const char *env_threads = std::getenv("CA_NUM_THREADS");
+    if (env_threads != nullptr && std::atoi(env_threads) > 0)
+    {
+        num_threads = std::atoi(env_threads);
+    }
+    const char *env_schedule = std::getenv("CA_SCHEDULE");
+    if (env_schedule != nullptr)
+    {
+        std::string name(env_schedule);
+        if (name == "static")
+        {
+            schedule = CAEnums::Static;
+        }
+        else if (name == "dynamic")
+        {
+            schedule = CAEnums::Dynamic;
+        }
+    }
+    const char *env_pin_threads = std::getenv("CA_PIN_THREADS");
+    if (env_pin_threads != nullptr && std::string(env_pin_threads) == "1")
+    {
+        pin_threads = true;
+    }
+}
+
+NeighborhoodStencil::NeighborhoodStencil()
+{
+    rank = 0;
+    radius = 0;
+    neighborhood_type = CAEnums::Moore;
+    strides[0] = 0;
+    strides[1] = 0;
+    strides[2] = 0;
+}
+
+int NeighborhoodStencil::build(int rank, int radius, CAEnums::Neighborhood neighborhood_type, const long *strides)
+{
+    int r[3] = {0, 0, 0}; // unused axes don't extend the neighborhood
+    int d[3];             // neighbor's relative index
+
+    this->rank = 0; // invalidate the stencil until it is fully built
+    offsets.clear();
+    coords.clear();
+    for (int axis = 0; axis < rank; axis++)
+    {
+        r[axis] = radius;
+    }
+
+    try
+    {
+        offsets.reserve(CellularAutomata<int>::get_neighborhood_size(rank, radius, neighborhood_type));
+        coords.reserve(offsets.capacity() * rank);
+        for (d[0] = -r[0]; d[0] <= r[0]; d[0]++)
+        {
+            for (d[1] = -r[1]; d[1] <= r[1]; d[1]++)
+            {
+                for (d[2] = -r[2]; d[2] <= r[2]; d[2]++)
+                {
+                    // exclude diagonal cells from neighborhood when VonNeumann is selected
+                    if (neighborhood_type == CAEnums::VonNeumann &&
+                        ((rank == 2 && is_diagonal_neighboring_cell_2d(d[0], d[1])) ||
+                         (rank == 3 && is_diagonal_neighboring_cell_3d(d[0], d[1], d[2]))))
+                    {
+                        continue;
+                    }
+                    long offset = 0;
+                    for (int axis = 0; axis < rank; axis++)
+                    {
+                        offset += d[axis] * strides[axis];
+                        coords.push_back(d[axis]);
+                    }
+                    offsets.push_back(offset);
+                }
+            }
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        offsets.clear();
+        coords.clear();
+        return CAEnums::NeighborhoodCellsMalloc;
+    }
+
+    this->rank = rank;
+    this->radius = radius;
+    this->neighborhood_type = neighborhood_type;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        this->strides[axis] = axis < rank ? strides[axis] : 0;
+    }
+    return 0;
+}
+
+bool NeighborhoodStencil::matches(int rank, int radius, CAEnums::Neighborhood neighborhood_type,
+                                  const long *strides) const
+{
+    if (this->rank != rank || this->radius != radius || this->neighborhood_type != neighborhood_type)
+    {
+        return false;
+    }
+    for (int axis = 0; axis < rank; axis++)
+    {
+        if (this->strides[axis] != strides[axis])
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 int BaseCellularAutomata::setup_neighborhood(CAEnums::Neighborhood neighborhood_type)
@@ -55,6 +171,28 @@ int BaseCellularAutomata::setup_rule(CAEnums::Rule rule_type)
     return 0;
 }
 
+int BaseCellularAutomata::setup_threads(int num_threads)
+{
+    if (num_threads < 0)
+    {
+        return CAEnums::InvalidNumThreads;
+    }
+    this->num_threads = num_threads;
+    return 0;
+}
+
+int BaseCellularAutomata::setup_schedule(CAEnums::Schedule schedule)
+{
+    this->schedule = schedule;
+    return 0;
+}
+
+int BaseCellularAutomata::setup_thread_pinning(bool pin_threads)
+{
+    this->pin_threads = pin_threads;
+    return 0;
+}
+
 void BaseCellularAutomata::print_error_status(CAEnums::ErrorCode error)
 {
     std::cout << "ERROR [" << error;
@@ -89,462 +227,250 @@ void BaseCellularAutomata::print_error_status(CAEnums::ErrorCode error)
         break;
     case CAEnums::RadiusLargerThanDimensions:
         std::cout << "]: Boundary radius is smaller than one of the following: axis1_dim / 2, axis2_dim / 2, and/or axis3_dim / 2";
+        break;
+    case CAEnums::RuleTableTooLarge:
+        std::cout << "]: Rule table has too many neighborhood configurations (rule_states ^ neighborhood size > RULE_TABLE_MAX_SIZE).";
+        break;
+    case CAEnums::InvalidTileSize:
+        std::cout << "]: Invalid tile size given. Tile rows and width must be greater than 0.";
+        break;
+    case CAEnums::InvalidNumThreads:
+        std::cout << "]: Invalid number of threads given. Must be greater than or equal to 0.";
+        break;
+    case CAEnums::InvalidNumSteps:
+        std::cout << "]: Invalid number of steps given. Must be greater than or equal to 0.";
+        break;
+    case CAEnums::InPlaceCellMoved:
+        std::cout << "]: A rule moved a cell while updating in place; the cell kept its position.";
+        break;
+    case CAEnums::InvalidDecomposition:
+        std::cout << "]: Grid can't be split across the processes along its first axis (too few slabs per process, or halos or logged grid over INT_MAX cells).";
+        break;
+    case CAEnums::InvalidDimensions:
+        std::cout << "]: Invalid grid dimensions. Every axis of a sparse grid must hold between 1 and "
+                  << ((long)SPARSE_BRICK_WIDTH << SPARSE_BRICK_KEY_BITS) << " cells.";
+        break;
     }
     std::cout << "\n";
 }
 
-template <>
-int CellularAutomata<int>::setup_dimensions_1d(int axis1_dim, int fill_value)
+TileScheduler::TileScheduler()
 {
-    if (vector != nullptr)
-    {
-        return CAEnums::CellsAlreadyInitialized;
-    }
-
-    this->axis1_dim = axis1_dim;
-    vector = new (std::nothrow) int[axis1_dim];
-    next_vector = new (std::nothrow) int[axis1_dim];
-
-    if (vector == nullptr || next_vector == nullptr)
-    {
-        return CAEnums::CellsMalloc;
-    }
-
-    // initialize vector filled with zeros
-    for (int j = 0; j < axis1_dim; j++)
-    {
-        vector[j] = fill_value;
-        next_vector[j] = fill_value;
-    }
-
-    create_log();
-    return 0;
+    num_threads = 1;
+    stealing = true;
+    timing = true;
 }
 
-template <>
-int CellularAutomata<int>::setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value)
+int TileScheduler::plan(long num_tiles, int num_threads, CAEnums::Schedule schedule)
 {
-    if (matrix != nullptr)
+    if ((long)tile_costs.size() != num_tiles)
     {
-        return CAEnums::CellsAlreadyInitialized;
+        tile_costs.assign(num_tiles, 1.0);
     }
-
-    this->axis1_dim = axis1_dim;
-    this->axis2_dim = axis2_dim;
-    matrix = new (std::nothrow) int *[axis1_dim];
-    next_matrix = new (std::nothrow) int *[axis1_dim];
-
-    if (matrix == nullptr || next_matrix == nullptr)
+    if ((int)queues.size() != num_threads)
     {
-        return CAEnums::CellsMalloc;
+        try
+        {
+            std::vector<TileQueue>(num_threads).swap(queues);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return CAEnums::NeighborhoodCellsMalloc;
+        }
     }
-
-    for (int i = 0; i < axis1_dim; i++)
+    this->num_threads = num_threads;
+    stealing = schedule != CAEnums::Static;
+    timing = schedule == CAEnums::Balanced;
+    if (!timing)
     {
-        matrix[i] = new (std::nothrow) int[axis2_dim];
-        next_matrix[i] = new (std::nothrow) int[axis2_dim];
+        // same number of tiles per thread
+        for (int thread = 0; thread < num_threads; thread++)
+        {
+            uint64_t head = num_tiles * thread / num_threads;
+            uint64_t tail = num_tiles * (thread + 1) / num_threads;
+            queues[thread].range.store((head << 32) | tail);
+        }
+        return 0;
     }
 
-    // initialize matrix filled with zeros
-    for (int j = 0; j < axis1_dim; j++)
+    double total_cost = 0;
+    for (long tile = 0; tile < num_tiles; tile++)
     {
-        for (int k = 0; k < axis2_dim; k++)
+        total_cost += tile_costs[tile];
+    }
+    // thread t gets the tiles whose cost prefix is in [t, t + 1) * total_cost / num_threads
+    long head = 0;
+    double prefix_cost = 0;
+    for (int thread = 0; thread < num_threads; thread++)
+    {
+        long tail = head;
+        double range_end = total_cost * (thread + 1) / num_threads;
+        while (tail < num_tiles && (thread == num_threads - 1 || prefix_cost + tile_costs[tail] / 2 <= range_end))
         {
-            matrix[j][k] = fill_value;
-            next_matrix[j][k] = fill_value;
+            prefix_cost += tile_costs[tail];
+            tail++;
         }
+        queues[thread].range.store(((uint64_t)head << 32) | (uint64_t)tail);
+        head = tail;
     }
-
-    create_log();
     return 0;
 }
 
-template <>
-int CellularAutomata<int>::setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value)
+bool TileScheduler::pop_tile(TileQueue &queue, bool front, long &tile)
 {
-    if (tensor != nullptr)
+    uint64_t range = queue.range.load();
+    while (true)
     {
-        return CAEnums::CellsAlreadyInitialized;
-    }
-
-    this->axis1_dim = axis1_dim;
-    this->axis2_dim = axis2_dim;
-    this->axis3_dim = axis3_dim;
-    tensor = new (std::nothrow) int **[axis1_dim];
-    next_tensor = new (std::nothrow) int **[axis1_dim];
-
-    if (tensor == nullptr || next_tensor == nullptr)
-    {
-        return CAEnums::CellsMalloc;
-    }
-
-    for (int i = 0; i < axis1_dim; i++)
-    {
-        tensor[i] = new (std::nothrow) int *[axis2_dim];
-        next_tensor[i] = new (std::nothrow) int *[axis2_dim];
-
-        for (int j = 0; j < axis2_dim; j++)
+        uint64_t head = range >> 32;
+        uint64_t tail = range & 0xffffffffu;
+        if (head >= tail)
         {
-            tensor[i][j] = new (std::nothrow) int[axis3_dim];
-            next_tensor[i][j] = new (std::nothrow) int[axis3_dim];
+            return false;
         }
-    }
-
-    // initialize matrix filled with zeros
-    for (int i = 0; i < axis1_dim; i++)
-    {
-        for (int j = 0; j < axis2_dim; j++)
+        uint64_t new_range = front ? ((head + 1) << 32) | tail : (head << 32) | (tail - 1);
+        if (queue.range.compare_exchange_weak(range, new_range))
         {
-            for (int k = 0; k < axis3_dim; k++)
-            {
-                tensor[i][j][k] = fill_value;
-                next_tensor[i][j][k] = fill_value;
-            }
+            tile = front ? head : tail - 1;
+            return true;
         }
     }
-
-    create_log();
-    return 0;
 }
 
-template <>
-int CellularAutomata<int>::init_condition(int x_state, double prob)
+bool TileScheduler::next_tile(int thread, long &tile)
 {
-    if (!(x_state < num_states))
+    if (pop_tile(queues[thread], true, tile))
     {
-        return CAEnums::InvalidCellStateCondition;
+        return true;
     }
+    return stealing && steal_tile(thread, tile);
+}
 
-    srand(time(NULL));
-    double random_cell_state;
-
-    if (vector != nullptr)
-    {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            random_cell_state = (double)rand() / RAND_MAX;
-            if (random_cell_state < prob)
-            {
-                vector[i] = x_state;
-            }
-        }
-    }
-    else if (matrix != nullptr)
+bool TileScheduler::steal_tile(int thread, long &tile)
+{
+    for (int victim = 1; victim < num_threads; victim++)
     {
-        for (int j = 0; j < axis1_dim; j++)
+        if (pop_tile(queues[(thread + victim) % num_threads], false, tile))
         {
-            for (int k = 0; k < axis2_dim; k++)
-            {
-                random_cell_state = (double)rand() / RAND_MAX;
-                if (random_cell_state < prob)
-                {
-                    matrix[j][k] = x_state;
-                }
-            }
+            return true;
         }
     }
-    else if (tensor != nullptr)
-    {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                for (int k = 0; k < axis3_dim; k++)
-                {
-                    random_cell_state = (double)rand() / RAND_MAX;
-                    if (random_cell_state < prob)
-                    {
-                        tensor[i][j][k] = x_state;
-                    }
-                }
-            }
-        }
-    }
-    else
-    {
-        return CAEnums::CellsAreNull;
-    }
-    return 0;
+    return false;
 }
 
-template <>
-int CellularAutomata<int>::set_new_cell_state(int *cell_index, int index_size,
-                                              int *neighborhood_cells, int neighborhood_size,
-                                              int &new_cell_state, void(custom_rule)(int *, int, int *, int, int &))
+BrickTable::BrickTable()
 {
-    int sum = 0;                         // sum of cells within boundary_radius for Parity rule
-    MajorityCounter state_votes_counter; // counter to keep track of votes for Majority rule
-    initialize_majority_rule_counter(state_votes_counter, num_states);
+    num_keys = 0;
+    bits = 0;
+}
 
-    switch (rule_type)
+long BrickTable::find(uint64_t key) const
+{
+    if (num_keys == 0)
     {
-    case CAEnums::Custom:
-        if (vector == nullptr && matrix == nullptr && tensor == nullptr)
-        {
-            new_cell_state = -1;
-            return CAEnums::CellsAreNull;
-        }
-        if (custom_rule == nullptr)
-        {
-            new_cell_state = -1;
-            return CAEnums::CustomRuleIsNull;
-        }
-        else
-        {
-            // custom_rule should set the new_cell_state
-            custom_rule(cell_index, index_size, neighborhood_cells, neighborhood_size, new_cell_state);
-        }
-        break;
-    case CAEnums::Parity:
-        for (int i = 0; i < neighborhood_size; i++)
+        return -1;
+    }
+    long mask = (long)buckets.size() - 1;
+    for (long bucket = get_bucket(key, bits);; bucket = (bucket + 1) & mask)
+    {
+        if (buckets[bucket].key == key)
         {
-            // update sum with current cell value
-            sum += neighborhood_cells[i];
+            return buckets[bucket].slot;
         }
-        new_cell_state = sum % num_states; // store the parity state as the new state
-        break;
-    case CAEnums::Majority:
-        for (int i = 0; i < neighborhood_size; i++)
+        if (buckets[bucket].key == EMPTY_KEY)
         {
-            // increment the cell state's number of votes
-            auto it = state_votes_counter.find(neighborhood_cells[i]);
-            if (it != state_votes_counter.end())
-            {
-                it->second++;
-            }
+            return -1;
         }
-        // find the max_element in the counter based on the pairs' second variable (number of "votes")
-        auto max_elem = max_element(state_votes_counter.begin(), state_votes_counter.end(),
-                                    less_than_votes);
-        new_cell_state = max_elem->first; // set the majority state as the new state
-        break;
     }
-    return 0;
 }
 
-template <>
-int CellularAutomata<int>::print_grid()
+int BrickTable::insert(uint64_t key, long slot, bool &inserted)
 {
-    if (vector != nullptr)
+    inserted = false;
+    int error_code = reserve(num_keys + 1);
+    if (error_code < 0)
     {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            std::cout << vector[i] << " ";
-        }
-        std::cout << std::endl;
+        return error_code;
     }
-    else if (matrix != nullptr)
+    long mask = (long)buckets.size() - 1;
+    long bucket = get_bucket(key, bits);
+    while (buckets[bucket].key != EMPTY_KEY)
     {
-        for (int j = 0; j < axis1_dim; j++)
+        if (buckets[bucket].key == key)
         {
-            for (int k = 0; k < axis2_dim; k++)
-            {
-                std::cout << matrix[j][k] << " ";
-            }
-            std::cout << std::endl;
+            return 0;
         }
+        bucket = (bucket + 1) & mask;
     }
-    else if (tensor != nullptr)
-    {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            std::cout << "Printing " << i << "'th slice of Tensor" << std::endl;
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                for (int k = 0; k < axis3_dim; k++)
-                {
-                    std::cout << tensor[i][j][k] << " ";
-                }
-                std::cout << std::endl;
-            }
-        }
-    }
-    else
-    {
-        return CAEnums::CellsAreNull;
-    }
+    buckets[bucket].key = key;
+    buckets[bucket].slot = slot;
+    num_keys++;
+    inserted = true;
     return 0;
 }
 
-template <>
-int CellularAutomata<int>::append_log()
+int BrickTable::reserve(long num_keys)
 {
-    std::ofstream file;
-    file.open(FILE_PATH, std::ios::app);
-
-    if (vector != nullptr)
-    {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            file << vector[i] << ",";
-        }
-    }
-    else if (matrix != nullptr)
+    if (2 * num_keys <= (long)buckets.size())
     {
-        for (int j = 0; j < axis1_dim; j++)
-        {
-            for (int k = 0; k < axis2_dim; k++)
-            {
-                file << matrix[j][k] << ",";
-            }
-        }
+        return 0;
     }
-    else if (tensor != nullptr)
+    int new_bits = std::max(bits, 4);
+    while ((1L << new_bits) < 2 * num_keys)
     {
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                for (int k = 0; k < axis3_dim; k++)
-                {
-                    file << tensor[i][j][k] << ",";
-                }
-            }
-        }
+        new_bits++;
     }
-    else
+    std::vector<Bucket> new_buckets;
+    try
     {
-        return CAEnums::CellsAreNull;
+        new_buckets.assign(1L << new_bits, Bucket{EMPTY_KEY, 0});
     }
-    file << "\n";
-    file.close();
-    return (0);
-}
-
-template <>
-int CellularAutomata<int>::step(void(custom_rule)(int *, int, int *, int, int &))
-{
-    int error_code = 0;       // store error code return by other methods
-    int new_cell_state;       // stores the cell's new state
-    int empty_cell_state = 0; // cell state for zeroing out old states
-    int index_size;           // number of indices required to address the cell
-
-    if (vector != nullptr)
+    catch (const std::bad_alloc &)
     {
-        // store the main cell's index in cell_index for custom rule type
-        index_size = 1;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-        for (int i = 0; i < axis1_dim; i++)
-        {
-            int cell_index[index_size] = {i};
-            new_cell_state = vector[i];
-            error_code = get_state_from_neighborhood_1d(cell_index, index_size, new_cell_state, custom_rule);
-            if (error_code < 0)
-            {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                /*
-                 * Return error code when omp is not enabled
-                 * otherwise the above pragma will exit out of the for loop(s)
-                 */
-                return error_code;
-#endif
-            }
-            /*
-             * The update cell if new_cell_state is no empty_state.
-             * Avoids overwriting the motion of cells.
-             */
-            if (new_cell_state != empty_cell_state)
-            {
-                next_vector[cell_index[0]] = new_cell_state;
-            }
-        }
-        // store next cell state to the current cell state for the next time step
-        swap_states<int>(vector, next_vector, axis1_dim);
+        return CAEnums::CellsMalloc;
     }
-    else if (matrix != nullptr)
+    long mask = (long)new_buckets.size() - 1;
+    for (const Bucket &old_bucket : buckets)
     {
-        // store the main cell's index in cell_index for custom rule type
-        index_size = 2;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-        for (int i = 0; i < axis1_dim; i++)
+        if (old_bucket.key == EMPTY_KEY)
         {
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                int cell_index[index_size] = {i, j};
-                new_cell_state = matrix[i][j];
-                error_code = get_state_from_neighborhood_2d(cell_index, index_size, new_cell_state, custom_rule);
-                if (error_code < 0)
-                {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                    /*
-                     * Return error code when omp is not enabled
-                     * otherwise the above pragma will exit out of the for loop(s)
-                     */
-                    return error_code;
-#endif
-                }
-                /*
-                 * The update cell if new_cell_state is no empty_state.
-                 * Avoids overwriting the motion of cells.
-                 */
-                if (new_cell_state != empty_cell_state)
-                {
-                    next_matrix[cell_index[0]][cell_index[1]] = new_cell_state;
-                }
-            }
+            continue;
         }
-        // store next cell state to the current cell state for the next time step
-        swap_states<int>(matrix, next_matrix, axis1_dim, axis2_dim);
-    }
-    else if (tensor != nullptr)
-    {
-        index_size = 3;
-#ifdef ENABLE_OMP
-#pragma omp parallel for firstprivate(error_code) private(new_cell_state)
-#endif
-        for (int i = 0; i < axis1_dim; i++)
+        long bucket = get_bucket(old_bucket.key, new_bits);
+        while (new_buckets[bucket].key != EMPTY_KEY)
         {
-            for (int j = 0; j < axis2_dim; j++)
-            {
-                for (int k = 0; k < axis3_dim; k++)
-                {
-                    int cell_index[index_size] = {i, j, k};
-                    new_cell_state = tensor[i][j][k];
-                    error_code = get_state_from_neighborhood_3d(cell_index, index_size, new_cell_state, custom_rule);
-                    if (error_code < 0)
-                    {
-#ifdef ENABLE_OMP
-#pragma omp cancel for
-#endif
-#ifndef ENABLE_OMP
-                        /*
-                         * Return error code when omp is not enabled
-                         * otherwise the above pragma will exit out of the for loop(s)
-                         */
-                        return error_code;
-#endif
-                    }
-                    /*
-                     * The update cell if new_cell_state is no empty_state.
-                     * Avoids overwriting the motion of cells.
-                     */
-                    if (new_cell_state != empty_cell_state)
-                    {
-                        next_tensor[cell_index[0]][cell_index[1]][cell_index[2]] = new_cell_state;
-                    }
-                }
-            }
+            bucket = (bucket + 1) & mask;
         }
-        // store next cell state to the current cell state for the next time step
-        swap_states<int>(tensor, next_tensor, axis1_dim, axis2_dim, axis3_dim);
-    }
-    else
-    {
-        return CAEnums::CellsAreNull;
+        new_buckets[bucket] = old_bucket;
     }
+    buckets.swap(new_buckets);
+    bits = new_bits;
+    return 0;
+}
 
-    steps_taken++;
-    // Appending the step to the file log
-    error_code = append_log();
-    return error_code;
+void BrickTable::clear()
+{
+    std::fill(buckets.begin(), buckets.end(), Bucket{EMPTY_KEY, 0});
+    num_keys = 0;
 }
+
+// The library holds the methods of the integral cell types; they use the class template's definitions
+template int CellularAutomata<int>::setup_dimensions_1d(int axis1_dim, int fill_value);
+template int CellularAutomata<int>::setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value);
+template int CellularAutomata<int>::setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value);
+template int CellularAutomata<int>::init_condition(int x_state, double prob);
+template int CellularAutomata<int>::print_grid();
+template int CellularAutomata<int>::append_log();
+
+template int CellularAutomata<uint8_t>::setup_dimensions_1d(int axis1_dim, int fill_value);
+template int CellularAutomata<uint8_t>::setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value);
+template int CellularAutomata<uint8_t>::setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value);
+template int CellularAutomata<uint8_t>::init_condition(int x_state, double prob);
+template int CellularAutomata<uint8_t>::print_grid();
+template int CellularAutomata<uint8_t>::append_log();
+
+template int CellularAutomata<uint16_t>::setup_dimensions_1d(int axis1_dim, int fill_value);
+template int CellularAutomata<uint16_t>::setup_dimensions_2d(int axis1_dim, int axis2_dim, int fill_value);
+template int CellularAutomata<uint16_t>::setup_dimensions_3d(int axis1_dim, int axis2_dim, int axis3_dim, int fill_value);
+template int CellularAutomata<uint16_t>::init_condition(int x_state, double prob);
+template int CellularAutomata<uint16_t>::print_grid();
+template int CellularAutomata<uint16_t>::append_log();
@@ -14,9 +14,6 @@
 #include <vector>
 #include <cmath> // pow
 
-CellularAutomata<GalaxyCell> Galaxy::CA = CellularAutomata<GalaxyCell>();
-double Galaxy::time_step = 0.1;
-
 Galaxy::Galaxy()
 {
     time_step = 0.1;
@@ -27,10 +24,14 @@ Galaxy::Galaxy()
     axis1_dim = 1;
     axis2_dim = 6;
     axis3_dim = 6;
+    sparse = false;
 }
 
-Galaxy::Galaxy(double time_step, int min_mass, int max_mass, double density, int boundary_radius, int axis1_dim, int axis2_dim, int axis3_dim)
+Galaxy::Galaxy(double time_step, int min_mass, int max_mass, double density, int boundary_radius, int axis1_dim, int axis2_dim, int axis3_dim,
+               bool sparse)
 {
+    this->sparse = sparse;
+
     if (time_step <= 0)
     {
         this->time_step = 0.1;
@@ -126,14 +127,17 @@ Galaxy::Galaxy(double time_step, int min_mass, int max_mass, double density, int
 int Galaxy::init_galaxy()
 {
     int error = 0; // store error return by CA
-    int i, j, k;   // iterators
 
-    error = CA.setup_dimensions_3d(axis1_dim, axis2_dim, axis3_dim);
+    error = CA.setup_sparse(sparse);
     if (error == CAEnums::CellsAlreadyInitialized)
     {
         // If already called init_galaxy then remove old instance and deinitialize it.
         // This allows our model to be restarted with in the same application.
         CA = CellularAutomata<GalaxyCell>();
+        error = CA.setup_sparse(sparse);
+    }
+    if (error == 0)
+    {
         error = CA.setup_dimensions_3d(axis1_dim, axis2_dim, axis3_dim);
     }
 
@@ -149,25 +153,14 @@ int Galaxy::init_galaxy()
         return error;
     }
     CA.setup_rule(CAEnums::Rule::Custom);
+    CA.setup_collision_rule(merge_galaxies);
     CA.init_condition(1, density);
 
     srand(time(NULL));
 
     // set non-empty cell mass to a random value
-    GalaxyCell ***all_cells = CA.get_tensor();
-    for (i = 0; i < CA.axis1_dim; i++)
-    {
-        for (j = 0; j < CA.axis2_dim; j++)
-        {
-            for (k = 0; k < CA.axis3_dim; k++)
-            {
-                if (all_cells[i][j][k].state != 0) // not empty
-                {
-                    all_cells[i][j][k].mass = (double)(min_mass + rand() % (max_mass - min_mass));
-                }
-            }
-        }
-    }
+    CA.for_each_cell([this](const int *, int, GalaxyCell &cell)
+                     { cell.mass = (double)(min_mass + rand() % (max_mass - min_mass)); });
 
     std::cout << "**** Starting simulation ****\n";
     CA.print_grid();
@@ -185,7 +178,9 @@ int Galaxy::simulation(int steps)
 
     for (i = 0; i < steps; i++)
     {
-        error = CA.step(galaxy_formation_rule);
+        error = CA.step([this](int *cell_index, const int index_size,
+                               const NeighborhoodView<GalaxyCell> &neighborhood, GalaxyCell &new_cell_state)
+                        { galaxy_formation_rule(cell_index, index_size, neighborhood, new_cell_state); });
         if (error < 0)
         {
             CA.print_error_status(static_cast<CAEnums::ErrorCode>(error));
@@ -199,7 +194,7 @@ int Galaxy::simulation(int steps)
 }
 
 void Galaxy::galaxy_formation_rule(int *cell_index, const int index_size,
-                                   GalaxyCell *neighborhood_cells, const int neighborhood_size,
+                                   const NeighborhoodView<GalaxyCell> &neighborhood,
                                    GalaxyCell &new_cell_state)
 {
     if (new_cell_state.state == 0)
@@ -211,10 +206,9 @@ void Galaxy::galaxy_formation_rule(int *cell_index, const int index_size,
     std::vector<double> total_force_vector(3, 0);
 
     // compute total vector
-    for (int i = 0; i < neighborhood_size; i++)
+    for (auto neighbor : neighborhood)
     {
-        std::vector<int> neighbor_position(index_size, 0);
-        get_periodic_von_neumann_neighbor_index(index_size, CA.boundary_radius, i, neighbor_position.data());
+        std::vector<int> neighbor_position(neighbor.offset, neighbor.offset + index_size);
 
         // don't include the cell of interest in our force calculation (0, 0, 0)
         if (neighbor_position[0] == 0 &&
@@ -225,7 +219,7 @@ void Galaxy::galaxy_formation_rule(int *cell_index, const int index_size,
         }
 
         std::vector<double> force_vector = compute_gravitational_force(new_cell_state,
-                                                                       neighborhood_cells[i],
+                                                                       neighbor.cell,
                                                                        neighbor_position);
         for (int j = 0; j < index_size; j++)
         {
@@ -390,6 +384,13 @@ void Galaxy::update_velocity_after_collision(GalaxyCell &new_cell, GalaxyCell co
     }
 }
 
+void Galaxy::merge_galaxies(GalaxyCell &new_cell, const GalaxyCell &collied_cell)
+{
+    update_velocity_after_collision(new_cell, collied_cell);
+    new_cell.state += collied_cell.state;
+    new_cell.mass += collied_cell.mass;
+}
+
 int Galaxy::round_int(double dbl)
 {
     return static_cast<int>(dbl < 0 ? dbl - 0.5 : dbl + 0.5);
@@ -412,6 +413,10 @@ GalaxyCell &Galaxy::get_cell_state(int *cell_index, const std::vector<int> &offs
 
 bool Galaxy::did_galaxies_collide(int *cell_index, const std::vector<int> &offset_index, GalaxyCell &new_cell_state)
 {
+    if (sparse)
+    {
+        return false; // merged where the cell lands (see merge_galaxies)
+    }
     const GalaxyCell cell = get_cell_state(cell_index, offset_index);
 
     // check if there was a collision
@@ -420,10 +425,8 @@ bool Galaxy::did_galaxies_collide(int *cell_index, const std::vector<int> &offse
         // collision occurred with current offset and collision type is set to inelastic thus merge the cells
         // at the collided index
         std::vector<int> periodic_new_cell_vec = get_periodic_vector(cell_index, offset_index);
-        update_velocity_after_collision(new_cell_state, cell);
+        merge_galaxies(new_cell_state, cell);
         std::copy(periodic_new_cell_vec.begin(), periodic_new_cell_vec.end(), cell_index);
-        new_cell_state.state += cell.state;
-        new_cell_state.mass += cell.mass;
         return true;
     }
     return false;
@@ -0,0 +1,2299 @@
+/**
+ * @file unit_test_CA.cpp
+ * @author agent (agent@local)
+ *
+ * <b>Contributor(s)</b> <br> &emsp;&emsp;
+ * @brief The program contains unit tests to test the correctness of
+ * the CellularAutomata grid layout and step method.
+ * Every step is checked against a straightforward reference implementation.
+ * @date 2026-10-16
+ */
+
+#include "CAdatatypes.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib> // setenv, unsetenv
+#include <fstream>
+#include <sstream>
+
+// last axis size used by shift_right_rule
+const int SHIFT_AXIS_DIM = 10;
+
+/**
+ * @brief Prints that a specific test passed.
+ *
+ * @param message the test function name
+ */
+void print_success(std::string message)
+{
+    std::cout << "TEST PASSED: " << message << "\n";
+}
+
+/**
+ * @brief Reference implementation of a single Parity/Majority step.
+ * The grid is treated as a 3d grid where unused leading axes have size 1.
+ *
+ * @param grid current cell states (row-major)
+ * @param dims grid dimensions (rank elements)
+ * @param rank grid rank
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule Parity or Majority
+ * @param num_states number of cell states
+ * @return std::vector<int> next cell states (row-major)
+ */
+std::vector<int> reference_step(const std::vector<int> &grid, const std::vector<int> &dims, int rank,
+                                CAEnums::Boundary bt, int radius, CAEnums::Neighborhood nt, CAEnums::Rule rule,
+                                int num_states)
+{
+    int d[3] = {1, 1, 1};
+    for (int axis = 0; axis < rank; axis++)
+    {
+        d[3 - rank + axis] = dims[axis];
+    }
+    int r[3] = {0, 0, 0};
+    for (int axis = 3 - rank; axis < 3; axis++)
+    {
+        r[axis] = radius;
+    }
+
+    std::vector<int> next(grid.size(), 0);
+    for (int i = 0; i < d[0]; i++)
+    {
+        for (int j = 0; j < d[1]; j++)
+        {
+            for (int k = 0; k < d[2]; k++)
+            {
+                // walled edge cells never change
+                bool edge = (r[0] > 0 && (i == 0 || i == d[0] - 1)) ||
+                            (r[1] > 0 && (j == 0 || j == d[1] - 1)) ||
+                            (r[2] > 0 && (k == 0 || k == d[2] - 1));
+                if (bt == CAEnums::Walled && edge)
+                {
+                    next[(i * d[1] + j) * d[2] + k] = grid[(i * d[1] + j) * d[2] + k];
+                    continue;
+                }
+                std::vector<int> votes(num_states, 0);
+                int sum = 0;
+                for (int di = -r[0]; di <= r[0]; di++)
+                {
+                    for (int dj = -r[1]; dj <= r[1]; dj++)
+                    {
+                        for (int dk = -r[2]; dk <= r[2]; dk++)
+                        {
+                            // VonNeumann neighborhoods only extend along one axis at a time
+                            int nonzero = (di != 0) + (dj != 0) + (dk != 0);
+                            if (nt == CAEnums::VonNeumann && nonzero > 1)
+                            {
+                                continue;
+                            }
+                            int ni = i + di;
+                            int nj = j + dj;
+                            int nk = k + dk;
+                            bool outside = ni < 0 || ni >= d[0] || nj < 0 || nj >= d[1] || nk < 0 || nk >= d[2];
+                            if (bt != CAEnums::Periodic && outside)
+                            {
+                                continue;
+                            }
+                            ni = (ni + d[0]) % d[0];
+                            nj = (nj + d[1]) % d[1];
+                            nk = (nk + d[2]) % d[2];
+                            int state = grid[(ni * d[1] + nj) * d[2] + nk];
+                            sum += state;
+                            votes[state]++;
+                        }
+                    }
+                }
+                int new_state = sum % num_states;
+                if (rule == CAEnums::Majority)
+                {
+                    // ties go to the highest state
+                    new_state = num_states - 1;
+                    for (int s = num_states - 2; s >= 0; s--)
+                    {
+                        if (votes[s] > votes[new_state])
+                        {
+                            new_state = s;
+                        }
+                    }
+                }
+                next[(i * d[1] + j) * d[2] + k] = new_state;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Copies the current grid of a CellularAutomata instance using its view.
+ *
+ * @tparam T cell type (int, uint8_t or uint16_t)
+ * @param CA the CellularAutomata instance
+ * @return std::vector<int>
+ */
+template <typename T>
+std::vector<int> copy_grid(CellularAutomata<T> &CA)
+{
+    GridView<T> view = CA.get_view();
+    std::vector<int> grid;
+    // rows are contiguous even when the grid is padded with ghost cells
+    int row_size = view.extent(view.rank() - 1);
+    for (long row = 0; row < view.size() / row_size; row++)
+    {
+        T *cell = view.rank() == 1   ? view.data()
+                    : view.rank() == 2 ? view.row(row)
+                                       : view.row(row / view.extent(1), row % view.extent(1));
+        grid.insert(grid.end(), cell, cell + row_size);
+    }
+    return grid;
+}
+
+/**
+ * @brief Sets up the dimensions of a grid of the given rank.
+ *
+ * @tparam T cell type
+ * @param CA the grid
+ * @param dims grid dimensions (rank elements)
+ */
+template <typename T>
+void setup_dimensions(CellularAutomata<T> &CA, const std::vector<int> &dims)
+{
+    switch (dims.size())
+    {
+    case 1:
+        assert((CA.setup_dimensions_1d(dims[0]) == 0));
+        break;
+    case 2:
+        assert((CA.setup_dimensions_2d(dims[0], dims[1]) == 0));
+        break;
+    case 3:
+        assert((CA.setup_dimensions_3d(dims[0], dims[1], dims[2]) == 0));
+        break;
+    }
+}
+
+/**
+ * @brief Sets up a CellularAutomata instance of the given rank with random cell states.
+ *
+ * @tparam T cell type (int, uint8_t or uint16_t)
+ * @param CA the CellularAutomata instance
+ * @param dims grid dimensions (rank elements)
+ */
+template <typename T>
+void setup_random_grid(CellularAutomata<T> &CA, const std::vector<int> &dims)
+{
+    setup_dimensions(CA, dims);
+    for (int state = 1; state < CA.num_states; state++)
+    {
+        assert((CA.init_condition(state, 0.5) == 0));
+    }
+}
+
+/**
+ * @brief Sets up a CellularAutomata instance with 3 states, a random grid and the given
+ * boundary, neighborhood and rule.
+ *
+ * @param dims grid dimensions (rank elements)
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param CA the CellularAutomata instance
+ */
+void make_random_ca(const std::vector<int> &dims, CAEnums::Boundary bt, int radius, CAEnums::Neighborhood nt,
+                    CAEnums::Rule rule, CellularAutomata<int> &CA)
+{
+    CA.setup_cell_states(3);
+    setup_random_grid(CA, dims);
+    assert((CA.setup_boundary(bt, radius) == 0));
+    CA.setup_neighborhood(nt);
+    CA.setup_rule(rule);
+}
+
+/**
+ * @brief Sets up two CellularAutomata instances like make_random_ca holding the same random grid,
+ * so a step mode of one can be compared with the other.
+ *
+ * @param dims grid dimensions (rank elements)
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param CA the reference instance
+ * @param CA_other the instance compared with CA
+ */
+void make_ca_pair(const std::vector<int> &dims, CAEnums::Boundary bt, int radius, CAEnums::Neighborhood nt,
+                  CAEnums::Rule rule, CellularAutomata<int> &CA, CellularAutomata<int> &CA_other)
+{
+    make_random_ca(dims, bt, radius, nt, rule, CA);
+    make_random_ca(dims, bt, radius, nt, rule, CA_other);
+    std::vector<int> grid = copy_grid(CA);
+    std::copy(grid.begin(), grid.end(), CA_other.get_view().data());
+}
+
+/**
+ * @brief Steps a CellularAutomata instance several times and compares every step
+ * to the reference implementation.
+ *
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule Parity or Majority
+ * @param num_states number of cell states
+ */
+void check_steps_match_reference(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                 CAEnums::Neighborhood nt, CAEnums::Rule rule, int num_states)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CA.setup_cell_states(num_states);
+    setup_random_grid(CA, dims);
+    assert((CA.setup_boundary(bt, radius) == 0));
+    CA.setup_neighborhood(nt);
+    CA.setup_rule(rule);
+
+    int rank = dims.size();
+    for (int step = 0; step < 3; step++)
+    {
+        std::vector<int> expected = reference_step(copy_grid(CA), dims, rank, bt, radius, nt, rule, num_states);
+        assert((CA.step() == 0));
+        assert((copy_grid(CA) == expected));
+    }
+}
+
+/**
+ * @brief Steps a narrow CellularAutomata instance and an int instance from the same grid
+ * and checks that both produce the same states.
+ *
+ * @tparam T narrow cell type (uint8_t or uint16_t)
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param nt neighborhood type
+ * @param rule Parity or Majority
+ * @param num_states number of cell states
+ */
+template <typename T>
+void check_narrow_steps_match_int(const std::vector<int> &dims, CAEnums::Boundary bt,
+                                  CAEnums::Neighborhood nt, CAEnums::Rule rule, int num_states)
+{
+    CellularAutomata<int> CA_int = CellularAutomata<int>();
+    CA_int.setup_cell_states(num_states);
+    setup_random_grid(CA_int, dims);
+    assert((CA_int.setup_boundary(bt, 1) == 0));
+    CA_int.setup_neighborhood(nt);
+    CA_int.setup_rule(rule);
+
+    CellularAutomata<T> CA_narrow = CellularAutomata<T>();
+    CA_narrow.setup_cell_states(num_states);
+    setup_random_grid(CA_narrow, dims);
+    assert((CA_narrow.setup_boundary(bt, 1) == 0));
+    CA_narrow.setup_neighborhood(nt);
+    CA_narrow.setup_rule(rule);
+    std::vector<int> initial = copy_grid(CA_int);
+    std::copy(initial.begin(), initial.end(), CA_narrow.get_view().data());
+
+    for (int step = 0; step < 3; step++)
+    {
+        assert((CA_int.step() == 0));
+        assert((CA_narrow.step() == 0));
+        assert((copy_grid(CA_int) == copy_grid(CA_narrow)));
+    }
+}
+
+/**
+ * @brief Checks that a StencilKernel gathers the same cells as the stencil's offsets
+ * from the center of a grid with the kernel's rank.
+ *
+ * @tparam Kernel StencilKernel instantiation
+ * @param dims grid dimensions (rank matching the kernel)
+ * @param radius kernel radius
+ * @param nt kernel neighborhood type
+ */
+template <typename Kernel>
+void check_stencil_kernel(const std::vector<int> &dims, int radius, CAEnums::Neighborhood nt)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CA.setup_cell_states(100);
+    setup_random_grid(CA, dims);
+    assert((CA.setup_boundary(CAEnums::Periodic, radius) == 0));
+    CA.setup_neighborhood(nt);
+
+    GridView<int> view = CA.get_view();
+    const NeighborhoodStencil &stencil = CA.get_stencil();
+    const int *center = view.data();
+    for (int axis = 0; axis < view.rank(); axis++)
+    {
+        center += (dims[axis] / 2) * view.stride(axis);
+    }
+    std::vector<int> gathered(stencil.size() + 1, -1);
+    assert((Kernel::gather(center, stencil, gathered.data()) == stencil.size()));
+    for (int n = 0; n < stencil.size(); n++)
+    {
+        assert((gathered[n] == center[stencil.offsets[n]]));
+    }
+    assert((gathered[stencil.size()] == -1));
+}
+
+/**
+ * @brief Custom rule that moves every non-empty cell one cell to the right (periodic).
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood_cells array of neighboring cells
+ * @param neighborhood_size size of neighborhood_cells array
+ * @param new_cell_state reference to the new cell state
+ */
+void shift_right_rule(int *cell_index, const int index_size,
+                      int * /*neighborhood_cells*/, const int /*neighborhood_size*/,
+                      int &new_cell_state)
+{
+    if (new_cell_state != 0)
+    {
+        cell_index[index_size - 1] = (cell_index[index_size - 1] + 1) % SHIFT_AXIS_DIM;
+    }
+}
+
+/**
+ * @brief Custom rule that sets non-empty cells to the weighted neighborhood sum modulo 3.
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood_cells array of neighboring cells
+ * @param neighborhood_size size of neighborhood_cells array
+ * @param new_cell_state reference to the new cell state
+ */
+void weighted_sum_rule(int * /*cell_index*/, const int /*index_size*/,
+                       int *neighborhood_cells, const int neighborhood_size,
+                       int &new_cell_state)
+{
+    if (new_cell_state == 0)
+    {
+        return;
+    }
+    int sum = 0;
+    for (int n = 0; n < neighborhood_size; n++)
+    {
+        sum += (n + 1) * neighborhood_cells[n];
+    }
+    new_cell_state = 1 + sum % 2;
+}
+
+/**
+ * @brief weighted_sum_rule written against the NeighborhoodView API.
+ * Also checks that the neighbor's relative index matches the cell it references.
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood view of the neighboring cells
+ * @param new_cell_state reference to the new cell state
+ */
+void weighted_sum_view_rule(int * /*cell_index*/, const int index_size,
+                            const NeighborhoodView<int> &neighborhood,
+                            int &new_cell_state)
+{
+    if (new_cell_state == 0)
+    {
+        return;
+    }
+    int sum = 0;
+    int n = 0;
+    for (auto neighbor : neighborhood)
+    {
+        assert((&neighbor.cell == &neighborhood[n]));
+        assert((neighbor.offset == neighborhood.offset(n)));
+        sum += (n + 1) * neighbor.cell;
+        n++;
+    }
+    assert((n == neighborhood.size() && neighborhood.rank() == index_size));
+    new_cell_state = 1 + sum % 2;
+}
+
+/**
+ * @brief Larger than Life style totalistic rule: a cell is born or survives depending on
+ * the number of live cells in its neighborhood relative to the neighborhood size.
+ *
+ * @param sum sum of the neighborhood's states (cell of interest included)
+ * @param neighborhood_size number of cells in the neighborhood
+ * @param new_cell_state reference to the new cell state
+ */
+void larger_than_life_rule(int sum, int neighborhood_size, int &new_cell_state)
+{
+    int live_neighbors = sum - new_cell_state;
+    if (new_cell_state == 1)
+    {
+        new_cell_state = (3 * live_neighbors >= neighborhood_size && 2 * live_neighbors <= neighborhood_size) ? 1 : 0;
+    }
+    else
+    {
+        new_cell_state = (3 * live_neighbors >= neighborhood_size && 5 * live_neighbors <= 2 * neighborhood_size) ? 1 : 0;
+    }
+}
+
+/**
+ * @brief larger_than_life_rule applied to a copied neighborhood array.
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood_cells array of neighboring cells
+ * @param neighborhood_size size of neighborhood_cells array
+ * @param new_cell_state reference to the new cell state
+ */
+void larger_than_life_array_rule(int * /*cell_index*/, const int /*index_size*/,
+                                 int *neighborhood_cells, const int neighborhood_size,
+                                 int &new_cell_state)
+{
+    int sum = 0;
+    for (int n = 0; n < neighborhood_size; n++)
+    {
+        sum += neighborhood_cells[n];
+    }
+    larger_than_life_rule(sum, neighborhood_size, new_cell_state);
+}
+
+/**
+ * @brief Tests that the view addresses the same cells as the row pointer accessors
+ * and that rows and slabs are contiguous.
+ */
+void test_grid_view()
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_dimensions_3d(4, 5, 6) == 0));
+    GridView<int> view = CA.get_view();
+    int ***tensor = CA.get_tensor();
+
+    assert((view.rank() == 3));
+    assert((view.size() == 4 * 5 * 6));
+    assert((view.extent(0) == 4 && view.extent(1) == 5 && view.extent(2) == 6));
+    assert((view.stride(0) == 30 && view.stride(1) == 6 && view.stride(2) == 1));
+    for (int i = 0; i < 4; i++)
+    {
+        assert((view.slab(i) == view.data() + i * 30));
+        for (int j = 0; j < 5; j++)
+        {
+            assert((view.row(i, j) == tensor[i][j]));
+            for (int k = 0; k < 6; k++)
+            {
+                assert((&view(i, j, k) == &tensor[i][j][k]));
+            }
+        }
+    }
+    assert((CA.get_next_view().data() == CA.get_next_tensor()[0][0]));
+
+    CellularAutomata<int> CA_2d = CellularAutomata<int>();
+    assert((CA_2d.setup_dimensions_2d(3, 7) == 0));
+    assert((CA_2d.setup_dimensions_1d(3) == CAEnums::CellsAlreadyInitialized));
+    GridView<int> view_2d = CA_2d.get_view();
+    assert((view_2d.rank() == 2 && view_2d.stride(0) == 7));
+    assert((view_2d.row(2) == CA_2d.get_matrix()[2]));
+    print_success("test_grid_view");
+}
+
+/**
+ * @brief Tests Parity and Majority steps on periodic grids of every rank.
+ */
+void test_periodic_steps()
+{
+    std::vector<std::vector<int>> all_dims = {{31}, {9, 12}, {6, 7, 8}};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (auto nt : neighborhoods)
+        {
+            check_steps_match_reference(dims, CAEnums::Periodic, 1, nt, CAEnums::Parity, 2);
+            check_steps_match_reference(dims, CAEnums::Periodic, 2, nt, CAEnums::Parity, 3);
+            check_steps_match_reference(dims, CAEnums::Periodic, 1, nt, CAEnums::Majority, 2);
+            check_steps_match_reference(dims, CAEnums::Periodic, 2, nt, CAEnums::Majority, 2);
+            check_steps_match_reference(dims, CAEnums::Periodic, 1, nt, CAEnums::Majority, 4);
+            // votes counted in the threads' vote scratch instead of the stack histogram
+            check_steps_match_reference(dims, CAEnums::Periodic, 1, nt, CAEnums::Majority, MAJORITY_STACK_STATES + 6);
+        }
+    }
+    print_success("test_periodic_steps");
+}
+
+/**
+ * @brief Tests Parity and Majority steps on CutOff and Walled grids of every rank,
+ * covering the interior region and the shells near the edges.
+ */
+void test_bounded_steps()
+{
+    std::vector<std::vector<int>> all_dims = {{31}, {9, 12}, {6, 7, 8}, {3, 9, 5}};
+    CAEnums::Boundary boundaries[2] = {CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                check_steps_match_reference(dims, bt, 1, nt, CAEnums::Parity, 2);
+                check_steps_match_reference(dims, bt, 1, nt, CAEnums::Parity, 3);
+                check_steps_match_reference(dims, bt, 1, nt, CAEnums::Majority, 2);
+                check_steps_match_reference(dims, bt, 1, nt, CAEnums::Majority, 3);
+            }
+        }
+    }
+    check_steps_match_reference({12, 10, 9}, CAEnums::Walled, 2, CAEnums::Moore, CAEnums::Parity, 3);
+    check_steps_match_reference({12, 10}, CAEnums::CutOff, 2, CAEnums::VonNeumann, CAEnums::Parity, 3);
+    print_success("test_bounded_steps");
+}
+
+/**
+ * @brief Tests that a custom rule moving cells leaves no stale cells behind
+ * after the generation buffers are swapped.
+ */
+void test_custom_rule_moves_cells()
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_dimensions_2d(4, SHIFT_AXIS_DIM) == 0));
+    CA.init_condition(1, 0.4);
+    CA.setup_rule(CAEnums::Custom);
+
+    std::vector<int> grid = copy_grid(CA);
+    for (int step = 0; step < 5; step++)
+    {
+        int *previous_data = CA.get_view().data();
+        assert((CA.step(shift_right_rule) == 0));
+        // generation buffers are swapped, not copied
+        assert((CA.get_next_view().data() == previous_data));
+
+        std::vector<int> expected(grid.size(), 0);
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < SHIFT_AXIS_DIM; j++)
+            {
+                expected[i * SHIFT_AXIS_DIM + (j + 1) % SHIFT_AXIS_DIM] = grid[i * SHIFT_AXIS_DIM + j];
+            }
+        }
+        grid = copy_grid(CA);
+        assert((grid == expected));
+    }
+    print_success("test_custom_rule_moves_cells");
+}
+
+/**
+ * @brief Tests that custom rules reading the NeighborhoodView produce the same steps
+ * as custom rules reading the copied neighborhood array.
+ */
+void test_neighborhood_view_rule()
+{
+    std::vector<std::vector<int>> all_dims = {{17}, {7, 9}, {5, 6, 7}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                CellularAutomata<int> CA_copy = CellularAutomata<int>();
+                CA_copy.setup_cell_states(3);
+                setup_random_grid(CA_copy, dims);
+                assert((CA_copy.setup_boundary(bt, 2) == 0));
+                CA_copy.setup_neighborhood(nt);
+                CA_copy.setup_rule(CAEnums::Custom);
+
+                CellularAutomata<int> CA_view = CellularAutomata<int>();
+                CA_view.setup_cell_states(3);
+                setup_random_grid(CA_view, dims);
+                assert((CA_view.setup_boundary(bt, 2) == 0));
+                CA_view.setup_neighborhood(nt);
+                CA_view.setup_rule(CAEnums::Custom);
+                GridView<int> initial = CA_copy.get_view();
+                std::copy(initial.data(), initial.data() + initial.size(), CA_view.get_view().data());
+
+                for (int step = 0; step < 3; step++)
+                {
+                    assert((CA_copy.step(weighted_sum_rule) == 0));
+                    assert((CA_view.step(weighted_sum_view_rule) == 0));
+                    assert((copy_grid(CA_copy) == copy_grid(CA_view)));
+                }
+            }
+        }
+    }
+    print_success("test_neighborhood_view_rule");
+}
+
+/**
+ * @brief Tests that the stencil lists the same relative indices as the
+ * get_periodic_*_neighbor_index decoders and that its offsets follow the grid strides.
+ */
+void test_neighborhood_stencil()
+{
+    std::vector<std::vector<int>> all_dims = {{17}, {7, 9}, {5, 6, 7}};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (auto nt : neighborhoods)
+        {
+            CellularAutomata<int> CA = CellularAutomata<int>();
+            setup_random_grid(CA, dims);
+            assert((CA.setup_boundary(CAEnums::Periodic, 2) == 0));
+            CA.setup_neighborhood(nt);
+
+            int rank = dims.size();
+            GridView<int> view = CA.get_view();
+            const NeighborhoodStencil &stencil = CA.get_stencil();
+            assert((stencil.size() == CellularAutomata<int>::get_neighborhood_size(rank, 2, nt)));
+            for (int n = 0; n < stencil.size(); n++)
+            {
+                int expected[3] = {0, 0, 0};
+                if (nt == CAEnums::Moore)
+                {
+                    get_periodic_moore_neighbor_index(rank, 2, n, expected);
+                }
+                else
+                {
+                    get_periodic_von_neumann_neighbor_index(rank, 2, n, expected);
+                }
+                long offset = 0;
+                for (int axis = 0; axis < rank; axis++)
+                {
+                    assert((stencil.coord(n)[axis] == expected[axis]));
+                    offset += expected[axis] * view.stride(axis);
+                }
+                assert((stencil.offsets[n] == offset));
+            }
+
+            // stencil is rebuilt when the neighborhood changes
+            CAEnums::Neighborhood other_nt = nt == CAEnums::Moore ? CAEnums::VonNeumann : CAEnums::Moore;
+            CA.setup_neighborhood(other_nt);
+            assert((CA.get_stencil().size() == CellularAutomata<int>::get_neighborhood_size(rank, 2, other_nt)));
+        }
+    }
+    print_success("test_neighborhood_stencil");
+}
+
+/**
+ * @brief Tests that steps read through ghost cells match steps without ghost cells
+ * for every boundary, neighborhood and rule.
+ */
+void test_ghost_cells()
+{
+    std::vector<std::vector<int>> all_dims = {{17}, {7, 9}, {5, 6, 7}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    CAEnums::Rule rules[3] = {CAEnums::Parity, CAEnums::Majority, CAEnums::Custom};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                for (auto rule : rules)
+                {
+                    CellularAutomata<int> CA_plain = CellularAutomata<int>();
+                    CA_plain.setup_cell_states(3);
+                    setup_random_grid(CA_plain, dims);
+                    assert((CA_plain.setup_boundary(bt, 2) == 0));
+                    CA_plain.setup_neighborhood(nt);
+                    CA_plain.setup_rule(rule);
+
+                    CellularAutomata<int> CA_ghost = CellularAutomata<int>();
+                    CA_ghost.setup_cell_states(3);
+                    setup_random_grid(CA_ghost, dims);
+                    assert((CA_ghost.setup_boundary(bt, 2) == 0));
+                    CA_ghost.setup_neighborhood(nt);
+                    CA_ghost.setup_rule(rule);
+                    std::vector<int> initial = copy_grid(CA_plain);
+                    std::copy(initial.begin(), initial.end(), CA_ghost.get_view().data());
+                    assert((CA_ghost.setup_ghost_cells(true) == 0));
+
+                    GridView<int> padded = CA_ghost.get_view();
+                    assert((padded.stride(padded.rank() - 1) == 1));
+                    assert((padded.rank() == 1 || padded.stride(padded.rank() - 2) == padded.extent(padded.rank() - 1) + 4));
+                    assert((copy_grid(CA_ghost) == initial));
+
+                    for (int step = 0; step < 3; step++)
+                    {
+                        if (rule == CAEnums::Custom)
+                        {
+                            assert((CA_plain.step(weighted_sum_view_rule) == 0));
+                            assert((CA_ghost.step(weighted_sum_view_rule) == 0));
+                        }
+                        else
+                        {
+                            assert((CA_plain.step() == 0));
+                            assert((CA_ghost.step() == 0));
+                        }
+                        assert((copy_grid(CA_plain) == copy_grid(CA_ghost)));
+                    }
+
+                    // removing the ghost cells keeps the grid
+                    std::vector<int> last = copy_grid(CA_ghost);
+                    assert((CA_ghost.setup_ghost_cells(false) == 0));
+                    assert((CA_ghost.get_view().stride(0) == CA_plain.get_view().stride(0)));
+                    assert((copy_grid(CA_ghost) == last));
+                }
+            }
+        }
+    }
+    print_success("test_ghost_cells");
+}
+
+/**
+ * @brief Tests that totalistic rules computed from running sums match the same rule
+ * computed from the neighborhood array for large radii, every boundary and neighborhood.
+ */
+void test_totalistic_rule()
+{
+    std::vector<std::pair<std::vector<int>, int>> all_dims_and_radius = {{{61}, 12}, {{40, 37}, 10}, {{13, 12, 14}, 3}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims_and_radius : all_dims_and_radius)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                CellularAutomata<int> CA_array = CellularAutomata<int>();
+                setup_random_grid(CA_array, dims_and_radius.first);
+                assert((CA_array.setup_boundary(bt, dims_and_radius.second) == 0));
+                CA_array.setup_neighborhood(nt);
+                CA_array.setup_rule(CAEnums::Custom);
+
+                CellularAutomata<int> CA_sums = CellularAutomata<int>();
+                setup_random_grid(CA_sums, dims_and_radius.first);
+                assert((CA_sums.setup_boundary(bt, dims_and_radius.second) == 0));
+                CA_sums.setup_neighborhood(nt);
+                CA_sums.setup_rule(CAEnums::Custom);
+                std::vector<int> initial = copy_grid(CA_array);
+                std::copy(initial.begin(), initial.end(), CA_sums.get_view().data());
+
+                for (int step = 0; step < 3; step++)
+                {
+                    assert((CA_array.step(larger_than_life_array_rule) == 0));
+                    assert((CA_sums.step(larger_than_life_rule) == 0));
+                    assert((copy_grid(CA_array) == copy_grid(CA_sums)));
+                }
+            }
+        }
+    }
+    print_success("test_totalistic_rule");
+}
+
+/**
+ * @brief Tests that Parity, Majority and totalistic steps, whose neighborhood sums are computed block by block,
+ * give the reference cells on grids spanning several blocks along every axis (every boundary and
+ * neighborhood type, radius 1 and 3).
+ */
+void test_window_blocks()
+{
+    std::vector<std::pair<std::vector<int>, int>> all_dims_and_radius = {
+        {{40000}, 1}, {{40000}, 3}, {{150, 1100}, 1}, {{150, 1100}, 3}, {{20, 40, 260}, 1}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims_and_radius : all_dims_and_radius)
+    {
+        const std::vector<int> &dims = dims_and_radius.first;
+        int radius = dims_and_radius.second;
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                check_steps_match_reference(dims, bt, radius, nt, CAEnums::Parity, 3);
+                check_steps_match_reference(dims, bt, radius, nt, CAEnums::Majority, 3);
+
+                CellularAutomata<int> CA_array = CellularAutomata<int>();
+                CellularAutomata<int> CA_sums = CellularAutomata<int>();
+                make_ca_pair(dims, bt, radius, nt, CAEnums::Custom, CA_array, CA_sums);
+                for (int step = 0; step < 2; step++)
+                {
+                    assert((CA_array.step(larger_than_life_array_rule) == 0));
+                    assert((CA_sums.step(larger_than_life_rule) == 0));
+                    assert((copy_grid(CA_array) == copy_grid(CA_sums)));
+                }
+            }
+        }
+    }
+    print_success("test_window_blocks");
+}
+
+/**
+ * @brief Tests that bit-packed binary Parity and Majority steps match the reference steps (rows
+ * longer than and ending on a 64 cell word) and that unpackable states fall back to the generic kernels.
+ */
+void test_packed_binary_steps()
+{
+    // rows longer than a 64 cell word and rows that end exactly on a word
+    std::vector<std::vector<int>> all_dims = {{200}, {5, 130}, {5, 4, 70}, {4, 5, 64}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::VonNeumann, CAEnums::Moore};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                for (int radius = 1; radius <= 2; radius++)
+                {
+                    check_steps_match_reference(dims, bt, radius, nt, CAEnums::Parity, 2);
+                    check_steps_match_reference(dims, bt, radius, nt, CAEnums::Majority, 2);
+                }
+            }
+        }
+    }
+
+    // a state outside [0, num_states) can't be packed and falls back to the generic kernels
+    std::vector<int> dims = {6, 70};
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CA.setup_cell_states(2);
+    setup_random_grid(CA, dims);
+    assert((CA.setup_boundary(CAEnums::Periodic, 1) == 0));
+    CA.setup_rule(CAEnums::Parity);
+    CA.get_matrix()[2][65] = 3;
+    std::vector<int> expected = reference_step(copy_grid(CA), dims, 2, CAEnums::Periodic, 1,
+                                               CAEnums::Moore, CAEnums::Parity, 2);
+    assert((CA.step() == 0));
+    assert((copy_grid(CA) == expected));
+
+    // consecutive packed steps keep the grid packed until the cells are read or a generic step runs
+    std::vector<int> packed_dims = {5, 4, 70};
+    for (auto bt : boundaries)
+    {
+        CellularAutomata<int> CA_packed = CellularAutomata<int>();
+        CA_packed.setup_cell_states(2);
+        setup_random_grid(CA_packed, packed_dims);
+        assert((CA_packed.setup_boundary(bt, 2) == 0));
+        CA_packed.setup_rule(CAEnums::Parity);
+        std::vector<int> packed_expected = copy_grid(CA_packed);
+        for (int step = 0; step < 4; step++)
+        {
+            packed_expected = reference_step(packed_expected, packed_dims, 3, bt, 2, CAEnums::Moore, CAEnums::Parity, 2);
+            assert((CA_packed.step() == 0));
+        }
+        // packed steps release the cell buffers; the tables fetched afterwards point at the unpacked cells
+        assert((CA_packed.get_tensor()[4][3][69] == packed_expected.back()));
+        assert((copy_grid(CA_packed) == packed_expected));
+
+        for (int step = 0; step < 2; step++)
+        {
+            packed_expected = reference_step(packed_expected, packed_dims, 3, bt, 2, CAEnums::Moore, CAEnums::Parity, 2);
+            assert((CA_packed.step() == 0));
+        }
+        // three states can't be packed: the generic step starts from the packed generation
+        CA_packed.setup_cell_states(3);
+        packed_expected = reference_step(packed_expected, packed_dims, 3, bt, 2, CAEnums::Moore, CAEnums::Parity, 3);
+        assert((CA_packed.step() == 0));
+        assert((copy_grid(CA_packed) == packed_expected));
+    }
+    print_success("test_packed_binary_steps");
+}
+
+/**
+ * @brief Tests that uint8_t and uint16_t cells step like int cells and that states must fit the cell type.
+ */
+void test_narrow_cell_states()
+{
+    std::vector<std::vector<int>> all_dims = {{90}, {12, 70}, {6, 7, 8}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::VonNeumann, CAEnums::Moore};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                check_narrow_steps_match_int<uint8_t>(dims, bt, nt, CAEnums::Parity, 2);
+                check_narrow_steps_match_int<uint8_t>(dims, bt, nt, CAEnums::Parity, 5);
+                check_narrow_steps_match_int<uint8_t>(dims, bt, nt, CAEnums::Majority, 2);
+                check_narrow_steps_match_int<uint8_t>(dims, bt, nt, CAEnums::Majority, 4);
+                check_narrow_steps_match_int<uint16_t>(dims, bt, nt, CAEnums::Parity, 7);
+                check_narrow_steps_match_int<uint16_t>(dims, bt, nt, CAEnums::Parity, 4); // sums wrap in uint16_t lanes
+                check_narrow_steps_match_int<uint16_t>(dims, bt, nt, CAEnums::Majority, 3);
+            }
+        }
+    }
+    // more states than the Majority stack histogram holds
+    check_narrow_steps_match_int<uint16_t>({20, 20}, CAEnums::Periodic, CAEnums::Moore, CAEnums::Majority, 300);
+
+    // states must fit the cell type
+    CellularAutomata<uint8_t> CA_uint8 = CellularAutomata<uint8_t>();
+    assert((CA_uint8.setup_dimensions_2d(4, 4, 256) == CAEnums::InvalidCellState));
+    assert((CA_uint8.setup_dimensions_2d(4, 4, 255) == 0));
+    CA_uint8.setup_cell_states(300);
+    assert((CA_uint8.init_condition(255, 0.5) == 0));
+    assert((CA_uint8.init_condition(256, 0.5) == CAEnums::InvalidCellStateCondition));
+    CellularAutomata<uint16_t> CA_uint16 = CellularAutomata<uint16_t>();
+    assert((CA_uint16.setup_dimensions_1d(8, -1) == CAEnums::InvalidCellState));
+    assert((CA_uint16.setup_dimensions_1d(8, 65535) == 0));
+    print_success("test_narrow_cell_states");
+}
+
+/**
+ * @brief Tests that Parity and Majority steps (int and uint16_t lanes) match the reference steps
+ * at every supported SIMD level.
+ */
+void test_simd_levels()
+{
+    int supported_level = set_simd_level(SimdAVX512);
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    for (int level = SimdScalar; level <= supported_level; level++)
+    {
+        set_simd_level(level);
+        for (auto bt : boundaries)
+        {
+            check_steps_match_reference({45}, bt, 2, CAEnums::Moore, CAEnums::Parity, 3);
+            check_steps_match_reference({19, 23}, bt, 1, CAEnums::VonNeumann, CAEnums::Parity, 5);
+            check_steps_match_reference({19, 23}, bt, 2, CAEnums::Moore, CAEnums::Majority, 3);
+            check_steps_match_reference({7, 9, 11}, bt, 1, CAEnums::Moore, CAEnums::Majority, 4);
+            check_steps_match_reference({7, 9, 11}, bt, 1, CAEnums::VonNeumann, CAEnums::Majority, 2);
+            // uint8_t and uint16_t cells sum in uint16_t lanes
+            check_narrow_steps_match_int<uint8_t>({19, 23}, bt, CAEnums::Moore, CAEnums::Parity, 3);
+            check_narrow_steps_match_int<uint16_t>({19, 23}, bt, CAEnums::VonNeumann, CAEnums::Parity, 8);
+            check_narrow_steps_match_int<uint8_t>({7, 9, 11}, bt, CAEnums::Moore, CAEnums::Majority, 4);
+        }
+    }
+    set_simd_level(supported_level);
+    print_success("test_simd_levels");
+}
+
+/**
+ * @brief Totalistic functor with its thresholds as members (larger_than_life_rule's thresholds).
+ */
+struct LargerThanLifeRule
+{
+    int survive_min, survive_max, birth_min, birth_max; //!< live neighbor bounds in 1/30ths of the neighborhood size
+
+    void operator()(int sum, int neighborhood_size, int &new_cell_state) const
+    {
+        int live_neighbors = 30 * (sum - new_cell_state);
+        if (new_cell_state == 1)
+        {
+            new_cell_state = (live_neighbors >= survive_min * neighborhood_size &&
+                              live_neighbors <= survive_max * neighborhood_size)
+                                 ? 1
+                                 : 0;
+        }
+        else
+        {
+            new_cell_state = (live_neighbors >= birth_min * neighborhood_size &&
+                              live_neighbors <= birth_max * neighborhood_size)
+                                 ? 1
+                                 : 0;
+        }
+    }
+};
+
+/**
+ * @brief Tests that capturing lambdas and functors step like the equivalent rule functions and that
+ * built-in rules ignore them.
+ */
+void test_lambda_rules()
+{
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{30}, {11, 13}, {7, 6, 9}})
+        {
+            CellularAutomata<int> CA_pointer = CellularAutomata<int>();
+            CA_pointer.setup_cell_states(3);
+            setup_random_grid(CA_pointer, dims);
+            assert((CA_pointer.setup_boundary(bt, 1) == 0));
+            CA_pointer.setup_rule(CAEnums::Custom);
+
+            CellularAutomata<int> CA_lambda = CellularAutomata<int>();
+            CA_lambda.setup_cell_states(3);
+            setup_random_grid(CA_lambda, dims);
+            assert((CA_lambda.setup_boundary(bt, 1) == 0));
+            CA_lambda.setup_rule(CAEnums::Custom);
+            std::vector<int> initial = copy_grid(CA_pointer);
+            std::copy(initial.begin(), initial.end(), CA_lambda.get_view().data());
+
+            // captured parameters instead of constants
+            int weight_shift = 1;
+            int parity_states = 2;
+            auto weighted_sum = [weight_shift, parity_states](int *, const int, int *neighborhood_cells,
+                                                              const int neighborhood_size, int &new_cell_state)
+            {
+                if (new_cell_state == 0)
+                {
+                    return;
+                }
+                int sum = 0;
+                for (int n = 0; n < neighborhood_size; n++)
+                {
+                    sum += (n + weight_shift) * neighborhood_cells[n];
+                }
+                new_cell_state = 1 + sum % parity_states;
+            };
+            auto weighted_sum_view = [&weight_shift](int *, const int, const NeighborhoodView<int> &neighborhood,
+                                                     int &new_cell_state)
+            {
+                if (new_cell_state == 0)
+                {
+                    return;
+                }
+                int sum = 0;
+                for (int n = 0; n < neighborhood.size(); n++)
+                {
+                    sum += (n + weight_shift) * neighborhood[n];
+                }
+                new_cell_state = 1 + sum % 2;
+            };
+            for (int step = 0; step < 2; step++)
+            {
+                assert((CA_pointer.step(weighted_sum_rule) == 0));
+                assert((CA_lambda.step(weighted_sum) == 0));
+                assert((copy_grid(CA_pointer) == copy_grid(CA_lambda)));
+                assert((CA_pointer.step(weighted_sum_view_rule) == 0));
+                assert((CA_lambda.step(weighted_sum_view) == 0));
+                assert((copy_grid(CA_pointer) == copy_grid(CA_lambda)));
+            }
+        }
+    }
+
+    // totalistic functor; same thresholds as larger_than_life_rule
+    CellularAutomata<int> CA_pointer = CellularAutomata<int>();
+    setup_random_grid(CA_pointer, {40, 37});
+    assert((CA_pointer.setup_boundary(CAEnums::CutOff, 5) == 0));
+    CA_pointer.setup_rule(CAEnums::Custom);
+    CellularAutomata<int> CA_functor = CellularAutomata<int>();
+    setup_random_grid(CA_functor, {40, 37});
+    assert((CA_functor.setup_boundary(CAEnums::CutOff, 5) == 0));
+    CA_functor.setup_rule(CAEnums::Custom);
+    std::vector<int> initial = copy_grid(CA_pointer);
+    std::copy(initial.begin(), initial.end(), CA_functor.get_view().data());
+    LargerThanLifeRule rule = {10, 15, 10, 12};
+    for (int step = 0; step < 3; step++)
+    {
+        assert((CA_pointer.step(larger_than_life_rule) == 0));
+        assert((CA_functor.step(rule) == 0));
+        assert((copy_grid(CA_pointer) == copy_grid(CA_functor)));
+    }
+
+    // built-in rules ignore the lambda
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CA.setup_cell_states(3);
+    std::vector<int> dims = {9, 8};
+    setup_random_grid(CA, dims);
+    CA.setup_rule(CAEnums::Parity);
+    std::vector<int> expected = reference_step(copy_grid(CA), dims, 2, CAEnums::Periodic, 1,
+                                               CAEnums::Moore, CAEnums::Parity, 3);
+    assert((CA.step([](int, int, int &new_cell_state)
+                    { new_cell_state = 0; }) == 0));
+    assert((copy_grid(CA) == expected));
+    print_success("test_lambda_rules");
+}
+
+/**
+ * @brief Tests that every compiled StencilKernel gathers the stencil's neighbors in order
+ * and that custom rules match view rules for radii with and without a compiled kernel.
+ */
+void test_stencil_kernels()
+{
+    check_stencil_kernel<StencilKernel<1, 1, CAEnums::Moore>>({17}, 1, CAEnums::Moore);
+    check_stencil_kernel<StencilKernel<1, 2, CAEnums::Moore>>({17}, 2, CAEnums::VonNeumann);
+    check_stencil_kernel<StencilKernel<2, 1, CAEnums::Moore>>({7, 9}, 1, CAEnums::Moore);
+    check_stencil_kernel<StencilKernel<2, 1, CAEnums::VonNeumann>>({7, 9}, 1, CAEnums::VonNeumann);
+    check_stencil_kernel<StencilKernel<2, 2, CAEnums::Moore>>({7, 9}, 2, CAEnums::Moore);
+    check_stencil_kernel<StencilKernel<2, 2, CAEnums::VonNeumann>>({7, 9}, 2, CAEnums::VonNeumann);
+    check_stencil_kernel<StencilKernel<3, 1, CAEnums::Moore>>({5, 6, 7}, 1, CAEnums::Moore);
+    check_stencil_kernel<StencilKernel<3, 1, CAEnums::VonNeumann>>({5, 6, 7}, 1, CAEnums::VonNeumann);
+    check_stencil_kernel<StencilKernel<3, 2, CAEnums::Moore>>({5, 6, 7}, 2, CAEnums::Moore);
+    check_stencil_kernel<StencilKernel<3, 2, CAEnums::VonNeumann>>({5, 6, 7}, 2, CAEnums::VonNeumann);
+    check_stencil_kernel<StencilKernel<3, 3, CAEnums::VonNeumann>>({7, 8, 9}, 3, CAEnums::VonNeumann);
+
+    std::vector<std::vector<int>> all_dims = {{23}, {11, 13}, {9, 8, 10}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (int radius : {1, 3})
+        {
+            for (auto bt : boundaries)
+            {
+                for (auto nt : neighborhoods)
+                {
+                    CellularAutomata<int> CA_copy = CellularAutomata<int>();
+                    CA_copy.setup_cell_states(3);
+                    setup_random_grid(CA_copy, dims);
+                    assert((CA_copy.setup_boundary(bt, radius) == 0));
+                    CA_copy.setup_neighborhood(nt);
+                    CA_copy.setup_rule(CAEnums::Custom);
+
+                    CellularAutomata<int> CA_view = CellularAutomata<int>();
+                    CA_view.setup_cell_states(3);
+                    setup_random_grid(CA_view, dims);
+                    assert((CA_view.setup_boundary(bt, radius) == 0));
+                    CA_view.setup_neighborhood(nt);
+                    CA_view.setup_rule(CAEnums::Custom);
+                    std::vector<int> initial = copy_grid(CA_copy);
+                    std::copy(initial.begin(), initial.end(), CA_view.get_view().data());
+
+                    for (int step = 0; step < 2; step++)
+                    {
+                        assert((CA_copy.step(weighted_sum_rule) == 0));
+                        assert((CA_view.step(weighted_sum_view_rule) == 0));
+                        assert((copy_grid(CA_copy) == copy_grid(CA_view)));
+                    }
+                }
+            }
+        }
+    }
+    print_success("test_stencil_kernels");
+}
+
+/**
+ * @brief Tests that steps of a rule materialized by setup_rule_table match steps calling the rule,
+ * that the table follows neighborhood changes and that invalid tables and states are reported.
+ */
+void test_rule_table()
+{
+    std::vector<std::vector<int>> all_dims = {{23}, {11, 13}, {9, 8, 10}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            for (auto nt : neighborhoods)
+            {
+                if (dims.size() == 3 && nt == CAEnums::Moore)
+                {
+                    continue; // 3 ^ 27 configurations
+                }
+                CellularAutomata<int> CA_rule = CellularAutomata<int>();
+                CA_rule.setup_cell_states(3);
+                setup_random_grid(CA_rule, dims);
+                assert((CA_rule.setup_boundary(bt, 1) == 0));
+                CA_rule.setup_neighborhood(nt);
+                CA_rule.setup_rule(CAEnums::Custom);
+
+                CellularAutomata<int> CA_table = CellularAutomata<int>();
+                CA_table.setup_cell_states(3);
+                setup_random_grid(CA_table, dims);
+                assert((CA_table.setup_boundary(bt, 1) == 0));
+                CA_table.setup_neighborhood(nt);
+                CA_table.setup_rule(CAEnums::Custom);
+                assert((CA_table.setup_rule_table(weighted_sum_rule, 3) == 0));
+                std::vector<int> initial = copy_grid(CA_rule);
+                std::copy(initial.begin(), initial.end(), CA_table.get_view().data());
+
+                for (int step = 0; step < 3; step++)
+                {
+                    assert((CA_rule.step(weighted_sum_rule) == 0));
+                    assert((step % 2 == 0 ? CA_table.step() : CA_table.step(weighted_sum_rule)) == 0);
+                    assert((copy_grid(CA_rule) == copy_grid(CA_table)));
+                }
+            }
+        }
+    }
+
+    // table set up before the grid and rebuilt when the neighborhood changes
+    CellularAutomata<int> CA_rule = CellularAutomata<int>();
+    CA_rule.setup_cell_states(3);
+    CA_rule.setup_rule(CAEnums::Custom);
+    CellularAutomata<int> CA_table = CellularAutomata<int>();
+    CA_table.setup_cell_states(3);
+    CA_table.setup_rule(CAEnums::Custom);
+    assert((CA_table.setup_rule_table(weighted_sum_rule, 3) == 0));
+    setup_random_grid(CA_rule, {12, 14});
+    setup_random_grid(CA_table, {12, 14});
+    std::vector<int> initial = copy_grid(CA_rule);
+    std::copy(initial.begin(), initial.end(), CA_table.get_view().data());
+    assert((CA_rule.step(weighted_sum_rule) == 0));
+    assert((CA_table.step() == 0));
+    assert((copy_grid(CA_rule) == copy_grid(CA_table)));
+    CA_rule.setup_neighborhood(CAEnums::VonNeumann);
+    CA_table.setup_neighborhood(CAEnums::VonNeumann);
+    assert((CA_rule.setup_boundary(CAEnums::Periodic, 2) == 0));
+    assert((CA_table.setup_boundary(CAEnums::Periodic, 2) == 0));
+    assert((CA_rule.step(weighted_sum_rule) == 0));
+    assert((CA_table.step() == 0));
+    assert((copy_grid(CA_rule) == copy_grid(CA_table)));
+
+    // other rules are still called
+    assert((CA_rule.step(larger_than_life_array_rule) == 0));
+    assert((CA_table.step(larger_than_life_array_rule) == 0));
+    assert((copy_grid(CA_rule) == copy_grid(CA_table)));
+
+    // states outside the table
+    CA_table.get_view().data()[0] = 3;
+    assert((CA_table.step() == CAEnums::InvalidCellState));
+
+    // 2 ^ 27 configurations
+    CellularAutomata<int> CA_3d = CellularAutomata<int>();
+    setup_random_grid(CA_3d, {5, 6, 7});
+    CA_3d.setup_rule(CAEnums::Custom);
+    assert((CA_3d.setup_rule_table(weighted_sum_rule, 1) == CAEnums::InvalidNumStates));
+    assert((CA_3d.setup_rule_table(weighted_sum_rule, 2) == CAEnums::RuleTableTooLarge));
+    assert((CA_3d.step() == CAEnums::CustomRuleIsNull));
+    CA_3d.setup_neighborhood(CAEnums::VonNeumann);
+    assert((CA_3d.setup_rule_table(weighted_sum_rule, 2) == 0));
+    assert((CA_3d.step() == 0));
+    assert((CA_3d.setup_rule_table(nullptr, 0) == 0));
+    assert((CA_3d.step() == CAEnums::CustomRuleIsNull));
+    print_success("test_rule_table");
+}
+
+/**
+ * @brief Tests that steps don't depend on the shape of the tiles they are split into,
+ * including grids whose first axis is shorter than a tile.
+ */
+void test_tiled_steps()
+{
+    std::vector<std::vector<int>> all_dims = {{45}, {2, 40}, {3, 37}, {19, 23}, {2, 9, 31}, {7, 6, 9}};
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    int tile_shapes[4][2] = {{1, 1}, {3, 5}, {2, 64}, {1000, 1000}};
+    for (const auto &dims : all_dims)
+    {
+        for (auto bt : boundaries)
+        {
+            CellularAutomata<int> CA_default = CellularAutomata<int>();
+            CA_default.setup_cell_states(3);
+            setup_random_grid(CA_default, dims);
+            assert((CA_default.setup_boundary(bt, 1) == 0));
+            CA_default.setup_rule(CAEnums::Custom);
+            std::vector<int> initial = copy_grid(CA_default);
+
+            for (auto shape : tile_shapes)
+            {
+                CellularAutomata<int> CA_tiled = CellularAutomata<int>();
+                CA_tiled.setup_cell_states(3);
+                setup_random_grid(CA_tiled, dims);
+                assert((CA_tiled.setup_boundary(bt, 1) == 0));
+                CA_tiled.setup_rule(CAEnums::Custom);
+                assert((CA_tiled.setup_tiles(shape[0], shape[1]) == 0));
+                std::copy(initial.begin(), initial.end(), CA_tiled.get_view().data());
+
+                CellularAutomata<int> CA_reference = CellularAutomata<int>();
+                CA_reference.setup_cell_states(3);
+                setup_random_grid(CA_reference, dims);
+                assert((CA_reference.setup_boundary(bt, 1) == 0));
+                CA_reference.setup_rule(CAEnums::Custom);
+                std::copy(initial.begin(), initial.end(), CA_reference.get_view().data());
+
+                for (int step = 0; step < 2; step++)
+                {
+                    assert((CA_reference.step(weighted_sum_rule) == 0));
+                    assert((CA_tiled.step(weighted_sum_rule) == 0));
+                    assert((copy_grid(CA_reference) == copy_grid(CA_tiled)));
+                }
+
+                // built-in rules
+                CA_tiled.setup_rule(CAEnums::Majority);
+                std::vector<int> expected = reference_step(copy_grid(CA_tiled), dims, dims.size(), bt, 1,
+                                                           CAEnums::Moore, CAEnums::Majority, 3);
+                assert((CA_tiled.step() == 0));
+                assert((copy_grid(CA_tiled) == expected));
+            }
+        }
+    }
+
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_tiles(0, 8) == CAEnums::InvalidTileSize));
+    assert((CA.setup_tiles(8, 0) == CAEnums::InvalidTileSize));
+    print_success("test_tiled_steps");
+}
+
+/**
+ * @brief Tests that the tile scheduler splits the tiles by cost, lets threads steal the
+ * tiles left to other threads, runs every tile once and stops at the first error.
+ */
+void test_tile_scheduler()
+{
+    TileScheduler scheduler;
+    long tile;
+
+    // uniform estimate for new tiles: 10 tiles over 3 threads
+    assert((scheduler.plan(10, 3) == 0));
+    std::vector<long> taken;
+    while (scheduler.next_tile(0, tile))
+    {
+        taken.push_back(tile);
+    }
+    // thread 0 runs its own range then steals from the back of the others'
+    assert((taken.size() == 10));
+    assert((taken[0] == 0 && taken[1] == 1 && taken[2] == 2));
+    std::sort(taken.begin(), taken.end());
+    for (long n = 0; n < 10; n++)
+    {
+        assert((taken[n] == n));
+    }
+    assert((!scheduler.next_tile(1, tile) && !scheduler.next_tile(2, tile)));
+
+    // the expensive first tile is left alone in thread 0's range
+    scheduler.tile_costs = {8, 1, 1, 1, 1, 1, 1, 1, 1};
+    assert((scheduler.plan(9, 2) == 0));
+    assert((scheduler.next_tile(1, tile) && tile == 1));
+    assert((scheduler.next_tile(0, tile) && tile == 0));
+    assert((scheduler.next_tile(0, tile) && tile == 8));
+
+    // every tile runs once and records its cost
+    std::vector<int> runs(50, 0);
+    auto count_runs = [&runs](long tile) -> int
+    {
+        runs[tile]++;
+        return 0;
+    };
+    assert((scheduler.plan(50, 4) == 0));
+    assert((scheduler.tile_costs.size() == 50));
+    assert((scheduler.run(count_runs) == 0));
+    assert((std::count(runs.begin(), runs.end(), 1) == 50));
+
+    // Static and Dynamic shares ignore the costs; only Dynamic steals
+    scheduler.tile_costs = {8, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+    assert((scheduler.plan(10, 2, CAEnums::Static) == 0));
+    for (long n = 0; n < 5; n++)
+    {
+        assert((scheduler.next_tile(0, tile) && tile == n));
+    }
+    assert((!scheduler.next_tile(0, tile)));
+    assert((scheduler.next_tile(1, tile) && tile == 5));
+    assert((scheduler.plan(10, 2, CAEnums::Dynamic) == 0));
+    for (long n = 0; n < 5; n++)
+    {
+        assert((scheduler.next_tile(0, tile) && tile == n));
+    }
+    assert((scheduler.next_tile(0, tile) && tile == 9));
+
+    // the first error stops the step
+    auto fail = [](long tile) -> int
+    {
+        return tile == 3 ? CAEnums::CellsAreNull : 0;
+    };
+    assert((scheduler.plan(50, 1) == 0));
+    assert((scheduler.run(fail) == CAEnums::CellsAreNull));
+    assert((scheduler.next_tile(0, tile) && tile == 4));
+    print_success("test_tile_scheduler");
+}
+
+/**
+ * @brief Tests the runtime thread count and schedule settings: their validation, their
+ * environment variable defaults, and that steps don't depend on them.
+ */
+void test_runtime_concurrency()
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.num_threads == 0 && CA.schedule == CAEnums::Balanced));
+    assert((CA.setup_threads(-1) == CAEnums::InvalidNumThreads));
+    assert((CA.setup_threads(3) == 0 && CA.num_threads == 3));
+    assert((CA.setup_schedule(CAEnums::Static) == 0 && CA.schedule == CAEnums::Static));
+
+    setenv("CA_NUM_THREADS", "2", 1);
+    setenv("CA_SCHEDULE", "dynamic", 1);
+    CellularAutomata<int> CA_env = CellularAutomata<int>();
+    assert((CA_env.num_threads == 2 && CA_env.schedule == CAEnums::Dynamic));
+    setenv("CA_NUM_THREADS", "none", 1);
+    setenv("CA_SCHEDULE", "unknown", 1);
+    CellularAutomata<int> CA_invalid_env = CellularAutomata<int>();
+    assert((CA_invalid_env.num_threads == 0 && CA_invalid_env.schedule == CAEnums::Balanced));
+    unsetenv("CA_NUM_THREADS");
+    unsetenv("CA_SCHEDULE");
+
+    std::vector<int> dims = {21, 34};
+    CAEnums::Schedule schedules[3] = {CAEnums::Static, CAEnums::Dynamic, CAEnums::Balanced};
+    CellularAutomata<int> CA_reference = CellularAutomata<int>();
+    CA_reference.setup_cell_states(3);
+    setup_random_grid(CA_reference, dims);
+    CA_reference.setup_rule(CAEnums::Custom);
+    std::vector<int> initial = copy_grid(CA_reference);
+    std::vector<std::vector<int>> expected;
+    for (int step = 0; step < 3; step++)
+    {
+        assert((CA_reference.step(weighted_sum_rule) == 0));
+        expected.push_back(copy_grid(CA_reference));
+    }
+    for (auto schedule : schedules)
+    {
+        for (int threads : {1, 4})
+        {
+            CellularAutomata<int> CA_step = CellularAutomata<int>();
+            CA_step.setup_cell_states(3);
+            setup_random_grid(CA_step, dims);
+            CA_step.setup_rule(CAEnums::Custom);
+            assert((CA_step.setup_tiles(2, 8) == 0));
+            assert((CA_step.setup_threads(threads) == 0));
+            assert((CA_step.setup_schedule(schedule) == 0));
+            std::copy(initial.begin(), initial.end(), CA_step.get_view().data());
+            for (int step = 0; step < 3; step++)
+            {
+                assert((CA_step.step(weighted_sum_rule) == 0));
+                assert((copy_grid(CA_step) == expected[step]));
+            }
+        }
+    }
+    print_success("test_runtime_concurrency");
+}
+
+/**
+ * @brief Tests that grids constructed by the step threads (first touch) start empty and that
+ * pinning the step threads to CPU sockets doesn't change the steps.
+ *
+ */
+void test_first_touch_and_pinning()
+{
+    std::vector<std::vector<int>> sockets;
+    int num_sockets = get_cpu_sockets(sockets);
+    assert((num_sockets == (int)sockets.size()));
+    for (const auto &socket : sockets)
+    {
+        assert((!socket.empty()));
+    }
+
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.pin_threads == false));
+    assert((CA.setup_thread_pinning(true) == 0 && CA.pin_threads == true));
+    setenv("CA_PIN_THREADS", "1", 1);
+    CellularAutomata<int> CA_env = CellularAutomata<int>();
+    assert((CA_env.pin_threads == true));
+    unsetenv("CA_PIN_THREADS");
+
+    std::vector<std::vector<int>> grid_dims = {{97}, {21, 34}, {7, 9, 40}};
+    for (const auto &dims : grid_dims)
+    {
+        for (int threads : {1, 3, 4})
+        {
+            CellularAutomata<int> CA_empty = CellularAutomata<int>();
+            assert((CA_empty.setup_tiles(2, 8) == 0));
+            assert((CA_empty.setup_threads(threads) == 0));
+            CA_empty.setup_cell_states(3);
+            assert((CA_empty.setup_boundary(CAEnums::Walled, 1) == 0));
+            switch (dims.size())
+            {
+            case 1:
+                assert((CA_empty.setup_dimensions_1d(dims[0]) == 0));
+                break;
+            case 2:
+                assert((CA_empty.setup_dimensions_2d(dims[0], dims[1]) == 0));
+                break;
+            case 3:
+                assert((CA_empty.setup_dimensions_3d(dims[0], dims[1], dims[2]) == 0));
+                break;
+            }
+            std::vector<int> grid = copy_grid(CA_empty);
+            assert((std::count(grid.begin(), grid.end(), 0) == (long)grid.size()));
+        }
+
+        CellularAutomata<int> CA_reference = CellularAutomata<int>();
+        CA_reference.setup_cell_states(3);
+        setup_random_grid(CA_reference, dims);
+        CA_reference.setup_rule(CAEnums::Custom);
+        std::vector<int> initial = copy_grid(CA_reference);
+        std::vector<std::vector<int>> expected;
+        for (int step = 0; step < 3; step++)
+        {
+            assert((CA_reference.step(weighted_sum_rule) == 0));
+            expected.push_back(copy_grid(CA_reference));
+        }
+        CellularAutomata<int> CA_pinned = CellularAutomata<int>();
+        assert((CA_pinned.setup_thread_pinning(true) == 0));
+        assert((CA_pinned.setup_schedule(CAEnums::Static) == 0));
+        assert((CA_pinned.setup_tiles(2, 8) == 0));
+        CA_pinned.setup_cell_states(3);
+        setup_random_grid(CA_pinned, dims);
+        CA_pinned.setup_rule(CAEnums::Custom);
+        std::copy(initial.begin(), initial.end(), CA_pinned.get_view().data());
+        for (int step = 0; step < 3; step++)
+        {
+            assert((CA_pinned.step(weighted_sum_rule) == 0));
+            assert((copy_grid(CA_pinned) == expected[step]));
+        }
+    }
+    print_success("test_first_touch_and_pinning");
+}
+
+/**
+ * @brief Tests that errors are reported by the threads once their tiles are done: every thread
+ * count returns an error code of a failing tile, and steps failing validation leave the grid untouched.
+ */
+void test_parallel_error_codes()
+{
+    TileScheduler scheduler;
+    auto fail_all = [](long tile) -> int
+    {
+        return tile % 2 == 0 ? CAEnums::CellsAreNull : CAEnums::RadiusLargerThanDimensions;
+    };
+    auto fail_one = [](long tile) -> int
+    {
+        return tile == 37 ? CAEnums::InvalidTileSize : 0;
+    };
+    auto succeed = [](long) -> int
+    {
+        return 0;
+    };
+    CAEnums::Schedule schedules[3] = {CAEnums::Static, CAEnums::Dynamic, CAEnums::Balanced};
+    for (auto schedule : schedules)
+    {
+        for (int threads : {1, 2, 4})
+        {
+            assert((scheduler.plan(64, threads, schedule) == 0));
+            int error_code = scheduler.run(fail_all);
+            assert((error_code == CAEnums::CellsAreNull || error_code == CAEnums::RadiusLargerThanDimensions));
+            assert((scheduler.plan(64, threads, schedule) == 0));
+            assert((scheduler.run(fail_one) == CAEnums::InvalidTileSize));
+            assert((scheduler.plan(64, threads, schedule) == 0));
+            assert((scheduler.run(succeed) == 0));
+        }
+    }
+
+    for (int threads : {1, 4})
+    {
+        CellularAutomata<int> CA = CellularAutomata<int>();
+        assert((CA.setup_threads(threads) == 0));
+        CA.setup_cell_states(3);
+        setup_random_grid(CA, {21, 34});
+        CA.setup_rule(CAEnums::Custom);
+        assert((CA.setup_rule_table(weighted_sum_rule, 3) == 0));
+        CA.get_view().data()[21 * 34 - 1] = 5;
+        std::vector<int> grid = copy_grid(CA);
+        assert((CA.step() == CAEnums::InvalidCellState));
+        assert((copy_grid(CA) == grid));
+    }
+    print_success("test_parallel_error_codes");
+}
+
+/**
+ * @brief Reads the log file (empty if there is none).
+ *
+ * @return std::string
+ */
+std::string read_log()
+{
+    std::ifstream file(FILE_PATH);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+/**
+ * @brief Runs step_n(num_steps) and num_steps steps on copies of a random grid and compares the grids
+ * (and the logs when the log file can be written).
+ *
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param num_steps number of steps
+ * @param step_once steps a CellularAutomata instance once
+ * @param step_many steps a CellularAutomata instance num_steps times with step_n
+ */
+template <typename StepOnce, typename StepMany>
+void check_step_n_matches_steps(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                CAEnums::Neighborhood nt, int num_steps, StepOnce step_once, StepMany step_many)
+{
+    CellularAutomata<int> CA_step = CellularAutomata<int>();
+    CellularAutomata<int> CA_step_n = CellularAutomata<int>();
+    make_ca_pair(dims, bt, radius, nt, CAEnums::Custom, CA_step, CA_step_n);
+    std::string header = read_log();
+    for (int step = 0; step < num_steps; step++)
+    {
+        assert((step_once(CA_step) == 0));
+    }
+    std::string step_log = read_log();
+
+    // both instances append to the same log file
+    assert((step_many(CA_step_n, num_steps) == 0));
+    assert((copy_grid(CA_step_n) == copy_grid(CA_step)));
+    assert((read_log() == step_log + step_log.substr(header.size())));
+}
+
+/**
+ * @brief Runs step_n(num_steps) and num_steps calls to step() of a built-in rule on copies of a random grid
+ * and compares the grids (and the logs when the log file can be written).
+ *
+ * @tparam T cell type (int, uint8_t or uint16_t)
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule Parity or Majority
+ * @param num_states number of cell states
+ * @param num_steps number of steps
+ * @param threads number of step threads
+ */
+template <typename T>
+void check_builtin_step_n_matches_steps(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                        CAEnums::Neighborhood nt, CAEnums::Rule rule, int num_states,
+                                        int num_steps, int threads = 1)
+{
+    CellularAutomata<T> CA_step = CellularAutomata<T>();
+    CellularAutomata<T> CA_step_n = CellularAutomata<T>();
+    for (CellularAutomata<T> *CA : {&CA_step, &CA_step_n})
+    {
+        CA->setup_cell_states(num_states);
+        setup_random_grid(*CA, dims);
+        assert((CA->setup_boundary(bt, radius) == 0));
+        CA->setup_neighborhood(nt);
+        CA->setup_rule(rule);
+        assert((CA->setup_threads(threads) == 0));
+    }
+    std::vector<int> initial = copy_grid(CA_step);
+    std::copy(initial.begin(), initial.end(), CA_step_n.get_view().data());
+    std::string header = read_log();
+    for (int step = 0; step < num_steps; step++)
+    {
+        assert((CA_step.step() == 0));
+    }
+    std::string step_log = read_log();
+
+    // both instances append to the same log file
+    assert((CA_step_n.step_n(num_steps) == 0));
+    assert((copy_grid(CA_step_n) == copy_grid(CA_step)));
+    assert((read_log() == step_log + step_log.substr(header.size())));
+}
+
+/**
+ * @brief Tests that step_n gives the cells and log of as many steps, with temporal blocking
+ * (several blocks, every boundary, radius and neighborhood type, function pointers, lambdas and
+ * rule tables, Parity and Majority on int and narrow cells) and with rules moving cells, which run one
+ * step at a time.
+ */
+void test_step_n()
+{
+    auto pointer_once = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_rule); };
+    auto pointer_many = [](CellularAutomata<int> &CA, int num_steps)
+    { return CA.step_n(num_steps, weighted_sum_rule); };
+    int weight_shift = 2;
+    auto lambda_rule = [weight_shift](int *cell_index, const int, int *neighborhood_cells,
+                                      const int neighborhood_size, int &new_cell_state)
+    {
+        int sum = 0;
+        for (int n = 0; n < neighborhood_size; n++)
+        {
+            sum += (n + weight_shift) * neighborhood_cells[n];
+        }
+        new_cell_state = (sum + cell_index[0]) % 3;
+    };
+    auto lambda_once = [&lambda_rule](CellularAutomata<int> &CA)
+    { return CA.step(lambda_rule); };
+    auto lambda_many = [&lambda_rule](CellularAutomata<int> &CA, int num_steps)
+    { return CA.step_n(num_steps, lambda_rule); };
+
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{70}, {21, 34}, {9, 11, 13}})
+        {
+            for (int radius : {1, 2})
+            {
+                for (auto nt : neighborhoods)
+                {
+                    for (int num_steps : {2, 3, 5})
+                    {
+                        check_step_n_matches_steps(dims, bt, radius, nt, num_steps, pointer_once, pointer_many);
+                    }
+                }
+            }
+            check_step_n_matches_steps(dims, bt, 1, CAEnums::Moore, 4, lambda_once, lambda_many);
+        }
+        // grids of several blocks along every axis
+        for (const auto &dims : std::vector<std::vector<int>>{{140000}, {300, 1100}, {70, 40, 300}})
+        {
+            for (int threads : {1, 4})
+            {
+                auto pointer_threads = [threads](CellularAutomata<int> &CA, int num_steps)
+                {
+                    assert((CA.setup_threads(threads) == 0));
+                    return CA.step_n(num_steps, weighted_sum_rule);
+                };
+                check_step_n_matches_steps(dims, bt, 1, CAEnums::Moore, 3, pointer_once, pointer_threads);
+            }
+        }
+    }
+
+    // built-in rules
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{70}, {21, 34}, {9, 11, 13}})
+        {
+            for (int radius : {1, 2})
+            {
+                for (auto nt : neighborhoods)
+                {
+                    check_builtin_step_n_matches_steps<int>(dims, bt, radius, nt, CAEnums::Parity, 3, 3);
+                    check_builtin_step_n_matches_steps<int>(dims, bt, radius, nt, CAEnums::Majority, 3, 3);
+                }
+            }
+            check_builtin_step_n_matches_steps<uint8_t>(dims, bt, 1, CAEnums::Moore, CAEnums::Parity, 5, 4);
+            check_builtin_step_n_matches_steps<uint8_t>(dims, bt, 1, CAEnums::VonNeumann, CAEnums::Majority, 4, 2);
+            check_builtin_step_n_matches_steps<uint16_t>(dims, bt, 1, CAEnums::Moore, CAEnums::Majority, 70, 3);
+        }
+        for (int threads : {1, 4})
+        {
+            check_builtin_step_n_matches_steps<int>({300, 1100}, bt, 1, CAEnums::Moore, CAEnums::Parity, 3, 5, threads);
+            check_builtin_step_n_matches_steps<int>({70, 40, 300}, bt, 1, CAEnums::Moore, CAEnums::Majority, 3, 3, threads);
+        }
+    }
+
+    // rule tables
+    for (auto bt : boundaries)
+    {
+        CellularAutomata<int> CA_rule = CellularAutomata<int>();
+        CA_rule.setup_cell_states(3);
+        setup_random_grid(CA_rule, {40, 70});
+        assert((CA_rule.setup_boundary(bt, 1) == 0));
+        CA_rule.setup_rule(CAEnums::Custom);
+        CellularAutomata<int> CA_table = CellularAutomata<int>();
+        CA_table.setup_cell_states(3);
+        setup_random_grid(CA_table, {40, 70});
+        assert((CA_table.setup_boundary(bt, 1) == 0));
+        CA_table.setup_rule(CAEnums::Custom);
+        std::vector<int> initial = copy_grid(CA_rule);
+        std::copy(initial.begin(), initial.end(), CA_table.get_view().data());
+        assert((CA_table.setup_rule_table(weighted_sum_rule, 3) == 0));
+        for (int step = 0; step < 4; step++)
+        {
+            assert((CA_rule.step(weighted_sum_rule) == 0));
+        }
+        assert((CA_table.step_n(4) == 0));
+        assert((copy_grid(CA_rule) == copy_grid(CA_table)));
+    }
+
+    // moving cells
+    auto shift_once = [](CellularAutomata<int> &CA)
+    { return CA.step(shift_right_rule); };
+    auto shift_many = [](CellularAutomata<int> &CA, int num_steps)
+    { return CA.step_n(num_steps, shift_right_rule); };
+    check_step_n_matches_steps({12, SHIFT_AXIS_DIM}, CAEnums::Periodic, 1, CAEnums::Moore, 3, shift_once, shift_many);
+
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CA.setup_cell_states(3);
+    setup_random_grid(CA, {21, 34});
+    CA.setup_rule(CAEnums::Custom);
+    std::vector<int> grid = copy_grid(CA);
+    assert((CA.step_n(-1, weighted_sum_rule) == CAEnums::InvalidNumSteps));
+    assert((CA.step_n(0, weighted_sum_rule) == 0));
+    assert((copy_grid(CA) == grid));
+    assert((CA.step_n(2) == CAEnums::CustomRuleIsNull));
+    print_success("test_step_n");
+}
+
+/**
+ * @brief Steps a double buffered CellularAutomata instance and one updating its cells in place
+ * from the same random grid and compares the grids after every step.
+ *
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param threads number of threads of the in place instance
+ * @param ghost_cells pad the in place grid with ghost layers
+ * @param step steps a CellularAutomata instance once
+ */
+template <typename Step>
+void check_in_place_matches_steps(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                  CAEnums::Neighborhood nt, CAEnums::Rule rule, int threads, bool ghost_cells,
+                                  Step step)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CellularAutomata<int> CA_in_place = CellularAutomata<int>();
+    make_ca_pair(dims, bt, radius, nt, rule, CA, CA_in_place);
+    assert((CA_in_place.setup_in_place(true) == 0));
+    assert((CA_in_place.setup_ghost_cells(ghost_cells) == 0));
+    assert((CA_in_place.setup_threads(threads) == 0));
+    for (int n = 0; n < 3; n++)
+    {
+        assert((step(CA) == 0));
+        assert((step(CA_in_place) == 0));
+        assert((copy_grid(CA_in_place) == copy_grid(CA)));
+    }
+}
+
+/**
+ * @brief Tests that updating the cells in place gives the cells of double buffered steps
+ * (every rank, boundary, radius and neighborhood type, one and several threads, array, view and
+ * totalistic rules, Parity, Majority, rule tables and step_n), that the grid has no next state and
+ * that rules moving cells are reported.
+ */
+void test_in_place_steps()
+{
+    auto array_step = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_rule); };
+    auto view_step = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_view_rule); };
+    auto totalistic_step = [](CellularAutomata<int> &CA)
+    { return CA.step(larger_than_life_rule); };
+    auto lambda_step = [](CellularAutomata<int> &CA)
+    {
+        return CA.step([](int *cell_index, const int, int *neighborhood_cells,
+                          const int neighborhood_size, int &new_cell_state)
+                       { new_cell_state = (neighborhood_size + neighborhood_cells[0] + cell_index[0]) % 3; });
+    };
+    auto rule_step = [](CellularAutomata<int> &CA)
+    { return CA.step(); };
+
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{31}, {9, 12}, {6, 7, 8}})
+        {
+            for (int radius : {1, 2})
+            {
+                for (auto nt : neighborhoods)
+                {
+                    for (int threads : {1, 4})
+                    {
+                        check_in_place_matches_steps(dims, bt, radius, nt, CAEnums::Custom, threads, false, array_step);
+                        check_in_place_matches_steps(dims, bt, radius, nt, CAEnums::Custom, threads, true, view_step);
+                        check_in_place_matches_steps(dims, bt, radius, nt, CAEnums::Custom, threads, false, totalistic_step);
+                        check_in_place_matches_steps(dims, bt, radius, nt, CAEnums::Parity, threads, true, rule_step);
+                        check_in_place_matches_steps(dims, bt, radius, nt, CAEnums::Majority, threads, false, rule_step);
+                    }
+                }
+            }
+            check_in_place_matches_steps(dims, bt, 1, CAEnums::Moore, CAEnums::Custom, 3, true, lambda_step);
+        }
+    }
+
+    // rule tables and step_n
+    auto table_step = [](CellularAutomata<int> &CA)
+    {
+        assert((CA.setup_rule_table(weighted_sum_rule, 3) == 0));
+        return CA.step();
+    };
+    auto step_n = [](CellularAutomata<int> &CA)
+    { return CA.step_n(3, weighted_sum_rule); };
+    check_in_place_matches_steps({40, 70}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, 4, false, table_step);
+    check_in_place_matches_steps({12, 9, 10}, CAEnums::CutOff, 1, CAEnums::Moore, CAEnums::Custom, 4, false, step_n);
+
+    // no next state buffer; toggling the mode keeps the cells
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_in_place(true) == 0));
+    assert((CA.setup_dimensions_3d(4, 5, 6, 1) == 0));
+    assert((CA.get_next_tensor() == nullptr && CA.get_next_view().rank() == 0));
+    assert((copy_grid(CA) == std::vector<int>(4 * 5 * 6, 1)));
+    CA.get_tensor()[1][2][3] = 2;
+    std::vector<int> grid = copy_grid(CA);
+    assert((CA.setup_in_place(false) == 0));
+    assert((CA.get_next_tensor() != nullptr && copy_grid(CA) == grid));
+    assert((CA.setup_in_place(true) == 0));
+    assert((CA.get_next_tensor() == nullptr && copy_grid(CA) == grid));
+
+    // rules can't move cells in place
+    CellularAutomata<int> CA_shift = CellularAutomata<int>();
+    CA_shift.setup_cell_states(3);
+    setup_random_grid(CA_shift, {12, SHIFT_AXIS_DIM});
+    CA_shift.setup_rule(CAEnums::Custom);
+    assert((CA_shift.setup_in_place(true) == 0));
+    grid = copy_grid(CA_shift);
+    assert((CA_shift.step(shift_right_rule) == CAEnums::InPlaceCellMoved));
+    assert((copy_grid(CA_shift) == grid));
+    print_success("test_in_place_steps");
+}
+
+/**
+ * @brief Steps a CellularAutomata instance with activity tracking and one without from the same
+ * sparse grid (cells near both ends of the first axis) and checks that both produce the same states.
+ *
+ * @tparam Step callable stepping a CellularAutomata instance and returning its error code
+ * @param dims grid dimensions
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param step steps a grid
+ */
+template <typename Step>
+void check_activity_matches_steps(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                  CAEnums::Neighborhood nt, CAEnums::Rule rule, Step step)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CellularAutomata<int> CA_tracked = CellularAutomata<int>();
+    make_ca_pair(dims, bt, radius, nt, rule, CA, CA_tracked);
+    std::vector<int> initial = copy_grid(CA);
+    long num_cells = initial.size();
+    for (long n = 0; n < num_cells; n++)
+    {
+        if (n % 7 != 0 || (n > num_cells / 5 && n < num_cells * 9 / 10))
+        {
+            initial[n] = 0;
+        }
+    }
+    std::copy(initial.begin(), initial.end(), CA.get_view().data());
+    std::copy(initial.begin(), initial.end(), CA_tracked.get_view().data());
+    assert((CA_tracked.setup_tiles(2, 3) == 0)); // many small tiles
+    assert((CA_tracked.setup_activity_tracking(true) == 0));
+    for (int n = 0; n < 6; n++)
+    {
+        assert((step(CA) == 0));
+        assert((step(CA_tracked) == 0));
+        assert((copy_grid(CA_tracked) == copy_grid(CA)));
+    }
+}
+
+/**
+ * @brief Tests that activity tracking gives the cells of full steps (every rank, boundary, radius and
+ * neighborhood type with array, view and totalistic rules, Parity, Majority, rule tables, step_n and
+ * rules moving cells) and that only the tiles next to changed cells are recomputed.
+ */
+void test_activity_tracking()
+{
+    auto array_step = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_rule); };
+    auto view_step = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_view_rule); };
+    auto totalistic_step = [](CellularAutomata<int> &CA)
+    { return CA.step(larger_than_life_rule); };
+    auto rule_step = [](CellularAutomata<int> &CA)
+    { return CA.step(); };
+
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{31}, {17, 12}, {7, 8, 9}})
+        {
+            for (int radius : {1, 2})
+            {
+                for (auto nt : neighborhoods)
+                {
+                    check_activity_matches_steps(dims, bt, radius, nt, CAEnums::Custom, array_step);
+                    check_activity_matches_steps(dims, bt, radius, nt, CAEnums::Custom, view_step);
+                    check_activity_matches_steps(dims, bt, radius, nt, CAEnums::Custom, totalistic_step);
+                    check_activity_matches_steps(dims, bt, radius, nt, CAEnums::Parity, rule_step);
+                    check_activity_matches_steps(dims, bt, radius, nt, CAEnums::Majority, rule_step);
+                }
+            }
+        }
+    }
+
+    // rule tables, step_n and rules moving cells
+    auto table_step = [](CellularAutomata<int> &CA)
+    {
+        assert((CA.setup_rule_table(weighted_sum_rule, 3) == 0));
+        return CA.step();
+    };
+    auto step_n = [](CellularAutomata<int> &CA)
+    { return CA.step_n(3, weighted_sum_rule); };
+    auto shift_step = [](CellularAutomata<int> &CA)
+    { return CA.step(shift_right_rule); };
+    check_activity_matches_steps({20, 30}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, table_step);
+    check_activity_matches_steps({12, 9, 10}, CAEnums::CutOff, 1, CAEnums::Moore, CAEnums::Custom, step_n);
+    check_activity_matches_steps({12, SHIFT_AXIS_DIM}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom,
+                                 shift_step);
+
+    // a lone cell dies: every tile, then the tiles around it, then none are recomputed
+    for (auto bt : boundaries)
+    {
+        CellularAutomata<int> CA = CellularAutomata<int>();
+        assert((CA.setup_dimensions_2d(64, 64) == 0));
+        assert((CA.setup_boundary(bt, 1) == 0));
+        CA.setup_rule(CAEnums::Custom);
+        assert((CA.setup_tiles(4, 8) == 0));
+        assert((CA.setup_activity_tracking(true) == 0));
+        CA.get_matrix()[bt == CAEnums::Walled ? 1 : 0][30] = 1; // next to the edge (Walled edges never change)
+        assert((CA.step(larger_than_life_rule) == 0));
+        long num_tiles = CA.get_num_active_tiles();
+        assert((num_tiles == 16 * 8));
+        assert((CA.step(larger_than_life_rule) == 0));
+        long num_active_tiles = CA.get_num_active_tiles();
+        assert((num_active_tiles > 0 && num_active_tiles < num_tiles / 10));
+        assert((CA.step(larger_than_life_rule) == 0));
+        assert((CA.get_num_active_tiles() == 0));
+        assert((copy_grid(CA) == std::vector<int>(64 * 64, 0)));
+
+        // cells changed outside of step are picked up once tracking is reset
+        CA.get_matrix()[40][40] = 1;
+        assert((CA.setup_activity_tracking(true) == 0));
+        assert((CA.step(larger_than_life_rule) == 0));
+        assert((CA.get_num_active_tiles() == num_tiles && CA.get_matrix()[40][40] == 0));
+    }
+
+    // changing the number of states of a settled grid recomputes every tile
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_dimensions_2d(64, 64) == 0));
+    assert((CA.setup_boundary(CAEnums::Periodic, 1) == 0));
+    assert((CA.setup_neighborhood(CAEnums::Moore) == 0));
+    assert((CA.setup_cell_states(2) == 0));
+    assert((CA.setup_rule(CAEnums::Parity) == 0));
+    assert((CA.setup_tiles(4, 8) == 0));
+    assert((CA.setup_activity_tracking(true) == 0));
+    for (int i = 0; i < 64; i++)
+        for (int j = 0; j < 64; j++)
+            CA.get_matrix()[i][j] = 1;
+    assert((CA.step() == 0));
+    assert((CA.step() == 0));
+    assert((CA.get_num_active_tiles() == 0 && copy_grid(CA) == std::vector<int>(64 * 64, 1)));
+    assert((CA.setup_cell_states(3) == 0));
+    assert((CA.step() == 0));
+    assert((copy_grid(CA) == std::vector<int>(64 * 64, 0)));
+    print_success("test_activity_tracking");
+}
+
+/**
+ * @brief Copies the cells of a grid into a row-major vector through for_each_cell, the cell access
+ * shared by dense and sparse grids.
+ *
+ * @param CA the CellularAutomata instance
+ * @param dims grid dimensions (rank elements)
+ * @return std::vector<int> cell states (row-major)
+ */
+std::vector<int> copy_sparse_grid(CellularAutomata<int> &CA, const std::vector<int> &dims)
+{
+    long num_cells = 1;
+    for (int dim : dims)
+    {
+        num_cells *= dim;
+    }
+    std::vector<int> grid(num_cells, 0);
+    assert((CA.for_each_cell([&grid, &dims](const int *cell_index, int index_size, int &cell)
+                             {
+                                 long position = 0;
+                                 for (int axis = 0; axis < index_size; axis++)
+                                 {
+                                     position = position * dims[axis] + cell_index[axis];
+                                 }
+                                 grid[position] = cell; }) == 0));
+    return grid;
+}
+
+/**
+ * @brief Counts the occupied cells of a grid.
+ *
+ * @param CA the CellularAutomata instance
+ * @return long number of cells that aren't 0
+ */
+long count_occupied_cells(CellularAutomata<int> &CA)
+{
+    long num_occupied = 0;
+    CA.for_each_cell([&num_occupied](const int *, int, int &)
+                     { num_occupied++; });
+    return num_occupied;
+}
+
+/**
+ * @brief Takes one step with the custom rule checked by check_sparse_matches_dense.
+ *
+ * @param CA the CellularAutomata instance
+ * @param rule_kind custom rule applied: 0 array, 1 NeighborhoodView, 2 totalistic, 3 shift, 4 rule table
+ * @return int error code of the step
+ */
+int step_rule_kind(CellularAutomata<int> &CA, int rule_kind)
+{
+    switch (rule_kind)
+    {
+    case 1:
+        return CA.step(weighted_sum_view_rule);
+    case 2:
+        return CA.step(larger_than_life_rule);
+    case 3:
+        return CA.step(shift_right_rule);
+    case 4:
+        return CA.step();
+    default:
+        return CA.step(weighted_sum_rule);
+    }
+}
+
+/**
+ * @brief Steps a sparse and a dense CellularAutomata instance from the same sparse random grid and
+ * compares their cells and the lines they log after every step.
+ *
+ * @param dims grid dimensions (rank elements)
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param rule_kind custom rule applied: 0 array, 1 NeighborhoodView, 2 totalistic, 3 shift (Custom rule type),
+ * 4 weighted_sum_rule materialized by setup_rule_table
+ */
+void check_sparse_matches_dense(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                                CAEnums::Neighborhood nt, CAEnums::Rule rule, int rule_kind)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    make_random_ca(dims, bt, radius, nt, rule, CA);
+    std::vector<int> initial = copy_grid(CA);
+    long num_cells = initial.size();
+    for (long n = 0; n < num_cells; n++)
+    {
+        // a few clusters and lone cells
+        if (n % 5 != 0 || (n > num_cells / 6 && n < num_cells * 3 / 4 && n % 41 != 0))
+        {
+            initial[n] = 0;
+        }
+    }
+    std::copy(initial.begin(), initial.end(), CA.get_view().data());
+    assert((copy_sparse_grid(CA, dims) == initial));
+
+    CellularAutomata<int> CA_sparse = CellularAutomata<int>();
+    assert((CA_sparse.setup_sparse(true) == 0));
+    CA_sparse.setup_cell_states(3);
+    setup_dimensions(CA_sparse, dims);
+    assert((CA_sparse.setup_boundary(bt, radius) == 0));
+    CA_sparse.setup_neighborhood(nt);
+    CA_sparse.setup_rule(rule);
+    if (rule_kind == 4)
+    {
+        assert((CA.setup_rule_table(weighted_sum_rule, 3) == 0));
+        assert((CA_sparse.setup_rule_table(weighted_sum_rule, 3) == 0));
+    }
+    for (long n = 0; n < num_cells; n++)
+    {
+        int cell_index[3] = {0, 0, 0};
+        long remainder = n;
+        for (int axis = dims.size() - 1; axis >= 0; axis--)
+        {
+            cell_index[axis] = remainder % dims[axis];
+            remainder /= dims[axis];
+        }
+        assert((CA_sparse.set_cell(cell_index, initial[n]) == 0));
+    }
+    assert((copy_sparse_grid(CA_sparse, dims) == initial));
+
+    for (int n = 0; n < 5; n++)
+    {
+        std::string log = read_log();
+        assert((step_rule_kind(CA, rule_kind) == 0));
+        std::string dense_log = read_log();
+        assert((step_rule_kind(CA_sparse, rule_kind) == 0));
+        assert((read_log() == dense_log + dense_log.substr(log.size())));
+        assert((copy_sparse_grid(CA_sparse, dims) == copy_grid(CA)));
+    }
+}
+
+/**
+ * @brief Tests that sparse grids give the cells and log lines of dense grids (every rank, boundary, radius
+ * and neighborhood type with array, view and totalistic rules, rule tables, Parity, Majority and rules
+ * moving cells), merge colliding cells with the collision rule, only hold the occupied bricks (a 4096^3
+ * grid), and return the documented error codes.
+ */
+void test_sparse_grid()
+{
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    std::vector<std::vector<int>> grid_dims = {{45}, {17, 20}, {16, 12}, {7, 10, 19}};
+    for (auto bt : boundaries)
+    {
+        for (auto &dims : grid_dims)
+        {
+            for (int radius = 1; radius <= 3; radius += 2)
+            {
+                for (auto nt : neighborhoods)
+                {
+                    for (int rule_kind = 0; rule_kind < 3; rule_kind++)
+                    {
+                        check_sparse_matches_dense(dims, bt, radius, nt, CAEnums::Custom, rule_kind);
+                    }
+                    check_sparse_matches_dense(dims, bt, radius, nt, CAEnums::Parity, 0);
+                    check_sparse_matches_dense(dims, bt, radius, nt, CAEnums::Majority, 0);
+                }
+            }
+        }
+    }
+    check_sparse_matches_dense({12, SHIFT_AXIS_DIM}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, 3);
+    check_sparse_matches_dense({3, 4, SHIFT_AXIS_DIM}, CAEnums::CutOff, 1, CAEnums::VonNeumann, CAEnums::Custom, 3);
+    check_sparse_matches_dense({17, 20}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, 4);
+    check_sparse_matches_dense({7, 10, 19}, CAEnums::Walled, 1, CAEnums::VonNeumann, CAEnums::Custom, 4);
+
+    // cells moved onto the same cell are merged by the collision rule
+    CellularAutomata<int> CA_merge = CellularAutomata<int>();
+    assert((CA_merge.setup_sparse(true) == 0));
+    assert((CA_merge.setup_dimensions_1d(20) == 0));
+    CA_merge.setup_rule(CAEnums::Custom);
+    CA_merge.setup_collision_rule([](int &moved_cell, const int &next_cell)
+                                  { moved_cell += next_cell; });
+    int sources[3][1] = {{2}, {5}, {17}};
+    for (int n = 0; n < 3; n++)
+    {
+        assert((CA_merge.set_cell(sources[n], n + 1) == 0));
+    }
+    assert((CA_merge.step([](int *cell_index, int, int *, int, int &)
+                          { cell_index[0] = 5; }) == 0));
+    std::vector<int> merged(20, 0);
+    merged[5] = 1 + 2 + 3;
+    assert((copy_sparse_grid(CA_merge, {20}) == merged));
+
+    // a 4096^3 grid only holds the bricks around its cells; the cluster wraps around the corner of the grid
+    const int dim = 4096;
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    CellularAutomata<int> CA_dense = CellularAutomata<int>();
+    assert((CA.setup_sparse(true) == 0 && CA.setup_logging(false) == 0));
+    assert((CA.setup_dimensions_3d(dim, dim, dim) == 0));
+    assert((CA_dense.setup_dimensions_3d(32, 32, 32) == 0));
+    CA.setup_rule(CAEnums::Parity);
+    CA_dense.setup_rule(CAEnums::Parity);
+    for (int n = 0; n < 12; n++)
+    {
+        int cell_index[3] = {(dim - 2 + n % 3) % dim, (dim - 1 + n / 3 % 2) % dim, (dim - 1 + n % 5) % dim};
+        assert((CA.set_cell(cell_index, 1) == 0));
+        CA_dense.get_tensor()[(cell_index[0] + 32) % 32][(cell_index[1] + 32) % 32][(cell_index[2] + 32) % 32] = 1;
+    }
+    for (int n = 0; n < 4; n++)
+    {
+        assert((CA.step() == 0 && CA_dense.step() == 0));
+        int num_occupied = 0;
+        CA.for_each_cell([&CA_dense, &num_occupied](const int *cell_index, int index_size, int &cell)
+                         {
+                             assert((index_size == 3 && cell == 1));
+                             assert((CA_dense.get_tensor()[cell_index[0] % 32][cell_index[1] % 32][cell_index[2] % 32] == 1));
+                             num_occupied++; });
+        assert((num_occupied == count_occupied_cells(CA_dense) && CA.get_num_bricks() <= 8 * 8));
+    }
+
+    // random cells, cell access and error codes
+    CellularAutomata<int> CA_random = CellularAutomata<int>();
+    int cell_index[3] = {1, 2, 3};
+    assert((CA_random.setup_sparse(true) == 0));
+    assert((CA_random.step(weighted_sum_rule) == CAEnums::CellsAreNull));
+    assert((CA_random.set_cell(cell_index, 1) == CAEnums::CellsAreNull));
+    assert((CA_random.setup_dimensions_3d(64, 64, 64, 1) == CAEnums::InvalidCellState));
+    assert((CA_random.setup_dimensions_3d(64, 0, 64) == CAEnums::InvalidDimensions));
+    assert((CA_random.setup_dimensions_3d(64, 64, 64) == 0));
+    assert((CA_random.setup_dimensions_2d(64, 64) == CAEnums::CellsAlreadyInitialized));
+    assert((CA_random.setup_sparse(false) == CAEnums::CellsAlreadyInitialized));
+    assert((CA_random.init_condition(1, 0.1) == 0));
+    long num_occupied = count_occupied_cells(CA_random);
+    assert((num_occupied > 64 * 64 * 64 / 12 && num_occupied < 64 * 64 * 64 / 8));
+    CA_random.setup_rule(CAEnums::Custom);
+    assert((CA_random.step() == CAEnums::CustomRuleIsNull));
+    int outside[3] = {1, 64, 3};
+    assert((CA_random.set_cell(outside, 1) == CAEnums::InvalidDimensions && CA_random.get_cell(outside) == 0));
+    assert((CA_random.set_cell(cell_index, 2) == 0 && CA_random.get_cell(cell_index) == 2));
+
+    // the same cell access on a dense grid
+    CellularAutomata<int> CA_plain = CellularAutomata<int>();
+    assert((CA_plain.setup_dimensions_3d(4, 5, 6) == 0));
+    assert((CA_plain.set_cell(cell_index, 2) == 0 && CA_plain.get_cell(cell_index) == 2));
+    assert((CA_plain.set_cell(outside, 1) == CAEnums::InvalidDimensions && CA_plain.get_cell(outside) == 0));
+    assert((count_occupied_cells(CA_plain) == 1 && CA_plain.get_tensor()[1][2][3] == 2));
+    assert((CA_plain.get_num_bricks() == 0));
+
+    // emptied bricks are dropped by the next step
+    CellularAutomata<int> CA_empty = CellularAutomata<int>();
+    assert((CA_empty.setup_sparse(true) == 0));
+    assert((CA_empty.setup_dimensions_2d(40, 40) == 0));
+    CA_empty.setup_rule(CAEnums::Custom);
+    assert((CA_empty.set_cell(cell_index, 1) == 0 && CA_empty.set_cell(cell_index, 0) == 0));
+    assert((CA_empty.get_num_bricks() == 1 && count_occupied_cells(CA_empty) == 0));
+    assert((CA_empty.step(weighted_sum_rule) == 0 && CA_empty.get_num_bricks() == 0));
+    print_success("test_sparse_grid");
+}
+
+int main()
+{
+    test_grid_view();
+    test_periodic_steps();
+    test_bounded_steps();
+    test_custom_rule_moves_cells();
+    test_neighborhood_view_rule();
+    test_neighborhood_stencil();
+    test_ghost_cells();
+    test_totalistic_rule();
+    test_window_blocks();
+    test_packed_binary_steps();
+    test_narrow_cell_states();
+    test_simd_levels();
+    test_lambda_rules();
+    test_stencil_kernels();
+    test_rule_table();
+    test_tiled_steps();
+    test_tile_scheduler();
+    test_runtime_concurrency();
+    test_first_touch_and_pinning();
+    test_parallel_error_codes();
+    test_step_n();
+    test_in_place_steps();
+    test_activity_tracking();
+    test_sparse_grid();
+    return 0;
+}
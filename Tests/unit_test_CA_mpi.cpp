@@ -0,0 +1,438 @@
+/**
+ * @file unit_test_CA_mpi.cpp
+ * @author agent (agent@local)
+ *
+ * <b>Contributor(s)</b> <br> &emsp;&emsp;
+ * @brief The program contains unit tests of grids split across MPI processes (see setup_mpi).
+ * Every process steps its slabs of the split grid and a whole copy of the grid, and checks that
+ * its slabs match. Run with mpirun -np N (1 to 4 processes).
+ * @date 2026-10-16
+ */
+
+#include "CAdatatypes.h"
+#include <mpi.h>
+#include <cassert>
+#include <cstdio>   // remove
+#include <cstdlib>  // mkdtemp
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h> // mkdir
+#include <unistd.h>   // chdir, rmdir
+
+// first axis size used by move_down_rule
+const int MOVE_AXIS_DIM = 12;
+
+int comm_rank = 0;
+int comm_size = 1;
+
+/**
+ * @brief Prints that a specific test passed (once, from the first process).
+ *
+ * @param message the test function name
+ */
+void print_success(std::string message)
+{
+    if (comm_rank == 0)
+    {
+        std::cout << "TEST PASSED: " << message << " (" << comm_size << " processes)\n";
+    }
+}
+
+/**
+ * @brief Initial state of a cell from its position in the whole grid (row-major),
+ * so every process fills its slabs without sharing a random sequence.
+ *
+ * @param n position of the cell in the whole grid
+ * @return int cell state (0, 1 or 2)
+ */
+int initial_state(long n)
+{
+    return ((unsigned long)(n + 1) * 2654435761UL >> 11) % 3;
+}
+
+/**
+ * @brief Get cell n of slab i (cells sharing index i along the first axis) of a grid.
+ *
+ * @param view the grid
+ * @param i slab index
+ * @param n position of the cell in the slab
+ * @return int&
+ */
+int &slab_cell(const GridView<int> &view, int i, long n)
+{
+    switch (view.rank())
+    {
+    case 1:
+        return view(i);
+    case 2:
+        return view(i, n);
+    default:
+        return view(i, n / view.extent(2), n % view.extent(2));
+    }
+}
+
+/**
+ * @brief Sets up a grid, split across every process or not, with the cell states of initial_state.
+ *
+ * @param CA the CellularAutomata instance
+ * @param dims dimensions of the whole grid
+ * @param split split the grid across the processes
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ */
+void setup_grid(CellularAutomata<int> &CA, const std::vector<int> &dims, bool split, CAEnums::Boundary bt,
+                int radius, CAEnums::Neighborhood nt, CAEnums::Rule rule)
+{
+    CA.setup_cell_states(3);
+    if (split)
+    {
+        assert((CA.setup_mpi(MPI_COMM_WORLD) == 0));
+    }
+    switch (dims.size())
+    {
+    case 1:
+        assert((CA.setup_dimensions_1d(dims[0]) == 0));
+        break;
+    case 2:
+        assert((CA.setup_dimensions_2d(dims[0], dims[1]) == 0));
+        break;
+    case 3:
+        assert((CA.setup_dimensions_3d(dims[0], dims[1], dims[2]) == 0));
+        break;
+    }
+    long slab_size = 1;
+    for (int axis = 1; axis < (int)dims.size(); axis++)
+    {
+        slab_size *= dims[axis];
+    }
+    int local_begin, local_end, global_begin;
+    CA.get_owned_slabs(local_begin, local_end, global_begin);
+    GridView<int> view = CA.get_view();
+    for (int i = local_begin; i < local_end; i++)
+    {
+        for (long n = 0; n < slab_size; n++)
+        {
+            slab_cell(view, i, n) = initial_state((global_begin + i - local_begin) * slab_size + n);
+        }
+    }
+    assert((CA.setup_boundary(bt, radius) == 0));
+    CA.setup_neighborhood(nt);
+    CA.setup_rule(rule);
+}
+
+/**
+ * @brief Checks that this process' slabs of a split grid match the same slabs of the whole grid.
+ *
+ * @param CA_split grid split across the processes
+ * @param CA whole grid
+ */
+void check_owned_slabs(CellularAutomata<int> &CA_split, CellularAutomata<int> &CA)
+{
+    GridView<int> split_view = CA_split.get_view();
+    GridView<int> view = CA.get_view();
+    long slab_size = view.size() / view.extent(0);
+    int local_begin, local_end, global_begin;
+    CA_split.get_owned_slabs(local_begin, local_end, global_begin);
+    for (int i = local_begin; i < local_end; i++)
+    {
+        for (long n = 0; n < slab_size; n++)
+        {
+            assert((slab_cell(split_view, i, n) == slab_cell(view, global_begin + i - local_begin, n)));
+        }
+    }
+}
+
+/**
+ * @brief Steps a split grid and the whole grid three times and compares this process' slabs after every step.
+ *
+ * @tparam Step callable stepping a CellularAutomata instance and returning its error code
+ * @param dims dimensions of the whole grid
+ * @param bt boundary type
+ * @param radius neighborhood radius
+ * @param nt neighborhood type
+ * @param rule rule type
+ * @param ghost_cells pad the split grid with ghost layers
+ * @param in_place update the split grid in place
+ * @param step steps a grid
+ */
+template <typename Step>
+void check_split_matches_whole(const std::vector<int> &dims, CAEnums::Boundary bt, int radius,
+                               CAEnums::Neighborhood nt, CAEnums::Rule rule, bool ghost_cells, bool in_place,
+                               Step step)
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    setup_grid(CA, dims, false, bt, radius, nt, rule);
+    CellularAutomata<int> CA_split = CellularAutomata<int>();
+    setup_grid(CA_split, dims, true, bt, radius, nt, rule);
+    assert((CA_split.setup_ghost_cells(ghost_cells) == 0));
+    assert((CA_split.setup_in_place(in_place) == 0));
+    for (int n = 0; n < 3; n++)
+    {
+        assert((step(CA) == 0));
+        assert((step(CA_split) == 0));
+        check_owned_slabs(CA_split, CA);
+    }
+}
+
+/**
+ * @brief Custom rule that sets non-empty cells to the weighted neighborhood sum modulo 2 plus one.
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood_cells array of neighboring cells
+ * @param neighborhood_size size of neighborhood_cells array
+ * @param new_cell_state reference to the new cell state
+ */
+void weighted_sum_rule(int *cell_index, const int index_size,
+                       int *neighborhood_cells, const int neighborhood_size,
+                       int &new_cell_state)
+{
+    if (new_cell_state == 0)
+    {
+        return;
+    }
+    int sum = 0;
+    for (int n = 0; n < neighborhood_size; n++)
+    {
+        sum += (n + 1) * neighborhood_cells[n];
+    }
+    new_cell_state = 1 + sum % 2;
+}
+
+/**
+ * @brief weighted_sum_rule written against the NeighborhoodView API, also weighted by the cell's first index.
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood view of the neighboring cells
+ * @param new_cell_state reference to the new cell state
+ */
+void indexed_view_rule(int *cell_index, const int index_size,
+                       const NeighborhoodView<int> &neighborhood,
+                       int &new_cell_state)
+{
+    int sum = cell_index[0];
+    for (int n = 0; n < neighborhood.size(); n++)
+    {
+        sum += (n + 1) * neighborhood[n];
+    }
+    new_cell_state = sum % 3;
+}
+
+/**
+ * @brief Totalistic rule: a cell lives when its neighborhood sum is a third to three quarters of the neighborhood size.
+ *
+ * @param sum sum of the neighborhood's states (cell of interest included)
+ * @param neighborhood_size number of cells in the neighborhood
+ * @param new_cell_state reference to the new cell state
+ */
+void third_to_half_rule(int sum, int neighborhood_size, int &new_cell_state)
+{
+    new_cell_state = 3 * sum >= neighborhood_size && 4 * sum <= 3 * neighborhood_size ? 1 + sum % 2 : 0;
+}
+
+/**
+ * @brief Custom rule that moves every non-empty cell one slab down the first axis (periodic grids).
+ *
+ * @param cell_index array of cell indices that we are going to update it state for
+ * @param index_size number of indices need to address the cell
+ * @param neighborhood_cells array of neighboring cells
+ * @param neighborhood_size size of neighborhood_cells array
+ * @param new_cell_state reference to the new cell state
+ */
+void move_down_rule(int *cell_index, const int index_size,
+                    int *neighborhood_cells, const int neighborhood_size,
+                    int &new_cell_state)
+{
+    if (new_cell_state != 0)
+    {
+        cell_index[0] = (cell_index[0] + 1) % MOVE_AXIS_DIM;
+    }
+}
+
+/**
+ * @brief Tests that split grids give the cells of the whole grid for every rank, boundary, radius and
+ * neighborhood type with array, view, lambda and totalistic rules, Parity, Majority, ghost cells and
+ * in place updates.
+ */
+void test_split_steps()
+{
+    auto array_step = [](CellularAutomata<int> &CA)
+    { return CA.step(weighted_sum_rule); };
+    auto view_step = [](CellularAutomata<int> &CA)
+    { return CA.step(indexed_view_rule); };
+    auto totalistic_step = [](CellularAutomata<int> &CA)
+    { return CA.step(third_to_half_rule); };
+    auto lambda_step = [](CellularAutomata<int> &CA)
+    {
+        return CA.step([](int *cell_index, const int index_size, int *neighborhood_cells,
+                          const int neighborhood_size, int &new_cell_state)
+                       { new_cell_state = (neighborhood_size + neighborhood_cells[0] + cell_index[0]) % 3; });
+    };
+    auto rule_step = [](CellularAutomata<int> &CA)
+    { return CA.step(); };
+
+    CAEnums::Boundary boundaries[3] = {CAEnums::Periodic, CAEnums::CutOff, CAEnums::Walled};
+    CAEnums::Neighborhood neighborhoods[2] = {CAEnums::Moore, CAEnums::VonNeumann};
+    for (auto bt : boundaries)
+    {
+        for (const auto &dims : std::vector<std::vector<int>>{{40}, {13, 9}, {9, 5, 6}})
+        {
+            for (int radius : {1, 2})
+            {
+                for (auto nt : neighborhoods)
+                {
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, false, false, array_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, true, false, view_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, false, false, totalistic_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, false, false, lambda_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Parity, true, false, rule_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Majority, false, false, rule_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, false, true, array_step);
+                    check_split_matches_whole(dims, bt, radius, nt, CAEnums::Custom, true, true, view_step);
+                }
+            }
+        }
+    }
+    print_success("test_split_steps");
+}
+
+/**
+ * @brief Tests rule tables, step_n and rules moving cells into other processes' slabs on split grids.
+ */
+void test_split_rule_table_and_moves()
+{
+    auto table_step = [](CellularAutomata<int> &CA)
+    {
+        assert((CA.setup_rule_table(weighted_sum_rule, 3) == 0));
+        return CA.step();
+    };
+    auto step_n = [](CellularAutomata<int> &CA)
+    { return CA.step_n(3, weighted_sum_rule); };
+    auto move_step = [](CellularAutomata<int> &CA)
+    { return CA.step(move_down_rule); };
+    check_split_matches_whole({16, 20}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, false, false, table_step);
+    check_split_matches_whole({12, 9, 10}, CAEnums::CutOff, 1, CAEnums::Moore, CAEnums::Custom, false, false, step_n);
+    check_split_matches_whole({MOVE_AXIS_DIM, 7}, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom, false, false,
+                              move_step);
+    check_split_matches_whole({MOVE_AXIS_DIM, 4, 5}, CAEnums::Periodic, 2, CAEnums::VonNeumann, CAEnums::Custom, true,
+                              false, move_step);
+    print_success("test_split_rule_table_and_moves");
+}
+
+/**
+ * @brief Tests the errors of grids that can't be split and of setup_mpi after the grid was set up.
+ */
+void test_split_errors()
+{
+    CellularAutomata<int> CA = CellularAutomata<int>();
+    assert((CA.setup_dimensions_2d(8, 8) == 0));
+    assert((CA.setup_mpi(MPI_COMM_WORLD) == CAEnums::CellsAlreadyInitialized));
+
+    if (comm_size > 1)
+    {
+        // fewer slabs than processes
+        CellularAutomata<int> CA_small = CellularAutomata<int>();
+        assert((CA_small.setup_mpi(MPI_COMM_WORLD) == 0));
+        assert((CA_small.setup_dimensions_2d(comm_size - 1, 8) == CAEnums::InvalidDecomposition));
+    }
+    if (comm_size > 2)
+    {
+        // blocks of a single slab can't hold halos of two slabs
+        CellularAutomata<int> CA_thin = CellularAutomata<int>();
+        setup_grid(CA_thin, {2 * comm_size - 1, 8}, true, CAEnums::Periodic, 2, CAEnums::Moore, CAEnums::Custom);
+        assert((CA_thin.step(weighted_sum_rule) == CAEnums::InvalidDecomposition));
+    }
+    print_success("test_split_errors");
+}
+
+/**
+ * @brief Reads a whole file.
+ *
+ * @param path file path
+ * @return std::string the file's content
+ */
+std::string read_file(const std::string &path)
+{
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+/**
+ * @brief Tests that the first process logs and prints split grids like the whole grid.
+ * Expects the first process to be the only one with a Data directory.
+ */
+void test_split_log_and_print()
+{
+    for (const auto &dims : std::vector<std::vector<int>>{{40}, {13, 9}, {9, 5, 6}})
+    {
+        std::stringstream split_output;
+        std::streambuf *cout_buffer = std::cout.rdbuf(split_output.rdbuf());
+        CellularAutomata<int> CA_split = CellularAutomata<int>();
+        setup_grid(CA_split, dims, true, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom);
+        for (int n = 0; n < 3; n++)
+        {
+            assert((CA_split.step(weighted_sum_rule) == 0));
+        }
+        assert((CA_split.print_grid() == 0));
+        std::cout.rdbuf(cout_buffer);
+        if (comm_rank != 0)
+        {
+            assert((split_output.str().empty()));
+            continue;
+        }
+        std::string split_log = read_file(FILE_PATH);
+
+        std::stringstream output;
+        cout_buffer = std::cout.rdbuf(output.rdbuf());
+        CellularAutomata<int> CA = CellularAutomata<int>();
+        setup_grid(CA, dims, false, CAEnums::Periodic, 1, CAEnums::Moore, CAEnums::Custom);
+        for (int n = 0; n < 3; n++)
+        {
+            assert((CA.step(weighted_sum_rule) == 0));
+        }
+        assert((CA.print_grid() == 0));
+        std::cout.rdbuf(cout_buffer);
+        assert((split_output.str() == output.str()));
+        assert((split_log == read_file(FILE_PATH)));
+    }
+    print_success("test_split_log_and_print");
+}
+
+int main(int argc, char **argv)
+{
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    // every process logs into its own directory; only the first one has a Data directory
+    char directory[] = "/tmp/unit_test_CA_mpi_XXXXXX";
+    assert((mkdtemp(directory) != nullptr));
+    assert((chdir(directory) == 0));
+
+    test_split_steps();
+    test_split_rule_table_and_moves();
+    test_split_errors();
+    if (comm_rank == 0)
+    {
+        assert((mkdir("Data", 0755) == 0));
+    }
+    test_split_log_and_print();
+
+    if (comm_rank == 0)
+    {
+        std::remove(FILE_PATH.c_str());
+        rmdir("Data");
+    }
+    rmdir(directory);
+    MPI_Finalize();
+    return 0;
+}
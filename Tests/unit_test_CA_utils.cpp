@@ -13,6 +13,7 @@
 #include <iostream>
 #include <vector>
 #include <utility> // pair
+#include <algorithm> // max
 
 /**
  * @brief Prints that a specific test passed.
@@ -231,6 +232,144 @@ void test_get_periodic_index()
     print_success("test_get_periodic_index");
 }
 
+/**
+ * @brief Tests the correctness of the MajorityHistogram class and get_binary_majority_state.
+ */
+void test_majority_histogram()
+{
+    // votes; expected majority state
+    std::vector<std::pair<std::vector<int>, int>> tests = {
+        {{0, 1, 1, 2}, 1}, {{2, 2, 0, 0}, 2}, {{0, 0, 0}, 0}, {{}, 2}, {{-1, 3, 7, 0}, 0}};
+    for (const auto &test : tests)
+    {
+        MajorityHistogram votes(3, nullptr);
+        for (int state : test.first)
+        {
+            votes.vote(state);
+        }
+        assert((votes.majority_state() == test.second));
+    }
+
+    // more states than fit on the stack are counted in the given array
+    std::vector<int> heap_votes(MAJORITY_STACK_STATES + 10, -1);
+    MajorityHistogram large_votes(MAJORITY_STACK_STATES + 10, heap_votes.data());
+    large_votes.vote(MAJORITY_STACK_STATES + 5);
+    large_votes.vote(MAJORITY_STACK_STATES + 5);
+    large_votes.vote(3);
+    assert((large_votes.majority_state() == MAJORITY_STACK_STATES + 5));
+    assert((heap_votes[MAJORITY_STACK_STATES + 5] == 2 && heap_votes[0] == 0));
+
+    assert((get_binary_majority_state(3, 2) == 1));
+    assert((get_binary_majority_state(2, 2) == 1));
+    assert((get_binary_majority_state(1, 4) == 0));
+    print_success("test_majority_histogram");
+}
+
+/**
+ * @brief Tests the correctness of the SIMD array kernels at every supported SIMD level (with scalar tails).
+ */
+void test_simd_kernels()
+{
+    int supported_level = set_simd_level(SimdAVX512);
+    assert((get_simd_level() == supported_level));
+    // every vector width plus a scalar tail
+    for (int level = SimdScalar; level <= supported_level; level++)
+    {
+        assert((set_simd_level(level) == level));
+        for (long size : {0L, 3L, 16L, 37L})
+        {
+            std::vector<int> a(size), b(size), c(size), out(size);
+            for (long n = 0; n < size; n++)
+            {
+                a[n] = (int)(n * 7919 % 201) - 100; // negative values too
+                b[n] = (int)(n * 104729 % 13);
+                c[n] = (int)(n % 5);
+            }
+
+            simd_add_arrays(out.data(), a.data(), b.data(), size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out[n] == a[n] + b[n]));
+            }
+            simd_sub_arrays(out.data(), a.data(), b.data(), size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out[n] == a[n] - b[n]));
+            }
+            simd_add_sub_arrays(out.data(), a.data(), b.data(), c.data(), size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out[n] == a[n] + b[n] - c[n]));
+            }
+            for (int divisor : {1, 2, 3, 7})
+            {
+                simd_remainder_array(out.data(), a.data(), divisor, size);
+                for (long n = 0; n < size; n++)
+                {
+                    assert((out[n] == a[n] % divisor));
+                }
+            }
+            simd_match_state_array(out.data(), c.data(), 2, size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out[n] == (c[n] == 2)));
+            }
+
+            // ties go to the last voted state
+            std::vector<int> best_votes(size, -1), best_states(size, -1);
+            simd_vote_state_array(best_votes.data(), best_states.data(), c.data(), 0, size);
+            simd_vote_state_array(best_votes.data(), best_states.data(), b.data(), 1, size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((best_votes[n] == std::max(b[n], c[n])));
+                assert((best_states[n] == (b[n] >= c[n] ? 1 : 0)));
+            }
+
+            // uint16_t lanes: sums wrap modulo 65536
+            std::vector<uint16_t> a16(size), b16(size), c16(size), out16(size);
+            for (long n = 0; n < size; n++)
+            {
+                a16[n] = (uint16_t)(n * 7919 % 65536); // large values too
+                b16[n] = (uint16_t)(n * 104729 % 13);
+                c16[n] = (uint16_t)(n % 5);
+            }
+            simd_add_arrays(out16.data(), a16.data(), a16.data(), size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out16[n] == (uint16_t)(a16[n] + a16[n])));
+            }
+            simd_add_sub_arrays(out16.data(), b16.data(), c16.data(), a16.data(), size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out16[n] == (uint16_t)(b16[n] + c16[n] - a16[n])));
+            }
+            for (int divisor : {1, 2, 3, 7, 65535})
+            {
+                simd_remainder_array(out16.data(), a16.data(), divisor, size);
+                for (long n = 0; n < size; n++)
+                {
+                    assert((out16[n] == a16[n] % divisor));
+                }
+            }
+            simd_match_state_array(out16.data(), c16.data(), 2, size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((out16[n] == (c16[n] == 2)));
+            }
+            std::vector<uint16_t> best_votes16(size, 0), best_states16(size, 0);
+            simd_vote_state_array(best_votes16.data(), best_states16.data(), c16.data(), 3, size);
+            simd_vote_state_array(best_votes16.data(), best_states16.data(), b16.data(), 4, size);
+            for (long n = 0; n < size; n++)
+            {
+                assert((best_votes16[n] == std::max(b16[n], c16[n])));
+                assert((best_states16[n] == (b16[n] >= c16[n] ? 4 : 3)));
+            }
+        }
+    }
+    set_simd_level(supported_level);
+    print_success("test_simd_kernels");
+}
+
 int main()
 {
     // ensure the methods work for various neighborhood radii
@@ -246,6 +385,8 @@ int main()
     test_is_diagonal_neighboring_cell_2d();
     test_is_diagonal_neighboring_cell_3d();
     test_get_periodic_index();
+    test_majority_histogram();
+    test_simd_kernels();
 
     return 0;
 }
@@ -15,6 +15,15 @@
 #include <map>
 #include <sstream>
 #include <fstream>
+#include <algorithm> // min, max
+#include <atomic>
+#ifdef __linux__
+#include <sched.h> // sched_getaffinity, sched_setaffinity
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CA_X86_KERNELS // SSE4.2/AVX2/AVX-512 kernels compiled with target attributes
+#include <immintrin.h>
+#endif
 
 bool is_diagonal_neighboring_cell_2d(int i, int j)
 {
@@ -285,3 +294,719 @@ void get_density(std::ifstream &data, std::ofstream &result)
         }
     }
 }
+
+namespace
+{
+// Scalar kernels: used when the CPU has no supported vector extension and for the tails of the vector kernels
+
+void add_arrays_scalar(int *out, const int *a, const int *b, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = a[n] + b[n];
+    }
+}
+
+void sub_arrays_scalar(int *out, const int *a, const int *b, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = a[n] - b[n];
+    }
+}
+
+void add_sub_arrays_scalar(int *out, const int *a, const int *b, const int *c, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = a[n] + b[n] - c[n];
+    }
+}
+
+void remainder_array_scalar(int *out, const int *in, int divisor, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = in[n] % divisor;
+    }
+}
+
+void match_state_array_scalar(int *out, const int *in, int state, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = in[n] == state;
+    }
+}
+
+void vote_state_array_scalar(int *best_votes, int *best_states, const int *votes, int state, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        if (votes[n] >= best_votes[n])
+        {
+            best_votes[n] = votes[n];
+            best_states[n] = state;
+        }
+    }
+}
+
+// uint16_t lanes: sums wrap modulo 65536 like the vector kernels
+
+void add_arrays_u16_scalar(uint16_t *out, const uint16_t *a, const uint16_t *b, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = (uint16_t)(a[n] + b[n]);
+    }
+}
+
+void add_sub_arrays_u16_scalar(uint16_t *out, const uint16_t *a, const uint16_t *b, const uint16_t *c, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = (uint16_t)(a[n] + b[n] - c[n]);
+    }
+}
+
+void remainder_array_u16_scalar(uint16_t *out, const uint16_t *in, int divisor, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = (uint16_t)(in[n] % divisor);
+    }
+}
+
+void match_state_array_u16_scalar(uint16_t *out, const uint16_t *in, int state, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        out[n] = in[n] == state;
+    }
+}
+
+void vote_state_array_u16_scalar(uint16_t *best_votes, uint16_t *best_states, const uint16_t *votes, int state, long size)
+{
+    for (long n = 0; n < size; n++)
+    {
+        if (votes[n] >= best_votes[n])
+        {
+            best_votes[n] = votes[n];
+            best_states[n] = (uint16_t)state;
+        }
+    }
+}
+
+#ifdef CA_X86_KERNELS
+// Vector kernels. Remainders divide in double precision, which is exact for every int
+// dividend and divisor once truncated, and then subtract quotient * divisor.
+
+// SSE4.2: 4 ints per register
+
+__attribute__((target("sse4.2"))) void add_arrays_sse42(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_add_epi32(x, y));
+    }
+    add_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("sse4.2"))) void sub_arrays_sse42(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_sub_epi32(x, y));
+    }
+    sub_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("sse4.2"))) void add_sub_arrays_sse42(int *out, const int *a, const int *b, const int *c, long size)
+{
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + n));
+        __m128i z = _mm_loadu_si128((const __m128i *)(c + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_sub_epi32(_mm_add_epi32(x, y), z));
+    }
+    add_sub_arrays_scalar(out + n, a + n, b + n, c + n, size - n);
+}
+
+__attribute__((target("sse4.2"))) void remainder_array_sse42(int *out, const int *in, int divisor, long size)
+{
+    __m128d divisor_pd = _mm_set1_pd(divisor);
+    __m128i divisor_epi32 = _mm_set1_epi32(divisor);
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + n));
+        __m128i low = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(x), divisor_pd));
+        __m128i high = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xEE)), divisor_pd));
+        __m128i quotient = _mm_unpacklo_epi64(low, high);
+        _mm_storeu_si128((__m128i *)(out + n), _mm_sub_epi32(x, _mm_mullo_epi32(quotient, divisor_epi32)));
+    }
+    remainder_array_scalar(out + n, in + n, divisor, size - n);
+}
+
+__attribute__((target("sse4.2"))) void match_state_array_sse42(int *out, const int *in, int state, long size)
+{
+    __m128i state_epi32 = _mm_set1_epi32(state);
+    __m128i one = _mm_set1_epi32(1);
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_and_si128(_mm_cmpeq_epi32(x, state_epi32), one));
+    }
+    match_state_array_scalar(out + n, in + n, state, size - n);
+}
+
+__attribute__((target("sse4.2"))) void vote_state_array_sse42(int *best_votes, int *best_states, const int *votes, int state, long size)
+{
+    __m128i state_epi32 = _mm_set1_epi32(state);
+    long n = 0;
+    for (; n + 4 <= size; n += 4)
+    {
+        __m128i best = _mm_loadu_si128((const __m128i *)(best_votes + n));
+        __m128i best_state = _mm_loadu_si128((const __m128i *)(best_states + n));
+        __m128i x = _mm_loadu_si128((const __m128i *)(votes + n));
+        __m128i keep = _mm_cmpgt_epi32(best, x); // lanes whose best votes stay
+        _mm_storeu_si128((__m128i *)(best_votes + n), _mm_blendv_epi8(x, best, keep));
+        _mm_storeu_si128((__m128i *)(best_states + n), _mm_blendv_epi8(state_epi32, best_state, keep));
+    }
+    vote_state_array_scalar(best_votes + n, best_states + n, votes + n, state, size - n);
+}
+
+// SSE4.2: 8 uint16_t lanes per register. Remainders divide in single precision, which is exact
+// once truncated since every dividend and quotient * divisor stays below 2^24.
+
+__attribute__((target("sse4.2"))) void add_arrays_u16_sse42(uint16_t *out, const uint16_t *a, const uint16_t *b, long size)
+{
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_add_epi16(x, y));
+    }
+    add_arrays_u16_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("sse4.2"))) void add_sub_arrays_u16_sse42(uint16_t *out, const uint16_t *a, const uint16_t *b,
+                                                                const uint16_t *c, long size)
+{
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + n));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + n));
+        __m128i z = _mm_loadu_si128((const __m128i *)(c + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_sub_epi16(_mm_add_epi16(x, y), z));
+    }
+    add_sub_arrays_u16_scalar(out + n, a + n, b + n, c + n, size - n);
+}
+
+__attribute__((target("sse4.2"))) __m128i remainder_epi32_sse42(__m128i x, __m128 divisor_ps, __m128i divisor_epi32)
+{
+    __m128i quotient = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(x), divisor_ps));
+    return _mm_sub_epi32(x, _mm_mullo_epi32(quotient, divisor_epi32));
+}
+
+__attribute__((target("sse4.2"))) void remainder_array_u16_sse42(uint16_t *out, const uint16_t *in, int divisor, long size)
+{
+    __m128 divisor_ps = _mm_set1_ps((float)divisor);
+    __m128i divisor_epi32 = _mm_set1_epi32(divisor);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + n));
+        __m128i low = remainder_epi32_sse42(_mm_cvtepu16_epi32(x), divisor_ps, divisor_epi32);
+        __m128i high = remainder_epi32_sse42(_mm_cvtepu16_epi32(_mm_srli_si128(x, 8)), divisor_ps, divisor_epi32);
+        _mm_storeu_si128((__m128i *)(out + n), _mm_packus_epi32(low, high));
+    }
+    remainder_array_u16_scalar(out + n, in + n, divisor, size - n);
+}
+
+__attribute__((target("sse4.2"))) void match_state_array_u16_sse42(uint16_t *out, const uint16_t *in, int state, long size)
+{
+    __m128i state_epi16 = _mm_set1_epi16((short)state);
+    __m128i one = _mm_set1_epi16(1);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + n));
+        _mm_storeu_si128((__m128i *)(out + n), _mm_and_si128(_mm_cmpeq_epi16(x, state_epi16), one));
+    }
+    match_state_array_u16_scalar(out + n, in + n, state, size - n);
+}
+
+__attribute__((target("sse4.2"))) void vote_state_array_u16_sse42(uint16_t *best_votes, uint16_t *best_states,
+                                                                  const uint16_t *votes, int state, long size)
+{
+    __m128i state_epi16 = _mm_set1_epi16((short)state);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m128i best = _mm_loadu_si128((const __m128i *)(best_votes + n));
+        __m128i best_state = _mm_loadu_si128((const __m128i *)(best_states + n));
+        __m128i x = _mm_loadu_si128((const __m128i *)(votes + n));
+        __m128i take = _mm_cmpeq_epi16(_mm_max_epu16(x, best), x); // lanes whose state wins the vote
+        _mm_storeu_si128((__m128i *)(best_votes + n), _mm_blendv_epi8(best, x, take));
+        _mm_storeu_si128((__m128i *)(best_states + n), _mm_blendv_epi8(best_state, state_epi16, take));
+    }
+    vote_state_array_u16_scalar(best_votes + n, best_states + n, votes + n, state, size - n);
+}
+
+// AVX2: 8 ints per register
+
+__attribute__((target("avx2"))) void add_arrays_avx2(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + n));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_add_epi32(x, y));
+    }
+    add_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("avx2"))) void sub_arrays_avx2(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + n));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_sub_epi32(x, y));
+    }
+    sub_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("avx2"))) void add_sub_arrays_avx2(int *out, const int *a, const int *b, const int *c, long size)
+{
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + n));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + n));
+        __m256i z = _mm256_loadu_si256((const __m256i *)(c + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_sub_epi32(_mm256_add_epi32(x, y), z));
+    }
+    add_sub_arrays_scalar(out + n, a + n, b + n, c + n, size - n);
+}
+
+__attribute__((target("avx2"))) void remainder_array_avx2(int *out, const int *in, int divisor, long size)
+{
+    __m256d divisor_pd = _mm256_set1_pd(divisor);
+    __m256i divisor_epi32 = _mm256_set1_epi32(divisor);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + n));
+        __m128i low = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), divisor_pd));
+        __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), divisor_pd));
+        __m256i quotient = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_sub_epi32(x, _mm256_mullo_epi32(quotient, divisor_epi32)));
+    }
+    remainder_array_scalar(out + n, in + n, divisor, size - n);
+}
+
+__attribute__((target("avx2"))) void match_state_array_avx2(int *out, const int *in, int state, long size)
+{
+    __m256i state_epi32 = _mm256_set1_epi32(state);
+    __m256i one = _mm256_set1_epi32(1);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_and_si256(_mm256_cmpeq_epi32(x, state_epi32), one));
+    }
+    match_state_array_scalar(out + n, in + n, state, size - n);
+}
+
+__attribute__((target("avx2"))) void vote_state_array_avx2(int *best_votes, int *best_states, const int *votes, int state, long size)
+{
+    __m256i state_epi32 = _mm256_set1_epi32(state);
+    long n = 0;
+    for (; n + 8 <= size; n += 8)
+    {
+        __m256i best = _mm256_loadu_si256((const __m256i *)(best_votes + n));
+        __m256i best_state = _mm256_loadu_si256((const __m256i *)(best_states + n));
+        __m256i x = _mm256_loadu_si256((const __m256i *)(votes + n));
+        __m256i keep = _mm256_cmpgt_epi32(best, x); // lanes whose best votes stay
+        _mm256_storeu_si256((__m256i *)(best_votes + n), _mm256_blendv_epi8(x, best, keep));
+        _mm256_storeu_si256((__m256i *)(best_states + n), _mm256_blendv_epi8(state_epi32, best_state, keep));
+    }
+    vote_state_array_scalar(best_votes + n, best_states + n, votes + n, state, size - n);
+}
+
+// AVX2: 16 uint16_t lanes per register
+
+__attribute__((target("avx2"))) void add_arrays_u16_avx2(uint16_t *out, const uint16_t *a, const uint16_t *b, long size)
+{
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + n));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_add_epi16(x, y));
+    }
+    add_arrays_u16_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("avx2"))) void add_sub_arrays_u16_avx2(uint16_t *out, const uint16_t *a, const uint16_t *b,
+                                                             const uint16_t *c, long size)
+{
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + n));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + n));
+        __m256i z = _mm256_loadu_si256((const __m256i *)(c + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_sub_epi16(_mm256_add_epi16(x, y), z));
+    }
+    add_sub_arrays_u16_scalar(out + n, a + n, b + n, c + n, size - n);
+}
+
+__attribute__((target("avx2"))) __m256i remainder_epi32_avx2(__m256i x, __m256 divisor_ps, __m256i divisor_epi32)
+{
+    __m256i quotient = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(x), divisor_ps));
+    return _mm256_sub_epi32(x, _mm256_mullo_epi32(quotient, divisor_epi32));
+}
+
+__attribute__((target("avx2"))) void remainder_array_u16_avx2(uint16_t *out, const uint16_t *in, int divisor, long size)
+{
+    __m256 divisor_ps = _mm256_set1_ps((float)divisor);
+    __m256i divisor_epi32 = _mm256_set1_epi32(divisor);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + n));
+        __m256i low = remainder_epi32_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)), divisor_ps, divisor_epi32);
+        __m256i high = remainder_epi32_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)), divisor_ps, divisor_epi32);
+        // packus interleaves the 128 bit halves of low and high; restore the lane order
+        __m256i packed = _mm256_packus_epi32(low, high);
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    remainder_array_u16_scalar(out + n, in + n, divisor, size - n);
+}
+
+__attribute__((target("avx2"))) void match_state_array_u16_avx2(uint16_t *out, const uint16_t *in, int state, long size)
+{
+    __m256i state_epi16 = _mm256_set1_epi16((short)state);
+    __m256i one = _mm256_set1_epi16(1);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + n));
+        _mm256_storeu_si256((__m256i *)(out + n), _mm256_and_si256(_mm256_cmpeq_epi16(x, state_epi16), one));
+    }
+    match_state_array_u16_scalar(out + n, in + n, state, size - n);
+}
+
+__attribute__((target("avx2"))) void vote_state_array_u16_avx2(uint16_t *best_votes, uint16_t *best_states,
+                                                               const uint16_t *votes, int state, long size)
+{
+    __m256i state_epi16 = _mm256_set1_epi16((short)state);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m256i best = _mm256_loadu_si256((const __m256i *)(best_votes + n));
+        __m256i best_state = _mm256_loadu_si256((const __m256i *)(best_states + n));
+        __m256i x = _mm256_loadu_si256((const __m256i *)(votes + n));
+        __m256i take = _mm256_cmpeq_epi16(_mm256_max_epu16(x, best), x); // lanes whose state wins the vote
+        _mm256_storeu_si256((__m256i *)(best_votes + n), _mm256_blendv_epi8(best, x, take));
+        _mm256_storeu_si256((__m256i *)(best_states + n), _mm256_blendv_epi8(best_state, state_epi16, take));
+    }
+    vote_state_array_u16_scalar(best_votes + n, best_states + n, votes + n, state, size - n);
+}
+
+// AVX-512: 16 ints per register. AVX-512F has no 16 bit lane instructions (those need AVX-512BW),
+// so the uint16_t kernels of this level are the AVX2 ones.
+
+__attribute__((target("avx512f"))) void add_arrays_avx512(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + n);
+        __m512i y = _mm512_loadu_si512(b + n);
+        _mm512_storeu_si512(out + n, _mm512_add_epi32(x, y));
+    }
+    add_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("avx512f"))) void sub_arrays_avx512(int *out, const int *a, const int *b, long size)
+{
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + n);
+        __m512i y = _mm512_loadu_si512(b + n);
+        _mm512_storeu_si512(out + n, _mm512_sub_epi32(x, y));
+    }
+    sub_arrays_scalar(out + n, a + n, b + n, size - n);
+}
+
+__attribute__((target("avx512f"))) void add_sub_arrays_avx512(int *out, const int *a, const int *b, const int *c, long size)
+{
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i x = _mm512_loadu_si512(a + n);
+        __m512i y = _mm512_loadu_si512(b + n);
+        __m512i z = _mm512_loadu_si512(c + n);
+        _mm512_storeu_si512(out + n, _mm512_sub_epi32(_mm512_add_epi32(x, y), z));
+    }
+    add_sub_arrays_scalar(out + n, a + n, b + n, c + n, size - n);
+}
+
+__attribute__((target("avx512f"))) void remainder_array_avx512(int *out, const int *in, int divisor, long size)
+{
+    __m512d divisor_pd = _mm512_set1_pd(divisor);
+    __m512i divisor_epi32 = _mm512_set1_epi32(divisor);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i x = _mm512_loadu_si512(in + n);
+        __m256i low = _mm512_cvttpd_epi32(_mm512_div_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(x)), divisor_pd));
+        __m256i high = _mm512_cvttpd_epi32(_mm512_div_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(x, 1)), divisor_pd));
+        __m512i quotient = _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+        _mm512_storeu_si512(out + n, _mm512_sub_epi32(x, _mm512_mullo_epi32(quotient, divisor_epi32)));
+    }
+    remainder_array_scalar(out + n, in + n, divisor, size - n);
+}
+
+__attribute__((target("avx512f"))) void match_state_array_avx512(int *out, const int *in, int state, long size)
+{
+    __m512i state_epi32 = _mm512_set1_epi32(state);
+    __m512i one = _mm512_set1_epi32(1);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i x = _mm512_loadu_si512(in + n);
+        _mm512_storeu_si512(out + n, _mm512_maskz_mov_epi32(_mm512_cmpeq_epi32_mask(x, state_epi32), one));
+    }
+    match_state_array_scalar(out + n, in + n, state, size - n);
+}
+
+__attribute__((target("avx512f"))) void vote_state_array_avx512(int *best_votes, int *best_states, const int *votes, int state, long size)
+{
+    __m512i state_epi32 = _mm512_set1_epi32(state);
+    long n = 0;
+    for (; n + 16 <= size; n += 16)
+    {
+        __m512i best = _mm512_loadu_si512(best_votes + n);
+        __m512i best_state = _mm512_loadu_si512(best_states + n);
+        __m512i x = _mm512_loadu_si512(votes + n);
+        __mmask16 take = _mm512_cmpge_epi32_mask(x, best); // lanes whose state wins the vote
+        _mm512_storeu_si512(best_votes + n, _mm512_mask_mov_epi32(best, take, x));
+        _mm512_storeu_si512(best_states + n, _mm512_mask_mov_epi32(best_state, take, state_epi32));
+    }
+    vote_state_array_scalar(best_votes + n, best_states + n, votes + n, state, size - n);
+}
+#endif
+
+/**
+ * @brief Kernels of one instruction set.
+ */
+struct SimdKernels
+{
+    void (*add_arrays)(int *, const int *, const int *, long);
+    void (*sub_arrays)(int *, const int *, const int *, long);
+    void (*add_sub_arrays)(int *, const int *, const int *, const int *, long);
+    void (*remainder_array)(int *, const int *, int, long);
+    void (*match_state_array)(int *, const int *, int, long);
+    void (*vote_state_array)(int *, int *, const int *, int, long);
+    void (*add_arrays_u16)(uint16_t *, const uint16_t *, const uint16_t *, long);
+    void (*add_sub_arrays_u16)(uint16_t *, const uint16_t *, const uint16_t *, const uint16_t *, long);
+    void (*remainder_array_u16)(uint16_t *, const uint16_t *, int, long);
+    void (*match_state_array_u16)(uint16_t *, const uint16_t *, int, long);
+    void (*vote_state_array_u16)(uint16_t *, uint16_t *, const uint16_t *, int, long);
+};
+
+int detect_simd_level()
+{
+#ifdef CA_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SimdAVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return SimdSSE42;
+    }
+#endif
+    return SimdScalar;
+}
+
+SimdKernels get_simd_kernels(int level)
+{
+    SimdKernels kernels = {add_arrays_scalar, sub_arrays_scalar, add_sub_arrays_scalar,
+                           remainder_array_scalar, match_state_array_scalar, vote_state_array_scalar,
+                           add_arrays_u16_scalar, add_sub_arrays_u16_scalar, remainder_array_u16_scalar,
+                           match_state_array_u16_scalar, vote_state_array_u16_scalar};
+#ifdef CA_X86_KERNELS
+    switch (level)
+    {
+    case SimdAVX512:
+        kernels = {add_arrays_avx512, sub_arrays_avx512, add_sub_arrays_avx512,
+                   remainder_array_avx512, match_state_array_avx512, vote_state_array_avx512,
+                   add_arrays_u16_avx2, add_sub_arrays_u16_avx2, remainder_array_u16_avx2,
+                   match_state_array_u16_avx2, vote_state_array_u16_avx2};
+        break;
+    case SimdAVX2:
+        kernels = {add_arrays_avx2, sub_arrays_avx2, add_sub_arrays_avx2,
+                   remainder_array_avx2, match_state_array_avx2, vote_state_array_avx2,
+                   add_arrays_u16_avx2, add_sub_arrays_u16_avx2, remainder_array_u16_avx2,
+                   match_state_array_u16_avx2, vote_state_array_u16_avx2};
+        break;
+    case SimdSSE42:
+        kernels = {add_arrays_sse42, sub_arrays_sse42, add_sub_arrays_sse42,
+                   remainder_array_sse42, match_state_array_sse42, vote_state_array_sse42,
+                   add_arrays_u16_sse42, add_sub_arrays_u16_sse42, remainder_array_u16_sse42,
+                   match_state_array_u16_sse42, vote_state_array_u16_sse42};
+        break;
+    }
+#endif
+    return kernels;
+}
+
+// selected once at program startup; kernels of every level are resolved up front so that
+// set_simd_level only swaps an atomic index that OpenMP workers read
+const int supported_simd_level = detect_simd_level();
+const SimdKernels level_simd_kernels[] = {get_simd_kernels(SimdScalar), get_simd_kernels(SimdSSE42),
+                                          get_simd_kernels(SimdAVX2), get_simd_kernels(SimdAVX512)};
+std::atomic<int> active_simd_level(supported_simd_level);
+
+inline const SimdKernels &active_simd_kernels()
+{
+    return level_simd_kernels[active_simd_level.load(std::memory_order_relaxed)];
+}
+} // namespace
+
+int get_simd_level()
+{
+    return active_simd_level.load(std::memory_order_relaxed);
+}
+
+int set_simd_level(int level)
+{
+    level = std::max((int)SimdScalar, std::min(level, supported_simd_level));
+    active_simd_level.store(level, std::memory_order_relaxed);
+    return level;
+}
+
+void simd_add_arrays(int *out, const int *a, const int *b, long size)
+{
+    active_simd_kernels().add_arrays(out, a, b, size);
+}
+
+void simd_sub_arrays(int *out, const int *a, const int *b, long size)
+{
+    active_simd_kernels().sub_arrays(out, a, b, size);
+}
+
+void simd_add_sub_arrays(int *out, const int *a, const int *b, const int *c, long size)
+{
+    active_simd_kernels().add_sub_arrays(out, a, b, c, size);
+}
+
+void simd_remainder_array(int *out, const int *in, int divisor, long size)
+{
+    active_simd_kernels().remainder_array(out, in, divisor, size);
+}
+
+void simd_match_state_array(int *out, const int *in, int state, long size)
+{
+    active_simd_kernels().match_state_array(out, in, state, size);
+}
+
+void simd_vote_state_array(int *best_votes, int *best_states, const int *votes, int state, long size)
+{
+    active_simd_kernels().vote_state_array(best_votes, best_states, votes, state, size);
+}
+
+void simd_add_arrays(uint16_t *out, const uint16_t *a, const uint16_t *b, long size)
+{
+    active_simd_kernels().add_arrays_u16(out, a, b, size);
+}
+
+void simd_add_sub_arrays(uint16_t *out, const uint16_t *a, const uint16_t *b, const uint16_t *c, long size)
+{
+    active_simd_kernels().add_sub_arrays_u16(out, a, b, c, size);
+}
+
+void simd_remainder_array(uint16_t *out, const uint16_t *in, int divisor, long size)
+{
+    active_simd_kernels().remainder_array_u16(out, in, divisor, size);
+}
+
+void simd_match_state_array(uint16_t *out, const uint16_t *in, int state, long size)
+{
+    active_simd_kernels().match_state_array_u16(out, in, state, size);
+}
+
+void simd_vote_state_array(uint16_t *best_votes, uint16_t *best_states, const uint16_t *votes, int state, long size)
+{
+    active_simd_kernels().vote_state_array_u16(best_votes, best_states, votes, state, size);
+}
+
+int get_cpu_sockets(std::vector<std::vector<int>> &sockets)
+{
+    sockets.clear();
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return 0;
+    }
+    std::map<int, std::vector<int>> socket_cpus; // socket id -> CPUs
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        int socket = 0; // single socket when the topology isn't exposed
+        std::ifstream package("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/physical_package_id");
+        package >> socket;
+        socket_cpus[socket].push_back(cpu);
+    }
+    for (const auto &socket : socket_cpus)
+    {
+        sockets.push_back(socket.second);
+    }
+#endif
+    return sockets.size();
+}
+
+bool pin_thread_to_cpus(const std::vector<int> &cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    return !cpus.empty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}